@@ -0,0 +1,146 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+
+/**
+ * \file    LWM2MBulkObserver.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Definition of a LWM2M Bulk Operation Observer.
+ *
+ */
+
+
+#ifndef __LWM2MBULKOBSERVER_H__
+#define __LWM2MBULKOBSERVER_H__
+#ifndef __DECL_LWM2MBULKOBSERVER_H__
+#define __DECL_LWM2MBULKOBSERVER_H__ extern
+#endif /* #ifndef __DECL_LWM2MBULKOBSERVER_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string>
+#include "LWM2MResourceObserver.h"
+
+/*
+ * --- Forward Declaration ----------------------------------------------------- *
+ */
+
+/* Forward declaration of the LWM2MBulkOperation class. */
+class LWM2MBulkOperation;
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief    Progress of a bulk operation.
+ */
+typedef struct
+{
+    /** Number of requests of the operation */
+    uint32_t total;
+    /** Number of requests waiting to be sent */
+    uint32_t pending;
+    /** Number of requests waiting for their answer */
+    uint32_t inFlight;
+    /** Number of requests that succeeded */
+    uint32_t succeeded;
+    /** Number of requests that failed */
+    uint32_t failed;
+
+} s_lwm2m_bulk_stats_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MBulkObserver Class.
+ *
+ *          A LWM2M Bulk Observer receives the result of every single
+ *          request of a bulk operation as soon as it is known and is
+ *          informed when the whole operation finished.
+ */
+class LWM2MBulkObserver
+{
+
+public:
+
+    /**
+     * \brief   Default constructor.
+     */
+    LWM2MBulkObserver( void ) {};
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MBulkObserver( void ) {};
+
+
+    /**
+     * \brief   Result of a single request.
+     *
+     * \param   p_op      The operation the request belongs to.
+     * \param   devName   Name of the device the request was sent to.
+     * \param   p_params  Parameters of the answer. The data field is
+     *                    not set.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    virtual int8_t result( const LWM2MBulkOperation* p_op,
+            const std::string& devName,
+            const s_lwm2m_obsparams_t* p_params ) = 0;
+
+
+    /**
+     * \brief   All requests of the operation finished.
+     *
+     * \param   p_op      The operation that finished.
+     * \param   p_stats   Final statistics of the operation.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    virtual int8_t done( const LWM2MBulkOperation* p_op,
+            const s_lwm2m_bulk_stats_t* p_stats ) = 0;
+
+};
+
+#endif /* #ifndef __LWM2MBULKOBSERVER_H__ */
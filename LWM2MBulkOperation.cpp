@@ -0,0 +1,452 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+
+/**
+ * \file    LWM2MBulkOperation.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of an operation on many LWM2M Devices.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string>
+#include "LWM2MBulkOperation.h"
+#include "LWM2MServer.h"
+#include "LWM2MDevice.h"
+#include "LWM2MObject.h"
+
+/* the CoAP implementation of wakaama has no C++ guards */
+extern "C" {
+#include "er-coap-13/er-coap-13.h"
+}
+
+/*
+ * --- Macro Definitions----------------------------------------------------- *
+ */
+
+/** Default number of requests waiting for their answer */
+#define LWM2M_BULK_DEF_MAXINFLIGHT              16
+/** Default time between sending two requests in ms */
+#define LWM2M_BULK_DEF_PACING                   0
+
+/** Status of an observation that was not answered yet */
+#define LWM2M_BULK_OBSERVE_PENDING              -1
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::LWM2MBulkOperation()
+*/
+LWM2MBulkOperation::LWM2MBulkOperation( e_lwm2m_bulk_op_t op, uint16_t objId,
+        uint16_t instId, uint16_t resId, const s_lwm2m_bulk_cfg_t* p_cfg )
+    : m_op( op )
+    , mp_srv( NULL )
+    , mp_observer( NULL )
+    , m_started( false )
+    , m_nextSend( 0 )
+    , m_finished( false )
+{
+    m_uri.objectId = objId;
+    m_uri.instanceId = instId;
+    m_uri.resourceId = resId;
+    m_uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID |
+            LWM2M_URI_FLAG_RESOURCE_ID;
+
+    m_cfg.maxInFlight = LWM2M_BULK_DEF_MAXINFLIGHT;
+    m_cfg.pacing = LWM2M_BULK_DEF_PACING;
+
+    if( p_cfg != NULL )
+    {
+        m_cfg = *p_cfg;
+
+        /* fall back to the defaults for invalid values */
+        if( m_cfg.maxInFlight == 0 )
+            m_cfg.maxInFlight = LWM2M_BULK_DEF_MAXINFLIGHT;
+    }
+
+    m_stats.total = 0;
+    m_stats.pending = 0;
+    m_stats.inFlight = 0;
+    m_stats.succeeded = 0;
+    m_stats.failed = 0;
+
+} /* LWM2MBulkOperation::LWM2MBulkOperation() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::~LWM2MBulkOperation()
+*/
+LWM2MBulkOperation::~LWM2MBulkOperation( void )
+{
+    /* the requests must not refer to the targets any longer */
+    if( mp_srv != NULL )
+        mp_srv->stopBulkOperation( this );
+
+} /* LWM2MBulkOperation::~LWM2MBulkOperation() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::addDevice()
+*/
+int16_t LWM2MBulkOperation::addDevice( const std::string& devName )
+{
+    if( m_started )
+        return -1;
+
+    m_devices.push_back( devName );
+    return 0;
+
+} /* LWM2MBulkOperation::addDevice() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::getStats()
+*/
+void LWM2MBulkOperation::getStats( s_lwm2m_bulk_stats_t* p_stats ) const
+{
+    *p_stats = m_stats;
+    p_stats->pending = m_pending.size();
+    p_stats->inFlight = m_inFlight.size();
+
+} /* LWM2MBulkOperation::getStats() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::start()
+*/
+int8_t LWM2MBulkOperation::start( LWM2MServer* p_srv )
+{
+    std::vector< std::string > devices;
+    std::vector< std::string >::const_iterator name;
+    std::map< std::string, LWM2MDevice* >::const_iterator dev;
+    std::vector< LWM2MObject* >::iterator obj;
+    s_target_t tgt;
+
+    if( m_started )
+        return -1;
+
+    /* use all devices that registered the object if none was given */
+    devices = m_devices;
+    if( devices.empty() )
+    {
+        std::vector< LWM2MDevice* > found;
+        std::vector< LWM2MDevice* >::const_iterator it;
+
+        p_srv->getDevicesByObject( m_uri.objectId, found );
+        for( it = found.begin(); it != found.end(); ++it )
+            devices.push_back( (*it)->getName() );
+    }
+
+    tgt.p_op = this;
+    tgt.p_params = NULL;
+    tgt.traceId = 0;
+
+    for( name = devices.begin(); name != devices.end(); ++name )
+    {
+        size_t cnt = m_targets.size();
+
+        tgt.devName = *name;
+        tgt.uri = m_uri;
+        tgt.p_res = NULL;
+
+        dev = p_srv->m_devMap.find( *name );
+        if( dev != p_srv->m_devMap.end() )
+        {
+            /* every registered instance that matches */
+            for( obj = dev->second->objectStart();
+                 obj != dev->second->objectEnd(); ++obj )
+            {
+                if( ((*obj)->getObjId() != m_uri.objectId) ||
+                    ((m_uri.instanceId != LWM2M_BULK_ALL_INSTANCES) &&
+                     ((*obj)->getInstId() != m_uri.instanceId)) )
+                    continue;
+
+                tgt.uri.instanceId = (*obj)->getInstId();
+                tgt.p_res = (*obj)->getResource( m_uri.resourceId );
+                m_targets.push_back( tgt );
+            }
+        }
+
+        /* devices given explicitly report a result in any case */
+        if( (cnt == m_targets.size()) && (!m_devices.empty()) )
+        {
+            tgt.uri.instanceId = m_uri.instanceId;
+            tgt.p_res = NULL;
+            m_targets.push_back( tgt );
+        }
+    }
+
+    std::list< s_target_t >::iterator it;
+    for( it = m_targets.begin(); it != m_targets.end(); ++it )
+        m_pending.push_back( &(*it) );
+
+    m_stats.total = m_targets.size();
+    m_started = true;
+    mp_srv = p_srv;
+    return 0;
+
+} /* LWM2MBulkOperation::start() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::step()
+*/
+void LWM2MBulkOperation::step( LWM2MServer* p_srv, uint64_t now )
+{
+    std::list< s_target_t* >::iterator it;
+    s_target_t* p_tgt;
+    int ret;
+
+    /* observations report their answer at the observed resource, the
+     * status of a notification is its counter */
+    for( it = m_inFlight.begin(); it != m_inFlight.end(); )
+    {
+        p_tgt = *it++;
+        if( (p_tgt->p_params == NULL) ||
+            (p_tgt->p_params->status == LWM2M_BULK_OBSERVE_PENDING) )
+            continue;
+
+        ret = p_tgt->p_params->status;
+        if( ret < COAP_400_BAD_REQUEST )
+        {
+            /* issued again after the device registered again */
+            p_srv->keepObservation( p_tgt->devName, &p_tgt->uri, true );
+            ret = COAP_205_CONTENT;
+        }
+        finish( p_tgt, p_tgt->p_params->clientID, ret,
+                p_tgt->p_params->format, NULL, 0 );
+    }
+
+    /* send further requests within the window */
+    while( (!m_pending.empty()) &&
+           (m_inFlight.size() < m_cfg.maxInFlight) && (now >= m_nextSend) )
+    {
+        p_tgt = m_pending.front();
+        m_pending.pop_front();
+        m_inFlight.push_back( p_tgt );
+
+        ret = sendTarget( p_srv, p_tgt );
+        if( ret != COAP_NO_ERROR )
+            finish( p_tgt, 0, ret, LWM2M_CONTENT_TEXT, NULL, 0 );
+        else
+            m_nextSend = now + m_cfg.pacing;
+    }
+
+    if( m_started && (!m_finished) && m_pending.empty() &&
+        m_inFlight.empty() )
+    {
+        m_finished = true;
+        if( mp_observer != NULL )
+        {
+            s_lwm2m_bulk_stats_t stats;
+            getStats( &stats );
+            mp_observer->done( this, &stats );
+        }
+    }
+
+} /* LWM2MBulkOperation::step() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::stop()
+*/
+void LWM2MBulkOperation::stop( LWM2MServer* p_srv )
+{
+    /* the callbacks of canceled requests finish the targets */
+    std::list< s_target_t* > inFlight( m_inFlight );
+    std::list< s_target_t* >::iterator it;
+
+    for( it = inFlight.begin(); it != inFlight.end(); ++it )
+    {
+        if( (*it)->p_params != NULL )
+        {
+            /* the application or a subscription may observe the same
+             * resource, only the request of the operation is canceled */
+            p_srv->cancelRequests( NULL, (*it)->p_res, (*it)->traceId );
+            finish( *it, 0, COAP_503_SERVICE_UNAVAILABLE,
+                    LWM2M_CONTENT_TEXT, NULL, 0 );
+        }
+        else
+            p_srv->cancelRequests( NULL, *it );
+    }
+
+    /* requests that were not answered are forgotten */
+    m_inFlight.clear();
+    mp_srv = NULL;
+
+} /* LWM2MBulkOperation::stop() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::sendTarget()
+*/
+int LWM2MBulkOperation::sendTarget( LWM2MServer* p_srv, s_target_t* p_tgt )
+{
+    lwm2m_client_t* p_cli;
+    const uint8_t* p_buf = NULL;
+    std::map< const LWM2MResource*, s_lwm2m_obsparams_t* >::iterator it;
+
+    p_cli = p_srv->getDevice( p_tgt->devName );
+    if( (p_cli == NULL) ||
+        (p_tgt->uri.instanceId == LWM2M_BULK_ALL_INSTANCES) )
+        return COAP_404_NOT_FOUND;
+
+    if( !m_value.empty() )
+        p_buf = (const uint8_t*)m_value.c_str();
+
+    switch( m_op )
+    {
+        case e_lwm2m_bulk_op_read:
+            return p_srv->request( p_cli, e_lwm2m_request_read, &p_tgt->uri,
+                    LWM2M_CONTENT_TEXT, NULL, 0, resultCb, p_tgt,
+                    e_lwm2m_request_class_bulk );
+
+        case e_lwm2m_bulk_op_write:
+            return p_srv->request( p_cli, e_lwm2m_request_write, &p_tgt->uri,
+                    LWM2M_CONTENT_TEXT, p_buf, m_value.length(), resultCb,
+                    p_tgt, e_lwm2m_request_class_bulk );
+
+        case e_lwm2m_bulk_op_execute:
+            return p_srv->request( p_cli, e_lwm2m_request_execute,
+                    &p_tgt->uri, LWM2M_CONTENT_TEXT, p_buf, m_value.length(),
+                    resultCb, p_tgt, e_lwm2m_request_class_bulk );
+
+        case e_lwm2m_bulk_op_observe:
+            /* the resource may not be discovered yet */
+            if( p_tgt->p_res == NULL )
+            {
+                std::map< std::string, LWM2MDevice* >::const_iterator dev;
+                LWM2MObject* p_obj = NULL;
+
+                dev = p_srv->m_devMap.find( p_tgt->devName );
+                if( dev != p_srv->m_devMap.end() )
+                    p_obj = dev->second->getObject( p_tgt->uri.objectId,
+                            p_tgt->uri.instanceId );
+                if( p_obj == NULL )
+                    return COAP_404_NOT_FOUND;
+
+                p_tgt->p_res = LWM2MServer::observedResource( p_obj,
+                        p_tgt->uri.resourceId );
+            }
+
+            /* notifications are handled by the observed resource */
+
+            it = p_srv->m_obsResMap.find( p_tgt->p_res );
+            if( it == p_srv->m_obsResMap.end() )
+                it = p_srv->m_obsResMap.insert( std::make_pair(
+                        (const LWM2MResource*)p_tgt->p_res,
+                        new s_lwm2m_obsparams_t() ) ).first;
+
+            p_tgt->p_params = it->second;
+            p_tgt->p_params->status = LWM2M_BULK_OBSERVE_PENDING;
+            return p_srv->request( p_cli, e_lwm2m_request_observe,
+                    &p_tgt->uri, LWM2M_CONTENT_TEXT, NULL, 0,
+                    LWM2MServer::notifyResCb, p_tgt->p_res,
+                    e_lwm2m_request_class_bulk, &p_tgt->traceId );
+    }
+
+    return COAP_400_BAD_REQUEST;
+
+} /* LWM2MBulkOperation::sendTarget() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::finish()
+*/
+void LWM2MBulkOperation::finish( s_target_t* p_tgt, uint16_t clientID,
+        int status, lwm2m_media_type_t format, uint8_t* p_buf, int len )
+{
+    s_lwm2m_obsparams_t params;
+
+    m_inFlight.remove( p_tgt );
+
+    /* success codes are of class 2 */
+    if( (status >> 5) == 2 )
+        m_stats.succeeded++;
+    else
+        m_stats.failed++;
+
+    if( mp_observer != NULL )
+    {
+        params.clientID = clientID;
+        params.uriP = &p_tgt->uri;
+        params.status = status;
+        params.format = format;
+        params.data = NULL;
+        params.dataLen = 0;
+        params.buffer = p_buf;
+        params.bufferLen = len;
+        mp_observer->result( this, p_tgt->devName, &params );
+    }
+
+} /* LWM2MBulkOperation::finish() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MBulkOperation::resultCb()
+*/
+void LWM2MBulkOperation::resultCb( uint16_t clientID, lwm2m_uri_t* uriP,
+        int status, lwm2m_media_type_t format, uint8_t* data, int dataLength,
+        void* userData )
+{
+    s_target_t* p_tgt = (s_target_t*)userData;
+
+    /* the URI of the target is passed to the observer */
+    (void)uriP;
+
+    if( p_tgt == NULL )
+        return;
+
+    p_tgt->p_op->finish( p_tgt, clientID, status, format, data, dataLength );
+
+} /* LWM2MBulkOperation::resultCb() */
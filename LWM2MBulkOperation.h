@@ -0,0 +1,338 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+
+/**
+ * \file    LWM2MBulkOperation.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of an operation on many LWM2M Devices.
+ *
+ */
+
+
+#ifndef __LWM2MBULKOPERATION_H__
+#define __LWM2MBULKOPERATION_H__
+#ifndef __DECL_LWM2MBULKOPERATION_H__
+#define __DECL_LWM2MBULKOPERATION_H__ extern
+#endif /* #ifndef __DECL_LWM2MBULKOPERATION_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <deque>
+#include <vector>
+#include "liblwm2m.h"
+#include "LWM2MBulkObserver.h"
+
+/*
+ * --- Forward Declaration ----------------------------------------------------- *
+ */
+
+/* Forward declaration of the LWM2MServer class. */
+class LWM2MServer;
+
+/* Forward declaration of the LWM2MResource class. */
+class LWM2MResource;
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Instance ID that selects all instances of the object */
+#define LWM2M_BULK_ALL_INSTANCES                LWM2M_MAX_ID
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief    Operation to run on the devices.
+ */
+typedef enum
+{
+    /** Read a resource */
+    e_lwm2m_bulk_op_read,
+
+    /** Write a resource */
+    e_lwm2m_bulk_op_write,
+
+    /** Execute a resource */
+    e_lwm2m_bulk_op_execute,
+
+    /** Observe a resource */
+    e_lwm2m_bulk_op_observe,
+
+} e_lwm2m_bulk_op_t;
+
+
+/**
+ * \brief    Configuration of a bulk operation.
+ */
+typedef struct
+{
+    /** Maximum number of requests waiting for their answer at a time */
+    uint16_t maxInFlight;
+    /** Minimum time between sending two requests in ms */
+    uint32_t pacing;
+
+} s_lwm2m_bulk_cfg_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MBulkOperation Class.
+ *
+ *          A bulk operation runs the same read, write, execute or observe
+ *          of a resource on many devices. The devices are either given
+ *          explicitly or all registered devices that have the object are
+ *          used. The instance of the object may be a wildcard to address
+ *          every instance a device registered.
+ *
+ *          The requests are sent with the bulk priority class. The number
+ *          of requests waiting for their answer is bounded and the
+ *          requests can be spread over time. The result of each request
+ *          is passed to the observer as soon as it is known. The values
+ *          of observed resources are passed to the observers of the
+ *          resources as usual. Established observations are issued
+ *          again when a device registers again, like the ones the
+ *          application started.
+ *
+ *          The operation is driven by the LWM2M Server it was started at.
+ */
+class LWM2MBulkOperation
+{
+    friend class LWM2MServer;
+
+public:
+
+    /**
+     * \brief   Constructor to create a bulk operation.
+     *
+     * \param   op      Operation to run.
+     * \param   objId   ID of the object.
+     * \param   instId  ID of the instance or LWM2M_BULK_ALL_INSTANCES.
+     * \param   resId   ID of the resource.
+     * \param   p_cfg   Configuration or NULL to use the default values.
+     */
+    LWM2MBulkOperation( e_lwm2m_bulk_op_t op, uint16_t objId,
+            uint16_t instId, uint16_t resId,
+            const s_lwm2m_bulk_cfg_t* p_cfg = NULL );
+
+
+    /**
+     * \brief   Destructor of the bulk operation.
+     *
+     *          A running operation is stopped at its server first.
+     */
+    virtual ~LWM2MBulkOperation( void );
+
+
+    /**
+     * \brief   Add a device the operation shall run on.
+     *
+     *          Devices can only be added as long as the operation was not
+     *          started at a server. If no device was added the operation
+     *          runs on all registered devices that have the object.
+     *
+     * \param   devName  Name of the device.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int16_t addDevice( const std::string& devName );
+
+
+    /**
+     * \brief   Set the value of a write or the arguments of an execute.
+     *
+     * \param   val     Value in text format.
+     */
+    void setValue( const std::string& val ) {m_value = val;}
+
+
+    /**
+     * \brief   Set the observer the results are passed to.
+     *
+     * \param   p_observer  Observer or NULL to not pass the results.
+     */
+    void setObserver( LWM2MBulkObserver* p_observer ) {
+        mp_observer = p_observer;
+    };
+
+
+    /**
+     * \brief   Get the operation that runs on the devices.
+     *
+     * \return  The operation.
+     */
+    e_lwm2m_bulk_op_t getOperation( void ) const {return m_op;}
+
+
+protected:
+
+    /**
+     * \brief   Get the statistics of the operation.
+     *
+     * \param   p_stats     Statistics structure to fill.
+     */
+    void getStats( s_lwm2m_bulk_stats_t* p_stats ) const;
+
+
+    /**
+     * \brief   Create the requests of the operation.
+     *
+     * \param   p_srv   Server the operation runs at.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t start( LWM2MServer* p_srv );
+
+
+    /**
+     * \brief   Send further requests and check the observations.
+     *
+     * \param   p_srv   Server the operation runs at.
+     * \param   now     Current time in ms.
+     */
+    void step( LWM2MServer* p_srv, uint64_t now );
+
+
+    /**
+     * \brief   Cancel the requests waiting for their answer.
+     *
+     * \param   p_srv   Server the operation runs at.
+     */
+    void stop( LWM2MServer* p_srv );
+
+
+private:
+
+    /**
+     * Request to a single device.
+     */
+    struct s_target_t
+    {
+        /* operation the request belongs to */
+        LWM2MBulkOperation* p_op;
+        /* name of the device */
+        std::string devName;
+        /* URI of the request */
+        lwm2m_uri_t uri;
+        /* observed resource */
+        LWM2MResource* p_res;
+        /* parameters of an observation */
+        s_lwm2m_obsparams_t* p_params;
+        /* ID of the observe request, other observes of the resource
+         * share the callback data */
+        uint32_t traceId;
+    };
+
+
+    /**
+     * \brief   Send the request of a target.
+     *
+     * \return  COAP_NO_ERROR on success or CoAP error code.
+     */
+    int sendTarget( LWM2MServer* p_srv, s_target_t* p_tgt );
+
+
+    /**
+     * \brief   Finish a target and pass its result to the observer.
+     */
+    void finish( s_target_t* p_tgt, uint16_t clientID, int status,
+            lwm2m_media_type_t format, uint8_t* p_buf, int len );
+
+
+    /**
+     * \brief   Callback of the requests.
+     */
+    static void resultCb( uint16_t clientID, lwm2m_uri_t* uriP, int status,
+            lwm2m_media_type_t format, uint8_t* data, int dataLength,
+            void* userData );
+
+
+private:
+
+    /** Operation to run */
+    e_lwm2m_bulk_op_t m_op;
+
+    /** URI of the resource, the instance may be a wildcard */
+    lwm2m_uri_t m_uri;
+
+    /** Value of a write or arguments of an execute */
+    std::string m_value;
+
+    /** Configuration */
+    s_lwm2m_bulk_cfg_t m_cfg;
+
+    /** Server the operation was started at until it is stopped */
+    LWM2MServer* mp_srv;
+
+    /** Observer of the results */
+    LWM2MBulkObserver* mp_observer;
+
+    /** Indicates if the operation was started */
+    bool m_started;
+
+    /** Devices added explicitly */
+    std::vector< std::string > m_devices;
+
+    /** Requests of the operation */
+    std::list< s_target_t > m_targets;
+
+    /** Requests waiting to be sent */
+    std::deque< s_target_t* > m_pending;
+
+    /** Requests waiting for their answer */
+    std::list< s_target_t* > m_inFlight;
+
+    /** Time in ms the next request may be sent */
+    uint64_t m_nextSend;
+
+    /** Indicates if the observer was informed about the end */
+    bool m_finished;
+
+    /** Statistics */
+    s_lwm2m_bulk_stats_t m_stats;
+};
+
+#endif /* #ifndef __LWM2MBULKOPERATION_H__ */
@@ -0,0 +1,199 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MCapture.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of the capture of the traffic of the LWM2M
+ *          server.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include "LWM2MCapture.h"
+#include "LWM2MMetrics.h"
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MCapture::open()
+*/
+int8_t LWM2MCapture::open( const char* p_path )
+{
+    s_lwm2m_capture_header_t hdr;
+    struct timeval tv;
+
+    if( p_path == NULL )
+        return -1;
+
+    close();
+
+    mp_file = fopen( p_path, "wb" );
+    if( mp_file == NULL )
+        return -1;
+
+    gettimeofday( &tv, NULL );
+    memset( &hdr, 0, sizeof(hdr) );
+    hdr.magic = LWM2M_CAPTURE_MAGIC;
+    hdr.version = LWM2M_CAPTURE_VERSION;
+    hdr.start = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+    if( fwrite( &hdr, sizeof(hdr), 1, mp_file ) != 1 )
+    {
+        close();
+        return -1;
+    }
+
+    m_start = LWM2MMetrics::now();
+    return 0;
+
+} /* LWM2MCapture::open() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MCapture::close()
+*/
+void LWM2MCapture::close( void )
+{
+    if( mp_file == NULL )
+        return;
+
+    fclose( mp_file );
+    mp_file = NULL;
+
+} /* LWM2MCapture::close() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MCapture::add()
+*/
+int8_t LWM2MCapture::add( e_lwm2m_capture_dir_t dir,
+        const struct sockaddr* p_addr, socklen_t addrLen,
+        const uint8_t* p_buf, size_t len, uint8_t flags )
+{
+    s_lwm2m_capture_record_t rec;
+
+    if( (mp_file == NULL) || (p_addr == NULL) || (p_buf == NULL) ||
+        (addrLen > sizeof(struct sockaddr_storage)) || (len > 0xFFFF) )
+        return -1;
+
+    memset( &rec, 0, sizeof(rec) );
+    rec.time = LWM2MMetrics::now() - m_start;
+    rec.len = len;
+    rec.dir = dir;
+    rec.addrLen = addrLen;
+    rec.flags = flags;
+
+    /* the stream is buffered, a capture that cannot be written any
+     * longer is stopped */
+    if( (fwrite( &rec, sizeof(rec), 1, mp_file ) != 1) ||
+        (fwrite( p_addr, addrLen, 1, mp_file ) != 1) ||
+        (fwrite( p_buf, len, 1, mp_file ) != 1) )
+    {
+        close();
+        return -1;
+    }
+    return 0;
+
+} /* LWM2MCapture::add() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MCapture::load()
+*/
+int32_t LWM2MCapture::load( const char* p_path,
+        std::vector< s_lwm2m_capture_packet_t >& packets )
+{
+    s_lwm2m_capture_header_t hdr;
+    s_lwm2m_capture_record_t rec;
+    s_lwm2m_capture_packet_t pkt;
+    int32_t cnt = 0;
+    FILE* p_file;
+
+    if( p_path == NULL )
+        return -1;
+
+    p_file = fopen( p_path, "rb" );
+    if( p_file == NULL )
+        return -1;
+
+    if( (fread( &hdr, sizeof(hdr), 1, p_file ) != 1) ||
+        (hdr.magic != LWM2M_CAPTURE_MAGIC) ||
+        (hdr.version != LWM2M_CAPTURE_VERSION) )
+    {
+        fclose( p_file );
+        return -1;
+    }
+
+    /* a capture of a server that stopped may end within a record */
+    while( fread( &rec, sizeof(rec), 1, p_file ) == 1 )
+    {
+        if( rec.addrLen > sizeof(pkt.addr) )
+            break;
+
+        memset( &pkt.addr, 0, sizeof(pkt.addr) );
+        pkt.time = rec.time;
+        pkt.dir = rec.dir;
+        pkt.flags = rec.flags;
+        pkt.addrLen = rec.addrLen;
+        pkt.data.resize( rec.len );
+
+        if( (fread( &pkt.addr, rec.addrLen, 1, p_file ) != 1) ||
+            ((rec.len > 0) &&
+             (fread( &pkt.data[0], rec.len, 1, p_file ) != 1)) )
+            break;
+
+        packets.push_back( pkt );
+        cnt++;
+    }
+
+    fclose( p_file );
+    return cnt;
+
+} /* LWM2MCapture::load() */
+
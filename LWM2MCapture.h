@@ -0,0 +1,244 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MCapture.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of the capture of the traffic of the LWM2M server.
+ *
+ */
+
+
+#ifndef __LWM2MCAPTURE_H__
+#define __LWM2MCAPTURE_H__
+#ifndef __DECL_LWM2MCAPTURE_H__
+#define __DECL_LWM2MCAPTURE_H__ extern
+#endif /* #ifndef __DECL_LWM2MCAPTURE_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <vector>
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Magic number at the start of a capture ("LWCP") */
+#define LWM2M_CAPTURE_MAGIC                     0x5043574C
+
+/** Version of the format of a capture */
+#define LWM2M_CAPTURE_VERSION                   1
+
+/** Flag of a retransmitted datagram */
+#define LWM2M_CAPTURE_FLAG_RETRANS              0x01
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Direction of a captured datagram.
+ */
+typedef enum
+{
+    /** Received by the server */
+    e_lwm2m_capture_in,
+    /** Request sent by the server */
+    e_lwm2m_capture_out
+
+} e_lwm2m_capture_dir_t;
+
+
+/**
+ * \brief   Header of a capture.
+ *
+ *          The header is followed by the records, each followed by the
+ *          address of the peer and the datagram.
+ */
+typedef struct
+{
+    /** LWM2M_CAPTURE_MAGIC */
+    uint32_t magic;
+    /** LWM2M_CAPTURE_VERSION */
+    uint16_t version;
+    /** Reserved */
+    uint16_t reserved;
+    /** Wall clock time in us the capture started */
+    uint64_t start;
+
+} s_lwm2m_capture_header_t;
+
+
+/**
+ * \brief   Record of a captured datagram.
+ */
+typedef struct
+{
+    /** Time in us since the start of the capture */
+    uint64_t time;
+    /** Length of the datagram */
+    uint16_t len;
+    /** Direction of type e_lwm2m_capture_dir_t */
+    uint8_t dir;
+    /** Length of the address of the peer */
+    uint8_t addrLen;
+    /** Flags LWM2M_CAPTURE_FLAG_* */
+    uint8_t flags;
+    /** Reserved */
+    uint8_t reserved[3];
+
+} s_lwm2m_capture_record_t;
+
+
+/**
+ * \brief   Datagram read from a capture.
+ */
+typedef struct
+{
+    /** Time in us since the start of the capture */
+    uint64_t time;
+    /** Direction of type e_lwm2m_capture_dir_t */
+    uint8_t dir;
+    /** Flags LWM2M_CAPTURE_FLAG_* */
+    uint8_t flags;
+    /** Address of the peer */
+    struct sockaddr_storage addr;
+    /** Length of the address of the peer */
+    socklen_t addrLen;
+    /** Datagram */
+    std::vector< uint8_t > data;
+
+} s_lwm2m_capture_packet_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MCapture Class.
+ *
+ *          A capture records the datagrams exchanged by the server with
+ *          their time and the address of the peer to a file. Captures
+ *          can be replayed to reproduce the load of a deployment without
+ *          its devices.
+ */
+class LWM2MCapture
+{
+
+public:
+
+    /**
+     * \brief   Default constructor.
+     */
+    LWM2MCapture( void ) : mp_file( NULL ), m_start( 0 ) {};
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MCapture( void ) {close();}
+
+
+    /**
+     * \brief   Start a capture.
+     *
+     *          A running capture is closed first.
+     *
+     * \param   p_path  File to write the capture to.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t open( const char* p_path );
+
+
+    /**
+     * \brief   Finish the capture.
+     */
+    void close( void );
+
+
+    /**
+     * \brief   Check if a capture is running.
+     */
+    bool isOpen( void ) const {return mp_file != NULL;}
+
+
+    /**
+     * \brief   Add a datagram to the capture.
+     *
+     * \param   dir         Direction of the datagram.
+     * \param   p_addr      Address of the peer.
+     * \param   addrLen     Length of the address.
+     * \param   p_buf       Datagram.
+     * \param   len         Length of the datagram.
+     * \param   flags       Flags LWM2M_CAPTURE_FLAG_*.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t add( e_lwm2m_capture_dir_t dir, const struct sockaddr* p_addr,
+            socklen_t addrLen, const uint8_t* p_buf, size_t len,
+            uint8_t flags = 0 );
+
+
+    /**
+     * \brief   Read a capture.
+     *
+     * \param   p_path  File to read the capture from.
+     * \param   packets List to append the datagrams to.
+     *
+     * \return  Number of datagrams or negative value on error.
+     */
+    static int32_t load( const char* p_path,
+            std::vector< s_lwm2m_capture_packet_t >& packets );
+
+
+private:
+
+    /** File of the capture */
+    FILE* mp_file;
+
+    /** Monotonic time in us the capture started */
+    uint64_t m_start;
+};
+
+#endif /* #ifndef __LWM2MCAPTURE_H__ */
+
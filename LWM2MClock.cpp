@@ -0,0 +1,133 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MClock.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of the clock of the LWM2M server.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <time.h>
+#include "LWM2MClock.h"
+
+/*
+ * --- Local Variables ------------------------------------------------------ *
+ */
+
+/** Clock of the system */
+static LWM2MSystemClock gSystemClock;
+
+/** Clock in use */
+static std::atomic< LWM2MClock* > gClock( &gSystemClock );
+
+/*
+ * --- Global Functions ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* lwm2m_clock_gettime()
+*/
+extern "C" time_t lwm2m_clock_gettime( void )
+{
+    /* the LWM2M implementation reads its time through this function,
+     * see wakaama.patch */
+    return LWM2MClock::timeS();
+
+} /* lwm2m_clock_gettime() */
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClock::instance()
+*/
+LWM2MClock* LWM2MClock::instance( void )
+{
+    return gClock.load( std::memory_order_acquire );
+
+} /* LWM2MClock::instance() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClock::setClock()
+*/
+void LWM2MClock::setClock( LWM2MClock* p_clock )
+{
+    if( p_clock == NULL )
+        p_clock = &gSystemClock;
+
+    gClock.store( p_clock, std::memory_order_release );
+
+} /* LWM2MClock::setClock() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSystemClock::milliseconds()
+*/
+uint64_t LWM2MSystemClock::milliseconds( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+} /* LWM2MSystemClock::milliseconds() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSimClock::LWM2MSimClock()
+*/
+LWM2MSimClock::LWM2MSimClock( time_t start )
+    : m_start( start )
+    , m_ms( 0 )
+{
+    if( m_start == 0 )
+        m_start = time( NULL );
+
+} /* LWM2MSimClock::LWM2MSimClock() */
+
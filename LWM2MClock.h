@@ -0,0 +1,205 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MClock.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of the clock of the LWM2M server.
+ *
+ */
+
+
+#ifndef __LWM2MCLOCK_H__
+#define __LWM2MCLOCK_H__
+#ifndef __DECL_LWM2MCLOCK_H__
+#define __DECL_LWM2MCLOCK_H__ extern
+#endif /* #ifndef __DECL_LWM2MCLOCK_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MClock Class.
+ *
+ *          The clock is the source of the protocol time of the server
+ *          and of the LWM2M implementation: lifetimes, timeouts,
+ *          retransmissions and the schedules of queued requests and
+ *          observations. A simulated clock can replace the system clock
+ *          to advance hours of protocol time within milliseconds. The
+ *          durations measured for the metrics always use the system
+ *          clock.
+ */
+class LWM2MClock
+{
+
+public:
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MClock( void ) {};
+
+
+    /**
+     * \brief   Get the time in seconds as used for lifetimes.
+     */
+    virtual time_t seconds( void ) = 0;
+
+
+    /**
+     * \brief   Get the monotonic time in ms.
+     */
+    virtual uint64_t milliseconds( void ) = 0;
+
+
+    /**
+     * \brief   Check if the clock is simulated.
+     *
+     *          The server does not wait for packets with a simulated
+     *          clock.
+     */
+    virtual bool isSimulated( void ) const {return false;}
+
+
+    /**
+     * \brief   Get the clock in use.
+     */
+    static LWM2MClock* instance( void );
+
+
+    /**
+     * \brief   Set the clock in use.
+     *
+     *          The clock must be set before the server is started and
+     *          exist until it is replaced.
+     *
+     * \param   p_clock     Clock to use or NULL for the system clock.
+     */
+    static void setClock( LWM2MClock* p_clock );
+
+
+    /**
+     * \brief   Get the time in seconds of the clock in use.
+     */
+    static time_t timeS( void ) {return instance()->seconds();}
+
+
+    /**
+     * \brief   Get the monotonic time in ms of the clock in use.
+     */
+    static uint64_t timeMs( void ) {return instance()->milliseconds();}
+};
+
+
+/**
+ * \brief   LWM2MSystemClock Class.
+ *
+ *          Clock of the operating system.
+ */
+class LWM2MSystemClock
+    : public LWM2MClock
+{
+
+public:
+
+    virtual time_t seconds( void ) {return time( NULL );}
+
+    virtual uint64_t milliseconds( void );
+};
+
+
+/**
+ * \brief   LWM2MSimClock Class.
+ *
+ *          Simulated clock that only advances when told to. It can be
+ *          advanced from any thread.
+ */
+class LWM2MSimClock
+    : public LWM2MClock
+{
+
+public:
+
+    /**
+     * \brief   Constructor.
+     *
+     * \param   start   Time in seconds the clock starts at, 0 for the
+     *                  current time of the system.
+     */
+    LWM2MSimClock( time_t start = 0 );
+
+
+    virtual time_t seconds( void ) {
+        return m_start + (time_t)(milliseconds() / 1000);
+    }
+
+    virtual uint64_t milliseconds( void ) {
+        return m_ms.load( std::memory_order_acquire );
+    }
+
+    virtual bool isSimulated( void ) const {return true;}
+
+
+    /**
+     * \brief   Advance the clock.
+     *
+     * \param   ms  Time in ms to advance the clock by.
+     */
+    void advance( uint64_t ms ) {
+        m_ms.fetch_add( ms, std::memory_order_acq_rel );
+    }
+
+
+private:
+
+    /** Time in seconds the clock started at */
+    time_t m_start;
+
+    /** Time in ms since the start */
+    std::atomic< uint64_t > m_ms;
+};
+
+#endif /* #ifndef __LWM2MCLOCK_H__ */
+
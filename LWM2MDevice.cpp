@@ -53,6 +53,27 @@
 #include "LWM2MObject.h"
 #include "LWM2MServer.h"
 
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_strStorage()
+*/
+static size_t prv_strStorage( const std::string& str )
+{
+    const char* p_data = str.data();
+
+    /* short strings are stored within the string object */
+    if( (p_data >= (const char*)&str) && (p_data < (const char*)(&str + 1)) )
+        return 0;
+
+    return str.capacity() + 1;
+
+} /* prv_strStorage() */
+
+
 /*
  * --- Methods Definition ----------------------------------------------------- *
  */
@@ -103,6 +124,37 @@ int32_t LWM2MDevice::getEndOfLife( void )
 } /* LWM2MObject::getEndOfLife() */
 
 
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MDevice::addTimeout()
+*/
+void LWM2MDevice::addTimeout( uint16_t threshold, uint32_t probeDelay,
+        uint32_t probeMax )
+{
+    if( m_timeouts < UINT16_MAX )
+        m_timeouts++;
+
+    if( m_circuitOpen )
+    {
+        /* the probe failed, back off */
+        m_probeDelay *= 2;
+        if( m_probeDelay > probeMax )
+            m_probeDelay = probeMax;
+    }
+    else if( (threshold != 0) && (m_timeouts >= threshold) )
+    {
+        /* stop sending requests to the device */
+        m_circuitOpen = true;
+        m_probeDelay = probeDelay;
+    }
+    else
+        return;
+
+    m_probeTot = LWM2MClock::timeS() + m_probeDelay;
+
+} /* LWM2MDevice::addTimeout() */
+
+
 /*---------------------------------------------------------------------------*/
 /*
 * LWM2MDevice::addObject()
@@ -145,3 +197,24 @@ int16_t LWM2MDevice::addObject( LWM2MObject* p_obj )
 
 } /* LWM2MObject::addObject() */
 
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MDevice::getMemSize()
+*/
+size_t LWM2MDevice::getMemSize( void ) const
+{
+    size_t size = sizeof( LWM2MDevice ) + prv_strStorage( m_name ) +
+        prv_strStorage( m_type ) + m_objVect.capacity() * sizeof( LWM2MObject* );
+
+    std::vector< LWM2MObject* >::const_iterator it = m_objVect.begin();
+    while( it != m_objVect.end() )
+    {
+        size += (*it)->getMemSize();
+        it++;
+    }
+
+    return size;
+
+} /* LWM2MDevice::getMemSize() */
+
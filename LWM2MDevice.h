@@ -53,10 +53,12 @@
  * --- Includes ------------------------------------------------------------- *
  */
 #include <stdint.h>
+#include <time.h>
 #include <iostream>
 #include <string>
 #include <vector>
 #include "LWM2MObject.h"
+#include "LWM2MClock.h"
 #include "liblwm2m.h"
 
 /*
@@ -89,6 +91,13 @@ public:
     LWM2MDevice( std::string name, uint16_t id, LWM2MServer* p_srv )
         : m_name( name )
         , m_id( id )
+        , m_queueMode( false )
+        , m_awakeTot( 0 )
+        , m_timeouts( 0 )
+        , m_circuitOpen( false )
+        , m_probeDelay( 0 )
+        , m_probeTot( 0 )
+        , mp_session( NULL )
         , mp_srv( p_srv ){
 
         /* clear object vector */
@@ -128,6 +137,84 @@ public:
     uint16_t getID( void ) const {return m_id;}
 
 
+    /**
+     * \brief   Get the type of the device.
+     *
+     *          Devices of the same type share the results of a LWM2M
+     *          Discover. By default the type is derived from the objects
+     *          the device registered.
+     *
+     * \return  Type of the device.
+     */
+    std::string getType( void ) const {return m_type;}
+
+
+    /**
+     * \brief   Set the type of the device.
+     *
+     *          The type should be set before the first resource
+     *          discovery of the device e.g. from the register event.
+     *          A new registration of the device resets the type to the
+     *          default derived from the registered objects.
+     *
+     * \param   type    Type of the device.
+     */
+    void setType( const std::string& type ) {m_type = type;}
+
+
+    /**
+     * \brief   Check if the device uses the queue mode.
+     *
+     *          A device in queue mode is only reachable for a short time
+     *          after it registered or updated its registration.
+     *
+     * \return  true if the device uses the queue mode.
+     */
+    bool isQueueMode( void ) const {return m_queueMode;}
+
+
+    /**
+     * \brief   Check if the device is reachable.
+     *
+     *          Devices that do not use the queue mode are always reachable.
+     *
+     * \return  true if requests can be sent to the device.
+     */
+    bool isAwake( void ) const {
+        return ( (!m_queueMode) || (LWM2MClock::timeS() < m_awakeTot) );
+    };
+
+
+    /**
+     * \brief   Check if the circuit of the device is open.
+     *
+     *          The circuit opens after a number of consecutive timeouts.
+     *          Requests to the device fail immediately then, except for
+     *          a probe from time to time, until the device answers.
+     *
+     * \return  true if the device is considered unreachable.
+     */
+    bool isCircuitOpen( void ) const {return m_circuitOpen;}
+
+
+    /**
+     * \brief   Check if a probe may be sent to the device.
+     *
+     * \return  true if the circuit is closed or the next probe is due.
+     */
+    bool isProbeDue( void ) const {
+        return ( (!m_circuitOpen) || (LWM2MClock::timeS() >= m_probeTot) );
+    };
+
+
+    /**
+     * \brief   Get the number of consecutive timeouts of the device.
+     *
+     * \return  Number of requests that timed out since the last answer.
+     */
+    uint16_t getTimeouts( void ) const {return m_timeouts;}
+
+
     /**
      * \brief   Get the lifetime of the device.
      *
@@ -150,6 +237,17 @@ public:
     int32_t getEndOfLife( void );
 
 
+    /**
+     * \brief   Get the memory used by the device and its objects.
+     *
+     *          The size includes the objects and resources of the device
+     *          but not the overhead of the heap.
+     *
+     * \return  Size of the device in bytes.
+     */
+    size_t getMemSize( void ) const;
+
+
     /**
      * \brief   Get a specific object.
      *
@@ -200,6 +298,74 @@ protected:
      */
     int16_t addObject( LWM2MObject* p_obj );
 
+
+    /**
+     * \brief   Set the internal ID of the device.
+     *
+     *          The ID changes when the device registers again.
+     *
+     * \param   id     Internal ID of the device.
+     */
+    void setID( uint16_t id ) {m_id = id;}
+
+
+    /**
+     * \brief   Define if the device uses the queue mode.
+     *
+     * \param   queueMode   true if the device uses the queue mode.
+     */
+    void setQueueMode( bool queueMode ) {m_queueMode = queueMode;}
+
+
+    /**
+     * \brief   Mark the device as reachable.
+     *
+     * \param   awakeTime   Time in s the device stays reachable.
+     */
+    void setAwake( uint32_t awakeTime ) {m_awakeTot = LWM2MClock::timeS() + awakeTime;}
+
+
+    /**
+     * \brief   Mark a device in queue mode as not reachable.
+     */
+    void setAsleep( void ) {m_awakeTot = 0;}
+
+
+    /**
+     * \brief   Count a request that timed out.
+     *
+     *          The circuit opens when the threshold is reached. Every
+     *          timeout of an open circuit doubles the time to the next
+     *          probe up to the maximum.
+     *
+     * \param   threshold   Consecutive timeouts that open the circuit,
+     *                      0 to never open it.
+     * \param   probeDelay  Time in s to the first probe.
+     * \param   probeMax    Maximum time in s between two probes.
+     */
+    void addTimeout( uint16_t threshold, uint32_t probeDelay,
+            uint32_t probeMax );
+
+
+    /**
+     * \brief   Count an answer of the device.
+     *
+     *          An answer closes the circuit.
+     */
+    void addAnswer( void ) {
+        m_timeouts = 0;
+        m_circuitOpen = false;
+    };
+
+
+    /**
+     * \brief   Note that a probe was sent to the device.
+     *
+     *          No further probe is sent until the probe timed out or
+     *          the probe delay elapsed.
+     */
+    void setProbing( void ) {m_probeTot = LWM2MClock::timeS() + m_probeDelay;}
+
 private:
 
     /** Name of the device */
@@ -208,9 +374,33 @@ private:
     /** ID of the device */
     uint16_t m_id;
 
+    /** Type of the device */
+    std::string m_type;
+
+    /** Device uses the queue mode */
+    bool m_queueMode;
+
+    /** Time the device stops to be reachable */
+    time_t m_awakeTot;
+
+    /** Consecutive timeouts of the device */
+    uint16_t m_timeouts;
+
+    /** Device is considered unreachable */
+    bool m_circuitOpen;
+
+    /** Time in s between two probes */
+    uint32_t m_probeDelay;
+
+    /** Time the next probe may be sent */
+    time_t m_probeTot;
+
     /** Vector of resources */
     std::vector< LWM2MObject* > m_objVect;
 
+    /** Connection the device registered from */
+    void* mp_session;
+
     /** Server instance this device belongs to */
     LWM2MServer* mp_srv;
 };
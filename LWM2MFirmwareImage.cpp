@@ -0,0 +1,134 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MFirmwareImage.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of a memory mapped firmware image.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LWM2MFirmwareImage.h"
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareImage::open()
+*/
+int16_t LWM2MFirmwareImage::open( const std::string& path )
+{
+    int16_t ret = 0;
+    struct stat st;
+    void* p_map = MAP_FAILED;
+
+    /* close a previously opened image */
+    close();
+
+    m_fd = ::open( path.c_str(), O_RDONLY );
+    if( m_fd < 0 )
+        ret = -1;
+
+    if( ret == 0 )
+    {
+        /* empty images can not be mapped */
+        if( (fstat( m_fd, &st ) != 0) || (st.st_size <= 0) )
+            ret = -2;
+    }
+
+    if( ret == 0 )
+    {
+        p_map = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0 );
+        if( p_map == MAP_FAILED )
+            ret = -3;
+    }
+
+    if( ret == 0 )
+    {
+        /* the transfers read the image at different offsets concurrently,
+         * so ask for the whole image to be paged in rather than for a
+         * sequential read ahead */
+        madvise( p_map, st.st_size, MADV_WILLNEED );
+
+        mp_data = (const uint8_t*)p_map;
+        m_size = st.st_size;
+        m_path = path;
+    }
+    else if( m_fd >= 0 )
+    {
+        ::close( m_fd );
+        m_fd = -1;
+    }
+
+    return ret;
+
+} /* LWM2MFirmwareImage::open() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareImage::close()
+*/
+void LWM2MFirmwareImage::close( void )
+{
+    if( mp_data != NULL )
+    {
+        munmap( (void*)mp_data, m_size );
+        mp_data = NULL;
+        m_size = 0;
+    }
+
+    if( m_fd >= 0 )
+    {
+        ::close( m_fd );
+        m_fd = -1;
+    }
+
+    m_path.clear();
+
+} /* LWM2MFirmwareImage::close() */
@@ -0,0 +1,173 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MFirmwareImage.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of a memory mapped firmware image.
+ *
+ */
+
+
+#ifndef __LWM2MFIRMWAREIMAGE_H__
+#define __LWM2MFIRMWAREIMAGE_H__
+#ifndef __DECL_LWM2MFIRMWAREIMAGE_H__
+#define __DECL_LWM2MFIRMWAREIMAGE_H__ extern
+#endif /* #ifndef __DECL_LWM2MFIRMWAREIMAGE_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MFirmwareImage Class.
+ *
+ *          A firmware image maps an image file read-only into memory. The
+ *          mapping is created once and can be shared by any number of
+ *          transfers, which send their blocks directly from the mapped
+ *          pages without copying the image.
+ */
+class LWM2MFirmwareImage
+{
+
+public:
+
+    /**
+     * \brief   Default constructor to create a firmware image.
+     */
+    LWM2MFirmwareImage( void )
+        : m_fd( -1 )
+        , mp_data( NULL )
+        , m_size( 0 ) {};
+
+
+    /**
+     * \brief   Default destructor of the firmware image.
+     *
+     *          Removes the mapping if the image is still open.
+     */
+    virtual ~LWM2MFirmwareImage( void ) {
+        close();
+    };
+
+
+    /**
+     * \brief   Open and map an image file.
+     *
+     *          An already opened image is closed before.
+     *
+     * \param   path    Path of the image file.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int16_t open( const std::string& path );
+
+
+    /**
+     * \brief   Remove the mapping and close the image file.
+     */
+    void close( void );
+
+
+    /**
+     * \brief   Check if the image is mapped.
+     *
+     * \return  true if the image is mapped.
+     */
+    bool isOpen( void ) const {return (mp_data != NULL);}
+
+
+    /**
+     * \brief   Get the mapped image data.
+     *
+     * \return  Pointer to the begin of the image or NULL if not mapped.
+     */
+    const uint8_t* getData( void ) const {return mp_data;}
+
+
+    /**
+     * \brief   Get the size of the image.
+     *
+     * \return  Size of the image in bytes.
+     */
+    size_t getSize( void ) const {return m_size;}
+
+
+    /**
+     * \brief   Get the path of the image.
+     *
+     * \return  Path of the image file.
+     */
+    std::string getPath( void ) const {return m_path;}
+
+
+private:
+
+    /**
+     * \brief   Protection against using copy constructor.
+     */
+    LWM2MFirmwareImage( const LWM2MFirmwareImage& );
+
+    /**
+     * \brief   Protection against using assignment operator.
+     */
+    LWM2MFirmwareImage& operator=( const LWM2MFirmwareImage& );
+
+
+private:
+
+    /** Path of the image file */
+    std::string m_path;
+
+    /** File descriptor of the image */
+    int m_fd;
+
+    /** Mapped image data */
+    const uint8_t* mp_data;
+
+    /** Size of the image */
+    size_t m_size;
+};
+
+#endif /* #ifndef __LWM2MFIRMWAREIMAGE_H__ */
@@ -0,0 +1,577 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MFirmwareUpdate.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of a firmware delivery to several LWM2M Devices.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "LWM2MFirmwareUpdate.h"
+#include "LWM2MServer.h"
+
+/* the CoAP implementation of wakaama has no C++ guards */
+extern "C" {
+#include "er-coap-13/er-coap-13.h"
+}
+
+/*
+ * --- Macro Definitions----------------------------------------------------- *
+ */
+
+/** Default size of a block */
+#define LWM2M_FWUPDATE_DEF_BLOCKSIZE            512
+/** Default number of devices with a block in flight */
+#define LWM2M_FWUPDATE_DEF_MAXINFLIGHT          32
+/** Default number of resumes of a stalled transfer */
+#define LWM2M_FWUPDATE_DEF_MAXRESUME            3
+/** Default delay before resuming a stalled transfer in ms */
+#define LWM2M_FWUPDATE_DEF_RESUMEDELAY          30000
+
+/** Initial ACK timeout in ms */
+#define LWM2M_FWUPDATE_ACK_TIMEOUT              (COAP_RESPONSE_TIMEOUT * 1000)
+/** Time to wait for a separate response after an empty ACK in ms */
+#define LWM2M_FWUPDATE_RESPONSE_TIMEOUT         \
+    ((uint64_t)(COAP_MAX_TRANSMIT_WAIT * 1000))
+
+/** Space reserved for the CoAP header and options of a block */
+#define LWM2M_FWUPDATE_HEADER_SIZE              64
+
+/** Path of the firmware package resource */
+#define LWM2M_FWUPDATE_PACKAGE_PATH             "/5/0/0"
+
+/* Status codes not known to every wakaama version */
+#ifndef COAP_231_CONTINUE
+#define COAP_231_CONTINUE                       (uint8_t)0x5F
+#endif
+#ifndef COAP_408_REQ_ENTITY_INCOMPLETE
+#define COAP_408_REQ_ENTITY_INCOMPLETE          (uint8_t)0x88
+#endif
+#ifndef COAP_413_ENTITY_TOO_LARGE
+#define COAP_413_ENTITY_TOO_LARGE               (uint8_t)0x8D
+#endif
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_isValidBlockSize()
+*/
+static bool prv_isValidBlockSize( uint16_t size )
+{
+    /* Block1 sizes are powers of two from 16 to 1024 */
+    return (size >= 16) && (size <= 1024) && ((size & (size - 1)) == 0);
+
+} /* prv_isValidBlockSize() */
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::LWM2MFirmwareUpdate()
+*/
+LWM2MFirmwareUpdate::LWM2MFirmwareUpdate( const LWM2MFirmwareImage* p_img,
+        const s_lwm2m_fwupdate_cfg_t* p_cfg )
+    : mp_img( p_img )
+    , m_started( false )
+    , m_nextToken( (uint32_t)rand() )
+{
+    m_cfg.blockSize = LWM2M_FWUPDATE_DEF_BLOCKSIZE;
+    m_cfg.maxInFlight = LWM2M_FWUPDATE_DEF_MAXINFLIGHT;
+    m_cfg.maxResume = LWM2M_FWUPDATE_DEF_MAXRESUME;
+    m_cfg.resumeDelay = LWM2M_FWUPDATE_DEF_RESUMEDELAY;
+
+    if( p_cfg != NULL )
+    {
+        m_cfg = *p_cfg;
+
+        /* fall back to the defaults for invalid values */
+        if( !prv_isValidBlockSize( m_cfg.blockSize ) )
+            m_cfg.blockSize = LWM2M_FWUPDATE_DEF_BLOCKSIZE;
+        if( m_cfg.maxInFlight == 0 )
+            m_cfg.maxInFlight = LWM2M_FWUPDATE_DEF_MAXINFLIGHT;
+    }
+
+    m_buffer.resize( m_cfg.blockSize + LWM2M_FWUPDATE_HEADER_SIZE );
+
+} /* LWM2MFirmwareUpdate::LWM2MFirmwareUpdate() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::addDevice()
+*/
+int16_t LWM2MFirmwareUpdate::addDevice( const std::string& devName )
+{
+    if( m_started || (mp_img == NULL) || (!mp_img->isOpen()) )
+        return -1;
+
+    if( m_transfers.find( devName ) != m_transfers.end() )
+        /* device was already added */
+        return 0;
+
+    s_transfer_t tr;
+    tr.devName = devName;
+    tr.p_session = NULL;
+    tr.blockSize = m_cfg.blockSize;
+    tr.blockNum = 0;
+    tr.mid = 0;
+    tr.token = 0;
+    tr.retrans = 0;
+    tr.acked = false;
+    tr.timeout = 0;
+    memset( &tr.progress, 0, sizeof(tr.progress) );
+    tr.progress.state = e_lwm2m_fwupdate_state_pending;
+    tr.progress.bytesTotal = mp_img->getSize();
+
+    std::map< std::string, s_transfer_t >::iterator it = m_transfers.insert(
+        std::pair< std::string, s_transfer_t >( devName, tr ) ).first;
+    m_pending.push_back( &it->second );
+
+    return 0;
+
+} /* LWM2MFirmwareUpdate::addDevice() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::getProgress()
+*/
+int8_t LWM2MFirmwareUpdate::getProgress( const std::string& devName,
+        s_lwm2m_fwupdate_progress_t* p_progress ) const
+{
+    std::map< std::string, s_transfer_t >::const_iterator it =
+        m_transfers.find( devName );
+
+    if( (it == m_transfers.end()) || (p_progress == NULL) )
+        return -1;
+
+    *p_progress = it->second.progress;
+    return 0;
+
+} /* LWM2MFirmwareUpdate::getProgress() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::getCount()
+*/
+uint32_t LWM2MFirmwareUpdate::getCount( e_lwm2m_fwupdate_state_t state ) const
+{
+    uint32_t cnt = 0;
+
+    std::map< std::string, s_transfer_t >::const_iterator it =
+        m_transfers.begin();
+    while( it != m_transfers.end() )
+    {
+        if( it->second.progress.state == state )
+            cnt++;
+        it++;
+    }
+
+    return cnt;
+
+} /* LWM2MFirmwareUpdate::getCount() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::step()
+*/
+void LWM2MFirmwareUpdate::step( LWM2MServer* p_srv, uint64_t now )
+{
+    m_started = true;
+
+    /* check the blocks in flight for timeouts */
+    std::map< uint16_t, s_transfer_t* >::iterator it = m_midMap.begin();
+    while( it != m_midMap.end() )
+    {
+        s_transfer_t* p_tr = it->second;
+        it++;
+
+        if( p_tr->timeout > now )
+            continue;
+
+        if( (!p_tr->acked) && (p_tr->retrans < COAP_MAX_RETRANSMIT) )
+        {
+            /* retransmit the block with the same message ID */
+            p_tr->retrans++;
+            p_tr->timeout = now +
+                ((uint64_t)LWM2M_FWUPDATE_ACK_TIMEOUT << p_tr->retrans);
+            p_tr->progress.retransmissions++;
+
+            if( sendBlock( p_srv, p_tr ) != 0 )
+                finish( p_tr, e_lwm2m_fwupdate_state_failed,
+                    COAP_404_NOT_FOUND );
+        }
+        else
+        {
+            /* device did not answer within the retransmission window */
+            stall( p_tr, now );
+        }
+    }
+
+    /* resume stalled transfers */
+    std::list< s_transfer_t* >::iterator stIt = m_stalled.begin();
+    while( (stIt != m_stalled.end()) &&
+           (m_midMap.size() < m_cfg.maxInFlight) )
+    {
+        s_transfer_t* p_tr = *stIt;
+        if( p_tr->timeout <= now )
+        {
+            stIt = m_stalled.erase( stIt );
+            p_tr->progress.resumes++;
+            p_tr->progress.state = e_lwm2m_fwupdate_state_active;
+            startBlock( p_srv, p_tr, now );
+        }
+        else
+            stIt++;
+    }
+
+    /* start pending transfers as long as there are free slots */
+    while( (m_pending.size() > 0) &&
+           (m_midMap.size() < m_cfg.maxInFlight) )
+    {
+        s_transfer_t* p_tr = m_pending.front();
+        m_pending.pop_front();
+
+        p_tr->progress.state = e_lwm2m_fwupdate_state_active;
+        startBlock( p_srv, p_tr, now );
+    }
+
+} /* LWM2MFirmwareUpdate::step() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::handlePacket()
+*/
+bool LWM2MFirmwareUpdate::handlePacket( LWM2MServer* p_srv, void* p_session,
+        uint8_t* p_buf, int len, uint64_t now )
+{
+    s_transfer_t* p_tr = NULL;
+    coap_packet_t pkt;
+    uint8_t type;
+    uint16_t mid;
+
+    if( (m_midMap.size() == 0) || (len < COAP_HEADER_LEN) )
+        return false;
+
+    /* peek at the header before parsing the whole packet */
+    type = (p_buf[0] & COAP_HEADER_TYPE_MASK) >> COAP_HEADER_TYPE_POSITION;
+    mid = (p_buf[2] << 8) | p_buf[3];
+
+    if( (type == COAP_TYPE_ACK) || (type == COAP_TYPE_RST) )
+    {
+        std::map< uint16_t, s_transfer_t* >::iterator it = m_midMap.find( mid );
+        if( it != m_midMap.end() )
+            p_tr = it->second;
+    }
+    else if( ((p_buf[0] & 0x0F) == sizeof(uint32_t)) &&
+             (len >= (int)(COAP_HEADER_LEN + sizeof(uint32_t))) )
+    {
+        /* separate response, match the token */
+        uint32_t token = ((uint32_t)p_buf[4] << 24) | ((uint32_t)p_buf[5] << 16) |
+            ((uint32_t)p_buf[6] << 8) | (uint32_t)p_buf[7];
+
+        std::map< uint32_t, s_transfer_t* >::iterator it = m_tokenMap.find( token );
+        if( it != m_tokenMap.end() )
+            p_tr = it->second;
+    }
+
+    if( (p_tr == NULL) || (p_tr->p_session != p_session) )
+        return false;
+
+    if( coap_parse_message( &pkt, p_buf, len ) != NO_ERROR )
+        /* drop malformed answers */
+        return true;
+
+    if( type == COAP_TYPE_CON )
+        sendAck( p_session, mid );
+
+    if( type == COAP_TYPE_RST )
+    {
+        /* device rejected the block */
+        finish( p_tr, e_lwm2m_fwupdate_state_failed,
+            COAP_501_NOT_IMPLEMENTED );
+    }
+    else if( pkt.code == 0 )
+    {
+        /* empty ACK, the response follows separately */
+        p_tr->acked = true;
+        p_tr->timeout = now + LWM2M_FWUPDATE_RESPONSE_TIMEOUT;
+    }
+    else
+    {
+        uint32_t num;
+        uint8_t more;
+        uint16_t size = p_tr->blockSize;
+        uint32_t offset;
+        bool hasBlock = coap_get_header_block1( &pkt, &num, &more, &size,
+            &offset ) != 0;
+
+        p_tr->progress.status = pkt.code;
+
+        if( (pkt.code == COAP_231_CONTINUE) || (pkt.code == COAP_204_CHANGED) )
+        {
+            uint32_t acked = p_tr->blockNum * p_tr->blockSize + p_tr->blockSize;
+            if( acked > p_tr->progress.bytesTotal )
+                acked = p_tr->progress.bytesTotal;
+            p_tr->progress.bytesAcked = acked;
+
+            if( acked >= p_tr->progress.bytesTotal )
+            {
+                finish( p_tr, e_lwm2m_fwupdate_state_done, pkt.code );
+            }
+            else
+            {
+                /* the device may ask for smaller blocks */
+                if( hasBlock && prv_isValidBlockSize( size ) &&
+                    (size < p_tr->blockSize) )
+                    p_tr->blockSize = size;
+
+                p_tr->blockNum = acked / p_tr->blockSize;
+                startBlock( p_srv, p_tr, now );
+            }
+        }
+        else if( (pkt.code == COAP_413_ENTITY_TOO_LARGE) && hasBlock &&
+                 prv_isValidBlockSize( size ) && (size < p_tr->blockSize) )
+        {
+            /* repeat the current offset with the size preferred by the
+             * device */
+            uint32_t curOffset = p_tr->blockNum * p_tr->blockSize;
+            p_tr->blockSize = size;
+            p_tr->blockNum = curOffset / size;
+            startBlock( p_srv, p_tr, now );
+        }
+        else if( (pkt.code == COAP_408_REQ_ENTITY_INCOMPLETE) &&
+                 (p_tr->progress.resumes < m_cfg.maxResume) )
+        {
+            /* device lost the transfer, start over from the first block */
+            p_tr->progress.resumes++;
+            p_tr->progress.bytesAcked = 0;
+            p_tr->blockNum = 0;
+            startBlock( p_srv, p_tr, now );
+        }
+        else
+        {
+            finish( p_tr, e_lwm2m_fwupdate_state_failed, pkt.code );
+        }
+    }
+
+    coap_free_header( &pkt );
+    return true;
+
+} /* LWM2MFirmwareUpdate::handlePacket() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::startBlock()
+*/
+void LWM2MFirmwareUpdate::startBlock( LWM2MServer* p_srv, s_transfer_t* p_tr,
+        uint64_t now )
+{
+    /* every block is a new exchange */
+    releaseBlock( p_tr );
+
+    p_tr->mid = p_srv->mp_lwm2mH->nextMID++;
+    p_tr->token = m_nextToken++;
+    p_tr->retrans = 0;
+    p_tr->acked = false;
+    p_tr->timeout = now + LWM2M_FWUPDATE_ACK_TIMEOUT;
+
+    m_midMap[p_tr->mid] = p_tr;
+    m_tokenMap[p_tr->token] = p_tr;
+
+    if( sendBlock( p_srv, p_tr ) != 0 )
+        /* device is not registered anymore */
+        finish( p_tr, e_lwm2m_fwupdate_state_failed, COAP_404_NOT_FOUND );
+
+} /* LWM2MFirmwareUpdate::startBlock() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::sendBlock()
+*/
+int16_t LWM2MFirmwareUpdate::sendBlock( LWM2MServer* p_srv, s_transfer_t* p_tr )
+{
+    lwm2m_client_t* p_cli;
+    coap_packet_t pkt;
+    std::string path;
+    uint8_t token[sizeof(uint32_t)];
+    uint32_t offset;
+    size_t blockLen;
+    size_t pktLen;
+
+    p_cli = p_srv->getDevice( p_tr->devName );
+    if( (p_cli == NULL) || (p_cli->sessionH == NULL) )
+        return -1;
+
+    offset = p_tr->blockNum * p_tr->blockSize;
+    if( offset >= mp_img->getSize() )
+        return -1;
+
+    blockLen = mp_img->getSize() - offset;
+    if( blockLen > p_tr->blockSize )
+        blockLen = p_tr->blockSize;
+
+    if( p_cli->altPath != NULL )
+        path = p_cli->altPath;
+    path += LWM2M_FWUPDATE_PACKAGE_PATH;
+
+    token[0] = (uint8_t)(p_tr->token >> 24);
+    token[1] = (uint8_t)(p_tr->token >> 16);
+    token[2] = (uint8_t)(p_tr->token >> 8);
+    token[3] = (uint8_t)(p_tr->token);
+
+    coap_init_message( &pkt, COAP_TYPE_CON, COAP_PUT, p_tr->mid );
+    coap_set_header_uri_path( &pkt, path.c_str() );
+    coap_set_header_content_type( &pkt, LWM2M_CONTENT_OPAQUE );
+    coap_set_header_token( &pkt, token, sizeof(token) );
+    coap_set_header_block1( &pkt, p_tr->blockNum,
+        ((offset + blockLen) < mp_img->getSize()) ? 1 : 0, p_tr->blockSize );
+
+    /* the payload refers to the mapped image directly */
+    coap_set_payload( &pkt, mp_img->getData() + offset, blockLen );
+
+    pktLen = coap_serialize_get_size( &pkt );
+    if( pktLen > m_buffer.size() )
+        m_buffer.resize( pktLen );
+
+    pktLen = coap_serialize_message( &pkt, &m_buffer[0] );
+    coap_free_header( &pkt );
+
+    if( pktLen == 0 )
+        return -1;
+
+    p_tr->p_session = p_cli->sessionH;
+    p_tr->progress.blocksSent++;
+    connection_send( (connection_t*)p_cli->sessionH, &m_buffer[0], pktLen );
+
+    return 0;
+
+} /* LWM2MFirmwareUpdate::sendBlock() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::sendAck()
+*/
+void LWM2MFirmwareUpdate::sendAck( void* p_session, uint16_t mid )
+{
+    coap_packet_t pkt;
+    uint8_t buffer[COAP_HEADER_LEN];
+    size_t pktLen;
+
+    coap_init_message( &pkt, COAP_TYPE_ACK, 0, mid );
+    pktLen = coap_serialize_message( &pkt, buffer );
+    if( pktLen > 0 )
+        connection_send( (connection_t*)p_session, buffer, pktLen );
+
+} /* LWM2MFirmwareUpdate::sendAck() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::releaseBlock()
+*/
+void LWM2MFirmwareUpdate::releaseBlock( s_transfer_t* p_tr )
+{
+    std::map< uint16_t, s_transfer_t* >::iterator midIt =
+        m_midMap.find( p_tr->mid );
+    if( (midIt != m_midMap.end()) && (midIt->second == p_tr) )
+        m_midMap.erase( midIt );
+
+    std::map< uint32_t, s_transfer_t* >::iterator tokIt =
+        m_tokenMap.find( p_tr->token );
+    if( (tokIt != m_tokenMap.end()) && (tokIt->second == p_tr) )
+        m_tokenMap.erase( tokIt );
+
+} /* LWM2MFirmwareUpdate::releaseBlock() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::stall()
+*/
+void LWM2MFirmwareUpdate::stall( s_transfer_t* p_tr, uint64_t now )
+{
+    releaseBlock( p_tr );
+
+    if( p_tr->progress.resumes >= m_cfg.maxResume )
+    {
+        finish( p_tr, e_lwm2m_fwupdate_state_failed,
+            COAP_503_SERVICE_UNAVAILABLE );
+    }
+    else
+    {
+        /* resume later on at the block that was not acknowledged */
+        p_tr->progress.state = e_lwm2m_fwupdate_state_stalled;
+        p_tr->timeout = now + m_cfg.resumeDelay;
+        m_stalled.push_back( p_tr );
+    }
+
+} /* LWM2MFirmwareUpdate::stall() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MFirmwareUpdate::finish()
+*/
+void LWM2MFirmwareUpdate::finish( s_transfer_t* p_tr,
+        e_lwm2m_fwupdate_state_t state, int status )
+{
+    releaseBlock( p_tr );
+
+    p_tr->progress.state = state;
+    p_tr->progress.status = status;
+
+} /* LWM2MFirmwareUpdate::finish() */
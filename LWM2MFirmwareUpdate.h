@@ -0,0 +1,351 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MFirmwareUpdate.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of a firmware delivery to several LWM2M Devices.
+ *
+ */
+
+
+#ifndef __LWM2MFIRMWAREUPDATE_H__
+#define __LWM2MFIRMWAREUPDATE_H__
+#ifndef __DECL_LWM2MFIRMWAREUPDATE_H__
+#define __DECL_LWM2MFIRMWAREUPDATE_H__ extern
+#endif /* #ifndef __DECL_LWM2MFIRMWAREUPDATE_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <deque>
+#include <map>
+#include <vector>
+#include "LWM2MFirmwareImage.h"
+
+/*
+ * --- Forward Declaration ----------------------------------------------------- *
+ */
+
+/* Forward declaration of the LWM2MServer class. */
+class LWM2MServer;
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief    States of the transfer to a single device.
+ */
+typedef enum
+{
+    /** Transfer waits for a free in-flight slot */
+    e_lwm2m_fwupdate_state_pending,
+
+    /** A block of the transfer is in flight */
+    e_lwm2m_fwupdate_state_active,
+
+    /** The device did not answer, transfer waits to be resumed */
+    e_lwm2m_fwupdate_state_stalled,
+
+    /** The whole image was acknowledged by the device */
+    e_lwm2m_fwupdate_state_done,
+
+    /** The transfer was given up */
+    e_lwm2m_fwupdate_state_failed,
+
+} e_lwm2m_fwupdate_state_t;
+
+
+/**
+ * \brief    Configuration of a firmware delivery.
+ */
+typedef struct
+{
+    /** Size of a Block1 block (power of two from 16 to 1024) */
+    uint16_t blockSize;
+    /** Maximum number of devices with a block in flight at a time */
+    uint16_t maxInFlight;
+    /** Number of times a stalled transfer is resumed before giving up */
+    uint8_t maxResume;
+    /** Time to wait before resuming a stalled transfer in ms */
+    uint32_t resumeDelay;
+
+} s_lwm2m_fwupdate_cfg_t;
+
+
+/**
+ * \brief    Progress of the transfer to a single device.
+ */
+typedef struct
+{
+    /** State of the transfer */
+    e_lwm2m_fwupdate_state_t state;
+    /** Number of bytes acknowledged by the device */
+    uint32_t bytesAcked;
+    /** Size of the image */
+    uint32_t bytesTotal;
+    /** Number of blocks sent including retransmissions */
+    uint32_t blocksSent;
+    /** Number of retransmitted blocks */
+    uint32_t retransmissions;
+    /** Number of times the transfer was resumed */
+    uint8_t resumes;
+    /** Last CoAP status received from the device */
+    int status;
+
+} s_lwm2m_fwupdate_progress_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MFirmwareUpdate Class.
+ *
+ *          A firmware update delivers one image to the package resource
+ *          (/5/0/0) of several devices using CoAP Block1 transfers. All
+ *          transfers send their blocks from the same mapped image. Each
+ *          device receives its blocks one after the other while the number
+ *          of devices with a block in flight is bounded. A device that does
+ *          not answer within the retransmission window is resumed at the
+ *          last acknowledged block later on.
+ *
+ *          The update is driven by the LWM2M Server it was started at.
+ */
+class LWM2MFirmwareUpdate
+{
+    friend class LWM2MServer;
+
+public:
+
+    /**
+     * \brief   Constructor to create a firmware update.
+     *
+     * \param   p_img   Mapped image to deliver. The image must remain open
+     *                  as long as the update is running.
+     * \param   p_cfg   Configuration or NULL to use the default values.
+     */
+    LWM2MFirmwareUpdate( const LWM2MFirmwareImage* p_img,
+            const s_lwm2m_fwupdate_cfg_t* p_cfg = NULL );
+
+
+    /**
+     * \brief   Default destructor of the firmware update.
+     */
+    virtual ~LWM2MFirmwareUpdate( void ) {};
+
+
+    /**
+     * \brief   Add a device the image shall be delivered to.
+     *
+     *          Devices can only be added as long as the update was not
+     *          started at a server.
+     *
+     * \param   devName  Name of the device.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int16_t addDevice( const std::string& devName );
+
+
+    /**
+     * \brief   Get the image delivered by the update.
+     *
+     * \return  The firmware image.
+     */
+    const LWM2MFirmwareImage* getImage( void ) const {return mp_img;}
+
+
+protected:
+
+    /**
+     * \brief   Get the progress of the transfer to a device.
+     *
+     * \param   devName     Name of the device.
+     * \param   p_progress  Progress structure to fill.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t getProgress( const std::string& devName,
+            s_lwm2m_fwupdate_progress_t* p_progress ) const;
+
+
+    /**
+     * \brief   Get the number of transfers in a specific state.
+     *
+     * \param   state   State to count the transfers for.
+     *
+     * \return  Number of transfers in the state.
+     */
+    uint32_t getCount( e_lwm2m_fwupdate_state_t state ) const;
+
+
+    /**
+     * \brief   Process timeouts and start further transfers.
+     *
+     * \param   p_srv   Server the update runs at.
+     * \param   now     Current time in ms.
+     */
+    void step( LWM2MServer* p_srv, uint64_t now );
+
+
+    /**
+     * \brief   Handle a received packet.
+     *
+     *          Checks if the packet answers one of the blocks in flight
+     *          and processes it in that case.
+     *
+     * \param   p_srv       Server the update runs at.
+     * \param   p_session   Connection the packet was received on.
+     * \param   p_buf       Packet data.
+     * \param   len         Length of the packet.
+     * \param   now         Current time in ms.
+     *
+     * \return  true if the packet belonged to the update.
+     */
+    bool handlePacket( LWM2MServer* p_srv, void* p_session, uint8_t* p_buf,
+            int len, uint64_t now );
+
+
+private:
+
+    /**
+     * Transfer of the image to a single device.
+     */
+    struct s_transfer_t
+    {
+        /* name of the device */
+        std::string devName;
+        /* session the current block was sent on */
+        void* p_session;
+        /* current block size */
+        uint16_t blockSize;
+        /* number of the block in flight */
+        uint32_t blockNum;
+        /* message ID of the block in flight */
+        uint16_t mid;
+        /* token of the block in flight */
+        uint32_t token;
+        /* number of retransmissions of the current block */
+        uint8_t retrans;
+        /* an empty ACK was received, waiting for the response */
+        bool acked;
+        /* time in ms to retransmit, give up or resume */
+        uint64_t timeout;
+        /* progress of the transfer */
+        s_lwm2m_fwupdate_progress_t progress;
+    };
+
+
+    /**
+     * \brief   Send the next block of a transfer using a new message ID.
+     */
+    void startBlock( LWM2MServer* p_srv, s_transfer_t* p_tr, uint64_t now );
+
+
+    /**
+     * \brief   (Re-)send the block in flight of a transfer.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int16_t sendBlock( LWM2MServer* p_srv, s_transfer_t* p_tr );
+
+
+    /**
+     * \brief   Send an empty ACK for a separate response.
+     */
+    void sendAck( void* p_session, uint16_t mid );
+
+
+    /**
+     * \brief   Remove the block in flight of a transfer.
+     */
+    void releaseBlock( s_transfer_t* p_tr );
+
+
+    /**
+     * \brief   Stall a transfer so that it is resumed later.
+     */
+    void stall( s_transfer_t* p_tr, uint64_t now );
+
+
+    /**
+     * \brief   Finish a transfer with a final state.
+     */
+    void finish( s_transfer_t* p_tr, e_lwm2m_fwupdate_state_t state,
+            int status );
+
+
+private:
+
+    /** Image to deliver */
+    const LWM2MFirmwareImage* mp_img;
+
+    /** Configuration */
+    s_lwm2m_fwupdate_cfg_t m_cfg;
+
+    /** Indicates if the update was started */
+    bool m_started;
+
+    /** Next token to use */
+    uint32_t m_nextToken;
+
+    /** Transfers by device name */
+    std::map< std::string, s_transfer_t > m_transfers;
+
+    /** Transfers waiting for a free in-flight slot */
+    std::deque< s_transfer_t* > m_pending;
+
+    /** Stalled transfers waiting to be resumed */
+    std::list< s_transfer_t* > m_stalled;
+
+    /** Transfers with a block in flight by message ID */
+    std::map< uint16_t, s_transfer_t* > m_midMap;
+
+    /** Transfers with a block in flight by token */
+    std::map< uint32_t, s_transfer_t* > m_tokenMap;
+
+    /** Buffer used to serialize the blocks */
+    std::vector< uint8_t > m_buffer;
+};
+
+#endif /* #ifndef __LWM2MFIRMWAREUPDATE_H__ */
@@ -0,0 +1,206 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MLockStats.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of the lock statistics of the LWM2M server.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string.h>
+#include "LWM2MLockStats.h"
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLockStats::LWM2MLockStats()
+*/
+LWM2MLockStats::LWM2MLockStats( void )
+    : mp_metrics( NULL )
+    , m_depth( 0 )
+    , m_holdStart( 0 )
+    , m_holder( 0 )
+{
+} /* LWM2MLockStats::LWM2MLockStats() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLockStats::lock()
+*/
+void LWM2MLockStats::lock( pthread_mutex_t* p_mutex, const char* p_func,
+        uint32_t line )
+{
+    uint64_t start = LWM2MMetrics::now();
+    uint32_t holder = 0;
+    bool contended = false;
+    uint64_t wait;
+
+    if( pthread_mutex_trylock( p_mutex ) != 0 )
+    {
+        /* the lock is held by another thread, the waiting time is
+         * accounted to the site holding it when the wait started */
+        holder = m_holder.load( std::memory_order_relaxed );
+        contended = true;
+        pthread_mutex_lock( p_mutex );
+    }
+
+    std::map< uint32_t, s_lwm2m_lock_site_t >::iterator it =
+            m_sites.find( line );
+    if( it == m_sites.end() )
+    {
+        s_lwm2m_lock_site_t site;
+
+        memset( &site, 0, sizeof(site) );
+        site.function = p_func;
+        site.line = line;
+        it = m_sites.insert( std::make_pair( line, site ) ).first;
+    }
+
+    if( m_depth++ > 0 )
+    {
+        it->second.recursive++;
+        return;
+    }
+
+    m_holdStart = LWM2MMetrics::now();
+    m_holder.store( line, std::memory_order_relaxed );
+    wait = m_holdStart - start;
+
+    it->second.acquisitions++;
+    it->second.waitTime += wait;
+    if( wait > it->second.maxWait )
+        it->second.maxWait = wait;
+
+    if( contended )
+    {
+        it->second.contended++;
+
+        std::map< uint32_t, s_lwm2m_lock_site_t >::iterator blk =
+                m_sites.find( holder );
+        if( blk != m_sites.end() )
+            blk->second.blockTime += wait;
+    }
+
+    if( mp_metrics != NULL )
+    {
+        mp_metrics->add( e_lwm2m_metric_lock_acquisitions );
+        if( contended )
+            mp_metrics->add( e_lwm2m_metric_lock_contended );
+        mp_metrics->record( e_lwm2m_histogram_lock_wait, wait );
+    }
+
+} /* LWM2MLockStats::lock() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLockStats::unlock()
+*/
+void LWM2MLockStats::unlock( pthread_mutex_t* p_mutex )
+{
+    uint64_t hold;
+
+    if( (m_depth > 0) && (--m_depth == 0) )
+    {
+        hold = LWM2MMetrics::now() - m_holdStart;
+
+        std::map< uint32_t, s_lwm2m_lock_site_t >::iterator it =
+                m_sites.find( m_holder.load( std::memory_order_relaxed ) );
+        if( it != m_sites.end() )
+        {
+            it->second.holdTime += hold;
+            if( hold > it->second.maxHold )
+                it->second.maxHold = hold;
+        }
+
+        if( mp_metrics != NULL )
+            mp_metrics->record( e_lwm2m_histogram_lock_hold, hold );
+
+        m_holder.store( 0, std::memory_order_relaxed );
+    }
+
+    pthread_mutex_unlock( p_mutex );
+
+} /* LWM2MLockStats::unlock() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLockStats::getSites()
+*/
+uint32_t LWM2MLockStats::getSites(
+        std::vector< s_lwm2m_lock_site_t >& sites ) const
+{
+    std::map< uint32_t, s_lwm2m_lock_site_t >::const_iterator it;
+
+    for( it = m_sites.begin(); it != m_sites.end(); ++it )
+        sites.push_back( it->second );
+
+    return m_sites.size();
+
+} /* LWM2MLockStats::getSites() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLockStats::reset()
+*/
+void LWM2MLockStats::reset( void )
+{
+    std::map< uint32_t, s_lwm2m_lock_site_t >::iterator it;
+
+    /* the sites stay known, the current holder keeps its start time */
+    for( it = m_sites.begin(); it != m_sites.end(); ++it )
+    {
+        const char* p_func = it->second.function;
+
+        memset( &it->second, 0, sizeof(it->second) );
+        it->second.function = p_func;
+        it->second.line = it->first;
+    }
+
+} /* LWM2MLockStats::reset() */
+
@@ -0,0 +1,190 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MLockStats.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of the lock statistics of the LWM2M server.
+ *
+ */
+
+
+#ifndef __LWM2MLOCKSTATS_H__
+#define __LWM2MLOCKSTATS_H__
+#ifndef __DECL_LWM2MLOCKSTATS_H__
+#define __DECL_LWM2MLOCKSTATS_H__ extern
+#endif /* #ifndef __DECL_LWM2MLOCKSTATS_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <map>
+#include <vector>
+#include "LWM2MMetrics.h"
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Statistics of a site the server lock is taken at, all times
+ *          in us.
+ */
+typedef struct
+{
+    /** Function taking the lock */
+    const char* function;
+    /** Line taking the lock */
+    uint32_t line;
+    /** Acquisitions of the lock that was not held by the thread */
+    uint64_t acquisitions;
+    /** Acquisitions of the lock that was held by the thread already */
+    uint64_t recursive;
+    /** Acquisitions that had to wait for another thread */
+    uint64_t contended;
+    /** Time waited for the lock */
+    uint64_t waitTime;
+    /** Longest wait for the lock */
+    uint64_t maxWait;
+    /** Time the lock was held */
+    uint64_t holdTime;
+    /** Longest time the lock was held */
+    uint64_t maxHold;
+    /** Time other threads waited while the lock was held by this site */
+    uint64_t blockTime;
+
+} s_lwm2m_lock_site_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MLockStats Class.
+ *
+ *          The statistics replace the plain locking of the recursive
+ *          server mutex when the server is built with
+ *          OPCUA_LWM2M_SERVER_LOCK_STATS. Every site taking the lock is
+ *          identified by its line. The statistics are updated while
+ *          holding the mutex so they need no locking on their own. Wait
+ *          and hold times are recorded in the metrics as well.
+ */
+class LWM2MLockStats
+{
+
+public:
+
+    /**
+     * \brief   Default constructor.
+     */
+    LWM2MLockStats( void );
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MLockStats( void ) {};
+
+
+    /**
+     * \brief   Set the metrics the wait and hold times are recorded in.
+     */
+    void setMetrics( LWM2MMetrics* p_metrics ) {mp_metrics = p_metrics;}
+
+
+    /**
+     * \brief   Take a mutex.
+     *
+     * \param   p_mutex     Recursive mutex to take.
+     * \param   p_func      Function taking the mutex.
+     * \param   line        Line taking the mutex.
+     */
+    void lock( pthread_mutex_t* p_mutex, const char* p_func, uint32_t line );
+
+
+    /**
+     * \brief   Release a mutex.
+     *
+     * \param   p_mutex     Mutex to release.
+     */
+    void unlock( pthread_mutex_t* p_mutex );
+
+
+    /**
+     * \brief   Get the statistics of the sites.
+     *
+     *          The mutex must be held by the caller.
+     *
+     * \param   sites   List to append the sites to.
+     *
+     * \return  Number of sites.
+     */
+    uint32_t getSites( std::vector< s_lwm2m_lock_site_t >& sites ) const;
+
+
+    /**
+     * \brief   Reset the statistics.
+     *
+     *          The mutex must be held by the caller.
+     */
+    void reset( void );
+
+
+private:
+
+    /** Statistics by line */
+    std::map< uint32_t, s_lwm2m_lock_site_t > m_sites;
+
+    /** Metrics to record the times in */
+    LWM2MMetrics* mp_metrics;
+
+    /** Recursion depth of the holding thread */
+    uint32_t m_depth;
+
+    /** Time in us the mutex was taken */
+    uint64_t m_holdStart;
+
+    /** Line holding the mutex or 0 */
+    std::atomic< uint32_t > m_holder;
+};
+
+#endif /* #ifndef __LWM2MLOCKSTATS_H__ */
+
@@ -0,0 +1,101 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MLoopObserver.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Definition of a LWM2M Server Loop Observer.
+ *
+ */
+
+
+#ifndef __LWM2MLOOPOBSERVER_H__
+#define __LWM2MLOOPOBSERVER_H__
+#ifndef __DECL_LWM2MLOOPOBSERVER_H__
+#define __DECL_LWM2MLOOPOBSERVER_H__ extern
+#endif /* #ifndef __DECL_LWM2MLOOPOBSERVER_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include "LWM2MLoopProfiler.h"
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MLoopObserver Class.
+ *
+ *          A LWM2M Loop Observer is informed about every iteration of
+ *          the server loop that was busy for longer than the configured
+ *          budget.
+ */
+class LWM2MLoopObserver
+{
+
+public:
+
+    /**
+     * \brief   Default constructor.
+     */
+    LWM2MLoopObserver( void ) {};
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MLoopObserver( void ) {};
+
+
+    /**
+     * \brief   An iteration exceeded the budget.
+     *
+     *          The observer is called by the server loop without holding
+     *          the lock of the server.
+     *
+     * \param   p_sample  Timing of the iteration.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    virtual int8_t overrun( const s_lwm2m_loop_sample_t* p_sample ) = 0;
+
+};
+
+#endif /* #ifndef __LWM2MLOOPOBSERVER_H__ */
+
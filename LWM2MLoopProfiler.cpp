@@ -0,0 +1,285 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MLoopProfiler.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of the timing of the server loop.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string.h>
+#include "LWM2MLoopProfiler.h"
+#include "LWM2MMetrics.h"
+
+/*
+ * --- Local Variables ------------------------------------------------------ *
+ */
+
+/** Names of the phases */
+static const char* const gPhaseNames[e_lwm2m_loop_phase_max] =
+{
+    "lock",
+    "events",
+    "deleted",
+    "firmware",
+    "bulk",
+    "subscriptions",
+    "retrans",
+    "step",
+    "queues",
+    "wait",
+    "packet",
+};
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::LWM2MLoopProfiler()
+*/
+LWM2MLoopProfiler::LWM2MLoopProfiler( void )
+    : m_last( 0 )
+    , m_depth( 0 )
+    , m_overruns( 0 )
+    , m_active( 0 )
+{
+    s_lwm2m_loop_config_t cfg;
+
+    cfg.budget = LWM2M_LOOP_BUDGET_US;
+    cfg.slow = LWM2M_LOOP_SLOW_US;
+    cfg.history = LWM2M_LOOP_HISTORY;
+    cfg.slowLog = LWM2M_LOOP_SLOW_LOG;
+    memset( &m_cur, 0, sizeof(m_cur) );
+    setConfig( cfg );
+
+} /* LWM2MLoopProfiler::LWM2MLoopProfiler() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::setConfig()
+*/
+int8_t LWM2MLoopProfiler::setConfig( const s_lwm2m_loop_config_t& cfg )
+{
+    if( (cfg.history == 0) || (cfg.slowLog == 0) )
+        return -1;
+
+    m_cfg = cfg;
+    m_history.assign( cfg.history, s_lwm2m_loop_sample_t() );
+    m_histNext = 0;
+    m_histCnt = 0;
+    m_slow.assign( cfg.slowLog, s_lwm2m_loop_sample_t() );
+    m_slowNext = 0;
+    m_slowCnt = 0;
+    m_overruns = 0;
+
+    return 0;
+
+} /* LWM2MLoopProfiler::setConfig() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::begin()
+*/
+void LWM2MLoopProfiler::begin( void )
+{
+    if( m_depth++ > 0 )
+        return;
+
+    memset( &m_cur, 0, sizeof(m_cur) );
+    m_cur.start = LWM2MMetrics::now();
+    m_last = m_cur.start;
+    m_active.store( m_last, std::memory_order_relaxed );
+
+} /* LWM2MLoopProfiler::begin() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::mark()
+*/
+void LWM2MLoopProfiler::mark( e_lwm2m_loop_phase_t phase )
+{
+    uint64_t now;
+
+    if( m_depth != 1 )
+        return;
+
+    now = LWM2MMetrics::now();
+    m_cur.phases[phase] += (uint32_t)(now - m_last);
+    m_last = now;
+    m_active.store( now, std::memory_order_relaxed );
+
+} /* LWM2MLoopProfiler::mark() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::end()
+*/
+int8_t LWM2MLoopProfiler::end( s_lwm2m_loop_sample_t* p_sample )
+{
+    uint32_t i;
+
+    if( m_depth == 0 )
+        return -1;
+
+    if( --m_depth > 0 )
+        return -1;
+
+    m_active.store( 0, std::memory_order_relaxed );
+
+    m_cur.busy = 0;
+    for( i = 0; i < e_lwm2m_loop_phase_max; i++ )
+    {
+        if( i != e_lwm2m_loop_phase_wait )
+            m_cur.busy += m_cur.phases[i];
+    }
+
+    push( m_history, m_histNext, m_histCnt, m_cur );
+    if( m_cur.busy >= m_cfg.slow )
+        push( m_slow, m_slowNext, m_slowCnt, m_cur );
+
+    *p_sample = m_cur;
+
+    if( (m_cfg.budget != 0) && (m_cur.busy > m_cfg.budget) )
+    {
+        m_overruns++;
+        return 1;
+    }
+    return 0;
+
+} /* LWM2MLoopProfiler::end() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::getHistory()
+*/
+uint32_t LWM2MLoopProfiler::getHistory(
+        std::vector< s_lwm2m_loop_sample_t >& samples ) const
+{
+    return copy( m_history, m_histNext, m_histCnt, samples );
+
+} /* LWM2MLoopProfiler::getHistory() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::getSlowLog()
+*/
+uint32_t LWM2MLoopProfiler::getSlowLog(
+        std::vector< s_lwm2m_loop_sample_t >& samples ) const
+{
+    return copy( m_slow, m_slowNext, m_slowCnt, samples );
+
+} /* LWM2MLoopProfiler::getSlowLog() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::getStall()
+*/
+uint64_t LWM2MLoopProfiler::getStall( void ) const
+{
+    uint64_t active = m_active.load( std::memory_order_relaxed );
+    uint64_t now;
+
+    if( active == 0 )
+        return 0;
+
+    now = LWM2MMetrics::now();
+    return (now > active) ? (now - active) : 0;
+
+} /* LWM2MLoopProfiler::getStall() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::getPhaseName()
+*/
+const char* LWM2MLoopProfiler::getPhaseName( e_lwm2m_loop_phase_t phase )
+{
+    if( phase >= e_lwm2m_loop_phase_max )
+        return "";
+
+    return gPhaseNames[phase];
+
+} /* LWM2MLoopProfiler::getPhaseName() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::push()
+*/
+void LWM2MLoopProfiler::push( std::vector< s_lwm2m_loop_sample_t >& ring,
+        size_t& next, size_t& cnt, const s_lwm2m_loop_sample_t& sample )
+{
+    ring[next] = sample;
+    next = (next + 1) % ring.size();
+    if( cnt < ring.size() )
+        cnt++;
+
+} /* LWM2MLoopProfiler::push() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MLoopProfiler::copy()
+*/
+uint32_t LWM2MLoopProfiler::copy(
+        const std::vector< s_lwm2m_loop_sample_t >& ring, size_t next,
+        size_t cnt, std::vector< s_lwm2m_loop_sample_t >& samples )
+{
+    size_t i;
+
+    for( i = 0; i < cnt; i++ )
+        samples.push_back( ring[(next + ring.size() - cnt + i) %
+                ring.size()] );
+
+    return (uint32_t)cnt;
+
+} /* LWM2MLoopProfiler::copy() */
+
@@ -0,0 +1,334 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MLoopProfiler.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of the timing of the server loop.
+ *
+ */
+
+
+#ifndef __LWM2MLOOPPROFILER_H__
+#define __LWM2MLOOPPROFILER_H__
+#ifndef __DECL_LWM2MLOOPPROFILER_H__
+#define __DECL_LWM2MLOOPPROFILER_H__ extern
+#endif /* #ifndef __DECL_LWM2MLOOPPROFILER_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Default time in us an iteration may be busy before it is reported */
+#define LWM2M_LOOP_BUDGET_US                    100000
+
+/** Default time in us an iteration is busy to be logged as slow */
+#define LWM2M_LOOP_SLOW_US                      20000
+
+/** Default number of iterations kept */
+#define LWM2M_LOOP_HISTORY                      64
+
+/** Default number of slow iterations kept */
+#define LWM2M_LOOP_SLOW_LOG                     16
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Phases of an iteration of the server loop.
+ */
+typedef enum
+{
+    /** Waiting for the lock of the server */
+    e_lwm2m_loop_phase_lock,
+    /** Device events passed to the server observers */
+    e_lwm2m_loop_phase_events,
+    /** Removal of deleted devices and objects */
+    e_lwm2m_loop_phase_deleted,
+    /** Firmware updates */
+    e_lwm2m_loop_phase_firmware,
+    /** Bulk operations */
+    e_lwm2m_loop_phase_bulk,
+    /** Scheduled observations */
+    e_lwm2m_loop_phase_subscriptions,
+    /** Retransmissions */
+    e_lwm2m_loop_phase_retrans,
+    /** Step of the LWM2M context */
+    e_lwm2m_loop_phase_step,
+    /** Dispatch of queued requests */
+    e_lwm2m_loop_phase_queues,
+    /** Wait for packets */
+    e_lwm2m_loop_phase_wait,
+    /** Reception and handling of a packet */
+    e_lwm2m_loop_phase_packet,
+
+    e_lwm2m_loop_phase_max
+
+} e_lwm2m_loop_phase_t;
+
+
+/**
+ * \brief   Timing of an iteration of the server loop.
+ */
+typedef struct
+{
+    /** Monotonic time in us the iteration started */
+    uint64_t start;
+    /** Duration of the phases in us */
+    uint32_t phases[e_lwm2m_loop_phase_max];
+    /** Duration in us without the wait for packets */
+    uint32_t busy;
+
+} s_lwm2m_loop_sample_t;
+
+
+/**
+ * \brief   Configuration of the loop timing.
+ */
+typedef struct
+{
+    /** Time in us an iteration may be busy before the loop observers are
+     *  notified, 0 to disable */
+    uint32_t budget;
+    /** Time in us an iteration must be busy to be logged as slow */
+    uint32_t slow;
+    /** Number of iterations kept */
+    uint16_t history;
+    /** Number of slow iterations kept */
+    uint16_t slowLog;
+
+} s_lwm2m_loop_config_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MLoopProfiler Class.
+ *
+ *          The profiler measures the phases of the iterations of the
+ *          server loop with a monotonic clock. The last iterations and
+ *          the last slow iterations are kept in ring buffers. Nested
+ *          iterations, e.g. of a blocking request started by an observer,
+ *          are part of the phase of the outer iteration. The time since
+ *          the last finished phase can be read from any thread without
+ *          locking to detect a loop that got stuck.
+ */
+class LWM2MLoopProfiler
+{
+
+public:
+
+    /**
+     * \brief   Default constructor.
+     */
+    LWM2MLoopProfiler( void );
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MLoopProfiler( void ) {};
+
+
+    /**
+     * \brief   Set the configuration.
+     *
+     *          The kept iterations are cleared.
+     *
+     * \param   cfg     Configuration to use.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t setConfig( const s_lwm2m_loop_config_t& cfg );
+
+
+    /**
+     * \brief   Get the configuration.
+     */
+    const s_lwm2m_loop_config_t& getConfig( void ) const {return m_cfg;}
+
+
+    /**
+     * \brief   Start an iteration.
+     */
+    void begin( void );
+
+
+    /**
+     * \brief   Finish a phase of the iteration.
+     *
+     *          The time since the previous phase is added to the phase.
+     *
+     * \param   phase   Phase that finished.
+     */
+    void mark( e_lwm2m_loop_phase_t phase );
+
+
+    /**
+     * \brief   Indicate that the loop waits for packets.
+     *
+     *          The loop is not reported as stuck until the next phase.
+     */
+    void suspend( void ) {
+        if( m_depth == 1 )
+            m_active.store( 0, std::memory_order_relaxed );
+    }
+
+
+    /**
+     * \brief   Finish an iteration.
+     *
+     * \param   p_sample    Filled with the timing of the iteration.
+     *
+     * \return  1 if the iteration exceeded the budget, 0 if not or
+     *          negative value for a nested iteration.
+     */
+    int8_t end( s_lwm2m_loop_sample_t* p_sample );
+
+
+    /**
+     * \brief   Get the last iterations.
+     *
+     * \param   samples List to append the iterations to, oldest first.
+     *
+     * \return  Number of iterations.
+     */
+    uint32_t getHistory( std::vector< s_lwm2m_loop_sample_t >& samples ) const;
+
+
+    /**
+     * \brief   Get the last slow iterations.
+     *
+     * \param   samples List to append the iterations to, oldest first.
+     *
+     * \return  Number of iterations.
+     */
+    uint32_t getSlowLog( std::vector< s_lwm2m_loop_sample_t >& samples ) const;
+
+
+    /**
+     * \brief   Get the number of iterations that exceeded the budget.
+     */
+    uint32_t getOverruns( void ) const {return m_overruns;}
+
+
+    /**
+     * \brief   Get the time the current phase is running.
+     *
+     *          Can be called from any thread without locking.
+     *
+     * \return  Time in us since the last finished phase or 0 if the
+     *          loop waits for packets or does not run.
+     */
+    uint64_t getStall( void ) const;
+
+
+    /**
+     * \brief   Get the name of a phase.
+     */
+    static const char* getPhaseName( e_lwm2m_loop_phase_t phase );
+
+
+private:
+
+    /**
+     * \brief   Add an iteration to a ring buffer.
+     */
+    static void push( std::vector< s_lwm2m_loop_sample_t >& ring,
+            size_t& next, size_t& cnt, const s_lwm2m_loop_sample_t& sample );
+
+
+    /**
+     * \brief   Copy a ring buffer oldest first.
+     */
+    static uint32_t copy( const std::vector< s_lwm2m_loop_sample_t >& ring,
+            size_t next, size_t cnt,
+            std::vector< s_lwm2m_loop_sample_t >& samples );
+
+
+private:
+
+    /** Configuration */
+    s_lwm2m_loop_config_t m_cfg;
+
+    /** Iteration that is running */
+    s_lwm2m_loop_sample_t m_cur;
+
+    /** Time in us the last phase finished */
+    uint64_t m_last;
+
+    /** Nesting of the iterations */
+    uint32_t m_depth;
+
+    /** Number of iterations that exceeded the budget */
+    uint32_t m_overruns;
+
+    /** Time in us the last phase finished, 0 while waiting */
+    std::atomic< uint64_t > m_active;
+
+    /** Last iterations */
+    std::vector< s_lwm2m_loop_sample_t > m_history;
+
+    /** Position of the next iteration in the history */
+    size_t m_histNext;
+
+    /** Number of iterations in the history */
+    size_t m_histCnt;
+
+    /** Last slow iterations */
+    std::vector< s_lwm2m_loop_sample_t > m_slow;
+
+    /** Position of the next iteration in the slow log */
+    size_t m_slowNext;
+
+    /** Number of iterations in the slow log */
+    size_t m_slowCnt;
+};
+
+#endif /* #ifndef __LWM2MLOOPPROFILER_H__ */
+
@@ -0,0 +1,300 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MMetrics.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of the metrics of the LWM2M server.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "LWM2MMetrics.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Number of sub-buckets per power of two */
+#define LWM2M_METRICS_SUB_COUNT                 (1 << LWM2M_METRICS_SUB_BITS)
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_percentile()
+*/
+static uint32_t prv_percentile( const uint64_t* p_buckets, uint64_t count,
+        uint32_t permille )
+{
+    uint64_t rank = (count * permille + 999) / 1000;
+    uint64_t sum = 0;
+    uint32_t i;
+
+    for( i = 0; i < LWM2M_METRICS_BUCKETS; i++ )
+    {
+        sum += p_buckets[i];
+        if( (sum >= rank) && (sum > 0) )
+            return i;
+    }
+    return LWM2M_METRICS_BUCKETS - 1;
+
+} /* prv_percentile() */
+
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MMetrics::LWM2MMetrics()
+*/
+LWM2MMetrics::LWM2MMetrics( void )
+{
+    reset();
+
+} /* LWM2MMetrics::LWM2MMetrics() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MMetrics::record()
+*/
+void LWM2MMetrics::record( e_lwm2m_histogram_t hist, uint64_t val )
+{
+    s_histogram_t& h = m_shards[shard()].histograms[hist];
+    uint64_t cur;
+
+    h.buckets[bucket( val )].fetch_add( 1, std::memory_order_relaxed );
+    h.sum.fetch_add( val, std::memory_order_relaxed );
+
+    cur = h.min.load( std::memory_order_relaxed );
+    while( (val < cur) && !h.min.compare_exchange_weak( cur, val,
+            std::memory_order_relaxed ) );
+
+    cur = h.max.load( std::memory_order_relaxed );
+    while( (val > cur) && !h.max.compare_exchange_weak( cur, val,
+            std::memory_order_relaxed ) );
+
+} /* LWM2MMetrics::record() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MMetrics::snapshot()
+*/
+void LWM2MMetrics::snapshot( s_lwm2m_metrics_t* p_metrics ) const
+{
+    uint64_t buckets[LWM2M_METRICS_BUCKETS];
+    uint32_t i;
+    uint32_t s;
+    uint32_t b;
+
+    memset( p_metrics, 0, sizeof(s_lwm2m_metrics_t) );
+    p_metrics->time = (now() - m_start.load( std::memory_order_relaxed )) /
+            1000;
+
+    for( s = 0; s < LWM2M_METRICS_SHARDS; s++ )
+    {
+        for( i = 0; i < e_lwm2m_metric_max; i++ )
+            p_metrics->counters[i] += m_shards[s].counters[i].load(
+                    std::memory_order_relaxed );
+    }
+
+    for( i = 0; i < e_lwm2m_histogram_max; i++ )
+    {
+        s_lwm2m_histogram_stats_t* p_stats = &p_metrics->histograms[i];
+
+        memset( buckets, 0, sizeof(buckets) );
+        p_stats->min = UINT64_MAX;
+        for( s = 0; s < LWM2M_METRICS_SHARDS; s++ )
+        {
+            const s_histogram_t& h = m_shards[s].histograms[i];
+            uint64_t min = h.min.load( std::memory_order_relaxed );
+            uint64_t max = h.max.load( std::memory_order_relaxed );
+
+            for( b = 0; b < LWM2M_METRICS_BUCKETS; b++ )
+                buckets[b] += h.buckets[b].load( std::memory_order_relaxed );
+            p_stats->sum += h.sum.load( std::memory_order_relaxed );
+            if( min < p_stats->min )
+                p_stats->min = min;
+            if( max > p_stats->max )
+                p_stats->max = max;
+        }
+
+        for( b = 0; b < LWM2M_METRICS_BUCKETS; b++ )
+            p_stats->count += buckets[b];
+
+        if( p_stats->count == 0 )
+        {
+            p_stats->min = 0;
+            continue;
+        }
+
+        /* the bucket values are bounded by the largest value seen */
+        p_stats->p50 = bucketValue( prv_percentile( buckets,
+                p_stats->count, 500 ) );
+        p_stats->p90 = bucketValue( prv_percentile( buckets,
+                p_stats->count, 900 ) );
+        p_stats->p99 = bucketValue( prv_percentile( buckets,
+                p_stats->count, 990 ) );
+        p_stats->p999 = bucketValue( prv_percentile( buckets,
+                p_stats->count, 999 ) );
+        if( p_stats->p50 > p_stats->max )
+            p_stats->p50 = p_stats->max;
+        if( p_stats->p90 > p_stats->max )
+            p_stats->p90 = p_stats->max;
+        if( p_stats->p99 > p_stats->max )
+            p_stats->p99 = p_stats->max;
+        if( p_stats->p999 > p_stats->max )
+            p_stats->p999 = p_stats->max;
+    }
+
+} /* LWM2MMetrics::snapshot() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MMetrics::reset()
+*/
+void LWM2MMetrics::reset( void )
+{
+    uint32_t s;
+    uint32_t i;
+    uint32_t b;
+
+    for( s = 0; s < LWM2M_METRICS_SHARDS; s++ )
+    {
+        for( i = 0; i < e_lwm2m_metric_max; i++ )
+            m_shards[s].counters[i].store( 0, std::memory_order_relaxed );
+
+        for( i = 0; i < e_lwm2m_histogram_max; i++ )
+        {
+            s_histogram_t& h = m_shards[s].histograms[i];
+            for( b = 0; b < LWM2M_METRICS_BUCKETS; b++ )
+                h.buckets[b].store( 0, std::memory_order_relaxed );
+            h.sum.store( 0, std::memory_order_relaxed );
+            h.min.store( UINT64_MAX, std::memory_order_relaxed );
+            h.max.store( 0, std::memory_order_relaxed );
+        }
+    }
+    m_start.store( now(), std::memory_order_relaxed );
+
+} /* LWM2MMetrics::reset() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MMetrics::now()
+*/
+uint64_t LWM2MMetrics::now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+} /* LWM2MMetrics::now() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MMetrics::bucket()
+*/
+uint32_t LWM2MMetrics::bucket( uint64_t val )
+{
+    uint32_t exp;
+
+    if( val < LWM2M_METRICS_SUB_COUNT )
+        return (uint32_t)val;
+
+    if( val >> (LWM2M_METRICS_MAX_EXP + 1) )
+        return LWM2M_METRICS_BUCKETS - 1;
+
+    /* the power of two selects the group, the following bits the
+     * sub-bucket in the group */
+    exp = 63 - __builtin_clzll( val );
+    return ((exp - LWM2M_METRICS_SUB_BITS + 1) << LWM2M_METRICS_SUB_BITS) +
+            (uint32_t)((val >> (exp - LWM2M_METRICS_SUB_BITS)) &
+            (LWM2M_METRICS_SUB_COUNT - 1));
+
+} /* LWM2MMetrics::bucket() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MMetrics::bucketValue()
+*/
+uint64_t LWM2MMetrics::bucketValue( uint32_t idx )
+{
+    uint32_t exp;
+    uint64_t sub;
+
+    if( idx < LWM2M_METRICS_SUB_COUNT )
+        return idx;
+
+    exp = (idx >> LWM2M_METRICS_SUB_BITS) + LWM2M_METRICS_SUB_BITS - 1;
+    sub = idx & (LWM2M_METRICS_SUB_COUNT - 1);
+    return ((LWM2M_METRICS_SUB_COUNT + sub + 1) <<
+            (exp - LWM2M_METRICS_SUB_BITS)) - 1;
+
+} /* LWM2MMetrics::bucketValue() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MMetrics::shard()
+*/
+uint32_t LWM2MMetrics::shard( void )
+{
+    static std::atomic< uint32_t > next( 0 );
+    static thread_local uint32_t idx =
+            next.fetch_add( 1, std::memory_order_relaxed ) %
+            LWM2M_METRICS_SHARDS;
+
+    return idx;
+
+} /* LWM2MMetrics::shard() */
+
@@ -0,0 +1,338 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MMetrics.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of the metrics of the LWM2M server.
+ *
+ */
+
+
+#ifndef __LWM2MMETRICS_H__
+#define __LWM2MMETRICS_H__
+#ifndef __DECL_LWM2MMETRICS_H__
+#define __DECL_LWM2MMETRICS_H__ extern
+#endif /* #ifndef __DECL_LWM2MMETRICS_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Number of shards the threads are spread to */
+#define LWM2M_METRICS_SHARDS                    4
+
+/** Sub-buckets per power of two, the relative error is below 1/8 */
+#define LWM2M_METRICS_SUB_BITS                  3
+
+/** Highest power of two of a histogram value in us */
+#define LWM2M_METRICS_MAX_EXP                   40
+
+/** Number of buckets of a histogram */
+#define LWM2M_METRICS_BUCKETS                   \
+    ((LWM2M_METRICS_MAX_EXP - LWM2M_METRICS_SUB_BITS + 2) << \
+     LWM2M_METRICS_SUB_BITS)
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Counters of the server.
+ */
+typedef enum
+{
+    /** Packets received */
+    e_lwm2m_metric_packets_in,
+    /** Bytes received */
+    e_lwm2m_metric_bytes_in,
+    /** Requests sent to devices including retransmissions */
+    e_lwm2m_metric_packets_out,
+    /** Bytes of the requests sent to devices */
+    e_lwm2m_metric_bytes_out,
+    /** Registrations of devices */
+    e_lwm2m_metric_registrations,
+    /** Registration updates of devices */
+    e_lwm2m_metric_updates,
+    /** Deregistrations of devices */
+    e_lwm2m_metric_deregistrations,
+    /** Requests started by the API */
+    e_lwm2m_metric_requests,
+    /** Retransmissions of requests */
+    e_lwm2m_metric_retransmissions,
+    /** Requests without an answer after all retransmissions */
+    e_lwm2m_metric_timeouts,
+    /** Notifications of observations */
+    e_lwm2m_metric_notifications,
+    /** Acquisitions of the server lock, only counted with
+     *  OPCUA_LWM2M_SERVER_LOCK_STATS */
+    e_lwm2m_metric_lock_acquisitions,
+    /** Acquisitions of the server lock that had to wait */
+    e_lwm2m_metric_lock_contended,
+
+    e_lwm2m_metric_max
+
+} e_lwm2m_metric_t;
+
+
+/**
+ * \brief   Latency histograms of the server.
+ */
+typedef enum
+{
+    /** Time of blocking API requests */
+    e_lwm2m_histogram_request,
+    /** Round trip time of requests to devices */
+    e_lwm2m_histogram_rtt,
+    /** Processing time of a server loop without the wait for packets */
+    e_lwm2m_histogram_loop,
+    /** Time waited for the server lock, only recorded with
+     *  OPCUA_LWM2M_SERVER_LOCK_STATS */
+    e_lwm2m_histogram_lock_wait,
+    /** Time the server lock was held */
+    e_lwm2m_histogram_lock_hold,
+
+    e_lwm2m_histogram_max
+
+} e_lwm2m_histogram_t;
+
+
+/**
+ * \brief   Summary of a latency histogram, all values in us.
+ */
+typedef struct
+{
+    /** Number of recorded values */
+    uint64_t count;
+    /** Sum of the recorded values */
+    uint64_t sum;
+    /** Smallest recorded value */
+    uint64_t min;
+    /** Largest recorded value */
+    uint64_t max;
+    /** Median */
+    uint64_t p50;
+    /** 90th percentile */
+    uint64_t p90;
+    /** 99th percentile */
+    uint64_t p99;
+    /** 99.9th percentile */
+    uint64_t p999;
+
+} s_lwm2m_histogram_stats_t;
+
+
+/**
+ * \brief   Snapshot of the metrics of the server.
+ */
+typedef struct
+{
+    /** Time in ms since the metrics were reset */
+    uint64_t time;
+
+    /** Counters since the metrics were reset */
+    uint64_t counters[e_lwm2m_metric_max];
+
+    /** Latency histograms since the metrics were reset */
+    s_lwm2m_histogram_stats_t histograms[e_lwm2m_histogram_max];
+
+    /** Registered devices */
+    uint32_t devices;
+
+    /** Outstanding requests to devices */
+    uint32_t transactions;
+
+    /** Requests waiting in the queues of the devices */
+    uint32_t queued;
+
+    /** Active observations */
+    uint32_t observations;
+
+    /** Devices and objects waiting to be deleted */
+    uint32_t deletions;
+
+    /** Connections of the wakaama core */
+    uint32_t connections;
+
+    /** Peers with a round trip time estimate */
+    uint32_t peers;
+
+} s_lwm2m_metrics_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MMetrics Class.
+ *
+ *          Counters and histograms are spread over shards that are
+ *          assigned to the threads on their first use. They are updated
+ *          with relaxed atomic operations so that recording neither locks
+ *          nor shares a cache line between the server thread and the
+ *          threads calling the API. Histograms use buckets with a fixed
+ *          relative precision per power of two. A snapshot sums up the
+ *          shards.
+ */
+class LWM2MMetrics
+{
+
+public:
+
+    /**
+     * \brief   Default constructor.
+     */
+    LWM2MMetrics( void );
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MMetrics( void ) {};
+
+
+    /**
+     * \brief   Add to a counter.
+     *
+     * \param   metric  Counter to add to.
+     * \param   val     Value to add.
+     */
+    void add( e_lwm2m_metric_t metric, uint64_t val = 1 ) {
+        m_shards[shard()].counters[metric].fetch_add( val,
+                std::memory_order_relaxed );
+    }
+
+
+    /**
+     * \brief   Record a latency.
+     *
+     * \param   hist    Histogram to record the value in.
+     * \param   val     Latency in us.
+     */
+    void record( e_lwm2m_histogram_t hist, uint64_t val );
+
+
+    /**
+     * \brief   Get a snapshot of the metrics.
+     *
+     *          The gauges of the snapshot are left to the server.
+     *
+     * \param   p_metrics   Snapshot to fill.
+     */
+    void snapshot( s_lwm2m_metrics_t* p_metrics ) const;
+
+
+    /**
+     * \brief   Reset all counters and histograms.
+     */
+    void reset( void );
+
+
+    /**
+     * \brief   Get the current time.
+     *
+     * \return  Monotonic time in us.
+     */
+    static uint64_t now( void );
+
+
+private:
+
+    /**
+     * \brief   Get the bucket of a value.
+     */
+    static uint32_t bucket( uint64_t val );
+
+
+    /**
+     * \brief   Get the highest value of a bucket.
+     */
+    static uint64_t bucketValue( uint32_t idx );
+
+
+    /**
+     * \brief   Get the shard of the calling thread.
+     */
+    static uint32_t shard( void );
+
+
+private:
+
+    /**
+     * Histogram of a shard.
+     */
+    struct s_histogram_t
+    {
+        /* number of values per bucket */
+        std::atomic< uint64_t > buckets[LWM2M_METRICS_BUCKETS];
+        /* sum of the values */
+        std::atomic< uint64_t > sum;
+        /* smallest value */
+        std::atomic< uint64_t > min;
+        /* largest value */
+        std::atomic< uint64_t > max;
+    };
+
+    /**
+     * Metrics recorded by a group of threads.
+     */
+    struct s_shard_t
+    {
+        /* keeps the counters off the cache line of the previous shard */
+        uint8_t pad[64];
+        /* counters */
+        std::atomic< uint64_t > counters[e_lwm2m_metric_max];
+        /* latency histograms */
+        s_histogram_t histograms[e_lwm2m_histogram_max];
+    };
+
+    /** Shards of the metrics */
+    s_shard_t m_shards[LWM2M_METRICS_SHARDS];
+
+    /** Time in us of the last reset */
+    std::atomic< uint64_t > m_start;
+};
+
+#endif /* #ifndef __LWM2MMETRICS_H__ */
+
@@ -51,6 +51,7 @@
 #include <vector>
 #include "LWM2MObject.h"
 #include "LWM2MDevice.h"
+#include "LWM2MServer.h"
 
 /*
  * --- Methods Definition ----------------------------------------------------- *
@@ -113,3 +114,41 @@ LWM2MResource* LWM2MObject::getResource( uint16_t resID )
 } /* LWM2MObject::getResource() */
 
 
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MObject::discover()
+*/
+int8_t LWM2MObject::discover( void )
+{
+    LWM2MServer* p_srv = getServer();
+
+    if( m_discovered )
+        return 0;
+
+    if( p_srv == NULL )
+        return -1;
+
+    return p_srv->discover( this );
+
+} /* LWM2MObject::discover() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MObject::getMemSize()
+*/
+size_t LWM2MObject::getMemSize( void ) const
+{
+    size_t size = sizeof( LWM2MObject ) +
+        m_resVect.capacity() * sizeof( LWM2MResource* );
+
+    std::vector< LWM2MResource* >::const_iterator it = resourceStart();
+    while( it != resourceEnd() )
+    {
+        size += (*it)->getMemSize();
+        it++;
+    }
+
+    return size;
+
+} /* LWM2MObject::getMemSize() */
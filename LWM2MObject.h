@@ -80,6 +80,7 @@ class LWM2MObject
 {
     friend class LWM2MDevice;
     friend class LWM2MResource;
+    friend class LWM2MServer;
 
 public:
 
@@ -89,6 +90,7 @@ public:
     LWM2MObject( void )
         : m_objId( 0 )
         , m_instId( 0 )
+        , m_discovered( false )
         , mp_parent(NULL ){
 
         /* clear resource vector */
@@ -102,6 +104,7 @@ public:
     LWM2MObject( uint16_t objId, uint8_t instId )
         : m_objId( objId )
         , m_instId( instId )
+        , m_discovered( false )
         , mp_parent(NULL ){
 
         /* clear resource vector */
@@ -185,6 +188,37 @@ public:
     LWM2MResource* getResource( uint16_t resID );
 
 
+    /**
+     * \brief   Check if the resources of the object were discovered.
+     *
+     * \return  true if the resources were discovered.
+     */
+    bool isDiscovered( void ) const {return m_discovered;}
+
+
+    /**
+     * \brief   Get the memory used by the object and its resources.
+     *
+     * \return  Size of the object in bytes.
+     */
+    size_t getMemSize( void ) const;
+
+
+    /**
+     * \brief   Discover the resources of the object.
+     *
+     *          The resources are created from a LWM2M Discover of the
+     *          object. The result is cached per device type, so only the
+     *          first device of a type is queried. Call this function
+     *          before the resources are accessed for the first time. It
+     *          returns immediately if the resources were already
+     *          discovered.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t discover( void );
+
+
     /**
      * \brief   Get the begin of the registered resources.
      *
@@ -215,6 +249,12 @@ protected:
     void setParent( const LWM2MDevice* p_parent ) {mp_parent = p_parent;};
 
 
+    /**
+     * \brief   Mark the resources as discovered.
+     */
+    void setDiscovered( void ) {m_discovered = true;};
+
+
 private:
 
     /** Object ID */
@@ -223,6 +263,9 @@ private:
     /** Instance ID */
     uint8_t m_instId;
 
+    /** Resources were discovered */
+    bool m_discovered;
+
     /** parent object */
     const LWM2MDevice* mp_parent;
 
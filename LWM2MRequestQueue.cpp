@@ -0,0 +1,237 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MRequestQueue.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of a queue for requests to a LWM2M device.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include "LWM2MRequestQueue.h"
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRequestQueue::push()
+*/
+void LWM2MRequestQueue::push( const s_lwm2m_request_t& req )
+{
+    m_queue.push_back( req );
+    m_clsQueued[req.cls]++;
+    if( m_queue.size() > m_maxQueued )
+        m_maxQueued = m_queue.size();
+
+} /* LWM2MRequestQueue::push() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRequestQueue::pop()
+*/
+bool LWM2MRequestQueue::pop( e_lwm2m_dispatch_t dispatch,
+        s_lwm2m_request_t& req )
+{
+    std::deque< s_lwm2m_request_t >::iterator it;
+    std::deque< s_lwm2m_request_t >::iterator next;
+
+    if( m_queue.empty() )
+        return false;
+
+    next = m_queue.begin();
+    if( dispatch == e_lwm2m_dispatch_priority )
+    {
+        /* the first request of the highest priority */
+        for( it = m_queue.begin(); it != m_queue.end(); ++it )
+        {
+            if( getPriority( it->type ) < getPriority( next->type ) )
+                next = it;
+        }
+    }
+
+    req = *next;
+    m_queue.erase( next );
+    m_clsQueued[req.cls]--;
+    return true;
+
+} /* LWM2MRequestQueue::pop() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRequestQueue::pop()
+*/
+bool LWM2MRequestQueue::pop( e_lwm2m_dispatch_t dispatch,
+        e_lwm2m_request_class_t cls, s_lwm2m_request_t& req )
+{
+    std::deque< s_lwm2m_request_t >::iterator it;
+    std::deque< s_lwm2m_request_t >::iterator next = m_queue.end();
+
+    if( m_clsQueued[cls] == 0 )
+        return false;
+
+    for( it = m_queue.begin(); it != m_queue.end(); ++it )
+    {
+        if( it->cls != cls )
+            continue;
+
+        /* the first request of the class or of the highest priority */
+        if( next == m_queue.end() )
+            next = it;
+        else if( (dispatch == e_lwm2m_dispatch_priority) &&
+                 (getPriority( it->type ) < getPriority( next->type )) )
+            next = it;
+
+        if( dispatch == e_lwm2m_dispatch_fifo )
+            break;
+    }
+
+    if( next == m_queue.end() )
+        return false;
+
+    req = *next;
+    m_queue.erase( next );
+    m_clsQueued[req.cls]--;
+    return true;
+
+} /* LWM2MRequestQueue::pop() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRequestQueue::take()
+*/
+bool LWM2MRequestQueue::take( const void* p_data, s_lwm2m_request_t& req,
+        uint32_t traceId )
+{
+    std::deque< s_lwm2m_request_t >::iterator it;
+
+    for( it = m_queue.begin(); it != m_queue.end(); ++it )
+    {
+        if( ((p_data == NULL) || (it->p_data == p_data)) &&
+            ((traceId == 0) || (it->traceId == traceId)) )
+        {
+            req = *it;
+            m_queue.erase( it );
+            m_clsQueued[req.cls]--;
+            return true;
+        }
+    }
+
+    return false;
+
+} /* LWM2MRequestQueue::take() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRequestQueue::count()
+*/
+size_t LWM2MRequestQueue::count( e_lwm2m_request_class_t cls ) const
+{
+    size_t cnt = 0;
+    int i;
+
+    for( i = 0; i <= cls; i++ )
+        cnt += m_clsQueued[i];
+
+    return cnt;
+
+} /* LWM2MRequestQueue::count() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRequestQueue::getMemSize()
+*/
+size_t LWM2MRequestQueue::getMemSize( void ) const
+{
+    size_t size = m_queue.size() * sizeof( s_lwm2m_request_t );
+    std::deque< s_lwm2m_request_t >::const_iterator it;
+
+    for( it = m_queue.begin(); it != m_queue.end(); ++it )
+        size += it->payload.capacity();
+
+    return size;
+
+} /* LWM2MRequestQueue::getMemSize() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRequestQueue::getStats()
+*/
+void LWM2MRequestQueue::getStats( s_lwm2m_request_stats_t* p_stats ) const
+{
+    p_stats->queued = m_queue.size();
+    p_stats->inFlight = 0;
+    p_stats->maxQueued = m_maxQueued;
+    p_stats->dispatched = m_dispatched;
+
+} /* LWM2MRequestQueue::getStats() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRequestQueue::getPriority()
+*/
+uint8_t LWM2MRequestQueue::getPriority( e_lwm2m_request_type_t type )
+{
+    switch( type )
+    {
+        case e_lwm2m_request_write:
+        case e_lwm2m_request_execute:
+            return 0;
+
+        case e_lwm2m_request_read:
+        case e_lwm2m_request_discover:
+            return 1;
+
+        default:
+            /* observations and their cancellations keep their order */
+            return 2;
+    }
+
+} /* LWM2MRequestQueue::getPriority() */
+
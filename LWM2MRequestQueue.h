@@ -0,0 +1,425 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MRequestQueue.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of a queue for requests to a LWM2M device.
+ *
+ */
+
+
+#ifndef __LWM2MREQUESTQUEUE_H__
+#define __LWM2MREQUESTQUEUE_H__
+#ifndef __DECL_LWM2MREQUESTQUEUE_H__
+#define __DECL_LWM2MREQUESTQUEUE_H__ extern
+#endif /* #ifndef __DECL_LWM2MREQUESTQUEUE_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include "liblwm2m.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Default number of outstanding requests per device */
+#define LWM2M_REQUEST_NSTART                    1
+
+/** Default time in ms a blocking request waits for its answer */
+#define LWM2M_REQUEST_TIMEOUT                   60000
+
+/** Use the configured time to wait for the answer of a blocking request */
+#define LWM2M_REQUEST_TIMEOUT_DEFAULT           0xFFFFFFFF
+
+/** Default time in s a device in queue mode is reachable after it
+ *  contacted the server (MAX_TRANSMIT_WAIT of RFC 7252) */
+#define LWM2M_REQUEST_AWAKE_TIME                93
+
+/** Default number of consecutive timeouts that open the circuit of a device */
+#define LWM2M_REQUEST_BREAKER_THRESHOLD         3
+
+/** Default time in s from opening the circuit to the first probe */
+#define LWM2M_REQUEST_BREAKER_PROBE             10
+
+/** Default maximum time in s between two probes of an open circuit */
+#define LWM2M_REQUEST_BREAKER_PROBE_MAX         600
+
+/** Default number of outstanding background requests to all devices */
+#define LWM2M_REQUEST_BUDGET_BACKGROUND         16
+
+/** Default number of outstanding bulk requests to all devices */
+#define LWM2M_REQUEST_BUDGET_BULK               8
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Type of a request.
+ */
+typedef enum
+{
+    /** Read a resource or an object */
+    e_lwm2m_request_read,
+    /** Write a resource or an object instance */
+    e_lwm2m_request_write,
+    /** Execute a resource */
+    e_lwm2m_request_execute,
+    /** Discover an object */
+    e_lwm2m_request_discover,
+    /** Start an observation */
+    e_lwm2m_request_observe,
+    /** Cancel an observation */
+    e_lwm2m_request_observe_cancel
+
+} e_lwm2m_request_type_t;
+
+
+/**
+ * \brief   Order queued requests are sent in.
+ */
+typedef enum
+{
+    /** Requests are sent in the order they were issued */
+    e_lwm2m_dispatch_fifo,
+    /** Writes and executes are sent first, then reads and discovers and
+     *  observations last. Requests of the same priority keep their order */
+    e_lwm2m_dispatch_priority
+
+} e_lwm2m_dispatch_t;
+
+
+/**
+ * \brief   Priority class of a request.
+ *
+ *          Queued requests of a more important class are always sent
+ *          first. Each class is limited by its own budget of outstanding
+ *          requests so that less important work only uses the capacity
+ *          that is left.
+ */
+typedef enum
+{
+    /** Requests a user waits for e.g. reads and writes of OPC UA */
+    e_lwm2m_request_class_interactive,
+    /** Periodic requests e.g. polling and discovering */
+    e_lwm2m_request_class_background,
+    /** Requests to many devices e.g. firmware updates or setting up
+     *  observations */
+    e_lwm2m_request_class_bulk,
+    /** Number of classes */
+    e_lwm2m_request_class_max
+
+} e_lwm2m_request_class_t;
+
+
+/**
+ * \brief   Request configuration of the server.
+ */
+typedef struct
+{
+    /** Number of outstanding requests per device */
+    uint8_t nstart;
+
+    /** Order queued requests are sent in */
+    e_lwm2m_dispatch_t dispatch;
+
+    /** Time in s a device in queue mode is reachable after it
+     *  contacted the server */
+    uint32_t awakeTime;
+
+    /** true to answer blocking reads of sleeping devices in queue mode
+     *  from the cached values. Off by default since such an answer
+     *  looks like a live read, LWM2MResource::getCacheTime() tells
+     *  the age of the value */
+    bool cacheReads;
+
+    /** true to discover the resources of the objects when a device
+     *  registers */
+    bool autoDiscover;
+
+    /** Time in ms a blocking request waits for its answer before it is
+     *  canceled, 0 to wait without limit */
+    uint32_t timeout;
+
+    /** Consecutive timeouts after which requests to a device fail
+     *  immediately, 0 to disable the circuit breaker */
+    uint16_t breakerThreshold;
+
+    /** Time in s from opening the circuit to the first probe */
+    uint32_t breakerProbe;
+
+    /** Maximum time in s between two probes, the time doubles with
+     *  every failed probe */
+    uint32_t breakerProbeMax;
+
+    /** Number of outstanding requests of each class to all devices,
+     *  0 for no limit */
+    uint16_t budget[e_lwm2m_request_class_max];
+
+} s_lwm2m_request_config_t;
+
+
+/**
+ * \brief   Request statistics of a device.
+ */
+typedef struct
+{
+    /** Number of queued requests */
+    uint32_t queued;
+
+    /** Number of outstanding requests */
+    uint32_t inFlight;
+
+    /** Maximum number of queued requests */
+    uint32_t maxQueued;
+
+    /** Number of requests sent to the device */
+    uint32_t dispatched;
+
+} s_lwm2m_request_stats_t;
+
+
+/**
+ * \brief   Request to a device.
+ */
+typedef struct
+{
+    /** Type of the request */
+    e_lwm2m_request_type_t type;
+
+    /** Priority class of the request */
+    e_lwm2m_request_class_t cls;
+
+    /** URI of the request */
+    lwm2m_uri_t uri;
+
+    /** Format of the payload */
+    lwm2m_media_type_t format;
+
+    /** Payload of a write or execute */
+    std::vector< uint8_t > payload;
+
+    /** Callback of the request */
+    lwm2m_result_callback_t cb;
+
+    /** User data of the callback */
+    void* p_data;
+
+    /** ID of the request in the trace */
+    uint32_t traceId;
+
+} s_lwm2m_request_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MRequestQueue Class.
+ *
+ *          The queue holds the requests to a device that could not be
+ *          sent because the device has already reached its limit of
+ *          outstanding requests or because the device sleeps in
+ *          queue mode.
+ */
+class LWM2MRequestQueue
+{
+
+public:
+
+    /**
+     * \brief   Default constructor to create a request queue.
+     */
+    LWM2MRequestQueue( void )
+        : m_maxQueued( 0 )
+        , m_dispatched( 0 ) {
+
+        /* no requests of any class */
+        for( int i = 0; i < e_lwm2m_request_class_max; i++ )
+            m_clsQueued[i] = 0;
+    };
+
+
+    /**
+     * \brief   Default destructor of the request queue.
+     */
+    virtual ~LWM2MRequestQueue( void ) {};
+
+
+    /**
+     * \brief   Add a request to the queue.
+     *
+     * \param   req     Request to add.
+     */
+    void push( const s_lwm2m_request_t& req );
+
+
+    /**
+     * \brief   Take the next request from the queue.
+     *
+     * \param   dispatch    Order the requests are taken in.
+     * \param   req         Request to write the next request to.
+     *
+     * \return  true if a request was taken.
+     */
+    bool pop( e_lwm2m_dispatch_t dispatch, s_lwm2m_request_t& req );
+
+
+    /**
+     * \brief   Take the next request of a class from the queue.
+     *
+     * \param   dispatch    Order the requests are taken in.
+     * \param   cls         Class of the request.
+     * \param   req         Request to write the next request to.
+     *
+     * \return  true if a request was taken.
+     */
+    bool pop( e_lwm2m_dispatch_t dispatch, e_lwm2m_request_class_t cls,
+            s_lwm2m_request_t& req );
+
+
+    /**
+     * \brief   Take the first request with specific callback data.
+     *
+     * \param   p_data      User data of the callback of the request or
+     *                      NULL for any request.
+     * \param   req         Request to write the taken request to.
+     * \param   traceId     ID of the request or 0 for any request.
+     *
+     * \return  true if a request was taken.
+     */
+    bool take( const void* p_data, s_lwm2m_request_t& req,
+            uint32_t traceId = 0 );
+
+
+    /**
+     * \brief   Check if the queue is empty.
+     *
+     * \return  true if no request is queued.
+     */
+    bool empty( void ) const {return m_queue.empty();}
+
+
+    /**
+     * \brief   Get the number of queued requests.
+     *
+     * \return  Number of requests.
+     */
+    size_t size( void ) const {return m_queue.size();}
+
+
+    /**
+     * \brief   Get the number of queued requests of a class.
+     *
+     * \param   cls     Class of the requests.
+     *
+     * \return  Number of requests of the class.
+     */
+    size_t size( e_lwm2m_request_class_t cls ) const {
+        return m_clsQueued[cls];
+    };
+
+
+    /**
+     * \brief   Get the number of queued requests that are sent before
+     *          a request of a class.
+     *
+     * \param   cls     Class of the request.
+     *
+     * \return  Number of requests of the class or a more important one.
+     */
+    size_t count( e_lwm2m_request_class_t cls ) const;
+
+
+    /**
+     * \brief   Get the memory used by the queued requests.
+     *
+     * \return  Size of the requests and their payloads in bytes.
+     */
+    size_t getMemSize( void ) const;
+
+
+    /**
+     * \brief   Count a request sent to the device.
+     */
+    void addDispatched( void ) {m_dispatched++;}
+
+
+    /**
+     * \brief   Get the statistics of the queue.
+     *
+     *          The number of outstanding requests is not known by
+     *          the queue and set to 0.
+     *
+     * \param   p_stats     Statistics structure to fill.
+     */
+    void getStats( s_lwm2m_request_stats_t* p_stats ) const;
+
+
+    /**
+     * \brief   Get the priority of a request type.
+     *
+     * \param   type    Type of the request.
+     *
+     * \return  Priority of the request, lower values are sent first.
+     */
+    static uint8_t getPriority( e_lwm2m_request_type_t type );
+
+
+private:
+
+    /** Queued requests in the order they were issued */
+    std::deque< s_lwm2m_request_t > m_queue;
+
+    /** Number of queued requests of each class */
+    size_t m_clsQueued[e_lwm2m_request_class_max];
+
+    /** Maximum number of queued requests */
+    size_t m_maxQueued;
+
+    /** Number of requests sent to the device */
+    uint32_t m_dispatched;
+};
+
+#endif /* #ifndef __LWM2MREQUESTQUEUE_H__ */
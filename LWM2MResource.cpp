@@ -47,8 +47,10 @@
 #include <stdint.h>
 #include <iostream>
 #include <string>
+#include <algorithm>
 #include "LWM2MResource.h"
 #include "LWM2MObject.h"
+#include "LWM2MClock.h"
 
 /*
  * --- Methods Definition ----------------------------------------------------- *
@@ -170,3 +172,299 @@ int8_t LWM2MResource::notifyObservers( const s_lwm2m_obsparams_t* p_params ) con
     return 0;
 }
 
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::registerObserver()
+*/
+int8_t LWM2MResource::registerObserver( LWM2MValueObserver* p_observer,
+        uint16_t instId )
+{
+    if( p_observer == NULL )
+        return -1;
+
+    /* find the observer in the list */
+    std::vector< s_lwm2m_valobs_t >::iterator it =
+            m_vectValObs.begin();
+
+    while( it != m_vectValObs.end() )
+    {
+        if( (it->p_obs == p_observer) && (it->instId == instId) )
+            /* found observer */
+            break;
+        it++;
+    }
+
+    if( it == m_vectValObs.end() )
+    {
+        /* The observer was not found so it has to be added. */
+        s_lwm2m_valobs_t obs = { p_observer, instId };
+        m_vectValObs.push_back( obs );
+    }
+
+    return 0;
+
+} /* LWM2MResource::registerObserver() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::deregisterObserver()
+*/
+int8_t LWM2MResource::deregisterObserver( const LWM2MValueObserver* p_observer,
+        uint16_t instId )
+{
+    if( p_observer == NULL )
+        return -1;
+
+    /* find the observer in the list */
+    std::vector< s_lwm2m_valobs_t >::iterator it =
+            m_vectValObs.begin();
+
+    while( it != m_vectValObs.end() )
+    {
+        if( (it->p_obs == p_observer) && (it->instId == instId) )
+            /* found observer */
+            break;
+        it++;
+    }
+
+    if( it != m_vectValObs.end() )
+        m_vectValObs.erase( it );
+
+    return 0;
+
+} /* LWM2MResource::deregisterObserver() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::notifyObservers()
+*/
+int8_t LWM2MResource::notifyObservers( const s_lwm2m_obsparams_t* p_params,
+        const LWM2MValue& val ) const
+{
+    /* all observers share the same decoded value */
+    std::vector< s_lwm2m_valobs_t >::const_iterator it =
+             m_vectValObs.begin();
+
+    while( it != m_vectValObs.end() )
+    {
+        /* observers of a single instance only receive its values */
+        if( (it->instId == LWM2M_VALUE_NO_INSTANCE) ||
+            (it->instId == val.getInstId()) )
+            it->p_obs->notify( this, p_params, val );
+        it++;
+    }
+
+    return 0;
+
+} /* LWM2MResource::notifyObservers() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::getInstance()
+*/
+int8_t LWM2MResource::getInstance( size_t idx, LWM2MValue& val ) const
+{
+    if( idx >= m_instVals.size() )
+        return -1;
+
+    val = m_instVals[idx];
+    if( val.m_len > 0 )
+        val.mp_data = &m_instData[m_instOffs[idx]];
+
+    return 0;
+
+} /* LWM2MResource::getInstance() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::findInstance()
+*/
+int8_t LWM2MResource::findInstance( uint16_t instId, LWM2MValue& val ) const
+{
+    /* instances are sorted by their ID */
+    size_t lo = 0;
+    size_t hi = m_instVals.size();
+
+    while( lo < hi )
+    {
+        size_t mid = (lo + hi) / 2;
+        if( m_instVals[mid].m_instId < instId )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if( (lo == m_instVals.size()) || (m_instVals[lo].m_instId != instId) )
+        return -1;
+
+    return getInstance( lo, val );
+
+} /* LWM2MResource::findInstance() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::updateInstances()
+*/
+int8_t LWM2MResource::updateInstances( const s_lwm2m_obsparams_t* p_params,
+        const LWM2MValue* p_vals, size_t cnt )
+{
+    std::vector< uint16_t > removed;
+    LWM2MValue val;
+
+    if( (p_vals == NULL) && (cnt > 0) )
+        return -1;
+
+    /* mark new and changed instances */
+    m_instChanged.clear();
+    for( size_t i = 0; i < cnt; i++ )
+    {
+        bool changed = (findInstance( p_vals[i].m_instId, val ) != 0) ||
+            (val.equals( p_vals[i] ) == false);
+        m_instChanged.push_back( changed ? 1 : 0 );
+    }
+
+    /* find removed instances */
+    for( size_t i = 0; i < m_instVals.size(); i++ )
+    {
+        size_t j = 0;
+        while( (j < cnt) && (p_vals[j].m_instId != m_instVals[i].m_instId) )
+            j++;
+
+        if( j == cnt )
+            removed.push_back( m_instVals[i].m_instId );
+    }
+
+    /* store the new instances */
+    m_instTmp.assign( p_vals, p_vals + cnt );
+    storeInstances();
+
+    /* observers receive the stored values */
+    for( size_t i = 0; i < removed.size(); i++ )
+    {
+        val = LWM2MValue();
+        val.m_resId = m_resId;
+        val.m_instId = removed[i];
+        notifyObservers( p_params, val );
+    }
+
+    for( size_t i = 0; i < cnt; i++ )
+    {
+        if( m_instChanged[i] && (findInstance( p_vals[i].m_instId, val ) == 0) )
+            notifyObservers( p_params, val );
+    }
+
+    return 0;
+
+} /* LWM2MResource::updateInstances() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::setInstance()
+*/
+int8_t LWM2MResource::setInstance( const LWM2MValue& val )
+{
+    LWM2MValue cur;
+
+    if( val.isInstance() == false )
+        return -1;
+
+    /* the data of the current instances stays valid until the new
+     * instances are stored */
+    m_instTmp.clear();
+    for( size_t i = 0; i < m_instVals.size(); i++ )
+    {
+        getInstance( i, cur );
+        if( cur.m_instId != val.m_instId )
+            m_instTmp.push_back( cur );
+    }
+    m_instTmp.push_back( val );
+    storeInstances();
+
+    return 0;
+
+} /* LWM2MResource::setInstance() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::storeInstances()
+*/
+void LWM2MResource::storeInstances( void )
+{
+    std::stable_sort( m_instTmp.begin(), m_instTmp.end(),
+        []( const LWM2MValue& a, const LWM2MValue& b ) {
+            return a.m_instId < b.m_instId; } );
+
+    m_instVals.clear();
+    m_instOffs.clear();
+    m_instDataTmp.clear();
+
+    for( size_t i = 0; i < m_instTmp.size(); i++ )
+    {
+        const LWM2MValue& val = m_instTmp[i];
+
+        /* copy the data of all instances into one buffer */
+        m_instOffs.push_back( m_instDataTmp.size() );
+        if( (val.mp_data != NULL) && (val.m_len > 0) )
+            m_instDataTmp.insert( m_instDataTmp.end(), val.mp_data,
+                val.mp_data + val.m_len );
+
+        m_instVals.push_back( val );
+        m_instVals.back().mp_data = NULL;
+    }
+
+    m_instData.swap( m_instDataTmp );
+    m_instTmp.clear();
+
+} /* LWM2MResource::storeInstances() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::setCachedValue()
+*/
+void LWM2MResource::setCachedValue( lwm2m_media_type_t format,
+        const uint8_t* p_buf, size_t len )
+{
+    if( (p_buf == NULL) || (len == 0) )
+    {
+        /* nothing to cache */
+        m_cacheValid = false;
+        return;
+    }
+
+    if( p_buf != m_cache.data() )
+        m_cache.assign( p_buf, p_buf + len );
+
+    m_cacheFormat = format;
+    m_cacheValid = true;
+    m_cacheTime = LWM2MClock::timeS();
+
+} /* LWM2MResource::setCachedValue() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MResource::getMemSize()
+*/
+size_t LWM2MResource::getMemSize( void ) const
+{
+    return sizeof( LWM2MResource ) +
+        m_vectObs.capacity() * sizeof( LWM2MResourceObserver* ) +
+        m_vectValObs.capacity() * sizeof( s_lwm2m_valobs_t ) +
+        m_instVals.capacity() * sizeof( LWM2MValue ) +
+        m_instOffs.capacity() * sizeof( size_t ) +
+        m_instData.capacity() +
+        m_instTmp.capacity() * sizeof( LWM2MValue ) +
+        m_instDataTmp.capacity() +
+        m_instChanged.capacity() +
+        m_cache.capacity();
+
+} /* LWM2MResource::getMemSize() */
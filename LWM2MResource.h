@@ -53,10 +53,13 @@
  * --- Includes ------------------------------------------------------------- *
  */
 #include <stdint.h>
+#include <time.h>
 #include <iostream>
 #include <string>
 #include <vector>
 #include "LWM2MResourceObserver.h"
+#include "LWM2MValueObserver.h"
+#include "LWM2MValue.h"
 
 /*
  * --- Forward Declaration ----------------------------------------------------- *
@@ -69,6 +72,25 @@ class LWM2MDevice;
 /* Forward declaration of the LWM2MObject class used as parent reference. */
 class LWM2MObject;
 
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Registration of a value observer.
+ */
+typedef struct
+{
+    /** The observer */
+    LWM2MValueObserver* p_obs;
+
+    /** Resource instance the observer is interested in or
+     *  LWM2M_VALUE_NO_INSTANCE for all values of the resource */
+    uint16_t instId;
+
+} s_lwm2m_valobs_t;
+
+
 /*
  * --- Class Definition ----------------------------------------------------- *
  */
@@ -91,7 +113,12 @@ public:
      */
     LWM2MResource( void )
         : m_resId( 0 )
-        , mp_parent( NULL ) {
+        , m_type( e_lwm2m_value_type_none )
+        , m_multiple( false )
+        , mp_parent( NULL )
+        , m_cacheFormat( LWM2M_CONTENT_TEXT )
+        , m_cacheValid( false )
+        , m_cacheTime( 0 ) {
 
         /* clear the observer vector */
         m_vectObs.clear();
@@ -102,9 +129,16 @@ public:
      * \brief   Extended constructor to create a LWM2M Object.
      */
     LWM2MResource( uint16_t resId, bool rd = false, bool wr  = false,
-            bool ex  = false )
+            bool ex  = false,
+            e_lwm2m_value_type_t type = e_lwm2m_value_type_none,
+            bool multiple = false )
         : m_resId( resId )
-        , mp_parent( NULL ) {
+        , m_type( type )
+        , m_multiple( multiple )
+        , mp_parent( NULL )
+        , m_cacheFormat( LWM2M_CONTENT_TEXT )
+        , m_cacheValid( false )
+        , m_cacheTime( 0 ) {
 
         /* clear the observer vector */
         m_vectObs.clear();
@@ -125,6 +159,109 @@ public:
     uint16_t getResId( void ) const {return m_resId;}
 
 
+    /**
+     * \brief   Get the type of the resource.
+     *
+     *          The type is used to decode the values of the resource.
+     *
+     * \return  Type of the resource.
+     */
+    e_lwm2m_value_type_t getType( void ) const {return m_type;}
+
+
+    /**
+     * \brief   Set the type of the resource.
+     *
+     * \param   type    Type of the resource.
+     */
+    void setType( e_lwm2m_value_type_t type ) {m_type = type;}
+
+
+    /**
+     * \brief   Check if the resource has multiple instances.
+     *
+     * \return  true if the resource is a multiple instance resource.
+     */
+    bool isMultiple( void ) const {return m_multiple;}
+
+
+    /**
+     * \brief   Define if the resource has multiple instances.
+     *
+     *          The values of the instances of a multiple instance
+     *          resource are kept by the resource. Value observers are
+     *          only notified about instances that were added, changed or
+     *          removed.
+     *
+     * \param   multiple    true for a multiple instance resource.
+     */
+    void setMultiple( bool multiple ) {m_multiple = multiple;}
+
+
+    /**
+     * \brief   Get the number of known resource instances.
+     *
+     * \return  Number of instances.
+     */
+    size_t getInstanceCount( void ) const {return m_instVals.size();}
+
+
+    /**
+     * \brief   Get a resource instance by its index.
+     *
+     *          Instances are sorted by their ID. Strings and opaque data
+     *          of the value refer to the resource and are valid until the
+     *          instances of the resource change.
+     *
+     * \param   idx     Index of the instance.
+     * \param   val     Value to write the instance to.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t getInstance( size_t idx, LWM2MValue& val ) const;
+
+
+    /**
+     * \brief   Find a resource instance by its ID.
+     *
+     * \param   instId  ID of the resource instance.
+     * \param   val     Value to write the instance to.
+     *
+     * \return  0 on success or negative value if the instance is unknown.
+     */
+    int8_t findInstance( uint16_t instId, LWM2MValue& val ) const;
+
+
+    /**
+     * \brief   Check if a value of the resource is cached.
+     *
+     *          The last value read from the device or notified by
+     *          the device is cached.
+     *
+     * \return  true if a value is cached.
+     */
+    bool hasCachedValue( void ) const {return m_cacheValid;}
+
+
+    /**
+     * \brief   Get the time the cached value was received.
+     *
+     * \return  Time of the cached value or 0 if there is none.
+     */
+    time_t getCacheTime( void ) const {return m_cacheTime;}
+
+
+    /**
+     * \brief   Get the memory used by the resource.
+     *
+     *          The size includes the buffers of the instances and of the
+     *          cached value but not the overhead of the heap.
+     *
+     * \return  Size of the resource in bytes.
+     */
+    size_t getMemSize( void ) const;
+
+
     /**
      * \brief   Get the parent object.
      *
@@ -176,6 +313,36 @@ public:
     int8_t deregisterObserver( const LWM2MResourceObserver* p_observer );
 
 
+    /**
+     * \brief   Register a value observer at the resource.
+     *
+     *          A value observer receives the decoded value of
+     *          every notification of the resource.
+     *
+     * \param   p_observer  Observer that shall be registered.
+     * \param   instId      Resource instance the observer is interested in.
+     *                      The observer receives all values of the
+     *                      resource by default.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t registerObserver( LWM2MValueObserver* p_observer,
+            uint16_t instId = LWM2M_VALUE_NO_INSTANCE );
+
+
+    /**
+     * \brief   Deregister a registered value observer at the resource.
+     *
+     * \param   p_observer  Observer that shall be deregistered.
+     * \param   instId      Resource instance the observer was
+     *                      registered for.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t deregisterObserver( const LWM2MValueObserver* p_observer,
+            uint16_t instId = LWM2M_VALUE_NO_INSTANCE );
+
+
 protected:
 
     /**
@@ -204,17 +371,121 @@ protected:
     int8_t notifyObservers( const s_lwm2m_obsparams_t* p_params ) const;
 
 
+    /**
+     * \brief   Check if the resource has value observers.
+     *
+     * \return  True if the resource has value observers of false otherwise.
+     */
+    bool hasValueObserver( void ) const { return m_vectValObs.size(); };
+
+
+    /**
+     * \brief   Notify all value observers about a change in the resource.
+     *
+     * \param   p_params  LWM2M parameters of the notification.
+     * \param   val       Decoded value.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t notifyObservers( const s_lwm2m_obsparams_t* p_params,
+            const LWM2MValue& val ) const;
+
+
+    /**
+     * \brief   Update all instances of a multiple instance resource.
+     *
+     *          The values replace the known instances. Value observers are
+     *          notified about new and changed instances. Removed instances
+     *          are notified with a value of type e_lwm2m_value_type_none.
+     *
+     * \param   p_params  LWM2M parameters of the notification.
+     * \param   p_vals    Values of all instances of the resource.
+     * \param   cnt       Number of values.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t updateInstances( const s_lwm2m_obsparams_t* p_params,
+            const LWM2MValue* p_vals, size_t cnt );
+
+
+    /**
+     * \brief   Update a single instance of a multiple instance resource.
+     *
+     *          Other instances of the resource are kept.
+     *
+     * \param   val       Value of the instance.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t setInstance( const LWM2MValue& val );
+
+
+    /**
+     * \brief   Cache the payload of the resource.
+     *
+     * \param   format    Format of the payload.
+     * \param   p_buf     Payload data.
+     * \param   len       Length of the payload.
+     */
+    void setCachedValue( lwm2m_media_type_t format, const uint8_t* p_buf,
+            size_t len );
+
+
+private:
+
+    /**
+     * \brief   Store the instances prepared in m_instTmp.
+     */
+    void storeInstances( void );
+
+
 private:
 
     /** Resource ID */
     uint16_t m_resId;
 
+    /** Type of the resource */
+    e_lwm2m_value_type_t m_type;
+
+    /** Resource has multiple instances */
+    bool m_multiple;
+
     /** parent object */
     const LWM2MObject* mp_parent;
 
     /** Vector of registed observer */
     std::vector< LWM2MResourceObserver* > m_vectObs;
 
+    /** Vector of registered value observers */
+    std::vector< s_lwm2m_valobs_t > m_vectValObs;
+
+    /** Values of the resource instances sorted by their ID. The data
+     *  of strings and opaque values is kept in m_instData. */
+    std::vector< LWM2MValue > m_instVals;
+
+    /** Offset of the data of each instance in m_instData */
+    std::vector< size_t > m_instOffs;
+
+    /** Data of all resource instances */
+    std::vector< uint8_t > m_instData;
+
+    /** Scratch buffers used while the instances are updated */
+    std::vector< LWM2MValue > m_instTmp;
+    std::vector< uint8_t > m_instDataTmp;
+    std::vector< uint8_t > m_instChanged;
+
+    /** Cached payload of the resource */
+    std::vector< uint8_t > m_cache;
+
+    /** Format of the cached payload */
+    lwm2m_media_type_t m_cacheFormat;
+
+    /** A payload is cached */
+    bool m_cacheValid;
+
+    /** Time the cached payload was received */
+    time_t m_cacheTime;
+
 };
 
 #endif /* #ifndef __LWM2MRESOURCE_H__ */
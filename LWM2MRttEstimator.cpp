@@ -0,0 +1,218 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MRttEstimator.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of a round trip time estimator for CoAP peers.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LWM2MRttEstimator.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Timeouts below are backed off with a factor of 3 */
+#define LWM2M_RTT_VBF_LOW_MS                    1000
+/** Timeouts above are backed off with a factor of 1.5 */
+#define LWM2M_RTT_VBF_HIGH_MS                   3000
+
+/** Maximum number of retransmissions of a weak sample */
+#define LWM2M_RTT_WEAK_MAX_RETRANS              2
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRttEstimator::LWM2MRttEstimator()
+*/
+LWM2MRttEstimator::LWM2MRttEstimator( const s_lwm2m_retrans_config_t& cfg )
+    : m_weakSrtt( 0 )
+    , m_weakRttvar( 0 )
+    , m_updated( 0 )
+{
+    memset( &m_stats, 0, sizeof(m_stats) );
+    m_stats.rto = bound( cfg, cfg.initialRto );
+
+} /* LWM2MRttEstimator::LWM2MRttEstimator() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRttEstimator::startExchange()
+*/
+uint32_t LWM2MRttEstimator::startExchange( const s_lwm2m_retrans_config_t& cfg,
+        uint64_t now )
+{
+    uint32_t rto = cfg.initialRto;
+
+    m_stats.exchanges++;
+
+    if( cfg.adaptive )
+    {
+        /* age the timeout of an idle peer towards the initial value */
+        if( (m_stats.rto < LWM2M_RTT_VBF_LOW_MS) &&
+            (now - m_updated > 16 * (uint64_t)m_stats.rto) )
+        {
+            m_stats.rto = bound( cfg, m_stats.rto * 2 );
+            m_updated = now;
+        }
+        else if( (m_stats.rto > LWM2M_RTT_VBF_HIGH_MS) &&
+            (now - m_updated > 4 * (uint64_t)m_stats.rto) )
+        {
+            m_stats.rto = bound( cfg, (m_stats.rto + cfg.initialRto) / 2 );
+            m_updated = now;
+        }
+        rto = bound( cfg, m_stats.rto );
+    }
+
+    /* randomize the first timeout between RTO and 1.5 * RTO */
+    return rto + (uint32_t)(rand() % (rto / 2 + 1));
+
+} /* LWM2MRttEstimator::startExchange() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRttEstimator::backoff()
+*/
+uint32_t LWM2MRttEstimator::backoff( const s_lwm2m_retrans_config_t& cfg,
+        uint32_t timeout )
+{
+    m_stats.retransmissions++;
+
+    if( !cfg.adaptive )
+        return timeout * 2;
+
+    /* short timeouts back off faster than long ones */
+    if( m_stats.rto < LWM2M_RTT_VBF_LOW_MS )
+        return timeout * 3;
+    else if( m_stats.rto > LWM2M_RTT_VBF_HIGH_MS )
+        return timeout + timeout / 2;
+    else
+        return timeout * 2;
+
+} /* LWM2MRttEstimator::backoff() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRttEstimator::addSample()
+*/
+void LWM2MRttEstimator::addSample( const s_lwm2m_retrans_config_t& cfg,
+        uint32_t rtt, uint8_t retrans, uint64_t now )
+{
+    uint32_t est;
+    uint32_t diff;
+
+    if( retrans > LWM2M_RTT_WEAK_MAX_RETRANS )
+        /* the sample can not be assigned to a transmission */
+        return;
+
+    m_stats.lastRtt = rtt;
+
+    if( retrans == 0 )
+    {
+        /* strong estimator */
+        if( m_stats.strongSamples == 0 )
+        {
+            m_stats.srtt = rtt;
+            m_stats.rttvar = rtt / 2;
+        }
+        else
+        {
+            diff = (m_stats.srtt > rtt) ? (m_stats.srtt - rtt) :
+                (rtt - m_stats.srtt);
+            m_stats.rttvar = (3 * m_stats.rttvar + diff) / 4;
+            m_stats.srtt = (7 * m_stats.srtt + rtt) / 8;
+        }
+        m_stats.strongSamples++;
+
+        est = m_stats.srtt + 4 * m_stats.rttvar;
+        m_stats.rto = bound( cfg, (est + m_stats.rto) / 2 );
+    }
+    else
+    {
+        /* weak estimator */
+        if( m_stats.weakSamples == 0 )
+        {
+            m_weakSrtt = rtt;
+            m_weakRttvar = rtt / 2;
+        }
+        else
+        {
+            diff = (m_weakSrtt > rtt) ? (m_weakSrtt - rtt) :
+                (rtt - m_weakSrtt);
+            m_weakRttvar = (3 * m_weakRttvar + diff) / 4;
+            m_weakSrtt = (7 * m_weakSrtt + rtt) / 8;
+        }
+        m_stats.weakSamples++;
+
+        est = m_weakSrtt + m_weakRttvar;
+        m_stats.rto = bound( cfg, (est + 3 * m_stats.rto) / 4 );
+    }
+
+    m_updated = now;
+
+} /* LWM2MRttEstimator::addSample() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MRttEstimator::bound()
+*/
+uint32_t LWM2MRttEstimator::bound( const s_lwm2m_retrans_config_t& cfg,
+        uint32_t rto )
+{
+    if( rto < cfg.minRto )
+        return cfg.minRto;
+    if( rto > cfg.maxRto )
+        return cfg.maxRto;
+    return rto;
+
+} /* LWM2MRttEstimator::bound() */
+
@@ -0,0 +1,242 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MRttEstimator.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of a round trip time estimator for CoAP peers.
+ *
+ */
+
+
+#ifndef __LWM2MRTTESTIMATOR_H__
+#define __LWM2MRTTESTIMATOR_H__
+#ifndef __DECL_LWM2MRTTESTIMATOR_H__
+#define __DECL_LWM2MRTTESTIMATOR_H__ extern
+#endif /* #ifndef __DECL_LWM2MRTTESTIMATOR_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Default initial retransmission timeout in ms */
+#define LWM2M_RTT_INITIAL_RTO_MS                2000
+/** Default lower bound of the retransmission timeout in ms */
+#define LWM2M_RTT_MIN_RTO_MS                    200
+/** Default upper bound of the retransmission timeout in ms */
+#define LWM2M_RTT_MAX_RTO_MS                    32000
+/** Default number of retransmissions before a request fails */
+#define LWM2M_RTT_MAX_RETRANSMIT                3
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Retransmission configuration of the server.
+ */
+typedef struct
+{
+    /** Retransmission timeout in ms used before a peer was measured */
+    uint32_t initialRto;
+
+    /** Lower bound of the retransmission timeout in ms */
+    uint32_t minRto;
+
+    /** Upper bound of the retransmission timeout in ms */
+    uint32_t maxRto;
+
+    /** Number of retransmissions before a request fails */
+    uint8_t maxRetransmit;
+
+    /** true to use the estimated timeout of the peer, false to use the
+     *  initial timeout with a binary exponential backoff */
+    bool adaptive;
+
+} s_lwm2m_retrans_config_t;
+
+
+/**
+ * \brief   Round trip time statistics of a peer.
+ */
+typedef struct
+{
+    /** Current retransmission timeout in ms */
+    uint32_t rto;
+
+    /** Smoothed round trip time in ms */
+    uint32_t srtt;
+
+    /** Round trip time variation in ms */
+    uint32_t rttvar;
+
+    /** Last measured round trip time in ms */
+    uint32_t lastRtt;
+
+    /** Number of exchanges started */
+    uint32_t exchanges;
+
+    /** Number of samples of exchanges without retransmission */
+    uint32_t strongSamples;
+
+    /** Number of samples of exchanges with retransmissions */
+    uint32_t weakSamples;
+
+    /** Number of retransmissions */
+    uint32_t retransmissions;
+
+    /** Number of exchanges that failed after all retransmissions */
+    uint32_t timeouts;
+
+} s_lwm2m_rtt_stats_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MRttEstimator Class.
+ *
+ *          The estimator keeps the retransmission timeout of a single
+ *          CoAP peer following CoCoA. Round trip times of exchanges
+ *          without retransmission feed a strong estimator, exchanges
+ *          that needed one or two retransmissions a weak estimator
+ *          measured from the first transmission. Both are combined into
+ *          the overall timeout, which is aged towards the initial value
+ *          while the peer is idle. Retransmissions back off with a factor
+ *          that depends on the current timeout.
+ */
+class LWM2MRttEstimator
+{
+
+public:
+
+    /**
+     * \brief   Constructor to create an estimator.
+     *
+     * \param   cfg     Configuration the initial timeout is taken from.
+     */
+    LWM2MRttEstimator( const s_lwm2m_retrans_config_t& cfg );
+
+
+    /**
+     * \brief   Default destructor of the estimator.
+     */
+    virtual ~LWM2MRttEstimator( void ) {};
+
+
+    /**
+     * \brief   Start a new exchange with the peer.
+     *
+     * \param   cfg     Retransmission configuration.
+     * \param   now     Current time in ms.
+     *
+     * \return  Timeout in ms until the first retransmission.
+     */
+    uint32_t startExchange( const s_lwm2m_retrans_config_t& cfg, uint64_t now );
+
+
+    /**
+     * \brief   Get the timeout of the next retransmission.
+     *
+     * \param   cfg     Retransmission configuration.
+     * \param   timeout Timeout of the previous transmission in ms.
+     *
+     * \return  Timeout in ms until the next retransmission.
+     */
+    uint32_t backoff( const s_lwm2m_retrans_config_t& cfg,
+            uint32_t timeout );
+
+
+    /**
+     * \brief   Add a measured round trip time.
+     *
+     * \param   cfg     Retransmission configuration.
+     * \param   rtt     Time in ms from the first transmission to the
+     *                  acknowledgement.
+     * \param   retrans Number of retransmissions of the exchange.
+     * \param   now     Current time in ms.
+     */
+    void addSample( const s_lwm2m_retrans_config_t& cfg, uint32_t rtt,
+            uint8_t retrans, uint64_t now );
+
+
+    /**
+     * \brief   Count an exchange that failed after all retransmissions.
+     */
+    void addTimeout( void ) {m_stats.timeouts++;}
+
+
+    /**
+     * \brief   Get the statistics of the peer.
+     *
+     * \return  Reference to the statistics.
+     */
+    const s_lwm2m_rtt_stats_t& getStats( void ) const {return m_stats;}
+
+
+private:
+
+    /**
+     * \brief   Limit a timeout to the configured bounds.
+     */
+    static uint32_t bound( const s_lwm2m_retrans_config_t& cfg,
+            uint32_t rto );
+
+
+private:
+
+    /** Statistics, also holding the overall timeout */
+    s_lwm2m_rtt_stats_t m_stats;
+
+    /** Smoothed round trip time of the weak estimator in ms */
+    uint32_t m_weakSrtt;
+
+    /** Round trip time variation of the weak estimator in ms */
+    uint32_t m_weakRttvar;
+
+    /** Time in ms the overall timeout was updated last */
+    uint64_t m_updated;
+};
+
+#endif /* #ifndef __LWM2MRTTESTIMATOR_H__ */
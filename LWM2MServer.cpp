@@ -48,11 +48,17 @@
 #include <string.h>
 #include <iostream>
 #include <string>
+#include <time.h>
+#include <algorithm>
 #include "LWM2MServer.h"
 #include "LWM2MDevice.h"
 #include "LWM2MObject.h"
 #include "LWM2MResource.h"
+
+extern "C" {
 #include "er-coap-13/er-coap-13.h"
+#include "internals.h"
+}
 
 
 /*
@@ -62,7 +68,11 @@
 /** Maximum size of a packet */
 #define LWM2MSERVER_MAX_PACKET_SIZE         1500
 
-#ifdef OPCUA_LWM2M_SERVER_USE_THREAD
+#if defined(OPCUA_LWM2M_SERVER_USE_THREAD) && defined(OPCUA_LWM2M_SERVER_LOCK_STATS)
+#define OPCUA_LWM2M_SERVER_MUTEX_LOCK(a)        (a)->m_lockStats.lock( &(a)->m_mutex, __FUNCTION__, __LINE__ );
+#define OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(a)      (a)->m_lockStats.unlock( &(a)->m_mutex );
+#define OPCUA_LWM2M_SERVER_SLEEP(a)
+#elif defined(OPCUA_LWM2M_SERVER_USE_THREAD)
 #define OPCUA_LWM2M_SERVER_MUTEX_LOCK(a)        pthread_mutex_lock( &(a)->m_mutex );
 #define OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(a)      pthread_mutex_unlock( &(a)->m_mutex );
 #define OPCUA_LWM2M_SERVER_SLEEP(a)
@@ -76,6 +86,221 @@
 /** Sleeptime while running the OPC UA Server */
 #define LWM2MSERVER_RUN_TOT_US                  5000
 
+/** Time in s the retransmissions of a tracked request are held back
+ *  in the LWM2M context */
+#define LWM2MSERVER_RETRANS_HOLD_S              10
+
+/** Maximum time in ms to wait for received packets */
+#define LWM2MSERVER_SELECT_TOT_MS               100
+
+/** Time in ms a failed discover is not repeated, doubled with every
+ *  further failure */
+#define LWM2MSERVER_DISCOVER_BACKOFF_MS         1000
+/** Maximum time in ms a failed discover is not repeated */
+#define LWM2MSERVER_DISCOVER_BACKOFF_MAX_MS     300000
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_timeMs()
+*/
+static uint64_t prv_timeMs( void )
+{
+    return LWM2MClock::timeMs();
+
+} /* prv_timeMs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_writeTLVHeader()
+*/
+static void prv_writeTLVHeader( std::vector< uint8_t >& buf, uint8_t type,
+        uint16_t id, size_t len )
+{
+    uint8_t hdr = type;
+    uint8_t lenLen = 0;
+
+    if( id > 0xFF )
+        hdr |= 0x20;
+
+    if( len < 8 )
+        hdr |= (uint8_t)len;
+    else
+    {
+        lenLen = (len > 0xFFFF) ? 3 : ((len > 0xFF) ? 2 : 1);
+        hdr |= (lenLen << 3);
+    }
+
+    buf.push_back( hdr );
+    if( id > 0xFF )
+        buf.push_back( (uint8_t)(id >> 8) );
+    buf.push_back( (uint8_t)id );
+
+    while( lenLen > 0 )
+    {
+        lenLen--;
+        buf.push_back( (uint8_t)(len >> (lenLen * 8)) );
+    }
+
+} /* prv_writeTLVHeader() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_encodeTLVValue()
+*/
+static int8_t prv_encodeTLVValue( std::vector< uint8_t >& buf,
+        e_lwm2m_value_type_t type, const std::string& val )
+{
+    char* p_end = NULL;
+
+    switch( type )
+    {
+    case e_lwm2m_value_type_int:
+    case e_lwm2m_value_type_time:
+    {
+        int64_t num = strtoll( val.c_str(), &p_end, 10 );
+        size_t len = 8;
+
+        if( (val.empty()) || (*p_end != 0) )
+            return -1;
+
+        /* use the shortest length that keeps the value */
+        if( (num >= INT8_MIN) && (num <= INT8_MAX) )
+            len = 1;
+        else if( (num >= INT16_MIN) && (num <= INT16_MAX) )
+            len = 2;
+        else if( (num >= INT32_MIN) && (num <= INT32_MAX) )
+            len = 4;
+
+        for( size_t i = len; i > 0; i-- )
+            buf.push_back( (uint8_t)((uint64_t)num >> ((i - 1) * 8)) );
+        break;
+    }
+
+    case e_lwm2m_value_type_float:
+    {
+        double num = strtod( val.c_str(), &p_end );
+        uint64_t raw;
+
+        if( (val.empty()) || (*p_end != 0) )
+            return -1;
+
+        memcpy( &raw, &num, sizeof(raw) );
+        for( size_t i = 8; i > 0; i-- )
+            buf.push_back( (uint8_t)(raw >> ((i - 1) * 8)) );
+        break;
+    }
+
+    case e_lwm2m_value_type_bool:
+        if( (val == "1") || (val == "true") )
+            buf.push_back( 1 );
+        else if( (val == "0") || (val == "false") )
+            buf.push_back( 0 );
+        else
+            return -1;
+        break;
+
+    case e_lwm2m_value_type_objlink:
+    {
+        unsigned long objId = strtoul( val.c_str(), &p_end, 10 );
+        unsigned long instId;
+
+        if( *p_end != ':' )
+            return -1;
+        instId = strtoul( p_end + 1, &p_end, 10 );
+        if( (*p_end != 0) || (objId > 0xFFFF) || (instId > 0xFFFF) )
+            return -1;
+
+        buf.push_back( (uint8_t)(objId >> 8) );
+        buf.push_back( (uint8_t)objId );
+        buf.push_back( (uint8_t)(instId >> 8) );
+        buf.push_back( (uint8_t)instId );
+        break;
+    }
+
+    default:
+        /* strings, opaque and unknown types are written as they are */
+        buf.insert( buf.end(), val.begin(), val.end() );
+        break;
+    }
+
+    return 0;
+
+} /* prv_encodeTLVValue() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_strMemSize()
+*/
+static size_t prv_strMemSize( const char* p_str )
+{
+    return (p_str != NULL) ? strlen( p_str ) + 1 : 0;
+
+} /* prv_strMemSize() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_sumUsage()
+*/
+static void prv_sumUsage( s_lwm2m_usage_t* p_total,
+        const s_lwm2m_usage_t* p_usage )
+{
+    int i;
+
+    for( i = 0; i < e_lwm2m_usage_max; i++ )
+        p_total->bytes[i] += p_usage->bytes[i];
+    p_total->total += p_usage->total;
+    p_total->devices += p_usage->devices;
+    p_total->objects += p_usage->objects;
+    p_total->resources += p_usage->resources;
+    p_total->instances += p_usage->instances;
+    p_total->observeParams += p_usage->observeParams;
+    p_total->observations += p_usage->observations;
+    p_total->transactions += p_usage->transactions;
+    p_total->queued += p_usage->queued;
+
+} /* prv_sumUsage() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_totalUsage()
+*/
+static void prv_totalUsage( s_lwm2m_usage_t* p_usage )
+{
+    int i;
+
+    p_usage->total = 0;
+    for( i = 0; i < e_lwm2m_usage_max; i++ )
+        p_usage->total += p_usage->bytes[i];
+
+} /* prv_totalUsage() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_devType()
+*/
+static std::string prv_devType( const lwm2m_client_t* p_cli )
+{
+    std::string type;
+    lwm2m_client_object_t* objectP;
+
+    /* devices registering the same objects are of the same type */
+    for( objectP = p_cli->objectList; objectP != NULL; objectP = objectP->next )
+        type += std::to_string( objectP->id ) + ",";
+
+    return type;
+
+} /* prv_devType() */
+
 /*
  * --- Methods Definition --------------------------------------------------- *
  */
@@ -196,6 +421,16 @@ int16_t LWM2MServer::stopServer( void )
         mp_lwm2mH = NULL;
     }
 
+    /* queued requests fail, non-blocking callers are informed */
+    while( !m_reqQueues.empty() )
+        dropRequestQueue( m_reqQueues.begin()->first,
+                COAP_503_SERVICE_UNAVAILABLE );
+
+    /* requests and connections are gone */
+    m_retrans.clear();
+    m_peers.clear();
+    m_reqPending.clear();
+
     OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
 
     return 0;
@@ -212,14 +447,19 @@ int16_t LWM2MServer::runServer( void )
     fd_set readfds;
     struct timeval tv;
     int result;
+    int8_t overrun;
+    s_lwm2m_loop_sample_t sample;
+    std::vector< LWM2MLoopObserver* > loopObs;
 
     FD_ZERO( &readfds );
     FD_SET( m_sock, &readfds );
 
     tv.tv_sec = 0;
-    tv.tv_usec = 100000;
+    tv.tv_usec = LWM2MSERVER_SELECT_TOT_MS * 1000;
 
+    m_loopProf.begin();
     OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_loopProf.mark( e_lwm2m_loop_phase_lock );
 
 #ifdef OPCUA_LWM2M_SERVER_USE_THREAD
     if( m_threadRun == false )
@@ -228,27 +468,65 @@ int16_t LWM2MServer::runServer( void )
 
     /* check for pending events */
     checkEvents();
+    m_loopProf.mark( e_lwm2m_loop_phase_events );
 
     /* Check for deleted devices */
     checkDeletedDevices();
+    m_loopProf.mark( e_lwm2m_loop_phase_deleted );
+
+    /* Check running firmware updates */
+    checkFirmwareUpdates();
+    m_loopProf.mark( e_lwm2m_loop_phase_firmware );
+
+    /* Check running bulk operations */
+    checkBulkOperations();
+    m_loopProf.mark( e_lwm2m_loop_phase_bulk );
+
+    /* Start scheduled observations */
+    checkSubscriptions();
+    m_loopProf.mark( e_lwm2m_loop_phase_subscriptions );
 
     if( ret == 0 )
     {
+        /* retransmit pending requests */
+        uint32_t next = checkRetransmissions();
+        m_loopProf.mark( e_lwm2m_loop_phase_retrans );
+
         result = lwm2m_step(mp_lwm2mH, &(tv.tv_sec) );
         if (result != 0)
             ret = -1;
+        m_loopProf.mark( e_lwm2m_loop_phase_step );
+
+        /* send queued requests of devices with free capacity */
+        checkRequestQueues();
+        m_loopProf.mark( e_lwm2m_loop_phase_queues );
+
+        /* wake up in time for the next retransmission */
+        if( (tv.tv_sec == 0) && (next < LWM2MSERVER_SELECT_TOT_MS) )
+            tv.tv_usec = next * 1000;
     }
 
     OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
 
+    /* a simulated clock does not advance while waiting */
+    if( LWM2MClock::instance()->isSimulated() )
+    {
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+    }
+
+    /* the wait for packets is not part of the busy time */
+    m_loopProf.suspend();
     if( ret == 0 )
     {
         result = select(FD_SETSIZE, &readfds, 0, 0, &tv);
         if ( result < 0 )
             ret = -1;
     }
+    m_loopProf.mark( e_lwm2m_loop_phase_wait );
 
     OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_loopProf.mark( e_lwm2m_loop_phase_lock );
     if( ret == 0 )
     {
         if (result > 0)
@@ -270,6 +548,16 @@ int16_t LWM2MServer::runServer( void )
                     char s[INET6_ADDRSTRLEN];
                     connection_t * connP;
 
+                    m_metrics.add( e_lwm2m_metric_packets_in );
+                    m_metrics.add( e_lwm2m_metric_bytes_in, numBytes );
+                    m_trace.addPacket( e_lwm2m_trace_receive, 0, LWM2M_MAX_ID,
+                            buffer, numBytes );
+
+                    if( m_capture.isOpen() )
+                        m_capture.add( e_lwm2m_capture_in,
+                                (struct sockaddr *)&addr, addrLen,
+                                buffer, numBytes );
+
                     s[0] = 0;
                     if (AF_INET == addr.ss_family)
                     {
@@ -290,14 +578,42 @@ int16_t LWM2MServer::runServer( void )
                         if( connP != NULL )
                             mp_connList = connP;
                     }
-                    if( connP != NULL )
+                    if( (connP != NULL) &&
+                        (handleFirmwareUpdates( connP, buffer, numBytes ) == false) )
+                    {
+                        uint64_t handled = LWM2MMetrics::now();
+
+                        /* measure the round trip time of answered requests */
+                        sampleRtt( connP, buffer, numBytes );
                         lwm2m_handle_packet( mp_lwm2mH, buffer, numBytes, connP );
+                        m_trace.addPacket( e_lwm2m_trace_handled, 0,
+                                LWM2M_MAX_ID, buffer, numBytes,
+                                LWM2MMetrics::now() - handled );
+
+                        /* an answer makes room for queued requests */
+                        checkRequestQueues();
+                    }
                 }
             }
         }
     }
+    m_loopProf.mark( e_lwm2m_loop_phase_packet );
+
+    overrun = m_loopProf.end( &sample );
+    if( overrun >= 0 )
+        m_metrics.record( e_lwm2m_histogram_loop, sample.busy );
+    if( overrun > 0 )
+        loopObs = m_vectLoopObs;
     OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
 
+    /* report the overrun without holding the lock */
+    std::vector< LWM2MLoopObserver* >::iterator it = loopObs.begin();
+    while( it != loopObs.end() )
+    {
+        (*it)->overrun( &sample );
+        it++;
+    }
+
     return ret;
 } /* LWM2MServer::runServer() */
 
@@ -355,12 +671,76 @@ LWM2MDevice* LWM2MServer::getLWM2MDevice( std::string client )
 } /* LWM2MServer::getLWM2MDevice() */
 
 
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getDevicesByObject()
+*/
+uint32_t LWM2MServer::getDevicesByObject( uint16_t objId,
+    std::vector< LWM2MDevice* >& devices )
+{
+    uint32_t cnt = 0;
+    std::map< uint16_t, std::map< LWM2MDevice*,
+        std::set< LWM2MObject* > > >::const_iterator it;
+    std::map< LWM2MDevice*, std::set< LWM2MObject* > >::const_iterator dev;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    it = m_objIdx.find( objId );
+    if( it != m_objIdx.end() )
+    {
+        for( dev = it->second.begin(); dev != it->second.end(); ++dev )
+        {
+            devices.push_back( dev->first );
+            cnt++;
+        }
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return cnt;
+
+} /* LWM2MServer::getDevicesByObject() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getObjectsById()
+*/
+uint32_t LWM2MServer::getObjectsById( uint16_t objId,
+    std::vector< LWM2MObject* >& objects )
+{
+    uint32_t cnt = 0;
+    std::map< uint16_t, std::map< LWM2MDevice*,
+        std::set< LWM2MObject* > > >::const_iterator it;
+    std::map< LWM2MDevice*, std::set< LWM2MObject* > >::const_iterator dev;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    it = m_objIdx.find( objId );
+    if( it != m_objIdx.end() )
+    {
+        for( dev = it->second.begin(); dev != it->second.end(); ++dev )
+        {
+            objects.insert( objects.end(), dev->second.begin(),
+                dev->second.end() );
+            cnt += dev->second.size();
+        }
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return cnt;
+
+} /* LWM2MServer::getObjectsById() */
+
+
 /*---------------------------------------------------------------------------*/
 /*
 * LWM2MServer::read()
 */
 int8_t LWM2MServer::read( const LWM2MResource* p_res, lwm2m_data_t** val,
-    s_lwm2m_obsparams_t* p_cbParams )
+    s_lwm2m_obsparams_t* p_cbParams, uint32_t timeout,
+    e_lwm2m_request_class_t cls )
 {
     int8_t ret = 0;
 
@@ -424,7 +804,27 @@ int8_t LWM2MServer::read( const LWM2MResource* p_res, lwm2m_data_t** val,
                 LWM2M_URI_FLAG_RESOURCE_ID;
 
         p_cbData->status = NO_ERROR;
-        lwm2mRet = lwm2m_dm_read( mp_lwm2mH, p_cli->internalID, &uri, readWriteResCb, p_cbData);
+        if( (p_cbParams == NULL) && m_reqCfg.cacheReads &&
+            p_res->hasCachedValue() &&
+            ((!p_dev->isAwake()) || (!p_dev->isProbeDue())) )
+        {
+            /* the device sleeps or is unreachable, answer from the
+             * cached value. Only blocking reads are answered, the URI
+             * and the buffer are local. The callback stores the value
+             * in the cache again, so a copy is passed. */
+            std::vector< uint8_t > cache( p_res->m_cache );
+            readWriteResCb( p_cli->internalID, &uri, CONTENT_2_05,
+                    p_res->m_cacheFormat, cache.data(), cache.size(),
+                    p_cbData );
+            p_cbData->uriP = NULL;
+            p_cbData->buffer = NULL;
+            p_cbData->bufferLen = 0;
+            lwm2mRet = COAP_NO_ERROR;
+        }
+        else
+            lwm2mRet = request( p_cli, e_lwm2m_request_read, &uri,
+                    LWM2M_CONTENT_TEXT, NULL, 0, readWriteResCb, p_cbData,
+                    cls );
 
         if( lwm2mRet != COAP_NO_ERROR )
             ret = -1;
@@ -436,20 +836,9 @@ int8_t LWM2MServer::read( const LWM2MResource* p_res, lwm2m_data_t** val,
     {
         if( p_cbParams == NULL )
         {
-            while( true )
-            {
-                int status;
-                OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
-#ifndef OPCUA_LWM2M_SERVER_USE_THREAD
-                /* call the server */
-                runServer();
-#endif /* #ifndef OPCUA_LWM2M_SERVER_USE_THREAD */
-                status = p_cbData->status;;
-                OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
-                if( status != NO_ERROR )
-                    break;
-                OPCUA_LWM2M_SERVER_SLEEP(LWM2MSERVER_RUN_TOT_US);
-            }
+            /* wait for the answer, the request is canceled when it is late */
+            ret = waitRequest( &p_cbData->status, NO_ERROR,
+                    p_cbData, timeout );
 
             if( p_cbData->status == CONTENT_2_05)
             {
@@ -475,7 +864,8 @@ int8_t LWM2MServer::read( const LWM2MResource* p_res, lwm2m_data_t** val,
 * LWM2MServer::write()
 */
 int8_t LWM2MServer::write( const LWM2MResource* p_res, const std::string& val,
-    s_lwm2m_obsparams_t* p_cbParams )
+    s_lwm2m_obsparams_t* p_cbParams, uint32_t timeout,
+    e_lwm2m_request_class_t cls )
 {
     int8_t ret = 0;
     lwm2m_client_t* p_cli;
@@ -534,8 +924,9 @@ int8_t LWM2MServer::write( const LWM2MResource* p_res, const std::string& val,
 
         p_cbData->status = NO_ERROR;
 
-        lwm2mRet = lwm2m_dm_write( mp_lwm2mH, p_cli->internalID, &uri, LWM2M_CONTENT_TEXT,
-                (uint8_t*)val.c_str(), val.length(), readWriteResCb, p_cbData  );
+        lwm2mRet = request( p_cli, e_lwm2m_request_write, &uri, LWM2M_CONTENT_TEXT,
+                (const uint8_t*)val.c_str(), val.length(), readWriteResCb, p_cbData,
+                cls );
 
 
         if( lwm2mRet != COAP_NO_ERROR )
@@ -548,20 +939,9 @@ int8_t LWM2MServer::write( const LWM2MResource* p_res, const std::string& val,
     {
         if( p_cbParams == NULL )
         {
-            while( true )
-            {
-                int status;
-                OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
-#ifndef OPCUA_LWM2M_SERVER_USE_THREAD
-                /* call the server */
-                runServer();
-#endif /* #ifndef OPCUA_LWM2M_SERVER_USE_THREAD */
-                status = p_cbData->status;
-                OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
-                if( status != NO_ERROR )
-                    break;
-                OPCUA_LWM2M_SERVER_SLEEP(LWM2MSERVER_RUN_TOT_US);
-            }
+            /* wait for the answer, the request is canceled when it is late */
+            ret = waitRequest( &p_cbData->status, NO_ERROR,
+                    p_cbData, timeout );
         }
         else
         {
@@ -578,54 +958,35 @@ int8_t LWM2MServer::write( const LWM2MResource* p_res, const std::string& val,
 } /* LWM2MServer::write() */
 
 
-
 /*---------------------------------------------------------------------------*/
 /*
-* LWM2MServer::observe()
+* LWM2MServer::read()
 */
-int8_t LWM2MServer::observe( const LWM2MObject* p_obj, bool observe )
+int8_t LWM2MServer::read( const LWM2MResource* p_res, uint16_t instId,
+    LWM2MValue& val, uint32_t timeout,
+    e_lwm2m_request_class_t cls )
 {
     int8_t ret = 0;
     lwm2m_client_t* p_cli;
     const LWM2MDevice* p_dev;
+    const LWM2MObject* p_obj;
     lwm2m_uri_t uri;
-
-    std::map< const LWM2MObject*, s_lwm2m_obsparams_t*>::iterator it;
-    s_lwm2m_obsparams_t* p_cbData = NULL;
+    s_instRead_t cbData;
     int lwm2mRet;
 
-    if( p_obj == NULL )
-        /* Invalid arguments */
-        ret = -1;
-
-    if( ret == 0 )
-    {
-        it = m_obsObjMap.find( p_obj );
-
-        /* get the observe parameters */
-        if( it == m_obsObjMap.end() )
-        {
-            if( observe == true )
-            {
-                /*create a new entry for the resource */
-                p_cbData = new s_lwm2m_obsparams_t();
-
-                m_obsObjMap.insert(std::pair< const LWM2MObject*, s_lwm2m_obsparams_t* >
-                    ( p_obj, p_cbData ) );
-            }
-        }
-        else
-        {
-            /* use existing parameter */
-            p_cbData = it->second;
-        }
-    }
+    memset( &cbData.params, 0, sizeof(s_lwm2m_obsparams_t) );
+    cbData.instId = instId;
 
     OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
 
+    if( (!isAlive()) || (p_res == NULL) || (instId == LWM2M_VALUE_NO_INSTANCE) )
+        ret = -1;
+
     if( ret == 0 )
     {
-        if( (!isAlive()) || (p_obj == NULL) )
+        /* get object of the resource */
+        p_obj = p_res->getObject();
+        if( p_obj == NULL )
             ret = -1;
     }
 
@@ -645,126 +1006,103 @@ int8_t LWM2MServer::observe( const LWM2MObject* p_obj, bool observe )
             ret = -1;
     }
 
+    if( (ret == 0) && m_reqCfg.cacheReads &&
+        ((!p_dev->isAwake()) || (!p_dev->isProbeDue())) &&
+        (p_res->findInstance( instId, val ) == 0) )
+    {
+        /* the device sleeps or is unreachable, answer from the known
+         * instances */
+        OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+        return 0;
+    }
+
     if( ret == 0 )
     {
-        /* start the query with the according values */
+        /* resource instances can not be addressed, read the resource */
         uri.objectId = p_obj->getObjId();
         uri.instanceId = p_obj->getInstId();
-        uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID;
-
-        if( observe == true )
-        {
-            /* start observation */
-            p_cbData->status = -1;
-
-            lwm2mRet = lwm2m_observe( mp_lwm2mH, p_cli->internalID, &uri, notifyObjCb,
-                const_cast<LWM2MObject*>( p_obj ));
+        uri.resourceId = p_res->getResId();
+        uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID |
+                LWM2M_URI_FLAG_RESOURCE_ID;
 
-            if( lwm2mRet != COAP_NO_ERROR )
-                ret = -1;
-            else
-                ret = 0;
-        }
-        else
-        {
-            /* cancel observation */
-            lwm2mRet = lwm2m_observe_cancel( mp_lwm2mH, p_cli->internalID, &uri, notifyObjCb,
-                const_cast<LWM2MObject*>( p_obj ));
+        cbData.params.status = NO_ERROR;
+        lwm2mRet = request( p_cli, e_lwm2m_request_read, &uri,
+                LWM2M_CONTENT_TEXT, NULL, 0, readResInstCb, &cbData, cls );
 
-            if( lwm2mRet != COAP_NO_ERROR )
-                ret = -1;
-            else
-                ret = 0;
-        }
+        if( lwm2mRet != COAP_NO_ERROR )
+            ret = -1;
     }
 
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
     if( ret == 0 )
     {
-        while( true )
-        {
-            int status;
-            OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
-
-#ifndef OPCUA_LWM2M_SERVER_USE_THREAD
-            /* call the server */
-            runServer();
-#endif /* #ifndef OPCUA_LWM2M_SERVER_USE_THREAD */
-            status = p_cbData->status;
-            OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
-            if( status != -1)
-                break;
-            OPCUA_LWM2M_SERVER_SLEEP(LWM2MSERVER_RUN_TOT_US);
-        }
-
-        if( p_cbData->status == NO_ERROR)
-        {
-            ret = 0;
-            if( observe == false )
-            {
-                /* observation was canceled so we have to delete the
-                 * observe parameters */
-              m_obsObjMap.erase( it );
-            }
-        }
-        else
+        /* wait for the answer, the request is canceled when it is late */
+        ret = waitRequest( &cbData.params.status, NO_ERROR,
+                &cbData, timeout );
+
+        OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+        if( (cbData.params.status != CONTENT_2_05) ||
+            (cbData.params.dataLen <= 0) ||
+            (p_res->findInstance( instId, val ) != 0) )
             ret = -1;
+        OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
     }
+
     return ret;
 
-} /* LWM2MServer::observe() */
-
+} /* LWM2MServer::read() */
 
 
 /*---------------------------------------------------------------------------*/
 /*
-* LWM2MServer::observe()
+* LWM2MServer::write()
 */
-int8_t LWM2MServer::observe( const LWM2MResource* p_res, bool observe )
+int8_t LWM2MServer::write( const LWM2MResource* p_res, uint16_t instId,
+    const std::string& val, s_lwm2m_obsparams_t* p_cbParams,
+    uint32_t timeout, e_lwm2m_request_class_t cls )
 {
     int8_t ret = 0;
     lwm2m_client_t* p_cli;
     const LWM2MDevice* p_dev;
     const LWM2MObject* p_obj;
     lwm2m_uri_t uri;
-
-    std::map< const LWM2MResource*, s_lwm2m_obsparams_t*>::iterator it;
     s_lwm2m_obsparams_t* p_cbData = NULL;
+    s_lwm2m_obsparams_t cbData;
+    std::vector< uint8_t > value;
+    std::vector< uint8_t > inst;
+    std::vector< uint8_t > payload;
     int lwm2mRet;
 
-    if( p_res == NULL )
-        /* Invalid arguments */
-        ret = -1;
-
-    if( ret == 0 )
+    if( p_cbParams == NULL )
     {
-        it = m_obsResMap.find( p_res );
+        /* create local cb parameters for blocking operation */
+        p_cbData = &cbData;
+        memset( p_cbData, 0, sizeof(s_lwm2m_obsparams_t) );
+    }
+    else
+    {
+        /* non-blocking operation with callback parameters */
+        p_cbData = p_cbParams;
+    }
 
-        /* get the observe parameters */
-        if( it == m_obsResMap.end() )
-        {
-            if( observe == true )
-            {
-                /*create a new entry for the resource */
-                p_cbData = new s_lwm2m_obsparams_t();
+    if( (p_res == NULL) || (instId == LWM2M_VALUE_NO_INSTANCE) )
+        return -1;
 
-                m_obsResMap.insert(std::pair< const LWM2MResource*, s_lwm2m_obsparams_t* >
-                    ( p_res, p_cbData ) );
-            }
-        }
-        else
-        {
-            /* use existing parameter */
-            p_cbData = it->second;
-        }
-    }
+    /* encode the instance as part of the multiple resource */
+    if( prv_encodeTLVValue( value, p_res->getType(), val ) != 0 )
+        return -1;
+
+    prv_writeTLVHeader( inst, LWM2M_TLV_TYPE_RES_INSTANCE, instId, value.size() );
+    inst.insert( inst.end(), value.begin(), value.end() );
+    prv_writeTLVHeader( payload, LWM2M_TLV_TYPE_MULTIPLE_RES, p_res->getResId(),
+        inst.size() );
+    payload.insert( payload.end(), inst.begin(), inst.end() );
 
     OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
 
-    if( ret == 0 )
-    {
-        if( (!isAlive()) || (p_res == NULL) )
-            ret = -1;
-    }
+    if( !isAlive() )
+        ret = -1;
 
     if( ret == 0 )
     {
@@ -792,282 +1130,3248 @@ int8_t LWM2MServer::observe( const LWM2MResource* p_res, bool observe )
 
     if( ret == 0 )
     {
-        /* start the query with the according values */
+        /* a write to the object instance is a partial update which keeps
+         * the other instances of the resource */
         uri.objectId = p_obj->getObjId();
         uri.instanceId = p_obj->getInstId();
-        uri.resourceId = p_res->getResId();
-        uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID |
-                LWM2M_URI_FLAG_RESOURCE_ID;
+        uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID;
 
-        if( observe == true )
-        {
-            /* start observation */
-            p_cbData->status = -1;
+        p_cbData->status = NO_ERROR;
 
-            lwm2mRet = lwm2m_observe( mp_lwm2mH, p_cli->internalID, &uri, notifyResCb,
-                const_cast<LWM2MResource*>( p_res ));
+        lwm2mRet = request( p_cli, e_lwm2m_request_write, &uri,
+                LWM2M_CONTENT_TLV, payload.data(), payload.size(),
+                readWriteResCb, p_cbData, cls );
 
-            if( lwm2mRet != COAP_NO_ERROR )
-                ret = -1;
-            else
-                ret = 0;
-        }
-        else
-        {
-            /* cancel observation */
-            lwm2mRet = lwm2m_observe_cancel( mp_lwm2mH, p_cli->internalID, &uri, notifyResCb,
-                const_cast<LWM2MResource*>( p_res ));
+        if( lwm2mRet != COAP_NO_ERROR )
+            ret = -1;
+    }
 
-            if( lwm2mRet != COAP_NO_ERROR )
-                ret = -1;
-            else
-                ret = 0;
-        }
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    if( (ret == 0) && (p_cbParams == NULL) )
+    {
+        /* wait for the answer, the request is canceled when it is late */
+        ret = waitRequest( &p_cbData->status, NO_ERROR,
+                p_cbData, timeout );
+
+        if( p_cbData->status != CHANGED_2_04 )
+            ret = -1;
+    }
+
+    return ret;
+
+} /* LWM2MServer::write() */
+
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::discover()
+*/
+int8_t LWM2MServer::discover( LWM2MObject* p_obj, uint32_t timeout,
+    e_lwm2m_request_class_t cls )
+{
+    int8_t ret = 0;
+    const LWM2MDevice* p_dev = NULL;
+    std::string key;
+    std::map< std::string, s_discover_t >::iterator it;
+    uint64_t deadline;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    if( (!isAlive()) || (p_obj == NULL) )
+        ret = -1;
+
+    if( (ret == 0) && p_obj->isDiscovered() )
+    {
+        OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+        return 0;
+    }
+
+    if( ret == 0 )
+    {
+        /* get device of the object */
+        p_dev = p_obj->getDevice();
+        if( p_dev == NULL )
+            ret = -1;
     }
 
+    if( ret == 0 )
+        key = discoverKey( p_dev, p_obj->getObjId() );
+
+    /* the first request for the type is sent to the device, all others
+     * wait for its result */
+    if( ret == 0 )
+        ret = startDiscover( p_obj, cls );
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    if( timeout == LWM2M_REQUEST_TIMEOUT_DEFAULT )
+        timeout = m_reqCfg.timeout;
+    deadline = prv_timeMs() + timeout;
+
     if( ret == 0 )
     {
         while( true )
         {
-            int status;
+            int status = -1;
             OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
-
 #ifndef OPCUA_LWM2M_SERVER_USE_THREAD
             /* call the server */
             runServer();
 #endif /* #ifndef OPCUA_LWM2M_SERVER_USE_THREAD */
-            status = p_cbData->status;
+            /* failed discovers stay in the cache with their error */
+            it = m_discoverCache.find( key );
+            if( it != m_discoverCache.end() )
+                status = it->second.status;
+            if( status == CONTENT_2_05 )
+                populate( p_obj, it->second );
             OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
-            if( status != -1)
+            if( status != NO_ERROR )
+                break;
+
+            /* the discover keeps running for other objects of the type */
+            if( (timeout != 0) && (prv_timeMs() >= deadline) )
                 break;
             OPCUA_LWM2M_SERVER_SLEEP(LWM2MSERVER_RUN_TOT_US);
         }
 
-        if( p_cbData->status == NO_ERROR)
-        {
-            ret = 0;
-            if( observe == false )
-            {
-                /* observation was canceled so we have to delete the
-                 * observe parameters */
-                m_obsResMap.erase( it );
-            }
-        }
-        else
+        if( p_obj->isDiscovered() == false )
             ret = -1;
     }
+
     return ret;
-} /* LWM2MServer::observe() */
+
+} /* LWM2MServer::discover() */
 
 
 /*---------------------------------------------------------------------------*/
 /*
-* LWM2MServer::registerObserver()
+* LWM2MServer::cancel()
 */
-int8_t LWM2MServer::registerObserver( LWM2MServerObserver* p_observer )
+int16_t LWM2MServer::cancel( const s_lwm2m_obsparams_t* p_cbParams )
 {
-    if( p_observer == NULL )
-        return -1;
-
-    /* find the observer in the list */
-    std::vector< LWM2MServerObserver*>::iterator it =
-            m_vectObs.begin();
-
-    while( it != m_vectObs.end() )
-    {
-        if( *it == p_observer )
-            /* found observer */
-            break;
-        it++;
-    }
+    int16_t ret;
 
+    if( p_cbParams == NULL )
+        return -1;
 
-    if( it == m_vectObs.end() )
-    {
-        /* The observer was not found so it has to be added. */
-        m_vectObs.push_back( p_observer );
-    }
-
-    return 0;
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    ret = cancelRequests( NULL, p_cbParams );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
 
-} /* LWM2MResource::registerObserver() */
+    return ret;
 
+} /* LWM2MServer::cancel() */
 
 
 /*---------------------------------------------------------------------------*/
 /*
-* LWM2MServer::deregisterObserver()
+* LWM2MServer::cancel()
 */
-int8_t LWM2MServer::deregisterObserver( const LWM2MServerObserver* p_observer )
+int16_t LWM2MServer::cancel( const LWM2MDevice* p_dev )
 {
-    if( p_observer == NULL )
-        return -1;
+    int16_t ret = 0;
+    lwm2m_client_t* p_cli;
 
-    /* find the observer in the list */
-    std::vector< LWM2MServerObserver*>::iterator it =
-            m_vectObs.begin();
+    if( p_dev == NULL )
+        return -1;
 
-    while( it != m_vectObs.end() )
-    {
-        if( *it == p_observer )
-            /* found observer */
-            break;
-        it++;
-    }
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
 
+    p_cli = getDevice( p_dev->getName() );
+    if( p_cli == NULL )
+        ret = -1;
+    else
+        ret = cancelRequests( p_cli, NULL );
 
-    if( it != m_vectObs.end() )
-    {
-        /* The observer was not found so it has to be added. */
-        m_vectObs.erase( it );
-    }
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
 
-    return 0;
+    return ret;
 
-} /* LWM2MResource::deregisterObserver() */
+} /* LWM2MServer::cancel() */
 
 
 /*---------------------------------------------------------------------------*/
 /*
-* LWM2MServer::getDevice()
+* LWM2MServer::clearDiscoverCache()
 */
-lwm2m_client_t* LWM2MServer::getDevice( std::string client )
+void LWM2MServer::clearDiscoverCache( void )
 {
-    if( !isAlive() )
-        return NULL;
-
-    /* client pointer */
-    lwm2m_client_t * p_targetP;
-    p_targetP = mp_lwm2mH->clientList;
-
-    if (p_targetP == NULL)
-    {
-        return NULL;
-    }
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
 
-    for( p_targetP = mp_lwm2mH->clientList; p_targetP != NULL;
-            p_targetP = p_targetP->next )
+    std::map< std::string, s_discover_t >::iterator it = m_discoverCache.begin();
+    while( it != m_discoverCache.end() )
     {
-        if( p_targetP != NULL )
-        {
-            if( client ==  p_targetP->name)
-                return p_targetP;
-        }
+        /* running discovers still refer to their entry */
+        if( it->second.status != NO_ERROR )
+            it = m_discoverCache.erase( it );
+        else
+            it++;
     }
 
-    return NULL;
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
 
-} /* LWM2MServer::getDevice() */
+} /* LWM2MServer::clearDiscoverCache() */
 
 
 /*---------------------------------------------------------------------------*/
 /*
-* LWM2MServer::notifyObservers()
+* LWM2MServer::observe()
 */
-int8_t LWM2MServer::notifyObservers( s_lwm2m_serverobserver_event_param_t param,
-    e_lwm2m_serverobserver_event_t ev ) const
+int8_t LWM2MServer::observe( const LWM2MObject* p_obj, bool observe,
+    uint32_t timeout, e_lwm2m_request_class_t cls )
 {
-    /* Iterate through the observers in the list */
-    std::vector< LWM2MServerObserver*>::const_iterator it =
-             m_vectObs.begin();
-
-    while( it != m_vectObs.end() )
-    {
-        /* notify the current observer */
-        (*it)->notify( param, ev );
-        it++;
-    }
+    int8_t ret = 0;
+    lwm2m_client_t* p_cli;
+    const LWM2MDevice* p_dev;
+    lwm2m_uri_t uri;
 
-    return 0;
-} /* LWM2MServer::notifyObservers() */
+    std::map< const LWM2MObject*, s_lwm2m_obsparams_t*>::iterator it;
+    s_lwm2m_obsparams_t* p_cbData = NULL;
+    bool created = false;
+    uint32_t traceId = 0;
+    int lwm2mRet;
 
+    if( p_obj == NULL )
+        /* Invalid arguments */
+        ret = -1;
 
-/*---------------------------------------------------------------------------*/
-/*
-* LWM2MServer::checkEvents()
-*/
-void LWM2MServer::checkEvents( void )
-{
-    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
-    while( m_devEv.size() )
+    if( ret == 0 )
     {
-        s_devEvent_t ev = m_devEv.front();
-        m_devEv.pop();
-        /* Notify all Observers */
-        notifyObservers( ev.param, ev.event );
-    }
-    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+        it = m_obsObjMap.find( p_obj );
+
+        /* get the observe parameters */
+        if( it == m_obsObjMap.end() )
+        {
+            if( observe == true )
+            {
+                /*create a new entry for the resource */
+                p_cbData = new s_lwm2m_obsparams_t();
+                created = true;
+
+                m_obsObjMap.insert(std::pair< const LWM2MObject*, s_lwm2m_obsparams_t* >
+                    ( p_obj, p_cbData ) );
+            }
+        }
+        else
+        {
+            /* use existing parameter */
+            p_cbData = it->second;
+        }
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    if( ret == 0 )
+    {
+        /* an observation that was never started can not be canceled */
+        if( (!isAlive()) || (p_obj == NULL) || (p_cbData == NULL) )
+            ret = -1;
+    }
+
+    if( ret == 0 )
+    {
+        /* get device of the resource */
+        p_dev = p_obj->getDevice();
+        if( p_dev == NULL )
+            ret = -1;
+    }
+
+    if( ret == 0 )
+    {
+        /* find the device in the list of registered devices */
+        p_cli = getDevice( p_dev->getName() );
+        if( p_cli == NULL )
+            ret = -1;
+    }
+
+    if( ret == 0 )
+    {
+        /* start the query with the according values */
+        uri.objectId = p_obj->getObjId();
+        uri.instanceId = p_obj->getInstId();
+        uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID;
+
+        if( observe == true )
+        {
+            /* start observation */
+            p_cbData->status = -1;
+
+            lwm2mRet = request( p_cli, e_lwm2m_request_observe, &uri,
+                LWM2M_CONTENT_TEXT, NULL, 0, notifyObjCb,
+                const_cast<LWM2MObject*>( p_obj ), cls, &traceId );
+
+            if( lwm2mRet != COAP_NO_ERROR )
+                ret = -1;
+            else
+                ret = 0;
+        }
+        else
+        {
+            /* cancel observation */
+            lwm2mRet = request( p_cli, e_lwm2m_request_observe_cancel, &uri,
+                LWM2M_CONTENT_TEXT, NULL, 0, notifyObjCb,
+                const_cast<LWM2MObject*>( p_obj ), cls, &traceId );
+
+            if( lwm2mRet != COAP_NO_ERROR )
+                ret = -1;
+            else
+                ret = 0;
+        }
+    }
+
+    /* the server must run while waiting */
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    if( ret == 0 )
+    {
+        /* wait for the answer, the request is canceled when it is late */
+        /* other observations of the same target share the callback
+         * data, only this request is canceled */
+        ret = waitRequest( &p_cbData->status, -1,
+                const_cast<LWM2MObject*>( p_obj ), timeout, traceId );
+
+        if( p_cbData->status == NO_ERROR)
+        {
+            ret = 0;
+
+            /* the observation is issued again after a registration */
+            OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+            keepObservation( p_dev->getName(), &uri, observe );
+
+            if( observe == false )
+            {
+                /* observation was canceled so we have to delete the
+                 * observe parameters */
+                it = m_obsObjMap.find( p_obj );
+                if( it != m_obsObjMap.end() )
+                {
+                    delete( it->second );
+                    m_obsObjMap.erase( it );
+                }
+            }
+            OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+        }
+        else
+            ret = -1;
+    }
+
+    if( (ret != 0) && created )
+    {
+        /* the parameters of a failed observation are not used anymore */
+        OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+        it = m_obsObjMap.find( p_obj );
+        if( (it != m_obsObjMap.end()) && (it->second == p_cbData) )
+        {
+            delete( it->second );
+            m_obsObjMap.erase( it );
+        }
+        OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+    }
+    return ret;
+
+} /* LWM2MServer::observe() */
+
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::observe()
+*/
+int8_t LWM2MServer::observe( const LWM2MResource* p_res, bool observe,
+    uint32_t timeout, e_lwm2m_request_class_t cls )
+{
+    int8_t ret = 0;
+    lwm2m_client_t* p_cli;
+    const LWM2MDevice* p_dev;
+    const LWM2MObject* p_obj;
+    lwm2m_uri_t uri;
+
+    std::map< const LWM2MResource*, s_lwm2m_obsparams_t*>::iterator it;
+    s_lwm2m_obsparams_t* p_cbData = NULL;
+    bool created = false;
+    uint32_t traceId = 0;
+    int lwm2mRet;
+
+    if( p_res == NULL )
+        /* Invalid arguments */
+        ret = -1;
+
+    if( ret == 0 )
+    {
+        it = m_obsResMap.find( p_res );
+
+        /* get the observe parameters */
+        if( it == m_obsResMap.end() )
+        {
+            if( observe == true )
+            {
+                /*create a new entry for the resource */
+                p_cbData = new s_lwm2m_obsparams_t();
+                created = true;
+
+                m_obsResMap.insert(std::pair< const LWM2MResource*, s_lwm2m_obsparams_t* >
+                    ( p_res, p_cbData ) );
+            }
+        }
+        else
+        {
+            /* use existing parameter */
+            p_cbData = it->second;
+        }
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    if( ret == 0 )
+    {
+        /* an observation that was never started can not be canceled */
+        if( (!isAlive()) || (p_res == NULL) || (p_cbData == NULL) )
+            ret = -1;
+    }
+
+    if( ret == 0 )
+    {
+        /* get object of the resource */
+        p_obj = p_res->getObject();
+        if( p_obj == NULL )
+            ret = -1;
+    }
+
+    if( ret == 0 )
+    {
+        /* get device of the resource */
+        p_dev = p_obj->getDevice();
+        if( p_dev == NULL )
+            ret = -1;
+    }
+
+    if( ret == 0 )
+    {
+        /* find the device in the list of registered devices */
+        p_cli = getDevice( p_dev->getName() );
+        if( p_cli == NULL )
+            ret = -1;
+    }
+
+    if( ret == 0 )
+    {
+        /* start the query with the according values */
+        uri.objectId = p_obj->getObjId();
+        uri.instanceId = p_obj->getInstId();
+        uri.resourceId = p_res->getResId();
+        uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID |
+                LWM2M_URI_FLAG_RESOURCE_ID;
+
+        if( observe == true )
+        {
+            /* start observation */
+            p_cbData->status = -1;
+
+            lwm2mRet = request( p_cli, e_lwm2m_request_observe, &uri,
+                LWM2M_CONTENT_TEXT, NULL, 0, notifyResCb,
+                const_cast<LWM2MResource*>( p_res ), cls, &traceId );
+
+            if( lwm2mRet != COAP_NO_ERROR )
+                ret = -1;
+            else
+                ret = 0;
+        }
+        else
+        {
+            /* cancel observation */
+            lwm2mRet = request( p_cli, e_lwm2m_request_observe_cancel, &uri,
+                LWM2M_CONTENT_TEXT, NULL, 0, notifyResCb,
+                const_cast<LWM2MResource*>( p_res ), cls, &traceId );
+
+            if( lwm2mRet != COAP_NO_ERROR )
+                ret = -1;
+            else
+                ret = 0;
+        }
+    }
+
+    /* the server must run while waiting */
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    if( ret == 0 )
+    {
+        /* wait for the answer, the request is canceled when it is late */
+        /* other observations of the same target share the callback
+         * data, only this request is canceled */
+        ret = waitRequest( &p_cbData->status, -1,
+                const_cast<LWM2MResource*>( p_res ), timeout, traceId );
+
+        if( p_cbData->status == NO_ERROR)
+        {
+            ret = 0;
+
+            /* the observation is issued again after a registration */
+            OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+            keepObservation( p_dev->getName(), &uri, observe );
+
+            if( observe == false )
+            {
+                /* observation was canceled so we have to delete the
+                 * observe parameters */
+                it = m_obsResMap.find( p_res );
+                if( it != m_obsResMap.end() )
+                {
+                    delete( it->second );
+                    m_obsResMap.erase( it );
+                }
+            }
+            OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+        }
+        else
+            ret = -1;
+    }
+
+    if( (ret != 0) && created )
+    {
+        /* the parameters of a failed observation are not used anymore */
+        OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+        it = m_obsResMap.find( p_res );
+        if( (it != m_obsResMap.end()) && (it->second == p_cbData) )
+        {
+            delete( it->second );
+            m_obsResMap.erase( it );
+        }
+        OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+    }
+    return ret;
+} /* LWM2MServer::observe() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::registerObserver()
+*/
+int8_t LWM2MServer::registerObserver( LWM2MServerObserver* p_observer )
+{
+    if( p_observer == NULL )
+        return -1;
+
+    /* find the observer in the list */
+    std::vector< LWM2MServerObserver*>::iterator it =
+            m_vectObs.begin();
+
+    while( it != m_vectObs.end() )
+    {
+        if( *it == p_observer )
+            /* found observer */
+            break;
+        it++;
+    }
+
+
+    if( it == m_vectObs.end() )
+    {
+        /* The observer was not found so it has to be added. */
+        m_vectObs.push_back( p_observer );
+    }
+
+    return 0;
+
+} /* LWM2MResource::registerObserver() */
+
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::deregisterObserver()
+*/
+int8_t LWM2MServer::deregisterObserver( const LWM2MServerObserver* p_observer )
+{
+    if( p_observer == NULL )
+        return -1;
+
+    /* find the observer in the list */
+    std::vector< LWM2MServerObserver*>::iterator it =
+            m_vectObs.begin();
+
+    while( it != m_vectObs.end() )
+    {
+        if( *it == p_observer )
+            /* found observer */
+            break;
+        it++;
+    }
+
+
+    if( it != m_vectObs.end() )
+    {
+        /* The observer was not found so it has to be added. */
+        m_vectObs.erase( it );
+    }
+
+    return 0;
+
+} /* LWM2MResource::deregisterObserver() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::registerObserver()
+*/
+int8_t LWM2MServer::registerObserver( LWM2MLoopObserver* p_observer )
+{
+    int8_t ret = 0;
+
+    if( p_observer == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    /* find the observer in the list */
+    std::vector< LWM2MLoopObserver*>::iterator it =
+            m_vectLoopObs.begin();
+
+    while( it != m_vectLoopObs.end() )
+    {
+        if( *it == p_observer )
+            /* found observer */
+            break;
+        it++;
+    }
+
+    if( it == m_vectLoopObs.end() )
+        m_vectLoopObs.push_back( p_observer );
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+    return ret;
+
+} /* LWM2MServer::registerObserver() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::deregisterObserver()
+*/
+int8_t LWM2MServer::deregisterObserver( const LWM2MLoopObserver* p_observer )
+{
+    int8_t ret = -1;
+
+    if( p_observer == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    /* find the observer in the list */
+    std::vector< LWM2MLoopObserver*>::iterator it =
+            m_vectLoopObs.begin();
+
+    while( it != m_vectLoopObs.end() )
+    {
+        if( *it == p_observer )
+            /* found observer */
+            break;
+        it++;
+    }
+
+    if( it != m_vectLoopObs.end() )
+    {
+        m_vectLoopObs.erase( it );
+        ret = 0;
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+    return ret;
+
+} /* LWM2MServer::deregisterObserver() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::startFirmwareUpdate()
+*/
+int8_t LWM2MServer::startFirmwareUpdate( LWM2MFirmwareUpdate* p_fw )
+{
+    int8_t ret = 0;
+
+    if( (p_fw == NULL) || (p_fw->getImage() == NULL) ||
+        (!p_fw->getImage()->isOpen()) )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    std::list< LWM2MFirmwareUpdate* >::iterator it = m_fwUpdates.begin();
+    while( it != m_fwUpdates.end() )
+    {
+        if( *it == p_fw )
+            /* update is already running */
+            break;
+        it++;
+    }
+
+    if( it == m_fwUpdates.end() )
+        m_fwUpdates.push_back( p_fw );
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+    return ret;
+
+} /* LWM2MServer::startFirmwareUpdate() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::stopFirmwareUpdate()
+*/
+int8_t LWM2MServer::stopFirmwareUpdate( LWM2MFirmwareUpdate* p_fw )
+{
+    if( p_fw == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_fwUpdates.remove( p_fw );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return 0;
+
+} /* LWM2MServer::stopFirmwareUpdate() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getFirmwareProgress()
+*/
+int8_t LWM2MServer::getFirmwareProgress( const LWM2MFirmwareUpdate* p_fw,
+    const std::string& devName, s_lwm2m_fwupdate_progress_t* p_progress )
+{
+    int8_t ret;
+
+    if( p_fw == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    ret = p_fw->getProgress( devName, p_progress );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::getFirmwareProgress() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getFirmwareCount()
+*/
+uint32_t LWM2MServer::getFirmwareCount( const LWM2MFirmwareUpdate* p_fw,
+    e_lwm2m_fwupdate_state_t state )
+{
+    uint32_t ret;
+
+    if( p_fw == NULL )
+        return 0;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    ret = p_fw->getCount( state );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::getFirmwareCount() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::startBulkOperation()
+*/
+int8_t LWM2MServer::startBulkOperation( LWM2MBulkOperation* p_op )
+{
+    int8_t ret = 0;
+
+    if( p_op == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    std::list< LWM2MBulkOperation* >::iterator it = m_bulkOps.begin();
+    while( it != m_bulkOps.end() )
+    {
+        if( *it == p_op )
+            /* operation is already running */
+            break;
+        it++;
+    }
+
+    if( it == m_bulkOps.end() )
+    {
+        /* select the devices */
+        ret = p_op->start( this );
+        if( ret == 0 )
+            m_bulkOps.push_back( p_op );
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+    return ret;
+
+} /* LWM2MServer::startBulkOperation() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::stopBulkOperation()
+*/
+int8_t LWM2MServer::stopBulkOperation( LWM2MBulkOperation* p_op )
+{
+    if( p_op == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_bulkOps.remove( p_op );
+    if( isAlive() )
+        p_op->stop( this );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return 0;
+
+} /* LWM2MServer::stopBulkOperation() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getBulkStats()
+*/
+int8_t LWM2MServer::getBulkStats( const LWM2MBulkOperation* p_op,
+    s_lwm2m_bulk_stats_t* p_stats )
+{
+    if( (p_op == NULL) || (p_stats == NULL) )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    p_op->getStats( p_stats );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return 0;
+
+} /* LWM2MServer::getBulkStats() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::setRetransmissionConfig()
+*/
+int8_t LWM2MServer::setRetransmissionConfig(
+    const s_lwm2m_retrans_config_t* p_cfg )
+{
+    if( p_cfg == NULL )
+        return -1;
+
+    if( (p_cfg->minRto == 0) || (p_cfg->minRto > p_cfg->initialRto) ||
+        (p_cfg->initialRto > p_cfg->maxRto) )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_retransCfg = *p_cfg;
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return 0;
+
+} /* LWM2MServer::setRetransmissionConfig() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getRttStats()
+*/
+int8_t LWM2MServer::getRttStats( const std::string& devName,
+    s_lwm2m_rtt_stats_t* p_stats )
+{
+    int8_t ret = 0;
+    lwm2m_client_t* p_cli;
+    std::map< void*, LWM2MRttEstimator >::iterator it;
+
+    if( p_stats == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    p_cli = getDevice( devName );
+    if( p_cli == NULL )
+        ret = -1;
+
+    if( ret == 0 )
+    {
+        /* the estimate is kept with the connection of the device */
+        it = m_peers.find( p_cli->sessionH );
+        if( it != m_peers.end() )
+            *p_stats = it->second.getStats();
+        else
+            *p_stats = LWM2MRttEstimator( m_retransCfg ).getStats();
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::getRttStats() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::setRequestConfig()
+*/
+int8_t LWM2MServer::setRequestConfig( const s_lwm2m_request_config_t* p_cfg )
+{
+    if( (p_cfg == NULL) || (p_cfg->nstart == 0) )
+        return -1;
+
+    if( (p_cfg->breakerThreshold != 0) && ((p_cfg->breakerProbe == 0) ||
+        (p_cfg->breakerProbe > p_cfg->breakerProbeMax)) )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_reqCfg = *p_cfg;
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return 0;
+
+} /* LWM2MServer::setRequestConfig() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getRequestStats()
+*/
+int8_t LWM2MServer::getRequestStats( const std::string& devName,
+    s_lwm2m_request_stats_t* p_stats )
+{
+    int8_t ret = 0;
+    lwm2m_client_t* p_cli;
+    std::map< uint16_t, LWM2MRequestQueue >::const_iterator it;
+
+    if( p_stats == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    p_cli = getDevice( devName );
+    if( p_cli == NULL )
+        ret = -1;
+
+    if( ret == 0 )
+    {
+        it = m_reqQueues.find( p_cli->internalID );
+        if( it != m_reqQueues.end() )
+            it->second.getStats( p_stats );
+        else
+            LWM2MRequestQueue().getStats( p_stats );
+
+        p_stats->inFlight = getInFlight( p_cli );
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::getRequestStats() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::addSubscription()
+*/
+int16_t LWM2MServer::addSubscription( const s_lwm2m_subscription_t* p_sub )
+{
+    int16_t ret;
+    std::map< uint16_t, std::map< LWM2MDevice*,
+        std::set< LWM2MObject* > > >::const_iterator it;
+    std::map< LWM2MDevice*, std::set< LWM2MObject* > >::const_iterator dev;
+    std::set< LWM2MObject* >::const_iterator obj;
+    lwm2m_uri_t uri;
+
+    if( p_sub == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    ret = m_subs.add( *p_sub );
+
+    /* observe the resource on the devices registered already */
+    it = m_objIdx.find( p_sub->objId );
+    if( (ret >= 0) && (it != m_objIdx.end()) )
+    {
+        uint64_t now = prv_timeMs();
+
+        uri.objectId = p_sub->objId;
+        uri.resourceId = p_sub->resId;
+        uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID |
+                LWM2M_URI_FLAG_RESOURCE_ID;
+
+        for( dev = it->second.begin(); dev != it->second.end(); ++dev )
+        {
+            for( obj = dev->second.begin(); obj != dev->second.end(); ++obj )
+            {
+                if( (p_sub->instId != LWM2M_SUBSCRIPTION_ALL_INSTANCES) &&
+                    ((*obj)->getInstId() != p_sub->instId) )
+                    continue;
+
+                uri.instanceId = (*obj)->getInstId();
+                m_subs.schedule( dev->first->getName(), uri, now );
+            }
+        }
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::addSubscription() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::removeSubscription()
+*/
+int8_t LWM2MServer::removeSubscription( int16_t id )
+{
+    int8_t ret;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    ret = m_subs.remove( id );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::removeSubscription() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::setSubscriptionConfig()
+*/
+int8_t LWM2MServer::setSubscriptionConfig(
+    const s_lwm2m_subscription_config_t* p_cfg )
+{
+    if( p_cfg == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_subs.setConfig( *p_cfg );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return 0;
+
+} /* LWM2MServer::setSubscriptionConfig() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getMetrics()
+*/
+int8_t LWM2MServer::getMetrics( s_lwm2m_metrics_t* p_metrics )
+{
+    std::map< uint16_t, LWM2MRequestQueue >::const_iterator it;
+    lwm2m_transaction_t* p_tr;
+    connection_t* p_conn;
+
+    if( p_metrics == NULL )
+        return -1;
+
+    m_metrics.snapshot( p_metrics );
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    p_metrics->devices = m_devMap.size();
+    p_metrics->observations = m_obsResMap.size() + m_obsObjMap.size();
+    p_metrics->deletions = m_devDel.size() + m_objDel.size();
+    p_metrics->peers = m_peers.size();
+
+    for( p_conn = mp_connList; p_conn != NULL; p_conn = p_conn->next )
+        p_metrics->connections++;
+
+    for( it = m_reqQueues.begin(); it != m_reqQueues.end(); ++it )
+        p_metrics->queued += it->second.size();
+
+    if( isAlive() )
+    {
+        for( p_tr = mp_lwm2mH->transactionList; p_tr != NULL;
+             p_tr = p_tr->next )
+            p_metrics->transactions++;
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return 0;
+
+} /* LWM2MServer::getMetrics() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getLockStats()
+*/
+int8_t LWM2MServer::getLockStats( std::vector< s_lwm2m_lock_site_t >& sites,
+        bool reset )
+{
+#if defined(OPCUA_LWM2M_SERVER_USE_THREAD) && defined(OPCUA_LWM2M_SERVER_LOCK_STATS)
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_lockStats.getSites( sites );
+    if( reset )
+        m_lockStats.reset();
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return 0;
+#else
+    (void)sites;
+    (void)reset;
+
+    /* the server lock is not instrumented */
+    return -1;
+#endif
+
+} /* LWM2MServer::getLockStats() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getUsage()
+*/
+int8_t LWM2MServer::getUsage( const std::string& devName,
+        s_lwm2m_usage_t* p_usage )
+{
+    std::map< std::string, LWM2MDevice* >::iterator it;
+    int8_t ret = -1;
+
+    if( p_usage == NULL )
+        return -1;
+
+    memset( p_usage, 0, sizeof(s_lwm2m_usage_t) );
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    it = m_devMap.find( devName );
+    if( it != m_devMap.end() )
+    {
+        addUsage( it->second, getDevice( devName ), p_usage );
+        prv_totalUsage( p_usage );
+        ret = 0;
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::getUsage() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getUsage()
+*/
+uint32_t LWM2MServer::getUsage(
+        std::map< std::string, s_lwm2m_usage_t >& devices,
+        s_lwm2m_usage_t* p_total )
+{
+    std::map< uint16_t, LWM2MDevice* >::iterator devIt;
+    std::list< s_devDel_t >::iterator delIt;
+    std::list< s_objDel_t >::iterator objIt;
+    lwm2m_client_t* p_cli;
+    s_lwm2m_usage_t usage;
+    uint32_t cnt = 0;
+
+    if( p_total == NULL )
+        return 0;
+
+    devices.clear();
+    memset( p_total, 0, sizeof(s_lwm2m_usage_t) );
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    /* the clients are walked once instead of looking up every device */
+    for( p_cli = isAlive() ? mp_lwm2mH->clientList : NULL; p_cli != NULL;
+         p_cli = p_cli->next )
+    {
+        devIt = m_devIdMap.find( p_cli->internalID );
+
+        memset( &usage, 0, sizeof(usage) );
+        addUsage( (devIt != m_devIdMap.end()) ? devIt->second : NULL,
+                p_cli, &usage );
+        prv_totalUsage( &usage );
+        prv_sumUsage( p_total, &usage );
+
+        if( p_cli->name != NULL )
+            devices[p_cli->name] = usage;
+        cnt++;
+    }
+
+    /* deleted devices and objects are kept for a while */
+    for( delIt = m_devDel.begin(); delIt != m_devDel.end(); ++delIt )
+        addUsage( delIt->p_dev, NULL, p_total );
+
+    for( objIt = m_objDel.begin(); objIt != m_objDel.end(); ++objIt )
+        p_total->bytes[e_lwm2m_usage_tree] += objIt->p_obj->getMemSize();
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    prv_totalUsage( p_total );
+
+    return cnt;
+
+} /* LWM2MServer::getUsage() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::startCapture()
+*/
+int8_t LWM2MServer::startCapture( const char* p_path )
+{
+    int8_t ret;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    ret = m_capture.open( p_path );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::startCapture() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::stopCapture()
+*/
+void LWM2MServer::stopCapture( void )
+{
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    m_capture.close();
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+} /* LWM2MServer::stopCapture() */
+
+
+#ifdef OPCUA_LWM2M_BENCHMARK
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::addTestDevice()
+*/
+int8_t LWM2MServer::addTestDevice( LWM2MDevice* p_dev )
+{
+    std::vector< LWM2MObject* >::iterator it;
+    int8_t ret = 0;
+
+    if( p_dev == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    if( (m_devMap.count( p_dev->getName() ) != 0) ||
+        (m_devIdMap.count( p_dev->getID() ) != 0) )
+    {
+        /* a device with the same name or ID exists */
+        ret = -1;
+    }
+    else
+    {
+        m_devMap[p_dev->getName()] = p_dev;
+        m_devIdMap[p_dev->getID()] = p_dev;
+        for( it = p_dev->objectStart(); it != p_dev->objectEnd(); ++it )
+            indexObject( *it );
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::addTestDevice() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::removeTestDevice()
+*/
+int8_t LWM2MServer::removeTestDevice( LWM2MDevice* p_dev )
+{
+    std::map< std::string, LWM2MDevice* >::iterator devIt;
+    std::vector< LWM2MObject* >::iterator it;
+    int8_t ret = -1;
+
+    if( p_dev == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    devIt = m_devMap.find( p_dev->getName() );
+    if( (devIt != m_devMap.end()) && (devIt->second == p_dev) )
+    {
+        for( it = p_dev->objectStart(); it != p_dev->objectEnd(); ++it )
+            unindexObject( *it );
+        m_devIdMap.erase( p_dev->getID() );
+        m_devMap.erase( devIt );
+        deletedObserveParams( p_dev );
+        ret = 0;
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::removeTestDevice() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::injectNotification()
+*/
+int8_t LWM2MServer::injectNotification( LWM2MResource* p_res, int status,
+        lwm2m_media_type_t format, uint8_t* p_buf, int len )
+{
+    const LWM2MObject* p_obj = (p_res != NULL) ? p_res->getObject() : NULL;
+    const LWM2MDevice* p_dev = (p_obj != NULL) ? p_obj->getDevice() : NULL;
+    lwm2m_uri_t uri;
+
+    if( p_dev == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    if( m_obsResMap.count( p_res ) == 0 )
+        m_obsResMap[p_res] = new s_lwm2m_obsparams_t();
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    uri.objectId = p_obj->getObjId();
+    uri.instanceId = p_obj->getInstId();
+    uri.resourceId = p_res->getResId();
+    uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID |
+            LWM2M_URI_FLAG_RESOURCE_ID;
+
+    notifyResCb( p_dev->getID(), &uri, status, format, p_buf, len, p_res );
+
+    return 0;
+
+} /* LWM2MServer::injectNotification() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::injectNotification()
+*/
+int8_t LWM2MServer::injectNotification( LWM2MObject* p_obj, int status,
+        lwm2m_media_type_t format, uint8_t* p_buf, int len )
+{
+    const LWM2MDevice* p_dev = (p_obj != NULL) ? p_obj->getDevice() : NULL;
+    lwm2m_uri_t uri;
+
+    if( p_dev == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    if( m_obsObjMap.count( p_obj ) == 0 )
+        m_obsObjMap[p_obj] = new s_lwm2m_obsparams_t();
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    uri.objectId = p_obj->getObjId();
+    uri.instanceId = p_obj->getInstId();
+    uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID;
+
+    notifyObjCb( p_dev->getID(), &uri, status, format, p_buf, len, p_obj );
+
+    return 0;
+
+} /* LWM2MServer::injectNotification() */
+#endif /* #ifdef OPCUA_LWM2M_BENCHMARK */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::setLoopConfig()
+*/
+int8_t LWM2MServer::setLoopConfig( const s_lwm2m_loop_config_t* p_cfg )
+{
+    int8_t ret;
+
+    if( p_cfg == NULL )
+        return -1;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    ret = m_loopProf.setConfig( *p_cfg );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::setLoopConfig() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getLoopHistory()
+*/
+uint32_t LWM2MServer::getLoopHistory(
+        std::vector< s_lwm2m_loop_sample_t >& samples )
+{
+    uint32_t ret;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    ret = m_loopProf.getHistory( samples );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::getLoopHistory() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getSlowLoops()
+*/
+uint32_t LWM2MServer::getSlowLoops(
+        std::vector< s_lwm2m_loop_sample_t >& samples )
+{
+    uint32_t ret;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    ret = m_loopProf.getSlowLog( samples );
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::getSlowLoops() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getDevice()
+*/
+lwm2m_client_t* LWM2MServer::getDevice( std::string client )
+{
+    if( !isAlive() )
+        return NULL;
+
+    /* client pointer */
+    lwm2m_client_t * p_targetP;
+    p_targetP = mp_lwm2mH->clientList;
+
+    if (p_targetP == NULL)
+    {
+        return NULL;
+    }
+
+    for( p_targetP = mp_lwm2mH->clientList; p_targetP != NULL;
+            p_targetP = p_targetP->next )
+    {
+        if( p_targetP != NULL )
+        {
+            if( client ==  p_targetP->name)
+                return p_targetP;
+        }
+    }
+
+    return NULL;
+
+} /* LWM2MServer::getDevice() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::notifyObservers()
+*/
+int8_t LWM2MServer::notifyObservers( s_lwm2m_serverobserver_event_param_t param,
+    e_lwm2m_serverobserver_event_t ev ) const
+{
+    /* Iterate through the observers in the list */
+    std::vector< LWM2MServerObserver*>::const_iterator it =
+             m_vectObs.begin();
+
+    while( it != m_vectObs.end() )
+    {
+        /* notify the current observer */
+        (*it)->notify( param, ev );
+        it++;
+    }
+
+    return 0;
+} /* LWM2MServer::notifyObservers() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::checkEvents()
+*/
+void LWM2MServer::checkEvents( void )
+{
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+    while( m_devEv.size() )
+    {
+        s_devEvent_t ev = m_devEv.front();
+        m_devEv.pop();
+        /* Notify all Observers */
+        notifyObservers( ev.param, ev.event );
+    }
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+} /* LWM2MServer::checkEvents() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::checkDeletedDevices()
+*/
+void LWM2MServer::checkDeletedDevices( void )
+{
+    std::list< s_devDel_t >::iterator it = m_devDel.begin();
+    while( it != m_devDel.end() )
+    {
+        if(it->tot < LWM2MClock::timeS())
+        {
+          /* Timeout expired, delete element */
+          if( it->p_dev != NULL )
+          {
+            /* the observations are forgotten unless the device
+             * registered again in the meantime */
+            if( m_devMap.find( it->p_dev->getName() ) == m_devMap.end() )
+              m_obsDurable.erase( it->p_dev->getName() );
+
+            /* Delete all the observed resources from the device */
+            deletedObserveParams( it->p_dev );
+            delete( it->p_dev );
+          }
+
+          m_devDel.pop_front();
+          it = m_devDel.begin();
+        }
+        else
+        {
+          /* Stop looking */
+          break;
+        }
+    }
+
+    std::list< s_objDel_t >::iterator objIt = m_objDel.begin();
+    while( objIt != m_objDel.end() )
+    {
+        if(objIt->tot < LWM2MClock::timeS())
+        {
+          /* Timeout expired, delete the removed object */
+          deletedObserveParams( objIt->p_obj );
+          delete( objIt->p_obj );
+          objIt = m_objDel.erase( objIt );
+        }
+        else
+          objIt++;
+    }
+} /* LWM2MServer::checkDeletedDevices() */
+
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::checkFirmwareUpdates()
+*/
+void LWM2MServer::checkFirmwareUpdates( void )
+{
+    if( m_fwUpdates.size() == 0 )
+        return;
+
+    uint64_t now = prv_timeMs();
+    std::list< LWM2MFirmwareUpdate* >::iterator it = m_fwUpdates.begin();
+    while( it != m_fwUpdates.end() )
+    {
+        (*it)->step( this, now );
+        it++;
+    }
+
+} /* LWM2MServer::checkFirmwareUpdates() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::handleFirmwareUpdates()
+*/
+bool LWM2MServer::handleFirmwareUpdates( void* p_session, uint8_t* p_buf,
+    int len )
+{
+    bool ret = false;
+
+    if( m_fwUpdates.size() == 0 )
+        return false;
+
+    uint64_t now = prv_timeMs();
+    std::list< LWM2MFirmwareUpdate* >::iterator it = m_fwUpdates.begin();
+    while( (it != m_fwUpdates.end()) && (ret == false) )
+    {
+        ret = (*it)->handlePacket( this, p_session, p_buf, len, now );
+        it++;
+    }
+
+    return ret;
+
+} /* LWM2MServer::handleFirmwareUpdates() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::checkBulkOperations()
+*/
+void LWM2MServer::checkBulkOperations( void )
+{
+    if( (m_bulkOps.size() == 0) || (!isAlive()) )
+        return;
+
+    uint64_t now = prv_timeMs();
+    std::list< LWM2MBulkOperation* >::iterator it = m_bulkOps.begin();
+    while( it != m_bulkOps.end() )
+    {
+        (*it)->step( this, now );
+        it++;
+    }
+
+} /* LWM2MServer::checkBulkOperations() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::applySubscriptions()
+*/
+void LWM2MServer::applySubscriptions( LWM2MObject* p_obj )
+{
+    std::vector< uint16_t > resIds;
+    std::vector< uint16_t >::const_iterator it;
+    lwm2m_uri_t uri;
+    uint64_t now;
+
+    m_subs.getResources( p_obj->getObjId(), p_obj->getInstId(), resIds );
+    if( resIds.empty() )
+        return;
+
+    now = prv_timeMs();
+    uri.objectId = p_obj->getObjId();
+    uri.instanceId = p_obj->getInstId();
+    uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID |
+            LWM2M_URI_FLAG_RESOURCE_ID;
+
+    for( it = resIds.begin(); it != resIds.end(); ++it )
+    {
+        uri.resourceId = *it;
+        m_subs.schedule( p_obj->getDevice()->getName(), uri, now );
+    }
+
+} /* LWM2MServer::applySubscriptions() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::applySubscriptions()
+*/
+void LWM2MServer::applySubscriptions( LWM2MDevice* p_dev )
+{
+    std::vector< LWM2MObject* >::iterator it;
+
+    for( it = p_dev->objectStart(); it != p_dev->objectEnd(); ++it )
+        applySubscriptions( *it );
+
+} /* LWM2MServer::applySubscriptions() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::checkSubscriptions()
+*/
+void LWM2MServer::checkSubscriptions( void )
+{
+    std::string devName;
+    lwm2m_uri_t uri;
+
+    if( (m_subs.pending() == 0) || (!isAlive()) )
+        return;
+
+    /* devices that left in the meantime are skipped as well as
+     * observations that were removed in the meantime */
+    uint64_t now = prv_timeMs();
+    while( m_subs.next( now, devName, uri ) )
+    {
+        if( isObserveWanted( devName, &uri ) )
+            startObserve( devName, &uri, e_lwm2m_request_class_bulk );
+    }
+
+} /* LWM2MServer::checkSubscriptions() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::keepObservation()
+*/
+void LWM2MServer::keepObservation( const std::string& devName,
+    const lwm2m_uri_t* p_uri, bool keep )
+{
+    s_obsKey_t key;
+    std::map< std::string, std::set< s_obsKey_t > >::iterator it;
+
+    key.objId = p_uri->objectId;
+    key.instId = p_uri->instanceId;
+    key.resId = LWM2M_URI_IS_SET_RESOURCE( p_uri ) ?
+            p_uri->resourceId : LWM2M_MAX_ID;
+
+    if( keep == true )
+    {
+        m_obsDurable[devName].insert( key );
+    }
+    else
+    {
+        it = m_obsDurable.find( devName );
+        if( it != m_obsDurable.end() )
+        {
+            it->second.erase( key );
+            if( it->second.empty() )
+                m_obsDurable.erase( it );
+        }
+    }
+
+} /* LWM2MServer::keepObservation() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::restoreObservations()
+*/
+void LWM2MServer::restoreObservations( LWM2MDevice* p_dev )
+{
+    std::map< std::string, std::set< s_obsKey_t > >::const_iterator it;
+    std::set< s_obsKey_t >::const_iterator key;
+    std::vector< uint16_t > resIds;
+    lwm2m_uri_t uri;
+    uint64_t now;
+
+    it = m_obsDurable.find( p_dev->getName() );
+    if( it == m_obsDurable.end() )
+        return;
+
+    /* the observations are spread and rate limited as the ones of
+     * the subscriptions */
+    now = prv_timeMs();
+    for( key = it->second.begin(); key != it->second.end(); ++key )
+    {
+        uri.objectId = key->objId;
+        uri.instanceId = key->instId;
+        uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID;
+
+        if( key->resId != LWM2M_MAX_ID )
+        {
+            /* the subscriptions were scheduled already */
+            resIds.clear();
+            m_subs.getResources( key->objId, key->instId, resIds );
+            if( std::find( resIds.begin(), resIds.end(), key->resId ) !=
+                    resIds.end() )
+                continue;
+
+            uri.resourceId = key->resId;
+            uri.flag |= LWM2M_URI_FLAG_RESOURCE_ID;
+        }
+
+        m_subs.schedule( p_dev->getName(), uri, now );
+    }
+
+} /* LWM2MServer::restoreObservations() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::isObserveWanted()
+*/
+bool LWM2MServer::isObserveWanted( const std::string& devName,
+    const lwm2m_uri_t* p_uri )
+{
+    std::map< std::string, std::set< s_obsKey_t > >::const_iterator it;
+    std::vector< uint16_t > resIds;
+    s_obsKey_t key;
+
+    key.objId = p_uri->objectId;
+    key.instId = p_uri->instanceId;
+    key.resId = LWM2M_URI_IS_SET_RESOURCE( p_uri ) ?
+            p_uri->resourceId : LWM2M_MAX_ID;
+
+    it = m_obsDurable.find( devName );
+    if( (it != m_obsDurable.end()) && (it->second.count( key ) > 0) )
+        return true;
+
+    if( key.resId == LWM2M_MAX_ID )
+        return false;
+
+    m_subs.getResources( key.objId, key.instId, resIds );
+    return std::find( resIds.begin(), resIds.end(), key.resId ) !=
+            resIds.end();
+
+} /* LWM2MServer::isObserveWanted() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::observedResource()
+*/
+LWM2MResource* LWM2MServer::observedResource( LWM2MObject* p_obj,
+        uint16_t resId )
+{
+    /* the resource may not be discovered yet */
+    LWM2MResource* p_res = p_obj->getResource( resId );
+    if( p_res == NULL )
+    {
+        p_res = new LWM2MResource( resId, false, false, false,
+                e_lwm2m_value_type_none, false );
+        p_obj->addResource( p_res );
+    }
+
+    return p_res;
+
+} /* LWM2MServer::observedResource() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::startObserve()
+*/
+int8_t LWM2MServer::startObserve( const std::string& devName,
+    const lwm2m_uri_t* p_uri, e_lwm2m_request_class_t cls )
+{
+    std::map< std::string, LWM2MDevice* >::iterator dev;
+    std::map< const LWM2MResource*, s_lwm2m_obsparams_t* >::iterator it;
+    std::map< const LWM2MObject*, s_lwm2m_obsparams_t* >::iterator obj;
+    lwm2m_client_t* p_cli;
+    LWM2MObject* p_obj;
+    LWM2MResource* p_res;
+    lwm2m_uri_t uri = *p_uri;
+
+    dev = m_devMap.find( devName );
+    p_cli = getDevice( devName );
+    if( (dev == m_devMap.end()) || (p_cli == NULL) )
+        return -1;
+
+    p_obj = dev->second->getObject( p_uri->objectId, p_uri->instanceId );
+    if( p_obj == NULL )
+        return -1;
+
+    if( !LWM2M_URI_IS_SET_RESOURCE( p_uri ) )
+    {
+        /* observation of the whole object instance */
+        obj = m_obsObjMap.find( p_obj );
+        if( obj == m_obsObjMap.end() )
+            obj = m_obsObjMap.insert( std::pair< const LWM2MObject*,
+                    s_lwm2m_obsparams_t* >( p_obj,
+                    new s_lwm2m_obsparams_t() ) ).first;
+
+        obj->second->status = -1;
+        if( request( p_cli, e_lwm2m_request_observe, &uri,
+                LWM2M_CONTENT_TEXT, NULL, 0, notifyObjCb, p_obj,
+                cls ) != COAP_NO_ERROR )
+            return -1;
+
+        return 0;
+    }
+
+    p_res = observedResource( p_obj, p_uri->resourceId );
+
+    it = m_obsResMap.find( p_res );
+    if( it == m_obsResMap.end() )
+        it = m_obsResMap.insert( std::pair< const LWM2MResource*,
+                s_lwm2m_obsparams_t* >( p_res,
+                new s_lwm2m_obsparams_t() ) ).first;
+
+    /* notifications are passed to the observers of the resource */
+    it->second->status = -1;
+    if( request( p_cli, e_lwm2m_request_observe, &uri, LWM2M_CONTENT_TEXT,
+            NULL, 0, notifyResCb, p_res, cls ) != COAP_NO_ERROR )
+        return -1;
+
+    return 0;
+
+} /* LWM2MServer::startObserve() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::checkRetransmissions()
+*/
+uint32_t LWM2MServer::checkRetransmissions( void )
+{
+    uint32_t next = 0xFFFFFFFF;
+    uint64_t now = prv_timeMs();
+    time_t sec = LWM2MClock::timeS();
+    lwm2m_transaction_t* p_tr;
+    std::map< lwm2m_transaction_t*, s_retrans_t >::iterator it;
+    std::map< void*, LWM2MRttEstimator >::iterator peer;
+
+    if( !isAlive() )
+        return next;
+
+    for( it = m_retrans.begin(); it != m_retrans.end(); ++it )
+        it->second.alive = false;
+
+    for( p_tr = mp_lwm2mH->transactionList; p_tr != NULL; p_tr = p_tr->next )
+    {
+        /* only sent requests to devices are tracked */
+        if( (p_tr->peerType != ENDPOINT_CLIENT) || (p_tr->peerP == NULL) ||
+            (p_tr->buffer == NULL) )
+            continue;
+
+        it = m_retrans.find( p_tr );
+        if( (it == m_retrans.end()) || (it->second.mID != p_tr->mID) )
+        {
+            /* new request, the first transmission was just sent */
+            s_retrans_t tr;
+            tr.mID = p_tr->mID;
+            tr.clientID = ((lwm2m_client_t*)p_tr->peerP)->internalID;
+            tr.p_session = ((lwm2m_client_t*)p_tr->peerP)->sessionH;
+            tr.p_data = NULL;
+            tr.cls = e_lwm2m_request_class_interactive;
+            tr.traceId = 0;
+            tr.first = now;
+            tr.retrans = 0;
+            tr.done = p_tr->ack_received;
+
+            peer = m_peers.find( tr.p_session );
+            if( peer == m_peers.end() )
+                peer = m_peers.insert( std::make_pair( tr.p_session,
+                        LWM2MRttEstimator( m_retransCfg ) ) ).first;
+
+            tr.timeout = peer->second.startExchange( m_retransCfg, now );
+            tr.next = now + tr.timeout;
+
+            m_metrics.add( e_lwm2m_metric_packets_out );
+            m_metrics.add( e_lwm2m_metric_bytes_out, p_tr->buffer_len );
+            captureRequest( p_tr, 0 );
+
+            m_retrans[p_tr] = tr;
+            it = m_retrans.find( p_tr );
+        }
+
+        it->second.alive = true;
+
+        /* a separate response is awaited by the LWM2M context */
+        if( p_tr->ack_received )
+            it->second.done = true;
+
+        if( it->second.done )
+            continue;
+
+        if( now >= it->second.next )
+        {
+            /* the estimator is released when the device deregistered */
+            peer = m_peers.find( it->second.p_session );
+            if( peer == m_peers.end() )
+                peer = m_peers.insert( std::make_pair( it->second.p_session,
+                        LWM2MRttEstimator( m_retransCfg ) ) ).first;
+
+            if( it->second.retrans < m_retransCfg.maxRetransmit )
+            {
+                /* retransmit the request with the same message ID */
+                lwm2m_buffer_send( it->second.p_session, p_tr->buffer,
+                        p_tr->buffer_len, mp_lwm2mH->userData );
+
+                m_metrics.add( e_lwm2m_metric_retransmissions );
+                m_metrics.add( e_lwm2m_metric_packets_out );
+                m_metrics.add( e_lwm2m_metric_bytes_out, p_tr->buffer_len );
+                m_trace.addPacket( e_lwm2m_trace_retransmit,
+                        it->second.traceId, it->second.clientID,
+                        p_tr->buffer, p_tr->buffer_len );
+                captureRequest( p_tr, LWM2M_CAPTURE_FLAG_RETRANS );
+
+                it->second.retrans++;
+                it->second.timeout = peer->second.backoff( m_retransCfg,
+                        it->second.timeout );
+                it->second.next = now + it->second.timeout;
+            }
+            else
+            {
+                /* exceed the retransmissions of the LWM2M context so
+                 * that it fails the request with its next step */
+                peer->second.addTimeout();
+                m_metrics.add( e_lwm2m_metric_timeouts );
+                m_trace.addPacket( e_lwm2m_trace_timeout, it->second.traceId,
+                        it->second.clientID, p_tr->buffer, p_tr->buffer_len );
+
+                /* a device in queue mode went to sleep already, other
+                 * devices may be unreachable */
+                LWM2MDevice* p_dev = findDevice( it->second.clientID );
+                if( (p_dev != NULL) && p_dev->isQueueMode() )
+                    p_dev->setAsleep();
+                else if( p_dev != NULL )
+                    p_dev->addTimeout( m_reqCfg.breakerThreshold,
+                            m_reqCfg.breakerProbe, m_reqCfg.breakerProbeMax );
+
+                p_tr->retrans_counter = COAP_MAX_RETRANSMIT + 2;
+                p_tr->retrans_time = 0;
+                it->second.done = true;
+                continue;
+            }
+        }
+
+        /* hold back the retransmissions of the LWM2M context */
+        p_tr->retrans_time = sec + LWM2MSERVER_RETRANS_HOLD_S;
+
+        if( it->second.next - now < next )
+            next = it->second.next - now;
+    }
+
+    /* forget requests that were answered or removed */
+    for( it = m_retrans.begin(); it != m_retrans.end(); )
+    {
+        if( it->second.alive == false )
+            m_retrans.erase( it++ );
+        else
+            ++it;
+    }
+
+    return next;
+
+} /* LWM2MServer::checkRetransmissions() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::sampleRtt()
+*/
+void LWM2MServer::sampleRtt( void* p_session, const uint8_t* p_buf, int len )
+{
+    uint8_t type;
+    uint16_t mID;
+    uint64_t now;
+    std::map< lwm2m_transaction_t*, s_retrans_t >::iterator it;
+    std::map< void*, LWM2MRttEstimator >::iterator peer;
+
+    /* check the CoAP version of the header */
+    if( (len < 4) || ((p_buf[0] >> 6) != 1) )
+        return;
+
+    /* only acknowledgements and resets finish a transmission */
+    type = (p_buf[0] >> 4) & 0x03;
+    if( (type != COAP_TYPE_ACK) && (type != COAP_TYPE_RST) )
+        return;
+
+    mID = ((uint16_t)p_buf[2] << 8) | p_buf[3];
+    now = prv_timeMs();
+
+    for( it = m_retrans.begin(); it != m_retrans.end(); ++it )
+    {
+        if( (it->second.done) || (it->second.mID != mID) ||
+            (it->second.p_session != p_session) )
+            continue;
+
+        it->second.done = true;
+
+        /* any answer shows that the device is reachable */
+        LWM2MDevice* p_dev = findDevice( it->second.clientID );
+        if( p_dev != NULL )
+            p_dev->addAnswer();
+
+        if( type == COAP_TYPE_ACK )
+        {
+            /* measured from the first transmission as proposed by CoCoA */
+            peer = m_peers.find( p_session );
+            if( peer != m_peers.end() )
+                peer->second.addSample( m_retransCfg,
+                        (uint32_t)(now - it->second.first),
+                        it->second.retrans, now );
+
+            m_metrics.record( e_lwm2m_histogram_rtt,
+                    (now - it->second.first) * 1000 );
+
+            /* a device in queue mode stays reachable while it answers */
+            if( (p_dev != NULL) && p_dev->isQueueMode() )
+                p_dev->setAwake( m_reqCfg.awakeTime );
+        }
+        break;
+    }
+
+} /* LWM2MServer::sampleRtt() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::captureRequest()
+*/
+void LWM2MServer::captureRequest( const lwm2m_transaction_t* p_tr,
+        uint8_t flags )
+{
+    connection_t* p_conn;
+
+    if( !m_capture.isOpen() )
+        return;
+
+    p_conn = (connection_t*)((lwm2m_client_t*)p_tr->peerP)->sessionH;
+    if( p_conn == NULL )
+        return;
+
+    m_capture.add( e_lwm2m_capture_out, (struct sockaddr *)&p_conn->addr,
+            p_conn->addrLen, p_tr->buffer, p_tr->buffer_len, flags );
+
+} /* LWM2MServer::captureRequest() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::findDevice()
+*/
+LWM2MDevice* LWM2MServer::findDevice( uint16_t clientID )
+{
+    std::map< uint16_t, LWM2MDevice* >::iterator it;
+
+    it = m_devIdMap.find( clientID );
+    if( it == m_devIdMap.end() )
+        return NULL;
+
+    return it->second;
+
+} /* LWM2MServer::findDevice() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::indexObject()
+*/
+void LWM2MServer::indexObject( LWM2MObject* p_obj )
+{
+    LWM2MDevice* p_dev = const_cast<LWM2MDevice*>( p_obj->getDevice() );
+
+    m_objIdx[p_obj->getObjId()][p_dev].insert( p_obj );
+
+} /* LWM2MServer::indexObject() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::unindexObject()
+*/
+void LWM2MServer::unindexObject( LWM2MObject* p_obj )
+{
+    std::map< uint16_t, std::map< LWM2MDevice*,
+        std::set< LWM2MObject* > > >::iterator it;
+    std::map< LWM2MDevice*, std::set< LWM2MObject* > >::iterator dev;
+
+    it = m_objIdx.find( p_obj->getObjId() );
+    if( it == m_objIdx.end() )
+        return;
+
+    dev = it->second.find( const_cast<LWM2MDevice*>( p_obj->getDevice() ) );
+    if( dev == it->second.end() )
+        return;
+
+    /* drop entries that became empty */
+    dev->second.erase( p_obj );
+    if( dev->second.empty() )
+        it->second.erase( dev );
+    if( it->second.empty() )
+        m_objIdx.erase( it );
+
+} /* LWM2MServer::unindexObject() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::wakeDevice()
+*/
+void LWM2MServer::wakeDevice( LWM2MDevice* p_dev, const lwm2m_client_t* p_cli )
+{
+    /* the binding may change with every update */
+    switch( p_cli->binding )
+    {
+        case BINDING_UQ:
+        case BINDING_SQ:
+        case BINDING_UQS:
+            p_dev->setQueueMode( true );
+            break;
+
+        default:
+            p_dev->setQueueMode( false );
+            break;
+    }
+
+    /* the queued requests are sent with the next check of the queues */
+    p_dev->setAwake( m_reqCfg.awakeTime );
+
+    /* the device contacted the server, it is reachable again */
+    p_dev->addAnswer();
+
+    /* a device registering from a new address leaves its old connection */
+    if( p_dev->mp_session != p_cli->sessionH )
+    {
+        void* p_old = p_dev->mp_session;
+        p_dev->mp_session = p_cli->sessionH;
+        releasePeer( p_old );
+    }
+
+} /* LWM2MServer::wakeDevice() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::releasePeer()
+*/
+void LWM2MServer::releasePeer( void* p_session )
+{
+    lwm2m_client_t* p_cli;
+
+    if( p_session == NULL )
+        return;
+
+    /* registrations that were replaced or removed do not count */
+    for( p_cli = mp_lwm2mH->clientList; p_cli != NULL; p_cli = p_cli->next )
+    {
+        if( (p_cli->sessionH == p_session) &&
+            (m_devIdMap.count( p_cli->internalID ) != 0) )
+            return;
+    }
+
+    m_peers.erase( p_session );
+
+} /* LWM2MServer::releasePeer() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::request()
+*/
+int LWM2MServer::request( lwm2m_client_t* p_cli, e_lwm2m_request_type_t type,
+        lwm2m_uri_t* p_uri, lwm2m_media_type_t format, const uint8_t* p_buf,
+        size_t len, lwm2m_result_callback_t cb, void* p_data,
+        e_lwm2m_request_class_t cls, uint32_t* p_traceId )
+{
+    s_lwm2m_request_t req;
+    LWM2MRequestQueue& queue = m_reqQueues[p_cli->internalID];
+    LWM2MDevice* p_dev = findDevice( p_cli->internalID );
+
+    m_metrics.add( e_lwm2m_metric_requests );
+
+    req.traceId = m_trace.nextId();
+    if( p_traceId != NULL )
+        *p_traceId = req.traceId;
+    m_trace.add( e_lwm2m_trace_call, req.traceId, p_cli->internalID, p_uri,
+            type );
+
+    req.type = type;
+    req.cls = cls;
+    req.uri = *p_uri;
+    req.format = format;
+    if( p_buf != NULL )
+        req.payload.assign( p_buf, p_buf + len );
+    req.cb = cb;
+    req.p_data = p_data;
+
+    /* requests to an unreachable device fail without a transaction,
+     * a single request is sent as probe when it is due */
+    if( (p_dev != NULL) && p_dev->isCircuitOpen() )
+    {
+        if( (!p_dev->isProbeDue()) || (getInFlight( p_cli ) != 0) )
+        {
+            m_trace.add( e_lwm2m_trace_reject, req.traceId,
+                    p_cli->internalID, p_uri, COAP_503_SERVICE_UNAVAILABLE );
+            return COAP_503_SERVICE_UNAVAILABLE;
+        }
+
+        p_dev->setProbing();
+        queue.addDispatched();
+        return sendRequest( p_cli->internalID, req );
+    }
+
+    /* queued requests of the same or a more important class are sent
+     * first to keep their order, requests to sleeping devices are kept
+     * until the device updates */
+    if( (queue.count( cls ) == 0) && ((p_dev == NULL) || p_dev->isAwake()) &&
+        (getInFlight( p_cli ) < m_reqCfg.nstart) &&
+        ((m_reqCfg.budget[cls] == 0) ||
+         (getInFlight( cls ) < m_reqCfg.budget[cls])) )
+    {
+        queue.addDispatched();
+        return sendRequest( p_cli->internalID, req );
+    }
+
+    queue.push( req );
+    m_reqPending.insert( p_cli->internalID );
+    m_trace.add( e_lwm2m_trace_enqueue, req.traceId, p_cli->internalID,
+            p_uri, queue.size() );
+    return COAP_NO_ERROR;
+
+} /* LWM2MServer::request() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::sendRequest()
+*/
+int LWM2MServer::sendRequest( uint16_t clientID, s_lwm2m_request_t& req )
+{
+    int ret;
+    uint8_t* p_buf = req.payload.empty() ? NULL : req.payload.data();
+    uint16_t mID = mp_lwm2mH->nextMID;
+    lwm2m_transaction_t* p_tr;
+
+    switch( req.type )
+    {
+        case e_lwm2m_request_read:
+            ret = lwm2m_dm_read( mp_lwm2mH, clientID, &req.uri, req.cb,
+                    req.p_data );
+            break;
+
+        case e_lwm2m_request_write:
+            ret = lwm2m_dm_write( mp_lwm2mH, clientID, &req.uri, req.format,
+                    p_buf, req.payload.size(), req.cb, req.p_data );
+            break;
+
+        case e_lwm2m_request_execute:
+            ret = lwm2m_dm_execute( mp_lwm2mH, clientID, &req.uri,
+                    req.format, p_buf, req.payload.size(), req.cb,
+                    req.p_data );
+            break;
+
+        case e_lwm2m_request_discover:
+            ret = lwm2m_dm_discover( mp_lwm2mH, clientID, &req.uri, req.cb,
+                    req.p_data );
+            break;
+
+        case e_lwm2m_request_observe:
+            ret = lwm2m_observe( mp_lwm2mH, clientID, &req.uri, req.cb,
+                    req.p_data );
+            break;
+
+        case e_lwm2m_request_observe_cancel:
+            ret = lwm2m_observe_cancel( mp_lwm2mH, clientID, &req.uri,
+                    req.cb, req.p_data );
+            break;
+
+        default:
+            ret = COAP_400_BAD_REQUEST;
+            break;
+    }
+
+    /* track the retransmissions of the request */
+    checkRetransmissions();
+
+    /* remember the callback data of a new transaction to cancel it and
+     * its class to limit the outstanding requests of the class */
+    if( mp_lwm2mH->nextMID != mID )
+    {
+        for( p_tr = mp_lwm2mH->transactionList; p_tr != NULL;
+             p_tr = p_tr->next )
+        {
+            std::map< lwm2m_transaction_t*, s_retrans_t >::iterator it =
+                    m_retrans.find( p_tr );
+            if( (p_tr->mID == mID) && (it != m_retrans.end()) )
+            {
+                it->second.p_data = req.p_data;
+                it->second.cls = req.cls;
+                it->second.traceId = req.traceId;
+                m_trace.addPacket( e_lwm2m_trace_send, req.traceId, clientID,
+                        p_tr->buffer, p_tr->buffer_len );
+            }
+        }
+    }
+
+    if( ret != COAP_NO_ERROR )
+        m_trace.add( e_lwm2m_trace_reject, req.traceId, clientID, &req.uri,
+                ret );
+
+    return ret;
+
+} /* LWM2MServer::sendRequest() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::cancelRequests()
+*/
+int16_t LWM2MServer::cancelRequests( lwm2m_client_t* p_cli, const void* p_data,
+        uint32_t traceId )
+{
+    int16_t cnt = 0;
+    s_lwm2m_request_t req;
+    lwm2m_transaction_t* p_tr;
+    lwm2m_transaction_t* p_next;
+    std::map< uint16_t, LWM2MRequestQueue >::iterator queue;
+    std::map< lwm2m_transaction_t*, s_retrans_t >::iterator it;
+
+    if( !isAlive() )
+        return 0;
+
+    /* queued requests were not sent yet */
+    for( queue = m_reqQueues.begin(); queue != m_reqQueues.end(); ++queue )
+    {
+        if( (p_cli != NULL) && (queue->first != p_cli->internalID) )
+            continue;
+
+        while( queue->second.take( p_data, req, traceId ) )
+        {
+            req.cb( queue->first, &req.uri, COAP_503_SERVICE_UNAVAILABLE,
+                    LWM2M_CONTENT_TEXT, NULL, 0, req.p_data );
+            cnt++;
+        }
+    }
+
+    /* outstanding requests are removed from the LWM2M context */
+    for( p_tr = mp_lwm2mH->transactionList; p_tr != NULL; p_tr = p_next )
+    {
+        p_next = p_tr->next;
+
+        if( (p_tr->peerType != ENDPOINT_CLIENT) ||
+            ((p_cli != NULL) && (p_tr->peerP != p_cli)) )
+            continue;
+
+        it = m_retrans.find( p_tr );
+        if( (p_data != NULL) && ((it == m_retrans.end()) ||
+            (it->second.mID != p_tr->mID) || (it->second.p_data != p_data)) )
+            continue;
+        if( (traceId != 0) && ((it == m_retrans.end()) ||
+            (it->second.traceId != traceId)) )
+            continue;
+
+        /* the callback releases the state of the request */
+        if( p_tr->callback != NULL )
+            p_tr->callback( p_tr, NULL );
+        transaction_remove( mp_lwm2mH, p_tr );
+
+        if( it != m_retrans.end() )
+            m_retrans.erase( it );
+        cnt++;
+    }
+
+    return cnt;
+
+} /* LWM2MServer::cancelRequests() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::waitRequest()
+*/
+int8_t LWM2MServer::waitRequest( const int* p_status, int pending,
+        const void* p_data, uint32_t timeout, uint32_t traceId )
+{
+    int8_t ret = 0;
+    uint64_t deadline;
+    uint64_t start = LWM2MMetrics::now();
+
+    if( timeout == LWM2M_REQUEST_TIMEOUT_DEFAULT )
+        timeout = m_reqCfg.timeout;
+    deadline = prv_timeMs() + timeout;
+
+    while( true )
+    {
+        int status;
+        OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+#ifndef OPCUA_LWM2M_SERVER_USE_THREAD
+        /* call the server */
+        runServer();
+#endif /* #ifndef OPCUA_LWM2M_SERVER_USE_THREAD */
+        status = *p_status;
+        if( (status == pending) && (timeout != 0) &&
+            (prv_timeMs() >= deadline) )
+        {
+            /* the request was not answered in time */
+            cancelRequests( NULL, p_data, traceId );
+            ret = -1;
+        }
+        OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+        if( (status != pending) || (ret != 0) )
+            break;
+        OPCUA_LWM2M_SERVER_SLEEP(LWM2MSERVER_RUN_TOT_US);
+    }
+
+    m_metrics.record( e_lwm2m_histogram_request,
+            LWM2MMetrics::now() - start );
+    return ret;
+
+} /* LWM2MServer::waitRequest() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getInFlight()
+*/
+uint32_t LWM2MServer::getInFlight( const lwm2m_client_t* p_cli ) const
+{
+    uint32_t cnt = 0;
+    lwm2m_transaction_t* p_tr;
+
+    if( !isAlive() )
+        return 0;
+
+    for( p_tr = mp_lwm2mH->transactionList; p_tr != NULL; p_tr = p_tr->next )
+    {
+        /* a request is outstanding until it was acknowledged */
+        if( (p_tr->peerType == ENDPOINT_CLIENT) && (p_tr->peerP == p_cli) &&
+            (!p_tr->ack_received) )
+            cnt++;
+    }
+
+    return cnt;
+
+} /* LWM2MServer::getInFlight() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::getInFlight()
+*/
+uint32_t LWM2MServer::getInFlight( e_lwm2m_request_class_t cls ) const
+{
+    uint32_t cnt = 0;
+    std::map< lwm2m_transaction_t*, s_retrans_t >::const_iterator it;
+
+    /* the tracked requests are outstanding until they were acknowledged
+     * or failed */
+    for( it = m_retrans.begin(); it != m_retrans.end(); ++it )
+    {
+        if( (it->second.cls == cls) && (!it->second.done) )
+            cnt++;
+    }
+
+    return cnt;
+
+} /* LWM2MServer::getInFlight() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::addUsage()
+*/
+void LWM2MServer::addUsage( LWM2MDevice* p_dev, const lwm2m_client_t* p_cli,
+        s_lwm2m_usage_t* p_usage ) const
+{
+    std::vector< LWM2MObject* >::iterator objIt;
+    std::vector< LWM2MResource* >::const_iterator resIt;
+    std::map< uint16_t, LWM2MRequestQueue >::const_iterator queueIt;
+    lwm2m_client_object_t* p_obj;
+    lwm2m_list_t* p_inst;
+    lwm2m_observation_t* p_obs;
+    lwm2m_transaction_t* p_tr;
+
+    p_usage->devices++;
+
+    if( p_dev != NULL )
+    {
+        p_usage->bytes[e_lwm2m_usage_tree] += p_dev->getMemSize();
+
+        for( objIt = p_dev->objectStart(); objIt != p_dev->objectEnd();
+             ++objIt )
+        {
+            p_usage->objects++;
+            if( m_obsObjMap.count( *objIt ) != 0 )
+                p_usage->observeParams++;
+
+            for( resIt = (*objIt)->resourceStart();
+                 resIt != (*objIt)->resourceEnd(); ++resIt )
+            {
+                p_usage->resources++;
+                if( m_obsResMap.count( *resIt ) != 0 )
+                    p_usage->observeParams++;
+            }
+        }
+        p_usage->bytes[e_lwm2m_usage_observe] +=
+                p_usage->observeParams * sizeof( s_lwm2m_obsparams_t );
+    }
+
+    if( p_cli == NULL )
+        return;
+
+    /* the client with the objects of its registration */
+    p_usage->bytes[e_lwm2m_usage_client] += sizeof( lwm2m_client_t ) +
+            prv_strMemSize( p_cli->name ) + prv_strMemSize( p_cli->msisdn ) +
+            prv_strMemSize( p_cli->altPath );
+    for( p_obj = p_cli->objectList; p_obj != NULL; p_obj = p_obj->next )
+    {
+        p_usage->bytes[e_lwm2m_usage_client] +=
+                sizeof( lwm2m_client_object_t );
+        for( p_inst = p_obj->instanceList; p_inst != NULL;
+             p_inst = p_inst->next )
+        {
+            p_usage->instances++;
+            p_usage->bytes[e_lwm2m_usage_client] += sizeof( lwm2m_list_t );
+        }
+    }
+
+    for( p_obs = p_cli->observationList; p_obs != NULL; p_obs = p_obs->next )
+    {
+        p_usage->observations++;
+        p_usage->bytes[e_lwm2m_usage_observations] +=
+                sizeof( lwm2m_observation_t );
+    }
+
+    /* transactions with their message and the retransmission state */
+    for( p_tr = isAlive() ? mp_lwm2mH->transactionList : NULL; p_tr != NULL;
+         p_tr = p_tr->next )
+    {
+        if( (p_tr->peerType != ENDPOINT_CLIENT) || (p_tr->peerP != p_cli) )
+            continue;
+
+        p_usage->transactions++;
+        p_usage->bytes[e_lwm2m_usage_transactions] +=
+                sizeof( lwm2m_transaction_t ) +
+                ((p_tr->message != NULL) ? sizeof( coap_packet_t ) : 0) +
+                ((p_tr->buffer != NULL) ? p_tr->buffer_len : 0) +
+                m_retrans.count( p_tr ) * sizeof( s_retrans_t );
+    }
+
+    queueIt = m_reqQueues.find( p_cli->internalID );
+    if( queueIt != m_reqQueues.end() )
+    {
+        p_usage->queued += queueIt->second.size();
+        p_usage->bytes[e_lwm2m_usage_queue] += queueIt->second.getMemSize();
+    }
+
+    if( p_cli->sessionH != NULL )
+    {
+        p_usage->bytes[e_lwm2m_usage_connection] += sizeof( connection_t ) +
+                m_peers.count( p_cli->sessionH ) *
+                sizeof( LWM2MRttEstimator );
+    }
+
+} /* LWM2MServer::addUsage() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::checkRequestQueues()
+*/
+void LWM2MServer::checkRequestQueues( void )
+{
+    std::set< uint16_t >::iterator id;
+    std::map< uint16_t, LWM2MRequestQueue >::iterator it;
+    std::vector< s_readyQueue_t > ready;
+    std::vector< s_readyQueue_t >::iterator rdy;
+    s_readyQueue_t state;
+    lwm2m_client_t* p_cli;
+    s_lwm2m_request_t req;
+    uint32_t clsInFlight;
+    int cls;
+    int lwm2mRet;
+
+    if( !isAlive() )
+        return;
+
+    /* only the devices with queued requests are looked up, each once */
+    for( id = m_reqPending.begin(); id != m_reqPending.end(); )
+    {
+        it = m_reqQueues.find( *id );
+        if( (it == m_reqQueues.end()) || it->second.empty() )
+        {
+            m_reqPending.erase( id++ );
+            continue;
+        }
+        ++id;
+
+        p_cli = (lwm2m_client_t*)lwm2m_list_find(
+                (lwm2m_list_t*)mp_lwm2mH->clientList, it->first );
+        if( p_cli == NULL )
+        {
+            /* the device is gone, the queued requests fail */
+            dropRequestQueue( it->first, COAP_404_NOT_FOUND );
+            continue;
+        }
+
+        /* the requests to an unreachable device fail until a probe
+         * is due */
+        state.p_dev = findDevice( it->first );
+        if( (state.p_dev != NULL) && state.p_dev->isAwake() &&
+            (!state.p_dev->isProbeDue()) )
+        {
+            while( it->second.pop( e_lwm2m_dispatch_fifo, req ) )
+                req.cb( it->first, &req.uri, COAP_503_SERVICE_UNAVAILABLE,
+                        LWM2M_CONTENT_TEXT, NULL, 0, req.p_data );
+            continue;
+        }
+
+        /* keep the requests of sleeping devices */
+        if( (state.p_dev != NULL) && (!state.p_dev->isAwake()) )
+            continue;
+
+        state.clientID = it->first;
+        state.p_queue = &it->second;
+        state.inFlight = getInFlight( p_cli );
+        if( state.inFlight < m_reqCfg.nstart )
+            ready.push_back( state );
+    }
+
+    /* serve the classes in the order of their importance, each within
+     * its own budget */
+    for( cls = 0; (cls < e_lwm2m_request_class_max) && (!ready.empty());
+         cls++ )
+    {
+        clsInFlight = getInFlight( (e_lwm2m_request_class_t)cls );
+
+        for( rdy = ready.begin(); rdy != ready.end(); ++rdy )
+        {
+            if( (m_reqCfg.budget[cls] != 0) &&
+                (clsInFlight >= m_reqCfg.budget[cls]) )
+                break;
+
+            /* nothing of the class is queued for the device */
+            if( rdy->p_queue->size( (e_lwm2m_request_class_t)cls ) == 0 )
+                continue;
+
+            while( (rdy->inFlight < m_reqCfg.nstart) &&
+                   ((m_reqCfg.budget[cls] == 0) ||
+                    (clsInFlight < m_reqCfg.budget[cls])) &&
+                   rdy->p_queue->pop( m_reqCfg.dispatch,
+                           (e_lwm2m_request_class_t)cls, req ) )
+            {
+                rdy->p_queue->addDispatched();
+                lwm2mRet = sendRequest( rdy->clientID, req );
+                if( lwm2mRet != COAP_NO_ERROR )
+                    req.cb( rdy->clientID, &req.uri, lwm2mRet,
+                            LWM2M_CONTENT_TEXT, NULL, 0, req.p_data );
+                else
+                {
+                    rdy->inFlight++;
+                    clsInFlight++;
+                }
+
+                /* a single request probes an unreachable device */
+                if( (rdy->p_dev != NULL) && rdy->p_dev->isCircuitOpen() &&
+                    (lwm2mRet == COAP_NO_ERROR) )
+                {
+                    rdy->p_dev->setProbing();
+                    break;
+                }
+            }
+        }
+    }
+
+} /* LWM2MServer::checkRequestQueues() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::dropRequestQueue()
+*/
+void LWM2MServer::dropRequestQueue( uint16_t clientID, int status )
+{
+    std::map< uint16_t, LWM2MRequestQueue >::iterator it;
+    s_lwm2m_request_t req;
+
+    it = m_reqQueues.find( clientID );
+    if( it == m_reqQueues.end() )
+        return;
+
+    /* removed first, the callbacks may issue further requests */
+    LWM2MRequestQueue queue( it->second );
+    m_reqQueues.erase( it );
+    m_reqPending.erase( clientID );
+
+    while( queue.pop( e_lwm2m_dispatch_fifo, req ) )
+        req.cb( clientID, &req.uri, status, LWM2M_CONTENT_TEXT, NULL, 0,
+                req.p_data );
+
+} /* LWM2MServer::dropRequestQueue() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::hasObserver()
+*/
+bool LWM2MServer::hasObserver( const LWM2MObject* p_obj, bool value )
+{
+    std::vector< LWM2MResource* >::const_iterator it = p_obj->resourceStart();
+
+    while( it != p_obj->resourceEnd() )
+    {
+        if( value ? ((*it)->hasValueObserver() || (*it)->isMultiple()) :
+            (*it)->hasObserver() )
+            return true;
+        it++;
+    }
+
+    return false;
+
+} /* LWM2MServer::hasObserver() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::notifyValueObservers()
+*/
+int8_t LWM2MServer::notifyValueObservers( LWM2MObject* p_obj,
+        LWM2MResource* p_res, const s_lwm2m_obsparams_t* p_params )
+{
+    int16_t cnt;
+    int16_t i = 0;
+
+    if( (p_obj == NULL) || (p_params == NULL) )
+        return -1;
+
+    /* observations pass 0 or the notification counter as status, so
+     * only errors and empty answers (e.g. of a write) are skipped */
+    if( (p_params->status >= COAP_400_BAD_REQUEST) ||
+        (p_params->buffer == NULL) || (p_params->bufferLen == 0) )
+        return 0;
+
+    /* multiple instance resources keep their instances up to date
+     * even without value observers */
+    if( p_res != NULL )
+    {
+        if( (p_res->hasValueObserver() == false) &&
+            (p_res->isMultiple() == false) )
+            return 0;
+    }
+    else if( hasObserver( p_obj, true ) == false )
+        return 0;
+
+    LWM2MValueDecoder& dec = acquireDecoder();
+
+    cnt = dec.decode( p_params->uriP, p_params->format, p_params->buffer,
+            p_params->bufferLen, p_obj );
+
+    if( (cnt == 0) && (p_res != NULL) && p_res->isMultiple() )
+    {
+        /* the resource has no instances left */
+        p_res->updateInstances( p_params, NULL, 0 );
+    }
+
+    while( i < cnt )
+    {
+        const LWM2MValue& val = dec.getValue( i );
+        LWM2MResource* p_cur = p_res;
+        int16_t next = i + 1;
+
+        if( p_cur == NULL )
+            p_cur = p_obj->getResource( val.getResId() );
+        else if( p_cur->getResId() != val.getResId() )
+            p_cur = NULL;
+
+        if( (p_cur != NULL) && p_cur->isMultiple() && val.isInstance() )
+        {
+            /* the instances of a resource follow each other and are
+             * passed as a whole to detect changed and removed instances */
+            while( (next < cnt) && (dec.getValue( next ).getResId() ==
+                    val.getResId()) )
+                next++;
+
+            p_cur->updateInstances( p_params, &val, next - i );
+        }
+        else if( (p_cur != NULL) && p_cur->hasValueObserver() )
+            p_cur->notifyObservers( p_params, val );
+
+        i = next;
+    }
+
+    releaseDecoder();
+
+    return (cnt < 0) ? -1 : 0;
+
+} /* LWM2MServer::notifyValueObservers() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::discoverKey()
+*/
+std::string LWM2MServer::discoverKey( const LWM2MDevice* p_dev, uint16_t objId )
+{
+    return p_dev->getType() + "/" + std::to_string( objId );
+
+} /* LWM2MServer::discoverKey() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::applyDiscoverCache()
+*/
+void LWM2MServer::applyDiscoverCache( LWM2MDevice* p_dev )
+{
+    std::vector< LWM2MObject* >::iterator objIt = p_dev->objectStart();
+    std::map< std::string, s_discover_t >::const_iterator it;
+
+    while( objIt != p_dev->objectEnd() )
+    {
+        it = m_discoverCache.find( discoverKey( p_dev, (*objIt)->getObjId() ) );
+        if( (it != m_discoverCache.end()) && (it->second.status == CONTENT_2_05) )
+            populate( *objIt, it->second );
+        objIt++;
+    }
+
+} /* LWM2MServer::applyDiscoverCache() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::startDiscover()
+*/
+int8_t LWM2MServer::startDiscover( const LWM2MObject* p_obj,
+        e_lwm2m_request_class_t cls )
+{
+    const LWM2MDevice* p_dev = p_obj->getDevice();
+    lwm2m_client_t* p_cli;
+    lwm2m_uri_t uri;
+    std::string key;
+    std::map< std::string, s_discover_t >::iterator it;
+    s_discover_t* p_disc;
+
+    if( p_dev == NULL )
+        return -1;
+
+    key = discoverKey( p_dev, p_obj->getObjId() );
+    it = m_discoverCache.find( key );
+    if( it != m_discoverCache.end() )
+    {
+        /* cached or running */
+        if( (it->second.status == CONTENT_2_05) ||
+            (it->second.status == NO_ERROR) )
+            return 0;
+
+        /* a failed discover is not repeated for every access */
+        if( prv_timeMs() < it->second.retry )
+            return -1;
+    }
+
+    /* find the device in the list of registered devices */
+    p_cli = getDevice( p_dev->getName() );
+    if( p_cli == NULL )
+        return -1;
+
+    p_disc = &m_discoverCache[key];
+    if( it == m_discoverCache.end() )
+    {
+        p_disc->key = key;
+        p_disc->backoff = 0;
+        p_disc->retry = 0;
+    }
+    p_disc->status = NO_ERROR;
+
+    uri.objectId = p_obj->getObjId();
+    uri.instanceId = p_obj->getInstId();
+    uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID;
+
+    if( request( p_cli, e_lwm2m_request_discover, &uri, LWM2M_CONTENT_TEXT,
+            NULL, 0, discoverCb, p_disc, cls ) != COAP_NO_ERROR )
+    {
+        failDiscover( p_disc, COAP_503_SERVICE_UNAVAILABLE );
+        return -1;
+    }
+
+    return 0;
+
+} /* LWM2MServer::startDiscover() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::failDiscover()
+*/
+void LWM2MServer::failDiscover( s_discover_t* p_disc, int status )
+{
+    /* the failure is cached, the next attempt is delayed */
+    p_disc->status = status;
+    p_disc->res.clear();
+    if( p_disc->backoff == 0 )
+        p_disc->backoff = LWM2MSERVER_DISCOVER_BACKOFF_MS;
+    else if( p_disc->backoff < (LWM2MSERVER_DISCOVER_BACKOFF_MAX_MS / 2) )
+        p_disc->backoff *= 2;
+    else
+        p_disc->backoff = LWM2MSERVER_DISCOVER_BACKOFF_MAX_MS;
+    p_disc->retry = prv_timeMs() + p_disc->backoff;
+
+} /* LWM2MServer::failDiscover() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::autoDiscover()
+*/
+int8_t LWM2MServer::autoDiscover( LWM2MObject* p_obj )
+{
+    int8_t ret = 0;
+    const LWM2MDevice* p_dev = p_obj->getDevice();
+    std::map< std::string, s_discover_t >::const_iterator it;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+
+    if( (!isAlive()) || (!m_reqCfg.autoDiscover) || (p_dev == NULL) )
+        ret = -1;
+
+    if( (ret == 0) && (p_obj->isDiscovered() == false) )
+    {
+        it = m_discoverCache.find( discoverKey( p_dev, p_obj->getObjId() ) );
+        if( (it != m_discoverCache.end()) &&
+            (it->second.status == CONTENT_2_05) )
+            populate( p_obj, it->second );
+        else
+            ret = startDiscover( p_obj, e_lwm2m_request_class_background );
+    }
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
+
+    return ret;
+
+} /* LWM2MServer::autoDiscover() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::autoDiscover()
+*/
+void LWM2MServer::autoDiscover( LWM2MDevice* p_dev )
+{
+    std::vector< LWM2MObject* >::iterator objIt = p_dev->objectStart();
+
+    while( objIt != p_dev->objectEnd() )
+    {
+        if( (*objIt)->isDiscovered() == false )
+            autoDiscover( *objIt );
+        objIt++;
+    }
+
+} /* LWM2MServer::autoDiscover() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::populate()
+*/
+void LWM2MServer::populate( LWM2MObject* p_obj, const s_discover_t& disc )
+{
+    std::vector< s_resDesc_t >::const_iterator it = disc.res.begin();
+
+    if( p_obj->isDiscovered() )
+        return;
+
+    while( it != disc.res.end() )
+    {
+        /* resources created by the application are kept */
+        if( p_obj->getResource( it->resId ) == NULL )
+            p_obj->addResource( new LWM2MResource( it->resId, false, false,
+                false, e_lwm2m_value_type_none, it->multiple ) );
+        it++;
+    }
+
+    p_obj->setDiscovered();
+
+} /* LWM2MServer::populate() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::parseDiscover()
+*/
+int8_t LWM2MServer::parseDiscover( const uint8_t* p_buf, size_t len,
+        std::vector< s_resDesc_t >& res )
+{
+    size_t i = 0;
+
+    /* the link format lists entries like </3/0/7>;dim=2 separated by ',' */
+    while( i < len )
+    {
+        uint32_t ids[3];
+        size_t cnt = 0;
+        bool multiple = false;
+
+        if( p_buf[i] != '<' )
+            return -1;
+        i++;
+
+        /* parse the path */
+        while( (i < len) && (p_buf[i] != '>') )
+        {
+            if( p_buf[i] == '/' )
+            {
+                if( cnt == 3 )
+                    return -1;
+                ids[cnt++] = 0;
+            }
+            else if( (p_buf[i] >= '0') && (p_buf[i] <= '9') && (cnt > 0) )
+                ids[cnt - 1] = (ids[cnt - 1] * 10) + (p_buf[i] - '0');
+            else
+                return -1;
+            i++;
+        }
+
+        if( i == len )
+            return -1;
+        i++;
+
+        /* parse the attributes */
+        while( (i < len) && (p_buf[i] != ',') )
+        {
+            if( (p_buf[i] == ';') && (i + 4 < len) &&
+                (memcmp( &p_buf[i + 1], "dim=", 4 ) == 0) )
+                multiple = true;
+            i++;
+        }
+        i++;
+
+        /* only resources are of interest */
+        if( (cnt == 3) && (ids[2] <= 0xFFFF) )
+        {
+            s_resDesc_t desc = { (uint16_t)ids[2], multiple };
+            res.push_back( desc );
+        }
+    }
+
+    return 0;
+
+} /* LWM2MServer::parseDiscover() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::acquireDecoder()
+*/
+LWM2MValueDecoder& LWM2MServer::acquireDecoder( void )
+{
+    /* an observer may trigger a nested notification e.g. by a blocking
+     * read, therefore every nesting level uses its own decoder */
+    if( m_decodeDepth == m_decoders.size() )
+        m_decoders.push_back( LWM2MValueDecoder() );
+
+    return m_decoders[m_decodeDepth++];
+
+} /* LWM2MServer::acquireDecoder() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::releaseDecoder()
+*/
+void LWM2MServer::releaseDecoder( void )
+{
+    if( m_decodeDepth > 0 )
+        m_decoders[--m_decodeDepth].clear();
 
-} /* LWM2MServer::checkEvents() */
+} /* LWM2MServer::releaseDecoder() */
 
 
 /*---------------------------------------------------------------------------*/
 /*
-* LWM2MServer::checkDeletedDevices()
+* LWM2MServer::deletedObserveParams()
 */
-void LWM2MServer::checkDeletedDevices( void )
+void LWM2MServer::deletedObserveParams( LWM2MDevice* p_dev )
 {
-    std::list< s_devDel_t >::iterator it = m_devDel.begin();
-    while( it != m_devDel.end() )
-    {
-        if(it->tot < time(NULL))
-        {
-          /* Timeout expired, delete element */
-          if( it->p_dev != NULL )
-          {
-            /* Delete all the observed resources from the device */
-            deletedObserveParams( it->p_dev );
-            delete( it->p_dev );
-          }
+  std::vector< LWM2MObject* >::iterator objIt;
 
-          m_devDel.pop_front();
-          it = m_devDel.begin();
-        }
-        else
-        {
-          /* Stop looking */
-          break;
-        }
-    }
-} /* LWM2MServer::checkDeletedDevices() */
+  OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+  if( p_dev != NULL)
+  {
+      objIt = p_dev->objectStart();
+      while( objIt != p_dev->objectEnd() )
+      {
+          deletedObserveParams( *objIt );
+          objIt++;
+      }
+  }
+  OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
 
+} /* LWM2MServer::deletedObserveParams() */
 
 
 /*---------------------------------------------------------------------------*/
 /*
 * LWM2MServer::deletedObserveParams()
 */
-void LWM2MServer::deletedObserveParams( LWM2MDevice* p_dev )
+void LWM2MServer::deletedObserveParams( LWM2MObject* p_obj )
 {
-  std::vector< LWM2MObject* >::iterator objIt;
   std::vector< LWM2MResource* >::const_iterator resIt;
   std::map< const LWM2MResource*, s_lwm2m_obsparams_t*>::iterator paramIt;
+  std::map< const LWM2MObject*, s_lwm2m_obsparams_t*>::iterator objParamIt;
 
-  OPCUA_LWM2M_SERVER_MUTEX_LOCK(p_srv);
-  if( p_dev != NULL)
+  OPCUA_LWM2M_SERVER_MUTEX_LOCK(this);
+  if( p_obj != NULL)
   {
-      objIt = p_dev->objectStart();
-      while( objIt != p_dev->objectEnd() )
+      resIt = p_obj->resourceStart();
+      while( resIt != p_obj->resourceEnd() )
       {
-          resIt = (*objIt)->resourceStart();
-          while( resIt != (*objIt)->resourceEnd() )
+          paramIt = m_obsResMap.find( *resIt );
+          if( paramIt != m_obsResMap.end() )
           {
-              paramIt = m_obsResMap.find( *resIt );
-              if( paramIt != m_obsResMap.end() )
-              {
-                  delete( paramIt->second );
-                  paramIt = m_obsResMap.erase( paramIt );
-              }
-              resIt++;
+              delete( paramIt->second );
+              m_obsResMap.erase( paramIt );
           }
-          objIt++;
+          resIt++;
+      }
+
+      objParamIt = m_obsObjMap.find( p_obj );
+      if( objParamIt != m_obsObjMap.end() )
+      {
+          delete( objParamIt->second );
+          m_obsObjMap.erase( objParamIt );
       }
   }
-  OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(p_srv);
+  OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(this);
 
 } /* LWM2MServer::deletedObserveParams() */
 
 
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::reconcileDevice()
+*/
+int16_t LWM2MServer::reconcileDevice( LWM2MDevice* p_dev, lwm2m_client_t* p_cli,
+        s_lwm2m_serverobserver_event_param_t* p_param )
+{
+    int16_t cnt = 0;
+    lwm2m_client_object_t* objectP;
+    lwm2m_list_t* instanceP;
+    std::vector< LWM2MObject* >::iterator objIt = p_dev->m_objVect.begin();
+
+    /* remove the object instances that are no longer registered */
+    while( objIt != p_dev->m_objVect.end() )
+    {
+        objectP = (lwm2m_client_object_t*)lwm2m_list_find(
+            (lwm2m_list_t*)p_cli->objectList, (*objIt)->getObjId() );
+        instanceP = NULL;
+        if( objectP != NULL )
+            instanceP = lwm2m_list_find( objectP->instanceList,
+                (*objIt)->getInstId() );
+
+        if( instanceP != NULL )
+        {
+            objIt++;
+            continue;
+        }
+
+        if( p_param != NULL )
+        {
+            if( p_param->removedCnt < LWM2M_SERVEROBSERVER_DELTA_MAX )
+            {
+                p_param->removed[p_param->removedCnt].objId = (*objIt)->getObjId();
+                p_param->removed[p_param->removedCnt].instId = (*objIt)->getInstId();
+                p_param->removedCnt++;
+            }
+            else
+                p_param->deltaOverflow = true;
+        }
+
+        /* the application may still refer to the object */
+        unindexObject( *objIt );
+        m_objDel.push_back( {*objIt, (uint32_t)(LWM2MClock::timeS() +
+            (p_dev->getLifetime() * 2))} );
+        objIt = p_dev->m_objVect.erase( objIt );
+        cnt++;
+    }
+
+    /* add the new object instances */
+    for( objectP = p_cli->objectList; objectP != NULL; objectP = objectP->next )
+    {
+        /* objects without instances are not supported */
+        for( instanceP = objectP->instanceList; instanceP != NULL;
+            instanceP = instanceP->next )
+        {
+            if( p_dev->getObject( objectP->id, instanceP->id ) != NULL )
+                continue;
+
+            /* create a new Object and add it to the device */
+            LWM2MObject* p_obj = new LWM2MObject( objectP->id, instanceP->id );
+            p_dev->addObject( p_obj );
+            indexObject( p_obj );
+
+            if( p_param != NULL )
+            {
+                if( p_param->addedCnt < LWM2M_SERVEROBSERVER_DELTA_MAX )
+                {
+                    p_param->added[p_param->addedCnt].objId = objectP->id;
+                    p_param->added[p_param->addedCnt].instId = instanceP->id;
+                    p_param->addedCnt++;
+                }
+                else
+                    p_param->deltaOverflow = true;
+            }
+            cnt++;
+        }
+    }
+
+    /* use the resources already discovered for the device type */
+    applyDiscoverCache( p_dev );
+
+    return cnt;
+
+} /* LWM2MServer::reconcileDevice() */
+
+
 /*---------------------------------------------------------------------------*/
 /*
 * LWM2MServer::monitorCb()
@@ -1085,13 +4389,13 @@ void LWM2MServer::monitorCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
 
     lwm2m_context_t* lwm2mH = p_srv->mp_lwm2mH;
     lwm2m_client_t* targetP;
-    lwm2m_client_object_t * objectP;
 
     switch( status )
     {
     case COAP_201_CREATED:
 
         /* A new client was registered */
+        p_srv->m_metrics.add( e_lwm2m_metric_registrations );
         targetP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)lwm2mH->clientList, clientID);
         if( targetP == NULL )
           ret = -1;
@@ -1102,72 +4406,67 @@ void LWM2MServer::monitorCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
           /* check the map for an existing device with the same name */
           if( it != p_srv->m_devMap.end())
           {
-
-            /* The device already exists. Delete the device before creating
-             * a new one. */
+            /* The device registered again e.g. after a reboot. Keep the
+             * device and update the objects that changed only. */
             s_devEvent_t ev;
+            memset( &ev.param, 0, sizeof(ev.param) );
+            p_srv->m_devIdMap.erase( it->second->getID() );
+            if( it->second->getID() != targetP->internalID )
+              p_srv->dropRequestQueue( it->second->getID(),
+                  COAP_404_NOT_FOUND );
+            it->second->setID( targetP->internalID );
+            p_srv->m_devIdMap[targetP->internalID] = it->second;
+            /* the objects may have changed e.g. after a firmware update */
+            it->second->setType( prv_devType( targetP ) );
+            p_srv->reconcileDevice( it->second, targetP, &ev.param );
+            p_srv->wakeDevice( it->second, targetP );
+            p_srv->autoDiscover( it->second );
+
+            /* the observations ended with the registration */
+            p_srv->applySubscriptions( it->second );
+            p_srv->restoreObservations( it->second );
+
             strncpy( (char*)ev.param.devName, it->second->getName().c_str(),
                 sizeof(ev.param.devName));
-            ev.event = e_lwm2m_serverobserver_event_deregister;
+            ev.event = e_lwm2m_serverobserver_event_update;
             p_srv->m_devEv.push( ev );
-
-            /* move the device to the deleted device list */
-            p_srv->m_devDel.push_back( {it->second, (time(NULL) + (it->second->getLifetime() * 2))} );
-            p_srv->m_devMap.erase( it );
-
-            ret = 0;
           }
-        }
-
-        if( ret == 0 )
-        {
-          /* create a new device and add it to the list */
-          LWM2MDevice* p_dev = new LWM2MDevice( targetP->name,
-              targetP->internalID, p_srv );
-
-          /* add all objects registered at the device */
-          for (objectP = targetP->objectList; objectP != NULL ; objectP = objectP->next)
+          else
           {
-            /* objects without instances are not supported */
-            if (objectP->instanceList != NULL)
-            {
-              /* iterate through all the instances and assign the found objects
-              * to the current device */
-              lwm2m_list_t * instanceP;
-
-              for (instanceP = objectP->instanceList; instanceP != NULL ;
-                  instanceP = instanceP->next)
-              {
-                /* create a new Object and add it to the device */
-                LWM2MObject* p_obj = new LWM2MObject( objectP->id, instanceP->id );
-                p_dev->addObject( p_obj );
-              }
-            }
+            /* create a new device and add it to the list */
+            LWM2MDevice* p_dev = new LWM2MDevice( targetP->name,
+                targetP->internalID, p_srv );
+            p_dev->setType( prv_devType( targetP ) );
+
+            /* add all objects registered at the device */
+            p_srv->reconcileDevice( p_dev, targetP, NULL );
+            p_srv->wakeDevice( p_dev, targetP );
+
+            p_srv->m_devMap.insert(
+                std::pair< std::string, LWM2MDevice* >( p_dev->getName(), p_dev ) );
+            p_srv->m_devIdMap[p_dev->getID()] = p_dev;
+            p_srv->autoDiscover( p_dev );
+            p_srv->applySubscriptions( p_dev );
+            p_srv->restoreObservations( p_dev );
+
+            /** Add event */
+            s_devEvent_t ev;
+            memset( &ev.param, 0, sizeof(ev.param) );
+            strncpy( (char*)ev.param.devName, p_dev->getName().c_str(),
+                         sizeof(ev.param.devName));
+            ev.event = e_lwm2m_serverobserver_event_register;
+            p_srv->m_devEv.push( ev );
           }
-
-          p_srv->m_devMap.insert(
-              std::pair< std::string, LWM2MDevice* >( p_dev->getName(), p_dev ) );
-
-          /** Add event */
-          s_devEvent_t ev;
-          strncpy( (char*)ev.param.devName, p_dev->getName().c_str(),
-                       sizeof(ev.param.devName));
-          ev.event = e_lwm2m_serverobserver_event_register;
-          p_srv->m_devEv.push( ev );
         }
         break;
 
     case COAP_202_DELETED:
 
         /* An existing client was deleted. */
-        it = p_srv->m_devMap.begin();
-        while( it != p_srv->m_devMap.end() )
-        {
-          if( it->second->getID() == clientID )
-            /* found matching ID */
-            break;
-          it++;
-        }
+        p_srv->m_metrics.add( e_lwm2m_metric_deregistrations );
+        it = p_srv->m_devMap.end();
+        if( p_srv->m_devIdMap.count( clientID ) != 0 )
+          it = p_srv->m_devMap.find( p_srv->m_devIdMap[clientID]->getName() );
 
         /* check the map for an existing device with the same name */
         if( it == p_srv->m_devMap.end())
@@ -1177,13 +4476,24 @@ void LWM2MServer::monitorCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
         {
           /* Notify all Observers */
           s_devEvent_t ev;
+          memset( &ev.param, 0, sizeof(ev.param) );
           strncpy( (char*)ev.param.devName, it->second->getName().c_str(),
               sizeof(ev.param.devName));
           ev.event = e_lwm2m_serverobserver_event_deregister;
           p_srv->m_devEv.push( ev );
 
+          /* the objects of the device are no longer found */
+          std::vector< LWM2MObject* >::iterator objIt;
+          for( objIt = it->second->objectStart();
+               objIt != it->second->objectEnd(); ++objIt )
+            p_srv->unindexObject( *objIt );
+          p_srv->m_devIdMap.erase( clientID );
+          p_srv->dropRequestQueue( clientID, COAP_404_NOT_FOUND );
+          p_srv->releasePeer( it->second->mp_session );
+          it->second->mp_session = NULL;
+
           /* move the device to the deleted device list */
-          p_srv->m_devDel.push_back( {it->second, (time(NULL) + (it->second->getLifetime() * 2))} );
+          p_srv->m_devDel.push_back( {it->second, (LWM2MClock::timeS() + (it->second->getLifetime() * 2))} );
           p_srv->m_devMap.erase( it );
         }
         break;
@@ -1191,10 +4501,48 @@ void LWM2MServer::monitorCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
     case COAP_204_CHANGED:
 
         /* An existing client was updated. */
+        p_srv->m_metrics.add( e_lwm2m_metric_updates );
         targetP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)lwm2mH->clientList,
             clientID);
+        if( targetP == NULL )
+          ret = -1;
+
+        if( ret == 0 )
+        {
+          it = p_srv->m_devMap.find( targetP->name );
+          if( it == p_srv->m_devMap.end())
+            ret = -1;
+        }
 
-        /** TODO */
+        if( ret == 0 )
+        {
+          /* a device in queue mode is reachable after an update */
+          p_srv->wakeDevice( it->second, targetP );
+
+          /* the object list of an update is optional, only changes
+           * of the objects are reported */
+          s_devEvent_t ev;
+          memset( &ev.param, 0, sizeof(ev.param) );
+          if( p_srv->reconcileDevice( it->second, targetP, &ev.param ) > 0 )
+          {
+            /* observe the subscribed resources of new instances */
+            if( ev.param.deltaOverflow )
+              p_srv->applySubscriptions( it->second );
+            for( int i = 0; (!ev.param.deltaOverflow) &&
+                 (i < ev.param.addedCnt); i++ )
+            {
+              LWM2MObject* p_obj = it->second->getObject(
+                  ev.param.added[i].objId, ev.param.added[i].instId );
+              if( p_obj != NULL )
+                p_srv->applySubscriptions( p_obj );
+            }
+
+            strncpy( (char*)ev.param.devName, it->second->getName().c_str(),
+                sizeof(ev.param.devName));
+            ev.event = e_lwm2m_serverobserver_event_update;
+            p_srv->m_devEv.push( ev );
+          }
+        }
 
         break;
 
@@ -1217,7 +4565,7 @@ void LWM2MServer::readWriteResCb( uint16_t clientID, lwm2m_uri_t * uriP, int sta
         void * userData )
 {
     int ret = 0;
-    lwm2m_data_t* p_lwm2mData;
+    lwm2m_data_t* p_lwm2mData = NULL;
 
     /* convert user data to server instance */
     s_lwm2m_obsparams_t* p_cbParams = (s_lwm2m_obsparams_t*)userData;
@@ -1238,16 +4586,10 @@ void LWM2MServer::readWriteResCb( uint16_t clientID, lwm2m_uri_t * uriP, int sta
     p_cbParams->buffer = data;
     p_cbParams->bufferLen = dataLength;
 
-    std::map< std::string, LWM2MDevice* >::const_iterator devIt = p_srv->m_devMap.begin();
-    while( devIt != p_srv->m_devMap.end() )
-    {
-      if( devIt->second->getID() == p_cbParams->clientID )
-      {
-        p_dev = devIt->second;
-        break;
-      }
-      devIt++;
-    }
+    std::map< uint16_t, LWM2MDevice* >::const_iterator devIt =
+        p_srv->m_devIdMap.find( p_cbParams->clientID );
+    if( devIt != p_srv->m_devIdMap.end() )
+      p_dev = devIt->second;
 
     if( p_dev == NULL )
     {
@@ -1270,6 +4612,14 @@ void LWM2MServer::readWriteResCb( uint16_t clientID, lwm2m_uri_t * uriP, int sta
 
     if( p_res != NULL )
     {
+        /* keep the last value for reads while the device sleeps */
+        if( status == CONTENT_2_05 )
+          p_res->setCachedValue( format, data, dataLength );
+
+        /* keep the instances of multiple instance resources */
+        if( p_res->isMultiple() )
+          p_srv->notifyValueObservers( p_obj, p_res, p_cbParams );
+
         ret = lwm2m_data_parse( p_cbParams->uriP, p_cbParams->buffer,
                p_cbParams->bufferLen, p_cbParams->format, &p_lwm2mData );
 
@@ -1279,36 +4629,165 @@ void LWM2MServer::readWriteResCb( uint16_t clientID, lwm2m_uri_t * uriP, int sta
     }
     else if( p_obj != NULL )
     {
-      ret = lwm2m_data_parse( p_cbParams->uriP, p_cbParams->buffer,
-             p_cbParams->bufferLen, p_cbParams->format, &p_lwm2mData );
+      /* values are decoded once for all value observers */
+      p_srv->notifyValueObservers( p_obj, NULL, p_cbParams );
 
-      /* Iterate through the resources and notify about the change of data */
-      std::vector< LWM2MResource* >::const_iterator it = p_obj->resourceStart();
-      p_cbParams->buffer = NULL;
-      while( it != p_obj->resourceEnd() )
+      if( hasObserver( p_obj, false ) )
       {
-          lwm2m_data_t* p_lwm2mDataCur = p_lwm2mData;
-          for( int i = 0; i < ret; i++ )
-          {
-              if( p_lwm2mData->id == (*it)->getResId() )
-              {
-                  /* ID match */
-                  p_cbParams->data = p_lwm2mDataCur;
-                  /* notify */
-                  (*it)->notifyObservers( p_cbParams );
-              }
-              p_lwm2mData++;
-          }
-          it++;
-      }
+        ret = lwm2m_data_parse( p_cbParams->uriP, p_cbParams->buffer,
+               p_cbParams->bufferLen, p_cbParams->format, &p_lwm2mData );
 
-      lwm2m_data_free(ret, p_lwm2mData);
+        /* Iterate through the resources and notify about the change of data */
+        std::vector< LWM2MResource* >::const_iterator it = p_obj->resourceStart();
+        p_cbParams->buffer = NULL;
+        while( it != p_obj->resourceEnd() )
+        {
+            lwm2m_data_t* p_lwm2mDataCur = p_lwm2mData;
+            for( int i = 0; i < ret; i++ )
+            {
+                if( p_lwm2mDataCur->id == (*it)->getResId() )
+                {
+                    /* ID match */
+                    p_cbParams->data = p_lwm2mDataCur;
+                    /* notify */
+                    (*it)->notifyObservers( p_cbParams );
+                }
+                p_lwm2mDataCur++;
+            }
+            it++;
+        }
+
+        if( ret > 0 )
+          lwm2m_data_free(ret, p_lwm2mData);
+      }
     }
 
     OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(p_srv);
 };
 
 
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::discoverCb()
+*/
+void LWM2MServer::discoverCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
+        lwm2m_media_type_t format, uint8_t * data, int dataLength,
+        void * userData )
+{
+    /* convert user data to the cache entry */
+    s_discover_t* p_disc = (s_discover_t*)userData;
+
+    LWM2MServer* p_srv = LWM2MServer::instance();
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(p_srv);
+
+    p_disc->res.clear();
+    if( (status == CONTENT_2_05) &&
+        (parseDiscover( data, dataLength, p_disc->res ) == 0) )
+    {
+        p_disc->status = CONTENT_2_05;
+
+        /* fill the objects of all devices of the type */
+        if( p_srv->m_reqCfg.autoDiscover )
+        {
+            std::map< std::string, LWM2MDevice* >::iterator devIt;
+            for( devIt = p_srv->m_devMap.begin();
+                 devIt != p_srv->m_devMap.end(); ++devIt )
+            {
+                if( discoverKey( devIt->second, uriP->objectId ) != p_disc->key )
+                    continue;
+
+                std::vector< LWM2MObject* >::iterator objIt;
+                for( objIt = devIt->second->objectStart();
+                     objIt != devIt->second->objectEnd(); ++objIt )
+                {
+                    if( (*objIt)->getObjId() == uriP->objectId )
+                        populate( *objIt, *p_disc );
+                }
+            }
+        }
+    }
+    else if( (status == NO_ERROR) || (status == CONTENT_2_05) )
+    {
+        /* no answer or an answer that can not be parsed */
+        p_srv->failDiscover( p_disc, COAP_500_INTERNAL_SERVER_ERROR );
+    }
+    else
+        p_srv->failDiscover( p_disc, status );
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(p_srv);
+
+} /* LWM2MServer::discoverCb() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MServer::readResInstCb()
+*/
+void LWM2MServer::readResInstCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
+        lwm2m_media_type_t format, uint8_t * data, int dataLength,
+        void * userData )
+{
+    /* convert user data to the read parameters */
+    s_instRead_t* p_read = (s_instRead_t*)userData;
+    s_lwm2m_obsparams_t* p_cbParams = &p_read->params;
+
+    LWM2MServer* p_srv = LWM2MServer::instance();
+    LWM2MDevice* p_dev = NULL;
+    LWM2MObject* p_obj = NULL;
+    LWM2MResource* p_res = NULL;
+
+    OPCUA_LWM2M_SERVER_MUTEX_LOCK(p_srv);
+
+    /* set LWM2M parameters */
+    p_cbParams->clientID = clientID;
+    p_cbParams->uriP = uriP;
+    p_cbParams->format = format;
+    p_cbParams->data = NULL;
+    p_cbParams->dataLen = 0;
+    p_cbParams->buffer = data;
+    p_cbParams->bufferLen = dataLength;
+
+    std::map< uint16_t, LWM2MDevice* >::const_iterator devIt =
+        p_srv->m_devIdMap.find( clientID );
+    if( devIt != p_srv->m_devIdMap.end() )
+      p_dev = devIt->second;
+
+    if( (p_dev != NULL) && LWM2M_URI_IS_SET_INSTANCE( uriP ) )
+    {
+      /* get object */
+      p_obj = p_dev->getObject( uriP->objectId, uriP->instanceId );
+    }
+
+    if( (p_obj != NULL) && ( LWM2M_URI_IS_SET_RESOURCE( uriP ) ) )
+    {
+      /* Get the resource */
+      p_res = p_obj->getResource( uriP->resourceId );
+    }
+
+    if( (p_res != NULL) && (status == CONTENT_2_05) )
+    {
+      /* decode the requested instance only */
+      LWM2MValueDecoder& dec = p_srv->acquireDecoder();
+
+      if( (dec.decode( uriP, format, data, dataLength, p_obj,
+              p_read->instId ) > 0) && dec.getValue( 0 ).isInstance() )
+      {
+        p_res->setInstance( dec.getValue( 0 ) );
+        p_cbParams->dataLen = 1;
+      }
+
+      p_srv->releaseDecoder();
+    }
+
+    /* set the status last, it finishes the blocking read */
+    p_cbParams->status = status;
+
+    OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(p_srv);
+
+} /* LWM2MServer::readResInstCb() */
+
+
 /*---------------------------------------------------------------------------*/
 /*
 * LWM2MServer::notifyResCb()
@@ -1318,7 +4797,7 @@ void LWM2MServer::notifyResCb( uint16_t clientID, lwm2m_uri_t * uriP, int status
         void * userData )
 {
     int ret = 0;
-    lwm2m_data_t* p_lwm2mData;
+    lwm2m_data_t* p_lwm2mData = NULL;
     std::map< const LWM2MResource*, s_lwm2m_obsparams_t*>::iterator it;
     s_lwm2m_obsparams_t* p_cbParams;
 
@@ -1351,17 +4830,15 @@ void LWM2MServer::notifyResCb( uint16_t clientID, lwm2m_uri_t * uriP, int status
     p_cbParams->buffer = data;
     p_cbParams->bufferLen = dataLength;
 
+    /* the first answer of an observation has the status 0 */
+    if( (status > NO_ERROR) && (status < COAP_400_BAD_REQUEST) )
+        p_srv->m_metrics.add( e_lwm2m_metric_notifications );
+    p_srv->m_trace.add( e_lwm2m_trace_notify, 0, clientID, uriP, status );
 
-    std::map< std::string, LWM2MDevice* >::const_iterator devIt = p_srv->m_devMap.begin();
-    while( devIt != p_srv->m_devMap.end() )
-    {
-      if( devIt->second->getID() == p_cbParams->clientID )
-      {
-        p_dev = devIt->second;
-        break;
-      }
-      devIt++;
-    }
+    std::map< uint16_t, LWM2MDevice* >::const_iterator devIt =
+        p_srv->m_devIdMap.find( p_cbParams->clientID );
+    if( devIt != p_srv->m_devIdMap.end() )
+      p_dev = devIt->second;
 
     if( p_dev == NULL )
     {
@@ -1385,17 +4862,28 @@ void LWM2MServer::notifyResCb( uint16_t clientID, lwm2m_uri_t * uriP, int status
 
     if( p_res != NULL )
     {
-        ret = lwm2m_data_parse( p_cbParams->uriP, p_cbParams->buffer,
-               p_cbParams->bufferLen, p_cbParams->format, &p_lwm2mData );
+        /* keep the last value for reads while the device sleeps, the
+         * status of a notification is its counter so only errors come
+         * without a payload */
+        if( (data != NULL) && (dataLength > 0) )
+          p_res->setCachedValue( format, data, dataLength );
 
-        if( ret > 0 )
-          p_cbParams->data = p_lwm2mData;
+        /* values are decoded once for all value observers */
+        p_srv->notifyValueObservers( p_obj, p_res, p_cbParams );
 
-        /* call the notification */
-        p_res->notifyObservers( p_cbParams );
-        if( p_lwm2mData != NULL )
-          lwm2m_data_free(ret, p_lwm2mData);
+        if( p_res->hasObserver() )
+        {
+          ret = lwm2m_data_parse( p_cbParams->uriP, p_cbParams->buffer,
+                 p_cbParams->bufferLen, p_cbParams->format, &p_lwm2mData );
 
+          if( ret > 0 )
+            p_cbParams->data = p_lwm2mData;
+
+          /* call the notification */
+          p_res->notifyObservers( p_cbParams );
+          if( ret > 0 )
+            lwm2m_data_free(ret, p_lwm2mData);
+        }
     }
     OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(p_srv);
 };
@@ -1410,7 +4898,7 @@ void LWM2MServer::notifyObjCb( uint16_t clientID, lwm2m_uri_t * uriP, int status
         void * userData )
 {
     int ret = 0;
-    lwm2m_data_t* p_lwm2mData;
+    lwm2m_data_t* p_lwm2mData = NULL;
     std::map< const LWM2MObject*, s_lwm2m_obsparams_t*>::iterator it;
     s_lwm2m_obsparams_t* p_cbParams;
 
@@ -1442,17 +4930,15 @@ void LWM2MServer::notifyObjCb( uint16_t clientID, lwm2m_uri_t * uriP, int status
     p_cbParams->buffer = data;
     p_cbParams->bufferLen = dataLength;
 
+    /* the first answer of an observation has the status 0 */
+    if( (status > NO_ERROR) && (status < COAP_400_BAD_REQUEST) )
+        p_srv->m_metrics.add( e_lwm2m_metric_notifications );
+    p_srv->m_trace.add( e_lwm2m_trace_notify, 0, clientID, uriP, status );
 
-    std::map< std::string, LWM2MDevice* >::const_iterator devIt = p_srv->m_devMap.begin();
-    while( devIt != p_srv->m_devMap.end() )
-    {
-      if( devIt->second->getID() == p_cbParams->clientID )
-      {
-        p_dev = devIt->second;
-        break;
-      }
-      devIt++;
-    }
+    std::map< uint16_t, LWM2MDevice* >::const_iterator devIt =
+        p_srv->m_devIdMap.find( p_cbParams->clientID );
+    if( devIt != p_srv->m_devIdMap.end() )
+      p_dev = devIt->second;
 
     if( p_dev == NULL )
     {
@@ -1468,6 +4954,12 @@ void LWM2MServer::notifyObjCb( uint16_t clientID, lwm2m_uri_t * uriP, int status
     }
 
     if( p_obj != NULL )
+    {
+      /* values are decoded once for all value observers */
+      p_srv->notifyValueObservers( p_obj, NULL, p_cbParams );
+    }
+
+    if( (p_obj != NULL) && hasObserver( p_obj, false ) )
     {
       ret = lwm2m_data_parse( p_cbParams->uriP, p_cbParams->buffer,
              p_cbParams->bufferLen, p_cbParams->format, &p_lwm2mData );
@@ -1492,7 +4984,8 @@ void LWM2MServer::notifyObjCb( uint16_t clientID, lwm2m_uri_t * uriP, int status
           it++;
       }
 
-      lwm2m_data_free(ret, p_lwm2mData);
+      if( ret > 0 )
+        lwm2m_data_free(ret, p_lwm2mData);
     }
 
     OPCUA_LWM2M_SERVER_MUTEX_UNLOCK(p_srv);
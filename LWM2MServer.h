@@ -58,12 +58,28 @@
 #include <list>
 #include <vector>
 #include <map>
+#include <set>
 #include <queue>
+#include <deque>
 #include "liblwm2m.h"
 #include "connection.h"
 #include "LWM2MDevice.h"
 #include "LWM2MResourceObserver.h"
 #include "LWM2MServerObserver.h"
+#include "LWM2MLoopObserver.h"
+#include "LWM2MFirmwareUpdate.h"
+#include "LWM2MBulkOperation.h"
+#include "LWM2MValueDecoder.h"
+#include "LWM2MRttEstimator.h"
+#include "LWM2MRequestQueue.h"
+#include "LWM2MSubscriptions.h"
+#include "LWM2MMetrics.h"
+#include "LWM2MLoopProfiler.h"
+#include "LWM2MTrace.h"
+#include "LWM2MLockStats.h"
+#include "LWM2MCapture.h"
+#include "LWM2MClock.h"
+#include "LWM2MUsage.h"
 
 #ifdef OPCUA_LWM2M_SERVER_USE_THREAD
 #include <pthread.h>
@@ -94,6 +110,8 @@ class LWM2MResource;
 class LWM2MServer
 {
     friend class LWM2MDevice;
+    friend class LWM2MFirmwareUpdate;
+    friend class LWM2MBulkOperation;
 
 
 private:
@@ -146,6 +164,123 @@ private:
       uint32_t tot;
     };
 
+    /**
+     * Resource found by a discover.
+     */
+    struct s_resDesc_t
+    {
+        /* ID of the resource */
+        uint16_t resId;
+        /* resource has multiple instances */
+        bool multiple;
+    };
+
+    /**
+     * Request queue that may send requests.
+     */
+    struct s_readyQueue_t
+    {
+        /* internal ID of the device */
+        uint16_t clientID;
+        /* queue of the device */
+        LWM2MRequestQueue* p_queue;
+        /* device of the queue or NULL */
+        LWM2MDevice* p_dev;
+        /* outstanding requests to the device */
+        uint32_t inFlight;
+    };
+
+    /**
+     * Cached discover result.
+     */
+    struct s_discover_t
+    {
+        /* key of the cache entry */
+        std::string key;
+        /* status of the discover, NO_ERROR while it is running */
+        int status;
+        /* resources of the object */
+        std::vector< s_resDesc_t > res;
+        /* time in ms between two attempts of a failing discover */
+        uint32_t backoff;
+        /* time in ms a failed discover may be sent again */
+        uint64_t retry;
+    };
+
+    /**
+     * Object removed by an update.
+     */
+    struct s_objDel_t
+    {
+      /* the removed object */
+      LWM2MObject* p_obj;
+      /* timeout to delete it */
+      uint32_t tot;
+    };
+
+    /**
+     * Read of a single resource instance.
+     */
+    struct s_instRead_t
+    {
+        /* parameters of the read */
+        s_lwm2m_obsparams_t params;
+        /* requested resource instance */
+        uint16_t instId;
+    };
+
+    /**
+     * Observation kept over re-registrations.
+     */
+    struct s_obsKey_t
+    {
+        /* ID of the object */
+        uint16_t objId;
+        /* ID of the object instance */
+        uint16_t instId;
+        /* ID of the resource, LWM2M_MAX_ID for a whole instance */
+        uint16_t resId;
+
+        bool operator<( const s_obsKey_t& key ) const {
+            if( objId != key.objId )
+                return objId < key.objId;
+            if( instId != key.instId )
+                return instId < key.instId;
+            return resId < key.resId;
+        }
+    };
+
+    /**
+     * Retransmission state of a pending request.
+     */
+    struct s_retrans_t
+    {
+        /* message ID of the request */
+        uint16_t mID;
+        /* internal ID of the device */
+        uint16_t clientID;
+        /* connection the request was sent on */
+        void* p_session;
+        /* user data of the request callback */
+        void* p_data;
+        /* priority class of the request */
+        e_lwm2m_request_class_t cls;
+        /* ID of the request in the trace */
+        uint32_t traceId;
+        /* time in ms of the first transmission */
+        uint64_t first;
+        /* time in ms of the next retransmission */
+        uint64_t next;
+        /* current timeout in ms */
+        uint32_t timeout;
+        /* number of retransmissions */
+        uint8_t retrans;
+        /* acknowledged, failed or left to the LWM2M implementation */
+        bool done;
+        /* request is still pending */
+        bool alive;
+    };
+
     /**
      * Device event.
      */
@@ -167,7 +302,33 @@ private:
         , m_port( LWM2M_STANDARD_PORT_STR )
         , m_addrFam( AF_INET6 )
         , mp_connList( NULL )
-        , mp_lwm2mH( NULL ) {
+        , mp_lwm2mH( NULL )
+        , m_decodeDepth( 0 ) {
+
+        /* default retransmission configuration */
+        m_retransCfg.initialRto = LWM2M_RTT_INITIAL_RTO_MS;
+        m_retransCfg.minRto = LWM2M_RTT_MIN_RTO_MS;
+        m_retransCfg.maxRto = LWM2M_RTT_MAX_RTO_MS;
+        m_retransCfg.maxRetransmit = LWM2M_RTT_MAX_RETRANSMIT;
+        m_retransCfg.adaptive = true;
+
+        /* default request configuration */
+        m_reqCfg.nstart = LWM2M_REQUEST_NSTART;
+        m_reqCfg.dispatch = e_lwm2m_dispatch_fifo;
+        m_reqCfg.awakeTime = LWM2M_REQUEST_AWAKE_TIME;
+        m_reqCfg.cacheReads = false;
+        m_reqCfg.autoDiscover = false;
+        m_reqCfg.timeout = LWM2M_REQUEST_TIMEOUT;
+        m_reqCfg.breakerThreshold = LWM2M_REQUEST_BREAKER_THRESHOLD;
+        m_reqCfg.breakerProbe = LWM2M_REQUEST_BREAKER_PROBE;
+        m_reqCfg.breakerProbeMax = LWM2M_REQUEST_BREAKER_PROBE_MAX;
+        m_reqCfg.budget[e_lwm2m_request_class_interactive] = 0;
+        m_reqCfg.budget[e_lwm2m_request_class_background] =
+                LWM2M_REQUEST_BUDGET_BACKGROUND;
+        m_reqCfg.budget[e_lwm2m_request_class_bulk] =
+                LWM2M_REQUEST_BUDGET_BULK;
+
+        m_lockStats.setMetrics( &m_metrics );
 
 #ifdef OPCUA_LWM2M_SERVER_USE_THREAD
         pthread_mutexattr_t attr;
@@ -251,16 +412,50 @@ public:
     LWM2MDevice* getLWM2MDevice( std::string client );
 
 
+    /**
+     * \brief   Get the devices that registered an object.
+     *
+     *          The devices are taken from an index that is updated with
+     *          every registration, so the time depends on the number of
+     *          devices found only.
+     *
+     * \param   objId   ID of the object.
+     * \param   devices List to append the devices to.
+     *
+     * \return  Number of devices found.
+     */
+    uint32_t getDevicesByObject( uint16_t objId,
+        std::vector< LWM2MDevice* >& devices );
+
+
+    /**
+     * \brief   Get the instances of an object of all devices.
+     *
+     * \param   objId   ID of the object.
+     * \param   objects List to append the object instances to.
+     *
+     * \return  Number of object instances found.
+     */
+    uint32_t getObjectsById( uint16_t objId,
+        std::vector< LWM2MObject* >& objects );
+
+
     /**
      * \brief   Read a resources value.
      *
      * \param   p_res The resource to read the value from.
      * \param   val   Value reference to write the value to.
+     * \param   p_cbParams  Parameters for a non-blocking read or NULL to
+     *                      wait for the result.
+     * \param   timeout     Time in ms to wait for the result.
+     * \param   cls         Priority class of the request.
      *
      * \return  0 on success or negative value on error.
      */
     int8_t read( const LWM2MResource* p_res, lwm2m_data_t**,
-        s_lwm2m_obsparams_t* p_cbParams );
+        s_lwm2m_obsparams_t* p_cbParams,
+        uint32_t timeout = LWM2M_REQUEST_TIMEOUT_DEFAULT,
+        e_lwm2m_request_class_t cls = e_lwm2m_request_class_interactive );
 
 
     /**
@@ -268,11 +463,63 @@ public:
      *
      * \param   p_res   The resource to write the value to.
      * \param   val     Value to set for the resource.
+     * \param   p_cbParams  Parameters for a non-blocking write or NULL to
+     *                      wait for the result.
+     * \param   timeout     Time in ms to wait for the result.
+     * \param   cls         Priority class of the request.
      *
      * \return  0 on success or negative value on error.
      */
     int8_t write( const LWM2MResource* p_res, const std::string& val,
-        s_lwm2m_obsparams_t* p_cbParams );
+        s_lwm2m_obsparams_t* p_cbParams,
+        uint32_t timeout = LWM2M_REQUEST_TIMEOUT_DEFAULT,
+        e_lwm2m_request_class_t cls = e_lwm2m_request_class_interactive );
+
+
+    /**
+     * \brief   Read the value of a single resource instance.
+     *
+     *          LWM2M does not address resource instances, therefore the
+     *          whole resource is read. Only the requested instance is
+     *          decoded and stored at the resource. The call blocks until
+     *          the device answered.
+     *
+     * \param   p_res   The multiple instance resource to read from.
+     * \param   instId  ID of the resource instance.
+     * \param   val     Value to write the instance to. Strings and opaque
+     *                  data refer to the resource.
+     * \param   timeout Time in ms to wait for the result.
+     * \param   cls     Priority class of the request.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t read( const LWM2MResource* p_res, uint16_t instId, LWM2MValue& val,
+        uint32_t timeout = LWM2M_REQUEST_TIMEOUT_DEFAULT,
+        e_lwm2m_request_class_t cls = e_lwm2m_request_class_interactive );
+
+
+    /**
+     * \brief   Write the value of a single resource instance.
+     *
+     *          The instance is written with a partial update of the object
+     *          instance so that the other instances of the resource are
+     *          neither transferred nor replaced.
+     *
+     * \param   p_res       The multiple instance resource to write to.
+     * \param   instId      ID of the resource instance.
+     * \param   val         Value in text format. It is converted according
+     *                      to the type of the resource.
+     * \param   p_cbParams  Parameters for a non-blocking write or NULL to
+     *                      wait for the result.
+     * \param   timeout     Time in ms to wait for the result.
+     * \param   cls         Priority class of the request.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t write( const LWM2MResource* p_res, uint16_t instId,
+        const std::string& val, s_lwm2m_obsparams_t* p_cbParams,
+        uint32_t timeout = LWM2M_REQUEST_TIMEOUT_DEFAULT,
+        e_lwm2m_request_class_t cls = e_lwm2m_request_class_interactive );
 
 
 
@@ -281,10 +528,14 @@ public:
      *
      * \param   p_obj     The object instance to observe.
      * \param   observe   Defines if the value shall be observed or not.
+     * \param   timeout   Time in ms to wait for the result.
+     * \param   cls       Priority class of the request.
      *
      * \return  0 on success or negative value on error.
      */
-    int8_t observe( const LWM2MObject* p_obj, bool observe );
+    int8_t observe( const LWM2MObject* p_obj, bool observe,
+        uint32_t timeout = LWM2M_REQUEST_TIMEOUT_DEFAULT,
+        e_lwm2m_request_class_t cls = e_lwm2m_request_class_interactive );
 
 
     /**
@@ -292,10 +543,75 @@ public:
      *
      * \param   p_res     The resource to observe.
      * \param   observe   Defines if the value shall be observed or not.
+     * \param   timeout   Time in ms to wait for the result.
+     * \param   cls       Priority class of the request.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t observe( const LWM2MResource* p_res, bool observe,
+        uint32_t timeout = LWM2M_REQUEST_TIMEOUT_DEFAULT,
+        e_lwm2m_request_class_t cls = e_lwm2m_request_class_interactive );
+
+
+    /**
+     * \brief   Discover the resources of an object instance.
+     *
+     *          Creates the resources of the object from a LWM2M Discover.
+     *          The result is cached by the type of the device and the
+     *          object ID. Objects of devices with the same type are
+     *          populated from the cache without a request. A discover
+     *          that is already running for the same type and object is
+     *          shared instead of sending another request. A discover
+     *          that is not answered in time keeps running for other
+     *          objects of the same type. A failed discover is cached as
+     *          well and fails without a request until its backoff
+     *          elapsed.
+     *
+     * \param   p_obj   The object to discover.
+     * \param   timeout Time in ms to wait for the result.
+     * \param   cls     Priority class of the request.
      *
      * \return  0 on success or negative value on error.
      */
-    int8_t observe( const LWM2MResource* p_res, bool observe );
+    int8_t discover( LWM2MObject* p_obj,
+        uint32_t timeout = LWM2M_REQUEST_TIMEOUT_DEFAULT,
+        e_lwm2m_request_class_t cls = e_lwm2m_request_class_interactive );
+
+
+    /**
+     * \brief   Cancel requests started with specific parameters.
+     *
+     *          Queued and outstanding requests that were started with
+     *          the parameters are removed. Their callbacks are called
+     *          with COAP_503_SERVICE_UNAVAILABLE before, afterwards the
+     *          parameters are no longer used by the server.
+     *
+     * \param   p_cbParams  Parameters of non-blocking requests.
+     *
+     * \return  Number of canceled requests or negative value on error.
+     */
+    int16_t cancel( const s_lwm2m_obsparams_t* p_cbParams );
+
+
+    /**
+     * \brief   Cancel all requests to a device.
+     *
+     *          Blocking calls waiting for the device return with an error.
+     *
+     * \param   p_dev   Device to cancel the requests for.
+     *
+     * \return  Number of canceled requests or negative value on error.
+     */
+    int16_t cancel( const LWM2MDevice* p_dev );
+
+
+    /**
+     * \brief   Clear the cached discover results.
+     *
+     *          Discover requests that are currently running are kept.
+     *          Failed discovers may be sent again right away.
+     */
+    void clearDiscoverCache( void );
 
 
     /**
@@ -355,194 +671,1238 @@ public:
     int8_t deregisterObserver( const LWM2MServerObserver* p_observer );
 
 
-protected:
-
     /**
-     * \brief   Get the device structure of a specific device.
+     * \brief   Register a loop observer.
      *
-     *          The LWM2M server class is a wrapper around the actual
-     *          LWM2M implementation. This function returns the original
-     *          structure of a LWM2M device from the LWM2M implementation
-     *          point f view.
+     *          A loop observer that is registered will be notified about
+     *          every iteration of the server loop exceeding the budget.
      *
-     * \return  Pointer to the device structure on success or NULL on error.
+     * \param   p_observer  Observer that shall be registered.
+     *
+     * \return  0 on success or negative value on error.
      */
-    lwm2m_client_t* getDevice( std::string client );
+    int8_t registerObserver( LWM2MLoopObserver* p_observer );
 
 
     /**
-     * \brief   Check if the resource has observers.
+     * \brief   Deregister a registered loop observer.
      *
-     * \return  True if the resource has observers of false otherwise.
+     * \param   p_observer  Observer that shall be deregistered.
+     *
+     * \return  0 on success or negative value on error.
      */
-    bool hasObserver( void ) const { return m_vectObs.size(); };
+    int8_t deregisterObserver( const LWM2MLoopObserver* p_observer );
 
 
     /**
-     * \brief   Notify all observers about a change in the resource.
+     * \brief   Start a firmware update.
      *
-     * \param   p_dev   Device the notification comes from.
-     * \param   ev      Type of notification.
+     *          The server delivers the image of the update to all of its
+     *          devices while it is running. The update must not be deleted
+     *          before it was stopped.
+     *
+     * \param   p_fw    Firmware update to start.
      *
      * \return  0 on success or negative value on error.
      */
-    int8_t notifyObservers( const s_lwm2m_serverobserver_event_param_t param,
-        e_lwm2m_serverobserver_event_t ev ) const;
+    int8_t startFirmwareUpdate( LWM2MFirmwareUpdate* p_fw );
 
 
-private:
+    /**
+     * \brief   Stop a firmware update.
+     *
+     *          Transfers that did not finish yet are abandoned.
+     *
+     * \param   p_fw    Firmware update to stop.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t stopFirmwareUpdate( LWM2MFirmwareUpdate* p_fw );
+
 
     /**
-     * \brief   Checks if the server is running.
+     * \brief   Get the progress of a firmware update for a device.
      *
-     *          This functions uses the internal variables such as the
-     *          socket and LWM2M context to check if the server is alive.
+     * \param   p_fw        Firmware update to query.
+     * \param   devName     Name of the device.
+     * \param   p_progress  Progress structure to fill.
      *
-     * \return  true if the server is alive.
+     * \return  0 on success or negative value on error.
      */
-    bool isAlive( void ) const {
-        return ( (m_sock != -1) && (mp_lwm2mH != NULL) );
-    };
+    int8_t getFirmwareProgress( const LWM2MFirmwareUpdate* p_fw,
+        const std::string& devName, s_lwm2m_fwupdate_progress_t* p_progress );
 
 
     /**
-     * \brief   Check events.
+     * \brief   Get the number of devices of a firmware update in a state.
      *
-     *          This functions checks for pending events.
+     * \param   p_fw    Firmware update to query.
+     * \param   state   State to count the devices for.
      *
+     * \return  Number of devices in the given state.
      */
-    void checkEvents( void );
+    uint32_t getFirmwareCount( const LWM2MFirmwareUpdate* p_fw,
+        e_lwm2m_fwupdate_state_t state );
 
 
     /**
-     * \brief   Check deleted devices.
+     * \brief   Start a bulk operation.
      *
-     *          This functions checks for deleted devices.
+     *          The devices of the operation are selected when it is
+     *          started. The server sends the requests of the operation
+     *          while it is running. An operation that is deleted while
+     *          it runs is stopped first.
+     *
+     * \param   p_op    Bulk operation to start.
      *
+     * \return  0 on success or negative value on error.
      */
-    void checkDeletedDevices( void );
+    int8_t startBulkOperation( LWM2MBulkOperation* p_op );
 
 
     /**
-     * \brief   Delete observe parameters for a specific device.
+     * \brief   Stop a bulk operation.
      *
-     * \param   p_dev   Device to delete observe parameters for
+     *          Requests waiting for their answer are canceled, requests
+     *          that were not sent yet are abandoned.
      *
+     * \param   p_op    Bulk operation to stop.
+     *
+     * \return  0 on success or negative value on error.
      */
-    void deletedObserveParams( LWM2MDevice* p_dev );
+    int8_t stopBulkOperation( LWM2MBulkOperation* p_op );
 
 
     /**
-     * \brief   Callback used to indicate if any action happened for a client.
+     * \brief   Get the statistics of a bulk operation.
      *
-     *          This function indicates several events e.g. if a new
-     *          device was registered or deregistered.
+     * \param   p_op    Bulk operation to query.
+     * \param   p_stats Statistics structure to fill.
      *
-     * \param   clientID    The internal device ID of the monitored event.
-     * \param   uriP        The URI the event belongs to.
-     * \param   status      Status of the event.
-     * \param   format      Format of the data included.
-     * \param   data        Data that was included in the event.
-     * \param   dataLength  Length of the data.
-     * \param   userData    User data pointer specified when the function was
-     *                      registered.
+     * \return  0 on success or negative value on error.
      */
-    static void monitorCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
-            lwm2m_media_type_t format, uint8_t * data, int dataLength,
-            void * userData );
+    int8_t getBulkStats( const LWM2MBulkOperation* p_op,
+        s_lwm2m_bulk_stats_t* p_stats );
 
 
     /**
-     * \brief   Callback used to indicate e.g result of read or write.
+     * \brief   Set the retransmission configuration.
      *
-     *          This function indicates several events e.g. the result of
-     *          a read write or when observing a value.
+     *          The timeouts of requests to the devices are estimated per
+     *          connection from the measured round trip times. Already
+     *          measured connections keep their estimates.
      *
-     * \param   clientID    The internal device ID of the monitored event.
-     * \param   uriP        The URI the event belongs to.
-     * \param   status      Status of the event.
-     * \param   format      Format of the data included.
-     * \param   data        Data that was included in the event.
-     * \param   dataLength  Length of the data.
-     * \param   userData    User data pointer specified when the function was
-     *                      registered.
+     * \param   p_cfg   Configuration to use.
+     *
+     * \return  0 on success or negative value on error.
      */
-    static void readWriteResCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
-            lwm2m_media_type_t format, uint8_t * data, int dataLength,
-            void * userData );
+    int8_t setRetransmissionConfig( const s_lwm2m_retrans_config_t* p_cfg );
 
 
+    /**
+     * \brief   Get the retransmission configuration.
+     *
+     * \param   p_cfg   Configuration structure to fill.
+     */
+    void getRetransmissionConfig( s_lwm2m_retrans_config_t* p_cfg ) const {
+        *p_cfg = m_retransCfg;
+    };
+
 
     /**
-     * \brief   Callback used to indicate e.g result of an observe.
+     * \brief   Get the round trip time statistics of a device.
      *
-     *          This function indicates several events e.g. the result of
-     *          a read write or when observing a value.
+     *          Devices without any request report the initial timeout.
      *
-     * \param   clientID    The internal device ID of the monitored event.
-     * \param   uriP        The URI the event belongs to.
-     * \param   status      Status of the event.
-     * \param   format      Format of the data included.
-     * \param   data        Data that was included in the event.
-     * \param   dataLength  Length of the data.
-     * \param   userData    User data pointer specified when the function was
-     *                      registered.
+     * \param   devName     Name of the device.
+     * \param   p_stats     Statistics structure to fill.
+     *
+     * \return  0 on success or negative value on error.
      */
-    static void notifyResCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
-            lwm2m_media_type_t format, uint8_t * data, int dataLength,
-            void * userData );
+    int8_t getRttStats( const std::string& devName,
+        s_lwm2m_rtt_stats_t* p_stats );
 
 
     /**
-     * \brief   Callback used to indicate e.g result of an observe.
+     * \brief   Set the request configuration.
      *
-     *          This function indicates several events e.g. the result of
-     *          a read write or when observing a value.
+     *          Requests to a device that already has the maximum number
+     *          of outstanding requests are queued and sent as soon as
+     *          one of the outstanding requests finished. Requests to
+     *          sleeping devices in queue mode are queued until the
+     *          device updates its registration. Requests to devices
+     *          whose circuit is open fail immediately.
      *
-     * \param   clientID    The internal device ID of the monitored event.
-     * \param   uriP        The URI the event belongs to.
-     * \param   status      Status of the event.
-     * \param   format      Format of the data included.
-     * \param   data        Data that was included in the event.
-     * \param   dataLength  Length of the data.
-     * \param   userData    User data pointer specified when the function was
-     *                      registered.
+     * \param   p_cfg   Configuration to use.
+     *
+     * \return  0 on success or negative value on error.
      */
-    static void notifyObjCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
-            lwm2m_media_type_t format, uint8_t * data, int dataLength,
-            void * userData );
+    int8_t setRequestConfig( const s_lwm2m_request_config_t* p_cfg );
+
 
-#ifdef OPCUA_LWM2M_SERVER_USE_THREAD
-
     /**
-     * \brief   Thread Function.
+     * \brief   Get the request configuration.
+     *
+     * \param   p_cfg   Configuration structure to fill.
      */
-    static void* threadEntryFunc( void* p_arg ) {
-        /* run the Server */
-        int ret = 0;
-        while( (p_arg != NULL) && (ret == 0))
-            ret = ((LWM2MServer*)p_arg)->runServer();
-        return NULL;
-    }
-#endif /* #ifdef OPCUA_LWM2M_SERVER_USE_THREAD */
+    void getRequestConfig( s_lwm2m_request_config_t* p_cfg ) const {
+        *p_cfg = m_reqCfg;
+    };
 
 
-private:
+    /**
+     * \brief   Get the request statistics of a device.
+     *
+     * \param   devName     Name of the device.
+     * \param   p_stats     Statistics structure to fill.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t getRequestStats( const std::string& devName,
+        s_lwm2m_request_stats_t* p_stats );
 
-    /* SIngleton instance */
-    static LWM2MServer* m_instance;
 
-    /** Socket descriptor used for the server connection */
-    int m_sock;
+    /**
+     * \brief   Add an observe subscription.
+     *
+     *          The resources of the subscription are observed on all
+     *          devices that have them, on registered devices as well as
+     *          on devices that register later on. The observations are
+     *          started with a random delay and limited in rate.
+     *
+     * \param   p_sub   Resources to observe.
+     *
+     * \return  ID of the subscription or negative value on error.
+     */
+    int16_t addSubscription( const s_lwm2m_subscription_t* p_sub );
 
-    /** port of the server data connection */
-    std::string m_port;
 
-    /** address family to use */
-    int m_addrFam;
+    /**
+     * \brief   Remove an observe subscription.
+     *
+     *          Observations that were started already are kept.
+     *
+     * \param   id      ID of the subscription.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t removeSubscription( int16_t id );
 
-    /** connection list */
-    connection_t* mp_connList;
+
+    /**
+     * \brief   Set the configuration of the subscriptions.
+     *
+     * \param   p_cfg   Configuration to use.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t setSubscriptionConfig( const s_lwm2m_subscription_config_t* p_cfg );
+
+
+    /**
+     * \brief   Get the configuration of the subscriptions.
+     *
+     * \param   p_cfg   Configuration structure to fill.
+     */
+    void getSubscriptionConfig( s_lwm2m_subscription_config_t* p_cfg ) const {
+        *p_cfg = m_subs.getConfig();
+    };
+
+
+    /**
+     * \brief   Get a snapshot of the metrics of the server.
+     *
+     *          Counters and histograms are read without blocking the
+     *          server, the gauges are taken while holding its lock.
+     *
+     * \param   p_metrics   Snapshot to fill.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t getMetrics( s_lwm2m_metrics_t* p_metrics );
+
+
+    /**
+     * \brief   Reset the counters and histograms of the metrics.
+     */
+    void resetMetrics( void ) {
+        m_metrics.reset();
+    };
+
+
+    /**
+     * \brief   Get the statistics of the sites taking the server lock.
+     *
+     *          The statistics are only available if the server is built
+     *          with OPCUA_LWM2M_SERVER_LOCK_STATS in threaded mode.
+     *
+     * \param   sites   List to append the sites to.
+     * \param   reset   True to reset the statistics afterwards.
+     *
+     * \return  0 on success or negative value if not available.
+     */
+    int8_t getLockStats( std::vector< s_lwm2m_lock_site_t >& sites,
+            bool reset = false );
+
+
+    /**
+     * \brief   Get the memory and objects used by a device.
+     *
+     * \param   devName     Name of the device.
+     * \param   p_usage     Usage structure to fill.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t getUsage( const std::string& devName, s_lwm2m_usage_t* p_usage );
+
+
+    /**
+     * \brief   Get the memory and objects used by all devices.
+     *
+     *          The total includes the devices that were deregistered
+     *          but are not deleted yet. Devices with pathological object
+     *          lists stand out when the devices are sorted by their total.
+     *
+     * \param   devices     Usage of the registered devices by name.
+     * \param   p_total     Usage of all devices.
+     *
+     * \return  Number of registered devices.
+     */
+    uint32_t getUsage( std::map< std::string, s_lwm2m_usage_t >& devices,
+            s_lwm2m_usage_t* p_total );
+
+
+    /**
+     * \brief   Set the configuration of the loop timing.
+     *
+     *          The kept iterations are cleared.
+     *
+     * \param   p_cfg   Configuration to use.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t setLoopConfig( const s_lwm2m_loop_config_t* p_cfg );
+
+
+    /**
+     * \brief   Get the configuration of the loop timing.
+     *
+     * \param   p_cfg   Configuration to fill.
+     */
+    void getLoopConfig( s_lwm2m_loop_config_t* p_cfg ) const {
+        *p_cfg = m_loopProf.getConfig();
+    };
+
+
+    /**
+     * \brief   Get the timing of the last iterations of the server loop.
+     *
+     * \param   samples List to append the iterations to, oldest first.
+     *
+     * \return  Number of iterations.
+     */
+    uint32_t getLoopHistory( std::vector< s_lwm2m_loop_sample_t >& samples );
+
+
+    /**
+     * \brief   Get the timing of the last slow iterations of the server
+     *          loop.
+     *
+     * \param   samples List to append the iterations to, oldest first.
+     *
+     * \return  Number of iterations.
+     */
+    uint32_t getSlowLoops( std::vector< s_lwm2m_loop_sample_t >& samples );
+
+
+    /**
+     * \brief   Get the time the server loop is busy with its current phase.
+     *
+     *          This does not take the lock and can be called by a
+     *          watchdog even if the server loop got stuck.
+     *
+     * \return  Time in us or 0 if the loop waits for packets.
+     */
+    uint64_t getLoopStall( void ) const {
+        return m_loopProf.getStall();
+    };
+
+
+    /**
+     * \brief   Enable or disable the request trace.
+     *
+     *          The trace is enabled by default.
+     */
+    void setTraceEnabled( bool enabled ) {
+        m_trace.setEnabled( enabled );
+    };
+
+
+    /**
+     * \brief   Get the records of the request trace.
+     *
+     *          This does not take the lock.
+     *
+     * \param   records List to append the records to, oldest first.
+     *
+     * \return  Number of records.
+     */
+    uint32_t getTrace( std::vector< s_lwm2m_trace_record_t >& records ) const {
+        return m_trace.getRecords( records );
+    };
+
+
+    /**
+     * \brief   Write a binary dump of the request trace.
+     *
+     *          This does not take the lock. The dump can be read
+     *          with LWM2MTrace::load().
+     *
+     * \param   fd  File descriptor to write to.
+     *
+     * \return  Number of records or negative value on error.
+     */
+    int32_t dumpTrace( int fd ) const {
+        return m_trace.dump( fd );
+    };
+
+
+    /**
+     * \brief   Dump the request trace when a signal is received.
+     *
+     * \param   signo   Signal, e.g. SIGUSR1.
+     * \param   p_path  File the dump is written to or NULL to restore
+     *                  the default handling of the signal.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t setTraceSignal( int signo, const char* p_path ) {
+        return LWM2MTrace::dumpOnSignal( (p_path != NULL) ? &m_trace : NULL,
+                signo, p_path );
+    };
+
+
+    /**
+     * \brief   Start to capture the traffic of the server.
+     *
+     *          All received datagrams and the requests sent to the
+     *          devices are written to the file with their time and
+     *          the address of the peer. A running capture is finished
+     *          first.
+     *
+     * \param   p_path  File to write the capture to.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t startCapture( const char* p_path );
+
+
+    /**
+     * \brief   Finish the capture of the traffic.
+     */
+    void stopCapture( void );
+
+
+#ifdef OPCUA_LWM2M_BENCHMARK
+    /**
+     * \brief   Add a device without a registration.
+     *
+     *          Test hook for tests and benchmarks that drive the paths of
+     *          notifications without a network. The hooks are only built
+     *          with OPCUA_LWM2M_BENCHMARK since they change the state of
+     *          the server without wakaama. The device is found like
+     *          a registered device but has no client in wakaama, so
+     *          requests to it fail. The caller keeps the device and
+     *          removes it with removeTestDevice() before deleting it.
+     *
+     * \param   p_dev   Device to add.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t addTestDevice( LWM2MDevice* p_dev );
+
+
+    /**
+     * \brief   Remove a device added with addTestDevice().
+     *
+     *          The observe parameters of the device are deleted.
+     *
+     * \param   p_dev   Device to remove.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t removeTestDevice( LWM2MDevice* p_dev );
+
+
+    /**
+     * \brief   Pass a notification of a resource to the server.
+     *
+     *          Test hook running the callback of an observation as if
+     *          wakaama had received the notification. The resource
+     *          observers and value observers of the resource are
+     *          notified. The observe parameters are created on first use.
+     *
+     * \param   p_res   Resource of a test device.
+     * \param   status  Status as passed by wakaama, i.e. 0 for the answer
+     *                  to the observe request and the notification counter
+     *                  afterwards.
+     * \param   format  Format of the payload.
+     * \param   p_buf   Payload of the notification.
+     * \param   len     Length of the payload.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t injectNotification( LWM2MResource* p_res, int status,
+            lwm2m_media_type_t format, uint8_t* p_buf, int len );
+
+
+    /**
+     * \brief   Pass a notification of an object to the server.
+     *
+     *          See injectNotification() of a resource.
+     *
+     * \param   p_obj   Object of a test device.
+     * \param   status  Status as passed by wakaama.
+     * \param   format  Format of the payload.
+     * \param   p_buf   Payload of the notification.
+     * \param   len     Length of the payload.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t injectNotification( LWM2MObject* p_obj, int status,
+            lwm2m_media_type_t format, uint8_t* p_buf, int len );
+#endif /* #ifdef OPCUA_LWM2M_BENCHMARK */
+
+
+protected:
+
+    /**
+     * \brief   Get the device structure of a specific device.
+     *
+     *          The LWM2M server class is a wrapper around the actual
+     *          LWM2M implementation. This function returns the original
+     *          structure of a LWM2M device from the LWM2M implementation
+     *          point f view.
+     *
+     * \return  Pointer to the device structure on success or NULL on error.
+     */
+    lwm2m_client_t* getDevice( std::string client );
+
+
+    /**
+     * \brief   Check if the resource has observers.
+     *
+     * \return  True if the resource has observers of false otherwise.
+     */
+    bool hasObserver( void ) const { return m_vectObs.size(); };
+
+
+    /**
+     * \brief   Notify all observers about a change in the resource.
+     *
+     * \param   p_dev   Device the notification comes from.
+     * \param   ev      Type of notification.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t notifyObservers( const s_lwm2m_serverobserver_event_param_t param,
+        e_lwm2m_serverobserver_event_t ev ) const;
+
+
+private:
+
+    /**
+     * \brief   Checks if the server is running.
+     *
+     *          This functions uses the internal variables such as the
+     *          socket and LWM2M context to check if the server is alive.
+     *
+     * \return  true if the server is alive.
+     */
+    bool isAlive( void ) const {
+        return ( (m_sock != -1) && (mp_lwm2mH != NULL) );
+    };
+
+
+    /**
+     * \brief   Check events.
+     *
+     *          This functions checks for pending events.
+     *
+     */
+    void checkEvents( void );
+
+
+    /**
+     * \brief   Check deleted devices.
+     *
+     *          This functions checks for deleted devices.
+     *
+     */
+    void checkDeletedDevices( void );
+
+
+    /**
+     * \brief   Delete observe parameters for a specific device.
+     *
+     * \param   p_dev   Device to delete observe parameters for
+     *
+     */
+    void deletedObserveParams( LWM2MDevice* p_dev );
+
+
+    /**
+     * \brief   Delete observe parameters for a specific object.
+     *
+     * \param   p_obj   Object to delete observe parameters for
+     *
+     */
+    void deletedObserveParams( LWM2MObject* p_obj );
+
+
+    /**
+     * \brief   Update the objects of a device from its registration.
+     *
+     *          Object instances the device no longer registers are removed
+     *          and kept until the device would have been deleted. New
+     *          object instances are added. All other objects and their
+     *          resources are kept.
+     *
+     * \param   p_dev   Device to update.
+     * \param   p_cli   Registration of the device.
+     * \param   p_param Event parameters to add the changes to or NULL.
+     *
+     * \return  Number of added and removed object instances.
+     */
+    int16_t reconcileDevice( LWM2MDevice* p_dev, lwm2m_client_t* p_cli,
+            s_lwm2m_serverobserver_event_param_t* p_param );
+
+
+    /**
+     * \brief   Check firmware updates.
+     *
+     *          This functions processes timeouts of the running firmware
+     *          updates and starts further transfers.
+     *
+     */
+    void checkFirmwareUpdates( void );
+
+
+    /**
+     * \brief   Pass a received packet to the running firmware updates.
+     *
+     * \param   p_session   Connection the packet was received on.
+     * \param   p_buf       Packet data.
+     * \param   len         Length of the packet.
+     *
+     * \return  true if the packet was consumed by a firmware update.
+     */
+    bool handleFirmwareUpdates( void* p_session, uint8_t* p_buf, int len );
+
+
+    /**
+     * \brief   Check bulk operations.
+     *
+     *          This functions sends further requests of the running bulk
+     *          operations.
+     */
+    void checkBulkOperations( void );
+
+
+    /**
+     * \brief   Schedule the subscribed observations of an object instance.
+     *
+     * \param   p_obj   Object instance of a device.
+     */
+    void applySubscriptions( LWM2MObject* p_obj );
+
+
+    /**
+     * \brief   Schedule the subscribed observations of a device.
+     *
+     * \param   p_dev   Device to schedule the observations for.
+     */
+    void applySubscriptions( LWM2MDevice* p_dev );
+
+
+    /**
+     * \brief   Start the scheduled observations that are due.
+     */
+    void checkSubscriptions( void );
+
+
+    /**
+     * \brief   Remember or forget an observation of a device.
+     *
+     *          Remembered observations are issued again after the
+     *          device registered again. They are forgotten when a
+     *          device that deregistered is deleted.
+     *
+     * \param   devName Name of the device.
+     * \param   p_uri   URI of the resource or object instance.
+     * \param   keep    True to remember the observation, false to
+     *                  forget it.
+     */
+    void keepObservation( const std::string& devName,
+        const lwm2m_uri_t* p_uri, bool keep );
+
+
+    /**
+     * \brief   Schedule the remembered observations of a device.
+     *
+     *          Observations covered by a subscription are left to
+     *          the subscription.
+     *
+     * \param   p_dev   Device that registered.
+     */
+    void restoreObservations( LWM2MDevice* p_dev );
+
+
+    /**
+     * \brief   Check if an observation is still wanted.
+     *
+     * \param   devName Name of the device.
+     * \param   p_uri   URI of the resource or object instance.
+     *
+     * \return  True if a subscription or a remembered observation
+     *          covers the URI.
+     */
+    bool isObserveWanted( const std::string& devName,
+        const lwm2m_uri_t* p_uri );
+
+
+    /**
+     * \brief   Get a resource to observe.
+     *
+     *          The resource is created if it was not discovered yet.
+     *
+     * \param   p_obj   Object of the resource.
+     * \param   resId   ID of the resource.
+     *
+     * \return  The resource.
+     */
+    static LWM2MResource* observedResource( LWM2MObject* p_obj,
+            uint16_t resId );
+
+
+    /**
+     * \brief   Start the observation of a resource without waiting.
+     *
+     *          The resource is created if it was not discovered yet.
+     *          An URI without a resource ID starts the observation of
+     *          the whole object instance.
+     *
+     * \param   devName Name of the device.
+     * \param   p_uri   URI of the resource or object instance.
+     * \param   cls     Priority class of the request.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t startObserve( const std::string& devName, const lwm2m_uri_t* p_uri,
+        e_lwm2m_request_class_t cls );
+
+
+    /**
+     * \brief   Check the retransmissions of pending requests.
+     *
+     *          New requests are picked up from the LWM2M context and
+     *          retransmitted with the timeout estimated for their
+     *          connection. Requests without an answer after the last
+     *          retransmission are handed back to the LWM2M context to fail.
+     *          Must be called after every new request.
+     *
+     * \return  Time in ms until the next retransmission is due.
+     */
+    uint32_t checkRetransmissions( void );
+
+
+    /**
+     * \brief   Measure the round trip time of an answered request.
+     *
+     * \param   p_session   Connection the packet was received on.
+     * \param   p_buf       Packet data.
+     * \param   len         Length of the packet.
+     */
+    void sampleRtt( void* p_session, const uint8_t* p_buf, int len );
+
+
+    /**
+     * \brief   Add a request sent to a device to the capture.
+     *
+     * \param   p_tr    Transaction of the request.
+     * \param   flags   Flags LWM2M_CAPTURE_FLAG_*.
+     */
+    void captureRequest( const lwm2m_transaction_t* p_tr, uint8_t flags );
+
+
+    /**
+     * \brief   Find a device by its internal ID.
+     *
+     * \param   clientID    Internal ID of the device.
+     *
+     * \return  Pointer to the device or NULL if not found.
+     */
+    LWM2MDevice* findDevice( uint16_t clientID );
+
+
+    /**
+     * \brief   Add an object instance to the object index.
+     *
+     * \param   p_obj   Object instance of a device.
+     */
+    void indexObject( LWM2MObject* p_obj );
+
+
+    /**
+     * \brief   Remove an object instance from the object index.
+     *
+     * \param   p_obj   Object instance of a device.
+     */
+    void unindexObject( LWM2MObject* p_obj );
+
+
+    /**
+     * \brief   Update the queue mode state of a device.
+     *
+     *          Called whenever the device registered or updated
+     *          its registration. Requests queued while the device
+     *          was sleeping are sent afterwards.
+     *
+     * \param   p_dev       Device that contacted the server.
+     * \param   p_cli       Registration of the device.
+     */
+    void wakeDevice( LWM2MDevice* p_dev, const lwm2m_client_t* p_cli );
+
+
+    /**
+     * \brief   Release the round trip time estimator of a connection.
+     *
+     *          The estimator is kept while a registered device uses
+     *          the connection.
+     *
+     * \param   p_session   Connection of the estimator.
+     */
+    void releasePeer( void* p_session );
+
+
+    /**
+     * \brief   Issue a request to a device.
+     *
+     *          The request is sent immediately if the device is awake
+     *          and has less outstanding requests than configured, no
+     *          request of the same or a more important class is queued
+     *          and the budget of the class is not used up. Otherwise it is queued and its callback is called with the
+     *          error if it can not be sent later on.
+     *
+     * \param   p_cli       Device to send the request to.
+     * \param   type        Type of the request.
+     * \param   p_uri       URI of the request.
+     * \param   format      Format of the payload.
+     * \param   p_buf       Payload of a write or execute or NULL.
+     * \param   len         Length of the payload.
+     * \param   cb          Callback of the request.
+     * \param   p_data      User data of the callback.
+     * \param   cls         Priority class of the request.
+     * \param   p_traceId   ID of the request to cancel it later or NULL.
+     *
+     * \return  COAP_NO_ERROR on success or CoAP error code.
+     */
+    int request( lwm2m_client_t* p_cli, e_lwm2m_request_type_t type,
+            lwm2m_uri_t* p_uri, lwm2m_media_type_t format,
+            const uint8_t* p_buf, size_t len, lwm2m_result_callback_t cb,
+            void* p_data, e_lwm2m_request_class_t cls,
+            uint32_t* p_traceId = NULL );
+
+
+    /**
+     * \brief   Send a request to a device.
+     *
+     * \param   clientID    Internal ID of the device.
+     * \param   req         Request to send.
+     *
+     * \return  COAP_NO_ERROR on success or CoAP error code.
+     */
+    int sendRequest( uint16_t clientID, s_lwm2m_request_t& req );
+
+
+    /**
+     * \brief   Cancel queued and outstanding requests.
+     *
+     * \param   p_cli       Device of the requests.
+     * \param   p_data      User data of the callbacks of the requests or
+     *                      NULL for all requests to the device.
+     * \param   traceId     ID of a single request or 0 for all requests
+     *                      with the user data.
+     *
+     * \return  Number of canceled requests.
+     */
+    int16_t cancelRequests( lwm2m_client_t* p_cli, const void* p_data,
+            uint32_t traceId = 0 );
+
+
+    /**
+     * \brief   Wait for the answer of a blocking request.
+     *
+     *          The server is run while waiting if it has no own thread.
+     *          The request is canceled if it was not answered in time.
+     *
+     * \param   p_status    Status the callback of the request sets.
+     * \param   pending     Status value while the request is pending.
+     * \param   p_data      User data of the callback of the request.
+     * \param   timeout     Time in ms to wait.
+     * \param   traceId     ID of the request if other requests use the
+     *                      same user data or 0.
+     *
+     * \return  0 if the request was answered or negative value on error.
+     */
+    int8_t waitRequest( const int* p_status, int pending, const void* p_data,
+            uint32_t timeout, uint32_t traceId = 0 );
+
+
+    /**
+     * \brief   Get the number of outstanding requests of a device.
+     *
+     * \param   p_cli       Device to check.
+     *
+     * \return  Number of requests not acknowledged yet.
+     */
+    uint32_t getInFlight( const lwm2m_client_t* p_cli ) const;
+
+
+    /**
+     * \brief   Get the number of outstanding requests of a class.
+     *
+     * \param   cls         Class of the requests.
+     *
+     * \return  Number of requests to all devices not acknowledged yet.
+     */
+    uint32_t getInFlight( e_lwm2m_request_class_t cls ) const;
+
+
+    /**
+     * \brief   Add the memory and objects used by a device.
+     *
+     * \param   p_dev       Device of the wrapper.
+     * \param   p_cli       Client of wakaama or NULL if the device is
+     *                      not registered anymore.
+     * \param   p_usage     Usage to add to.
+     */
+    void addUsage( LWM2MDevice* p_dev, const lwm2m_client_t* p_cli,
+            s_lwm2m_usage_t* p_usage ) const;
+
+
+    /**
+     * \brief   Check the request queues.
+     *
+     *          Sends queued requests to devices that have less outstanding
+     *          requests than configured. The classes are served in the
+     *          order of their importance as long as their budget allows.
+     *          Requests of devices that are no longer registered fail.
+     *          Only the devices with queued requests are looked at.
+     */
+    void checkRequestQueues( void );
+
+
+    /**
+     * \brief   Remove the request queue of a device.
+     *
+     *          The callbacks of the queued requests are called with
+     *          the status.
+     *
+     * \param   clientID    Internal ID of the device.
+     * \param   status      Status the queued requests fail with.
+     */
+    void dropRequestQueue( uint16_t clientID, int status );
+
+
+    /**
+     * \brief   Check if any resource of an object has observers.
+     *
+     * \param   p_obj       Object to check.
+     * \param   value       true to check for value observers and multiple
+     *                      instance resources, false to check for
+     *                      observers of the raw LWM2M data.
+     *
+     * \return  true if at least one resource has an observer.
+     */
+    static bool hasObserver( const LWM2MObject* p_obj, bool value );
+
+
+    /**
+     * \brief   Notify the value observers of an object or a resource.
+     *
+     *          The payload is decoded once and the decoded values are passed
+     *          to all value observers. Nothing is decoded if none of the
+     *          resources has value observers.
+     *
+     * \param   p_obj       Object the payload belongs to.
+     * \param   p_res       Resource the payload belongs to or NULL if the
+     *                      payload contains the whole object.
+     * \param   p_params    Parameters of the notification.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t notifyValueObservers( LWM2MObject* p_obj, LWM2MResource* p_res,
+            const s_lwm2m_obsparams_t* p_params );
+
+
+    /**
+     * \brief   Get the discover cache key of an object.
+     *
+     * \param   p_dev   Device the object belongs to.
+     * \param   objId   ID of the object.
+     *
+     * \return  Key of the cache entry.
+     */
+    static std::string discoverKey( const LWM2MDevice* p_dev, uint16_t objId );
+
+
+    /**
+     * \brief   Populate the objects of a device from the discover cache.
+     *
+     *          Objects without a cached discover result are kept
+     *          unchanged and discovered on their first access.
+     *
+     * \param   p_dev   Device to populate.
+     */
+    void applyDiscoverCache( LWM2MDevice* p_dev );
+
+
+    /**
+     * \brief   Send the discover of an object if it is not cached.
+     *
+     *          Does nothing if a discover of the same type and object is
+     *          cached or running already. A failed discover is sent again
+     *          after a backoff that doubles with every failure. Requires
+     *          the mutex.
+     *
+     * \param   p_obj   Object to discover.
+     * \param   cls     Priority class of the request.
+     *
+     * \return  0 on success or negative value on error or during the
+     *          backoff of a failed discover.
+     */
+    int8_t startDiscover( const LWM2MObject* p_obj,
+            e_lwm2m_request_class_t cls );
+
+
+    /**
+     * \brief   Discover an object automatically without waiting.
+     *
+     *          The object is populated from the cache or its discover is
+     *          started in the background if automatic discovery is
+     *          enabled in the request configuration. Called when the
+     *          device registers.
+     *
+     * \param   p_obj   Object to discover.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t autoDiscover( LWM2MObject* p_obj );
+
+
+    /**
+     * \brief   Cache the failure of a discover.
+     *
+     * \param   p_disc  Cache entry of the discover.
+     * \param   status  Error of the discover.
+     */
+    void failDiscover( s_discover_t* p_disc, int status );
+
+
+    /**
+     * \brief   Discover all undiscovered objects of a device automatically.
+     *
+     * \param   p_dev   Device to discover.
+     */
+    void autoDiscover( LWM2MDevice* p_dev );
+
+
+    /**
+     * \brief   Create the resources of an object from a discover result.
+     *
+     * \param   p_obj   Object to populate.
+     * \param   disc    Discover result.
+     */
+    static void populate( LWM2MObject* p_obj, const s_discover_t& disc );
+
+
+    /**
+     * \brief   Parse the link format of a discover result.
+     *
+     * \param   p_buf   Link format data.
+     * \param   len     Length of the data.
+     * \param   res     Vector the found resources are added to.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    static int8_t parseDiscover( const uint8_t* p_buf, size_t len,
+            std::vector< s_resDesc_t >& res );
+
+
+    /**
+     * \brief   Get an unused value decoder.
+     *
+     *          Every call must be followed by a call to releaseDecoder().
+     *
+     * \return  Reference to the decoder.
+     */
+    LWM2MValueDecoder& acquireDecoder( void );
+
+
+    /**
+     * \brief   Release the decoder acquired last.
+     */
+    void releaseDecoder( void );
+
+
+    /**
+     * \brief   Callback used to indicate if any action happened for a client.
+     *
+     *          This function indicates several events e.g. if a new
+     *          device was registered or deregistered.
+     *
+     * \param   clientID    The internal device ID of the monitored event.
+     * \param   uriP        The URI the event belongs to.
+     * \param   status      Status of the event.
+     * \param   format      Format of the data included.
+     * \param   data        Data that was included in the event.
+     * \param   dataLength  Length of the data.
+     * \param   userData    User data pointer specified when the function was
+     *                      registered.
+     */
+    static void monitorCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
+            lwm2m_media_type_t format, uint8_t * data, int dataLength,
+            void * userData );
+
+
+    /**
+     * \brief   Callback used to indicate e.g result of read or write.
+     *
+     *          This function indicates several events e.g. the result of
+     *          a read write or when observing a value.
+     *
+     * \param   clientID    The internal device ID of the monitored event.
+     * \param   uriP        The URI the event belongs to.
+     * \param   status      Status of the event.
+     * \param   format      Format of the data included.
+     * \param   data        Data that was included in the event.
+     * \param   dataLength  Length of the data.
+     * \param   userData    User data pointer specified when the function was
+     *                      registered.
+     */
+    static void readWriteResCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
+            lwm2m_media_type_t format, uint8_t * data, int dataLength,
+            void * userData );
+
+
+
+    /**
+     * \brief   Callback used to indicate the result of a discover.
+     *
+     * \param   clientID    The internal device ID of the monitored event.
+     * \param   uriP        The URI the event belongs to.
+     * \param   status      Status of the event.
+     * \param   format      Format of the data included.
+     * \param   data        Data that was included in the event.
+     * \param   dataLength  Length of the data.
+     * \param   userData    Cache entry of the discover.
+     */
+    static void discoverCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
+            lwm2m_media_type_t format, uint8_t * data, int dataLength,
+            void * userData );
+
+
+    /**
+     * \brief   Callback used to indicate the result of an instance read.
+     *
+     *          Only the requested resource instance is decoded from the
+     *          received resource.
+     *
+     * \param   clientID    The internal device ID of the monitored event.
+     * \param   uriP        The URI the event belongs to.
+     * \param   status      Status of the event.
+     * \param   format      Format of the data included.
+     * \param   data        Data that was included in the event.
+     * \param   dataLength  Length of the data.
+     * \param   userData    User data pointer specified when the function was
+     *                      registered.
+     */
+    static void readResInstCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
+            lwm2m_media_type_t format, uint8_t * data, int dataLength,
+            void * userData );
+
+
+    /**
+     * \brief   Callback used to indicate e.g result of an observe.
+     *
+     *          This function indicates several events e.g. the result of
+     *          a read write or when observing a value.
+     *
+     * \param   clientID    The internal device ID of the monitored event.
+     * \param   uriP        The URI the event belongs to.
+     * \param   status      Status of the event.
+     * \param   format      Format of the data included.
+     * \param   data        Data that was included in the event.
+     * \param   dataLength  Length of the data.
+     * \param   userData    User data pointer specified when the function was
+     *                      registered.
+     */
+    static void notifyResCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
+            lwm2m_media_type_t format, uint8_t * data, int dataLength,
+            void * userData );
+
+
+    /**
+     * \brief   Callback used to indicate e.g result of an observe.
+     *
+     *          This function indicates several events e.g. the result of
+     *          a read write or when observing a value.
+     *
+     * \param   clientID    The internal device ID of the monitored event.
+     * \param   uriP        The URI the event belongs to.
+     * \param   status      Status of the event.
+     * \param   format      Format of the data included.
+     * \param   data        Data that was included in the event.
+     * \param   dataLength  Length of the data.
+     * \param   userData    User data pointer specified when the function was
+     *                      registered.
+     */
+    static void notifyObjCb( uint16_t clientID, lwm2m_uri_t * uriP, int status,
+            lwm2m_media_type_t format, uint8_t * data, int dataLength,
+            void * userData );
+
+#ifdef OPCUA_LWM2M_SERVER_USE_THREAD
+
+    /**
+     * \brief   Thread Function.
+     */
+    static void* threadEntryFunc( void* p_arg ) {
+        /* run the Server */
+        int ret = 0;
+        while( (p_arg != NULL) && (ret == 0))
+            ret = ((LWM2MServer*)p_arg)->runServer();
+        return NULL;
+    }
+#endif /* #ifdef OPCUA_LWM2M_SERVER_USE_THREAD */
+
+
+private:
+
+    /* SIngleton instance */
+    static LWM2MServer* m_instance;
+
+    /** Socket descriptor used for the server connection */
+    int m_sock;
+
+    /** port of the server data connection */
+    std::string m_port;
+
+    /** address family to use */
+    int m_addrFam;
+
+    /** connection list */
+    connection_t* mp_connList;
 
     /** LWM2M context */
     lwm2m_context_t* mp_lwm2mH;
@@ -550,21 +1910,94 @@ private:
     /** LWM2M Devices associated to the server */
     std::map< std::string, LWM2MDevice* > m_devMap;
 
+    /** LWM2M Devices by their internal ID */
+    std::map< uint16_t, LWM2MDevice* > m_devIdMap;
+
+    /** Object instances of the devices by object ID and device */
+    std::map< uint16_t, std::map< LWM2MDevice*,
+        std::set< LWM2MObject* > > > m_objIdx;
+
     /** List of LWM2M Devices deleted by the server */
     std::list< s_devDel_t > m_devDel;
 
+    /** List of LWM2M Objects removed by device updates */
+    std::list< s_objDel_t > m_objDel;
+
     /** Device event queue */
     std::queue< s_devEvent_t > m_devEv;
 
     /** Vector of registered observer */
     std::vector< LWM2MServerObserver* > m_vectObs;
 
+    /** Vector of registered loop observer */
+    std::vector< LWM2MLoopObserver* > m_vectLoopObs;
+
     /** Map for resource observe callbacks */
     std::map< const LWM2MResource*, s_lwm2m_obsparams_t*> m_obsResMap;
 
     /** Map for object observe callbacks */
     std::map< const LWM2MObject*, s_lwm2m_obsparams_t*> m_obsObjMap;
 
+    /** Running firmware updates */
+    std::list< LWM2MFirmwareUpdate* > m_fwUpdates;
+
+    /** Running bulk operations */
+    std::list< LWM2MBulkOperation* > m_bulkOps;
+
+    /** Observe subscriptions and the observations scheduled */
+    LWM2MSubscriptions m_subs;
+
+    /** Observations started by the user or by bulk operations by device
+     *  name. They are kept when a device leaves to survive the rebuild
+     *  of its objects and forgotten with the deleted device. */
+    std::map< std::string, std::set< s_obsKey_t > > m_obsDurable;
+
+    /** Cached discover results by device type and object ID */
+    std::map< std::string, s_discover_t > m_discoverCache;
+
+    /** Value decoders, one per nested notification. A deque is used
+     *  so that decoders in use keep their address when a nested
+     *  notification adds a new one. */
+    std::deque< LWM2MValueDecoder > m_decoders;
+
+    /** Number of decoders currently in use */
+    size_t m_decodeDepth;
+
+    /** Retransmission configuration */
+    s_lwm2m_retrans_config_t m_retransCfg;
+
+    /** Retransmission state of the pending requests */
+    std::map< lwm2m_transaction_t*, s_retrans_t > m_retrans;
+
+    /** Round trip time estimators by connection */
+    std::map< void*, LWM2MRttEstimator > m_peers;
+
+    /** Request configuration */
+    s_lwm2m_request_config_t m_reqCfg;
+
+    /** Request queues by internal device ID */
+    std::map< uint16_t, LWM2MRequestQueue > m_reqQueues;
+
+    /** Internal IDs of the devices with queued requests */
+    std::set< uint16_t > m_reqPending;
+
+    /** Metrics of the server */
+    LWM2MMetrics m_metrics;
+
+    /** Timing of the server loop */
+    LWM2MLoopProfiler m_loopProf;
+
+    /** Lifecycle trace of the requests */
+    LWM2MTrace m_trace;
+
+    /** Capture of the traffic */
+    LWM2MCapture m_capture;
+
+    /** Statistics of the mutex, only updated if the server is built
+     *  with OPCUA_LWM2M_SERVER_LOCK_STATS. The member is kept in any
+     *  case so that the layout of the class does not depend on it. */
+    LWM2MLockStats m_lockStats;
+
 #ifdef OPCUA_LWM2M_SERVER_USE_THREAD
     /** Mutex for Thread safe execution */
     pthread_mutex_t m_mutex;
@@ -65,6 +65,13 @@
 class LWM2MDevice;
 
 
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Maximum number of added or removed object instances of an update */
+#define LWM2M_SERVEROBSERVER_DELTA_MAX          16
+
 /*
  * --- Type Definitions ----------------------------------------------------- *
  */
@@ -86,6 +93,20 @@ typedef enum
 } e_lwm2m_serverobserver_event_t;
 
 
+/**
+ * \brief    Object instance of an update.
+ */
+typedef struct
+{
+  /* ID of the object */
+  uint16_t objId;
+
+  /* ID of the instance */
+  uint16_t instId;
+
+} s_lwm2m_serverobserver_objinst_t;
+
+
 /**
  * \brief    Parameters used for notifications.
  */
@@ -94,6 +115,23 @@ typedef struct
   /* Name of the device */
   char devName[100];
 
+  /* Number of object instances added by an update */
+  uint8_t addedCnt;
+
+  /* Object instances added by an update */
+  s_lwm2m_serverobserver_objinst_t added[LWM2M_SERVEROBSERVER_DELTA_MAX];
+
+  /* Number of object instances removed by an update */
+  uint8_t removedCnt;
+
+  /* Object instances removed by an update. The objects are kept by the
+   * server until the device would have been deleted. */
+  s_lwm2m_serverobserver_objinst_t removed[LWM2M_SERVEROBSERVER_DELTA_MAX];
+
+  /* More object instances changed than listed. All objects of the
+   * device have to be checked. */
+  bool deltaOverflow;
+
 } s_lwm2m_serverobserver_event_param_t;
 
 
@@ -0,0 +1,197 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+
+/**
+ * \file    LWM2MSubscriptions.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of observe subscriptions applied to all devices.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include "LWM2MSubscriptions.h"
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSubscriptions::LWM2MSubscriptions()
+*/
+LWM2MSubscriptions::LWM2MSubscriptions( void )
+    : m_nextId( 0 )
+    , m_refilled( 0 )
+{
+    m_cfg.jitter = LWM2M_SUBSCRIPTION_JITTER;
+    m_cfg.rate = LWM2M_SUBSCRIPTION_RATE;
+    m_cfg.burst = LWM2M_SUBSCRIPTION_BURST;
+    m_tokens = (uint64_t)m_cfg.burst * 1000;
+
+} /* LWM2MSubscriptions::LWM2MSubscriptions() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSubscriptions::setConfig()
+*/
+void LWM2MSubscriptions::setConfig( const s_lwm2m_subscription_config_t& cfg )
+{
+    m_cfg = cfg;
+    if( m_cfg.burst == 0 )
+        m_cfg.burst = 1;
+
+    if( m_tokens > (uint64_t)m_cfg.burst * 1000 )
+        m_tokens = (uint64_t)m_cfg.burst * 1000;
+
+} /* LWM2MSubscriptions::setConfig() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSubscriptions::add()
+*/
+int16_t LWM2MSubscriptions::add( const s_lwm2m_subscription_t& sub )
+{
+    int16_t id;
+
+    if( m_nextId < 0 )
+        return -1;
+
+    id = m_nextId++;
+    m_subs[id] = sub;
+    return id;
+
+} /* LWM2MSubscriptions::add() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSubscriptions::remove()
+*/
+int8_t LWM2MSubscriptions::remove( int16_t id )
+{
+    if( m_subs.erase( id ) == 0 )
+        return -1;
+
+    return 0;
+
+} /* LWM2MSubscriptions::remove() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSubscriptions::getResources()
+*/
+void LWM2MSubscriptions::getResources( uint16_t objId, uint16_t instId,
+        std::vector< uint16_t >& resIds ) const
+{
+    std::map< int16_t, s_lwm2m_subscription_t >::const_iterator it;
+
+    for( it = m_subs.begin(); it != m_subs.end(); ++it )
+    {
+        if( (it->second.objId == objId) &&
+            ((it->second.instId == LWM2M_SUBSCRIPTION_ALL_INSTANCES) ||
+             (it->second.instId == instId)) )
+            resIds.push_back( it->second.resId );
+    }
+
+} /* LWM2MSubscriptions::getResources() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSubscriptions::schedule()
+*/
+void LWM2MSubscriptions::schedule( const std::string& devName,
+        const lwm2m_uri_t& uri, uint64_t now )
+{
+    s_job_t job;
+    uint64_t due = now;
+
+    /* spread the observations of devices registering at once */
+    if( m_cfg.jitter != 0 )
+        due += (uint64_t)rand() % (m_cfg.jitter + 1);
+
+    job.devName = devName;
+    job.uri = uri;
+    m_jobs.insert( std::make_pair( due, job ) );
+
+} /* LWM2MSubscriptions::schedule() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MSubscriptions::next()
+*/
+bool LWM2MSubscriptions::next( uint64_t now, std::string& devName,
+        lwm2m_uri_t& uri )
+{
+    std::multimap< uint64_t, s_job_t >::iterator it = m_jobs.begin();
+
+    if( m_cfg.rate != 0 )
+    {
+        /* refill the bucket, one token per 1000 / rate ms */
+        uint64_t max = (uint64_t)m_cfg.burst * 1000;
+        if( now > m_refilled )
+            m_tokens += (now - m_refilled) * m_cfg.rate;
+        if( m_tokens > max )
+            m_tokens = max;
+        m_refilled = now;
+    }
+
+    if( (it == m_jobs.end()) || (it->first > now) )
+        return false;
+
+    if( m_cfg.rate != 0 )
+    {
+        if( m_tokens < 1000 )
+            return false;
+        m_tokens -= 1000;
+    }
+
+    devName = it->second.devName;
+    uri = it->second.uri;
+    m_jobs.erase( it );
+    return true;
+
+} /* LWM2MSubscriptions::next() */
@@ -0,0 +1,263 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+
+/**
+ * \file    LWM2MSubscriptions.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of observe subscriptions applied to all devices.
+ *
+ */
+
+
+#ifndef __LWM2MSUBSCRIPTIONS_H__
+#define __LWM2MSUBSCRIPTIONS_H__
+#ifndef __DECL_LWM2MSUBSCRIPTIONS_H__
+#define __DECL_LWM2MSUBSCRIPTIONS_H__ extern
+#endif /* #ifndef __DECL_LWM2MSUBSCRIPTIONS_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+#include "liblwm2m.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Instance ID that matches all instances of an object */
+#define LWM2M_SUBSCRIPTION_ALL_INSTANCES        LWM2M_MAX_ID
+
+/** Default maximum delay in ms of an observation after a registration */
+#define LWM2M_SUBSCRIPTION_JITTER               5000
+
+/** Default number of observations started per second */
+#define LWM2M_SUBSCRIPTION_RATE                 20
+
+/** Default number of observations started at once */
+#define LWM2M_SUBSCRIPTION_BURST                10
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Resources a subscription observes.
+ */
+typedef struct
+{
+    /** ID of the object */
+    uint16_t objId;
+
+    /** ID of the instance or LWM2M_SUBSCRIPTION_ALL_INSTANCES */
+    uint16_t instId;
+
+    /** ID of the resource */
+    uint16_t resId;
+
+} s_lwm2m_subscription_t;
+
+
+/**
+ * \brief   Configuration of the subscriptions.
+ */
+typedef struct
+{
+    /** Maximum random delay in ms of an observation after the device
+     *  registered */
+    uint32_t jitter;
+
+    /** Number of observations started per second, 0 for no limit */
+    uint16_t rate;
+
+    /** Number of observations that may be started at once */
+    uint16_t burst;
+
+} s_lwm2m_subscription_config_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MSubscriptions Class.
+ *
+ *          Subscriptions describe resources that are observed on every
+ *          device that has them. The observations of a device are
+ *          scheduled when it registers. Each one is delayed by a random
+ *          jitter and a token bucket limits the number of observations
+ *          started per second, so that many devices registering at the
+ *          same time do not lead to a burst of requests.
+ */
+class LWM2MSubscriptions
+{
+
+public:
+
+    /**
+     * \brief   Default constructor to create the subscriptions.
+     */
+    LWM2MSubscriptions( void );
+
+
+    /**
+     * \brief   Default destructor of the subscriptions.
+     */
+    virtual ~LWM2MSubscriptions( void ) {};
+
+
+    /**
+     * \brief   Set the configuration.
+     *
+     * \param   cfg     Configuration to use.
+     */
+    void setConfig( const s_lwm2m_subscription_config_t& cfg );
+
+
+    /**
+     * \brief   Get the configuration.
+     *
+     * \return  The configuration in use.
+     */
+    const s_lwm2m_subscription_config_t& getConfig( void ) const {
+        return m_cfg;
+    };
+
+
+    /**
+     * \brief   Add a subscription.
+     *
+     * \param   sub     Resources to observe.
+     *
+     * \return  ID of the subscription or negative value on error.
+     */
+    int16_t add( const s_lwm2m_subscription_t& sub );
+
+
+    /**
+     * \brief   Remove a subscription.
+     *
+     * \param   id      ID of the subscription.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t remove( int16_t id );
+
+
+    /**
+     * \brief   Get the subscribed resources of an object instance.
+     *
+     * \param   objId   ID of the object.
+     * \param   instId  ID of the instance.
+     * \param   resIds  List to append the IDs of the resources to.
+     */
+    void getResources( uint16_t objId, uint16_t instId,
+            std::vector< uint16_t >& resIds ) const;
+
+
+    /**
+     * \brief   Schedule an observation.
+     *
+     * \param   devName Name of the device.
+     * \param   uri     URI of the resource.
+     * \param   now     Current time in ms.
+     */
+    void schedule( const std::string& devName, const lwm2m_uri_t& uri,
+            uint64_t now );
+
+
+    /**
+     * \brief   Take the next observation to start.
+     *
+     * \param   now     Current time in ms.
+     * \param   devName Name of the device to write to.
+     * \param   uri     URI of the resource to write to.
+     *
+     * \return  true if an observation is due and allowed by the rate.
+     */
+    bool next( uint64_t now, std::string& devName, lwm2m_uri_t& uri );
+
+
+    /**
+     * \brief   Get the number of scheduled observations.
+     *
+     * \return  Number of observations not started yet.
+     */
+    size_t pending( void ) const {return m_jobs.size();}
+
+
+private:
+
+    /**
+     * Scheduled observation.
+     */
+    struct s_job_t
+    {
+        /* name of the device */
+        std::string devName;
+        /* URI of the resource */
+        lwm2m_uri_t uri;
+    };
+
+
+private:
+
+    /** Configuration */
+    s_lwm2m_subscription_config_t m_cfg;
+
+    /** Subscriptions by ID */
+    std::map< int16_t, s_lwm2m_subscription_t > m_subs;
+
+    /** ID of the next subscription */
+    int16_t m_nextId;
+
+    /** Scheduled observations by the time in ms they are due */
+    std::multimap< uint64_t, s_job_t > m_jobs;
+
+    /** Observations that may be started, scaled by 1000 */
+    uint64_t m_tokens;
+
+    /** Time in ms the tokens were refilled */
+    uint64_t m_refilled;
+};
+
+#endif /* #ifndef __LWM2MSUBSCRIPTIONS_H__ */
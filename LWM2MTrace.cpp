@@ -0,0 +1,501 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MTrace.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of the request trace of the LWM2M server.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "LWM2MTrace.h"
+#include "LWM2MMetrics.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Number of records written at once by a dump */
+#define LWM2M_TRACE_DUMP_CHUNK                  32
+
+/*
+ * --- Local Variables ------------------------------------------------------ *
+ */
+
+/** Names of the events */
+static const char* const gEventNames[e_lwm2m_trace_max] =
+{
+    "call",
+    "enqueue",
+    "reject",
+    "send",
+    "retransmit",
+    "timeout",
+    "receive",
+    "handled",
+    "notify",
+};
+
+/** Traces dumped by signal */
+static std::atomic< const LWM2MTrace* > gSigTrace[NSIG];
+
+/** Files the traces are dumped to by signal */
+static char gSigPath[NSIG][LWM2M_TRACE_PATH_MAX];
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_write()
+*/
+static int8_t prv_write( int fd, const void* p_buf, size_t len )
+{
+    const uint8_t* p = (const uint8_t*)p_buf;
+    ssize_t ret;
+
+    while( len > 0 )
+    {
+        ret = write( fd, p, len );
+        if( ret <= 0 )
+            return -1;
+        p += ret;
+        len -= ret;
+    }
+    return 0;
+
+} /* prv_write() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_read()
+*/
+static int8_t prv_read( int fd, void* p_buf, size_t len )
+{
+    uint8_t* p = (uint8_t*)p_buf;
+    ssize_t ret;
+
+    while( len > 0 )
+    {
+        ret = read( fd, p, len );
+        if( ret <= 0 )
+            return -1;
+        p += ret;
+        len -= ret;
+    }
+    return 0;
+
+} /* prv_read() */
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::LWM2MTrace()
+*/
+LWM2MTrace::LWM2MTrace( uint32_t size )
+    : m_head( 0 )
+    , m_nextId( 1 )
+    , m_enabled( true )
+{
+    uint64_t cnt = 1;
+    uint64_t i;
+
+    while( cnt < size )
+        cnt <<= 1;
+
+    mp_slots = new s_slot_t[cnt];
+    m_mask = cnt - 1;
+
+    for( i = 0; i < cnt; i++ )
+        mp_slots[i].seq.store( 0, std::memory_order_relaxed );
+
+} /* LWM2MTrace::LWM2MTrace() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::~LWM2MTrace()
+*/
+LWM2MTrace::~LWM2MTrace( void )
+{
+    int signo;
+
+    /* a signal must not dump a deleted trace */
+    for( signo = 1; signo < NSIG; signo++ )
+    {
+        if( gSigTrace[signo].load() == this )
+            dumpOnSignal( NULL, signo, NULL );
+    }
+
+    delete[] mp_slots;
+
+} /* LWM2MTrace::~LWM2MTrace() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::add()
+*/
+void LWM2MTrace::add( e_lwm2m_trace_event_t event, uint32_t id,
+        uint16_t clientID, const lwm2m_uri_t* p_uri, uint32_t value )
+{
+    s_lwm2m_trace_record_t rec;
+
+    if( !isEnabled() )
+        return;
+
+    memset( &rec, 0, sizeof(rec) );
+    rec.event = event;
+    rec.id = id;
+    rec.clientID = clientID;
+    rec.value = value;
+    rec.objId = LWM2M_MAX_ID;
+    rec.instId = LWM2M_MAX_ID;
+    rec.resId = LWM2M_MAX_ID;
+
+    if( p_uri != NULL )
+    {
+        if( p_uri->flag & LWM2M_URI_FLAG_OBJECT_ID )
+            rec.objId = p_uri->objectId;
+        if( p_uri->flag & LWM2M_URI_FLAG_INSTANCE_ID )
+            rec.instId = p_uri->instanceId;
+        if( p_uri->flag & LWM2M_URI_FLAG_RESOURCE_ID )
+            rec.resId = p_uri->resourceId;
+    }
+
+    push( rec );
+
+} /* LWM2MTrace::add() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::addPacket()
+*/
+void LWM2MTrace::addPacket( e_lwm2m_trace_event_t event, uint32_t id,
+        uint16_t clientID, const uint8_t* p_buf, size_t len,
+        uint32_t duration )
+{
+    s_lwm2m_trace_record_t rec;
+
+    if( !isEnabled() )
+        return;
+
+    memset( &rec, 0, sizeof(rec) );
+    rec.event = event;
+    rec.id = id;
+    rec.clientID = clientID;
+    rec.value = len;
+    rec.duration = duration;
+    rec.objId = LWM2M_MAX_ID;
+    rec.instId = LWM2M_MAX_ID;
+    rec.resId = LWM2M_MAX_ID;
+
+    /* version, type and token length, code, message ID and token */
+    if( (p_buf != NULL) && (len >= 4) )
+    {
+        rec.code = p_buf[1];
+        rec.mID = ((uint16_t)p_buf[2] << 8) | p_buf[3];
+        rec.tokenLen = p_buf[0] & 0x0F;
+        if( (rec.tokenLen > sizeof(rec.token)) || (len < 4u + rec.tokenLen) )
+            rec.tokenLen = 0;
+        memcpy( rec.token, p_buf + 4, rec.tokenLen );
+    }
+
+    push( rec );
+
+} /* LWM2MTrace::addPacket() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::getRecords()
+*/
+uint32_t LWM2MTrace::getRecords(
+        std::vector< s_lwm2m_trace_record_t >& records ) const
+{
+    uint64_t head = m_head.load( std::memory_order_acquire );
+    uint64_t pos = (head > m_mask) ? (head - m_mask - 1) : 0;
+    s_lwm2m_trace_record_t rec;
+    uint32_t cnt = 0;
+
+    for( ; pos < head; pos++ )
+    {
+        if( read( pos, &rec ) )
+        {
+            records.push_back( rec );
+            cnt++;
+        }
+    }
+    return cnt;
+
+} /* LWM2MTrace::getRecords() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::dump()
+*/
+int32_t LWM2MTrace::dump( int fd ) const
+{
+    s_lwm2m_trace_header_t hdr;
+    s_lwm2m_trace_record_t recs[LWM2M_TRACE_DUMP_CHUNK];
+    uint64_t head = m_head.load( std::memory_order_acquire );
+    uint64_t first = (head > m_mask) ? (head - m_mask - 1) : 0;
+    uint64_t pos;
+    uint32_t cnt = 0;
+    uint32_t n = 0;
+
+    /* the header is written before the records are copied, records
+     * overwritten meanwhile are written with an invalid event */
+    memset( &hdr, 0, sizeof(hdr) );
+    hdr.magic = LWM2M_TRACE_MAGIC;
+    hdr.version = LWM2M_TRACE_VERSION;
+    hdr.recordSize = sizeof(s_lwm2m_trace_record_t);
+    hdr.count = head - first;
+    hdr.lost = first;
+    hdr.time = LWM2MMetrics::now();
+
+    if( prv_write( fd, &hdr, sizeof(hdr) ) != 0 )
+        return -1;
+
+    for( pos = first; pos < head; pos++ )
+    {
+        if( !read( pos, &recs[n] ) )
+        {
+            memset( &recs[n], 0, sizeof(recs[n]) );
+            recs[n].event = e_lwm2m_trace_max;
+        }
+        else
+            cnt++;
+
+        if( ++n == LWM2M_TRACE_DUMP_CHUNK )
+        {
+            if( prv_write( fd, recs, n * sizeof(recs[0]) ) != 0 )
+                return -1;
+            n = 0;
+        }
+    }
+
+    if( (n > 0) && (prv_write( fd, recs, n * sizeof(recs[0]) ) != 0) )
+        return -1;
+
+    return cnt;
+
+} /* LWM2MTrace::dump() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::load()
+*/
+int32_t LWM2MTrace::load( int fd,
+        std::vector< s_lwm2m_trace_record_t >& records )
+{
+    s_lwm2m_trace_header_t hdr;
+    s_lwm2m_trace_record_t rec;
+    uint32_t cnt = 0;
+    uint32_t i;
+
+    if( prv_read( fd, &hdr, sizeof(hdr) ) != 0 )
+        return -1;
+
+    if( (hdr.magic != LWM2M_TRACE_MAGIC) ||
+        (hdr.version != LWM2M_TRACE_VERSION) ||
+        (hdr.recordSize != sizeof(s_lwm2m_trace_record_t)) )
+        return -1;
+
+    for( i = 0; i < hdr.count; i++ )
+    {
+        if( prv_read( fd, &rec, sizeof(rec) ) != 0 )
+            return -1;
+
+        /* skip the records overwritten while dumping */
+        if( rec.event >= e_lwm2m_trace_max )
+            continue;
+
+        records.push_back( rec );
+        cnt++;
+    }
+    return cnt;
+
+} /* LWM2MTrace::load() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::dumpOnSignal()
+*/
+int8_t LWM2MTrace::dumpOnSignal( const LWM2MTrace* p_trace, int signo,
+        const char* p_path )
+{
+    struct sigaction sa;
+
+    if( (signo <= 0) || (signo >= NSIG) )
+        return -1;
+
+    memset( &sa, 0, sizeof(sa) );
+    sigemptyset( &sa.sa_mask );
+
+    if( p_trace == NULL )
+    {
+        sa.sa_handler = SIG_DFL;
+        if( sigaction( signo, &sa, NULL ) != 0 )
+            return -1;
+        gSigTrace[signo].store( NULL );
+        return 0;
+    }
+
+    if( (p_path == NULL) || (strlen( p_path ) >= LWM2M_TRACE_PATH_MAX) )
+        return -1;
+
+    /* the handler must not see a path that is changed */
+    gSigTrace[signo].store( NULL );
+    strcpy( gSigPath[signo], p_path );
+    gSigTrace[signo].store( p_trace );
+
+    sa.sa_handler = signalHandler;
+    sa.sa_flags = SA_RESTART;
+    if( sigaction( signo, &sa, NULL ) != 0 )
+    {
+        gSigTrace[signo].store( NULL );
+        return -1;
+    }
+    return 0;
+
+} /* LWM2MTrace::dumpOnSignal() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::getEventName()
+*/
+const char* LWM2MTrace::getEventName( e_lwm2m_trace_event_t event )
+{
+    if( event >= e_lwm2m_trace_max )
+        return "";
+
+    return gEventNames[event];
+
+} /* LWM2MTrace::getEventName() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::push()
+*/
+void LWM2MTrace::push( const s_lwm2m_trace_record_t& rec )
+{
+    uint64_t pos = m_head.fetch_add( 1, std::memory_order_relaxed );
+    s_slot_t& slot = mp_slots[pos & m_mask];
+
+    /* readers skip the slot while it is written */
+    slot.seq.store( 0, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    slot.rec = rec;
+    slot.rec.time = LWM2MMetrics::now();
+
+    slot.seq.store( pos + 1, std::memory_order_release );
+
+} /* LWM2MTrace::push() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::read()
+*/
+bool LWM2MTrace::read( uint64_t pos, s_lwm2m_trace_record_t* p_rec ) const
+{
+    const s_slot_t& slot = mp_slots[pos & m_mask];
+    uint64_t seq;
+
+    seq = slot.seq.load( std::memory_order_acquire );
+    if( seq != pos + 1 )
+        return false;
+
+    *p_rec = slot.rec;
+
+    /* the record is valid if it was not overwritten while copying */
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return slot.seq.load( std::memory_order_relaxed ) == seq;
+
+} /* LWM2MTrace::read() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MTrace::signalHandler()
+*/
+void LWM2MTrace::signalHandler( int signo )
+{
+    const LWM2MTrace* p_trace;
+    int errnoSave = errno;
+    int fd;
+
+    if( (signo <= 0) || (signo >= NSIG) )
+        return;
+
+    p_trace = gSigTrace[signo].load();
+    if( p_trace != NULL )
+    {
+        fd = open( gSigPath[signo], O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+        if( fd >= 0 )
+        {
+            p_trace->dump( fd );
+            close( fd );
+        }
+    }
+
+    errno = errnoSave;
+
+} /* LWM2MTrace::signalHandler() */
+
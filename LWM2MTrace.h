@@ -0,0 +1,365 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MTrace.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of the request trace of the LWM2M server.
+ *
+ */
+
+
+#ifndef __LWM2MTRACE_H__
+#define __LWM2MTRACE_H__
+#ifndef __DECL_LWM2MTRACE_H__
+#define __DECL_LWM2MTRACE_H__ extern
+#endif /* #ifndef __DECL_LWM2MTRACE_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include "liblwm2m.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Default number of records of the trace, rounded up to a power of two */
+#define LWM2M_TRACE_SIZE                        4096
+
+/** Magic number at the start of a dump ("LWTR") */
+#define LWM2M_TRACE_MAGIC                       0x5254574C
+
+/** Version of the format of a dump */
+#define LWM2M_TRACE_VERSION                     1
+
+/** Maximum length of the path a dump is written to on a signal */
+#define LWM2M_TRACE_PATH_MAX                    256
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Events of the lifecycle of a request.
+ */
+typedef enum
+{
+    /** Request was made, value is the request type */
+    e_lwm2m_trace_call,
+    /** Request was queued, value is the number of queued requests */
+    e_lwm2m_trace_enqueue,
+    /** Request failed before it was sent, value is the status */
+    e_lwm2m_trace_reject,
+    /** First transmission of a request, value is the length */
+    e_lwm2m_trace_send,
+    /** Retransmission of a request, value is the length */
+    e_lwm2m_trace_retransmit,
+    /** Request exceeded its retransmissions, value is the length */
+    e_lwm2m_trace_timeout,
+    /** Packet was received, value is the length */
+    e_lwm2m_trace_receive,
+    /** Received packet was parsed and dispatched, value is the length */
+    e_lwm2m_trace_handled,
+    /** Answer or notification was passed to the observers, value is the
+     *  status */
+    e_lwm2m_trace_notify,
+
+    e_lwm2m_trace_max
+
+} e_lwm2m_trace_event_t;
+
+
+/**
+ * \brief   Record of the trace.
+ *
+ *          The layout is the binary format of a dump. Records of the
+ *          same request have the same ID, the packets of a request
+ *          can be correlated by the token.
+ */
+typedef struct
+{
+    /** Monotonic time in us */
+    uint64_t time;
+    /** ID of the request or 0 if not known */
+    uint32_t id;
+    /** Value depending on the event */
+    uint32_t value;
+    /** Duration in us of the event or 0 */
+    uint32_t duration;
+    /** Internal ID of the device or LWM2M_MAX_ID if not known */
+    uint16_t clientID;
+    /** CoAP message ID of a packet */
+    uint16_t mID;
+    /** Object ID or LWM2M_MAX_ID */
+    uint16_t objId;
+    /** Instance ID or LWM2M_MAX_ID */
+    uint16_t instId;
+    /** Resource ID or LWM2M_MAX_ID */
+    uint16_t resId;
+    /** Event of type e_lwm2m_trace_event_t */
+    uint8_t event;
+    /** CoAP code of a packet */
+    uint8_t code;
+    /** Length of the token */
+    uint8_t tokenLen;
+    /** CoAP token of a packet */
+    uint8_t token[8];
+    /** Reserved */
+    uint8_t reserved[7];
+
+} s_lwm2m_trace_record_t;
+
+
+/**
+ * \brief   Header of a dump.
+ *
+ *          A dump consists of the header followed by the records,
+ *          oldest first.
+ */
+typedef struct
+{
+    /** LWM2M_TRACE_MAGIC */
+    uint32_t magic;
+    /** LWM2M_TRACE_VERSION */
+    uint16_t version;
+    /** Size of a record */
+    uint16_t recordSize;
+    /** Number of records */
+    uint32_t count;
+    /** Number of records overwritten before the dump */
+    uint32_t lost;
+    /** Monotonic time in us of the dump */
+    uint64_t time;
+
+} s_lwm2m_trace_header_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MTrace Class.
+ *
+ *          The trace records the lifecycle of the requests of the server
+ *          in a ring buffer of fixed size. Records are added without
+ *          locking and the oldest records are overwritten. Reading and
+ *          dumping the trace does not block writers and is safe within
+ *          a signal handler.
+ */
+class LWM2MTrace
+{
+
+public:
+
+    /**
+     * \brief   Constructor.
+     *
+     * \param   size    Number of records, rounded up to a power of two.
+     */
+    LWM2MTrace( uint32_t size = LWM2M_TRACE_SIZE );
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MTrace( void );
+
+
+    /**
+     * \brief   Enable or disable the trace.
+     */
+    void setEnabled( bool enabled ) {
+        m_enabled.store( enabled, std::memory_order_relaxed );
+    };
+
+
+    /**
+     * \brief   Check if the trace is enabled.
+     */
+    bool isEnabled( void ) const {
+        return m_enabled.load( std::memory_order_relaxed );
+    };
+
+
+    /**
+     * \brief   Get a new request ID.
+     */
+    uint32_t nextId( void ) {
+        return m_nextId.fetch_add( 1, std::memory_order_relaxed );
+    };
+
+
+    /**
+     * \brief   Add a record of a request.
+     *
+     * \param   event       Event to record.
+     * \param   id          ID of the request.
+     * \param   clientID    Internal ID of the device.
+     * \param   p_uri       URI of the request or NULL.
+     * \param   value       Value of the event.
+     */
+    void add( e_lwm2m_trace_event_t event, uint32_t id, uint16_t clientID,
+            const lwm2m_uri_t* p_uri, uint32_t value );
+
+
+    /**
+     * \brief   Add a record of a CoAP packet.
+     *
+     *          Message ID, code and token are taken from the packet.
+     *
+     * \param   event       Event to record.
+     * \param   id          ID of the request or 0.
+     * \param   clientID    Internal ID of the device or LWM2M_MAX_ID.
+     * \param   p_buf       Packet.
+     * \param   len         Length of the packet.
+     * \param   duration    Duration in us of the event or 0.
+     */
+    void addPacket( e_lwm2m_trace_event_t event, uint32_t id,
+            uint16_t clientID, const uint8_t* p_buf, size_t len,
+            uint32_t duration = 0 );
+
+
+    /**
+     * \brief   Get the records.
+     *
+     * \param   records List to append the records to, oldest first.
+     *
+     * \return  Number of records.
+     */
+    uint32_t getRecords( std::vector< s_lwm2m_trace_record_t >& records ) const;
+
+
+    /**
+     * \brief   Write a dump of the trace.
+     *
+     *          Only async-signal-safe functions are used.
+     *
+     * \param   fd  File descriptor to write to.
+     *
+     * \return  Number of records or negative value on error.
+     */
+    int32_t dump( int fd ) const;
+
+
+    /**
+     * \brief   Read a dump of a trace.
+     *
+     * \param   fd      File descriptor to read from.
+     * \param   records List to append the records to.
+     *
+     * \return  Number of records or negative value on error.
+     */
+    static int32_t load( int fd, std::vector< s_lwm2m_trace_record_t >& records );
+
+
+    /**
+     * \brief   Dump a trace when a signal is received.
+     *
+     *          Every signal writes a new dump to the file.
+     *
+     * \param   p_trace Trace to dump or NULL to restore the default
+     *                  handling of the signal.
+     * \param   signo   Signal, e.g. SIGUSR1.
+     * \param   p_path  File the dump is written to.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    static int8_t dumpOnSignal( const LWM2MTrace* p_trace, int signo,
+            const char* p_path );
+
+
+    /**
+     * \brief   Get the name of an event.
+     */
+    static const char* getEventName( e_lwm2m_trace_event_t event );
+
+
+private:
+
+    /**
+     * \brief   Slot of the ring buffer.
+     */
+    struct s_slot_t
+    {
+        /* position of the record plus one, 0 while it is written */
+        std::atomic< uint64_t > seq;
+        /* record */
+        s_lwm2m_trace_record_t rec;
+    };
+
+    /**
+     * \brief   Reserve and fill a slot.
+     */
+    void push( const s_lwm2m_trace_record_t& rec );
+
+    /**
+     * \brief   Copy a record if it was not overwritten.
+     */
+    bool read( uint64_t pos, s_lwm2m_trace_record_t* p_rec ) const;
+
+    /**
+     * \brief   Handler of the dump signal.
+     */
+    static void signalHandler( int signo );
+
+
+private:
+
+    /** Ring buffer */
+    s_slot_t* mp_slots;
+
+    /** Mask of a position within the ring buffer */
+    uint64_t m_mask;
+
+    /** Position of the next record */
+    std::atomic< uint64_t > m_head;
+
+    /** Next request ID */
+    std::atomic< uint32_t > m_nextId;
+
+    /** Trace is enabled */
+    std::atomic< bool > m_enabled;
+};
+
+#endif /* #ifndef __LWM2MTRACE_H__ */
+
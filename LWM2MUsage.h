@@ -0,0 +1,120 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+
+/**
+ * \file    LWM2MUsage.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of the memory and resources used by the devices
+ *          of the LWM2M server.
+ *
+ */
+
+
+#ifndef __LWM2MUSAGE_H__
+#define __LWM2MUSAGE_H__
+#ifndef __DECL_LWM2MUSAGE_H__
+#define __DECL_LWM2MUSAGE_H__ extern
+#endif /* #ifndef __DECL_LWM2MUSAGE_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Parts of the memory used by a device.
+ */
+typedef enum
+{
+    /** Device, objects and resources of the wrapper */
+    e_lwm2m_usage_tree,
+    /** Observe parameters of the wrapper */
+    e_lwm2m_usage_observe,
+    /** Client of wakaama with the objects of the registration */
+    e_lwm2m_usage_client,
+    /** Observations of wakaama */
+    e_lwm2m_usage_observations,
+    /** Outstanding transactions with their messages */
+    e_lwm2m_usage_transactions,
+    /** Requests waiting in the queue of the device */
+    e_lwm2m_usage_queue,
+    /** Connection and round trip time estimate */
+    e_lwm2m_usage_connection,
+
+    e_lwm2m_usage_max
+
+} e_lwm2m_usage_t;
+
+
+/**
+ * \brief   Memory and objects used by a device or by all devices.
+ *
+ *          The sizes are the sizes of the structures and buffers. The
+ *          overhead of the heap and of the containers is not included.
+ */
+typedef struct
+{
+    /** Bytes used by the parts of the device */
+    size_t bytes[e_lwm2m_usage_max];
+    /** Bytes used in total */
+    size_t total;
+    /** Number of devices */
+    uint32_t devices;
+    /** Number of objects of the wrapper */
+    uint32_t objects;
+    /** Number of resources of the wrapper */
+    uint32_t resources;
+    /** Number of object instances announced by the registration */
+    uint32_t instances;
+    /** Number of observe parameters of the wrapper */
+    uint32_t observeParams;
+    /** Number of observations of wakaama */
+    uint32_t observations;
+    /** Number of outstanding transactions */
+    uint32_t transactions;
+    /** Number of queued requests */
+    uint32_t queued;
+
+} s_lwm2m_usage_t;
+
+#endif /* #ifndef __LWM2MUSAGE_H__ */
@@ -0,0 +1,135 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MValue.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of a decoded LWM2M value.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string.h>
+#include "LWM2MValue.h"
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValue::getInt()
+*/
+int64_t LWM2MValue::getInt( void ) const
+{
+    switch( m_type )
+    {
+    case e_lwm2m_value_type_int:
+    case e_lwm2m_value_type_bool:
+    case e_lwm2m_value_type_time:
+        return m_val.asInt;
+
+    case e_lwm2m_value_type_float:
+        return (int64_t)m_val.asFloat;
+
+    default:
+        return 0;
+    }
+
+} /* LWM2MValue::getInt() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValue::getFloat()
+*/
+double LWM2MValue::getFloat( void ) const
+{
+    switch( m_type )
+    {
+    case e_lwm2m_value_type_int:
+    case e_lwm2m_value_type_bool:
+    case e_lwm2m_value_type_time:
+        return (double)m_val.asInt;
+
+    case e_lwm2m_value_type_float:
+        return m_val.asFloat;
+
+    default:
+        return 0;
+    }
+
+} /* LWM2MValue::getFloat() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValue::equals()
+*/
+bool LWM2MValue::equals( const LWM2MValue& val ) const
+{
+    if( m_type != val.m_type )
+        return false;
+
+    switch( m_type )
+    {
+    case e_lwm2m_value_type_int:
+    case e_lwm2m_value_type_bool:
+    case e_lwm2m_value_type_time:
+        return m_val.asInt == val.m_val.asInt;
+
+    case e_lwm2m_value_type_float:
+        return m_val.asFloat == val.m_val.asFloat;
+
+    case e_lwm2m_value_type_objlink:
+        return (m_val.asLink.objId == val.m_val.asLink.objId) &&
+            (m_val.asLink.instId == val.m_val.asLink.instId);
+
+    default:
+        break;
+    }
+
+    /* strings, opaque and unknown values compare their data */
+    if( m_len != val.m_len )
+        return false;
+
+    return (m_len == 0) || (memcmp( mp_data, val.mp_data, m_len ) == 0);
+
+} /* LWM2MValue::equals() */
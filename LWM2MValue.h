@@ -0,0 +1,293 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MValue.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of a decoded LWM2M value.
+ *
+ */
+
+
+#ifndef __LWM2MVALUE_H__
+#define __LWM2MVALUE_H__
+#ifndef __DECL_LWM2MVALUE_H__
+#define __DECL_LWM2MVALUE_H__ extern
+#endif /* #ifndef __DECL_LWM2MVALUE_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/*
+ * --- Forward Declaration ----------------------------------------------------- *
+ */
+
+/* Forward declaration of the LWM2MValueDecoder class. */
+class LWM2MValueDecoder;
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Instance ID of a value that does not belong to a resource instance */
+#define LWM2M_VALUE_NO_INSTANCE                 0xFFFF
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * \brief    Types of a decoded value.
+ */
+typedef enum
+{
+    /** Type is not known */
+    e_lwm2m_value_type_none,
+
+    /** Signed integer */
+    e_lwm2m_value_type_int,
+
+    /** Floating point number */
+    e_lwm2m_value_type_float,
+
+    /** Boolean */
+    e_lwm2m_value_type_bool,
+
+    /** UTF-8 string */
+    e_lwm2m_value_type_string,
+
+    /** Opaque data */
+    e_lwm2m_value_type_opaque,
+
+    /** Object link */
+    e_lwm2m_value_type_objlink,
+
+    /** Time as seconds since the epoch */
+    e_lwm2m_value_type_time,
+
+} e_lwm2m_value_type_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MValue Class.
+ *
+ *          A LWM2M Value is the decoded value of a resource or of a
+ *          resource instance. Numeric values are converted when the value
+ *          is decoded. Strings and opaque data refer to the received
+ *          packet and are only valid during the notification they were
+ *          passed with. Use getString() to keep a copy.
+ */
+class LWM2MValue
+{
+    friend class LWM2MValueDecoder;
+    friend class LWM2MResource;
+
+public:
+
+    /**
+     * \brief   Default constructor to create an empty value.
+     */
+    LWM2MValue( void )
+        : m_type( e_lwm2m_value_type_none )
+        , m_resId( 0 )
+        , m_instId( LWM2M_VALUE_NO_INSTANCE )
+        , mp_data( NULL )
+        , m_len( 0 ) {
+        m_val.asInt = 0;
+    };
+
+
+    /**
+     * \brief   Get the type of the value.
+     *
+     * \return  Type of the value.
+     */
+    e_lwm2m_value_type_t getType( void ) const {return m_type;}
+
+
+    /**
+     * \brief   Get the ID of the resource the value belongs to.
+     *
+     * \return  Resource ID.
+     */
+    uint16_t getResId( void ) const {return m_resId;}
+
+
+    /**
+     * \brief   Get the ID of the resource instance the value belongs to.
+     *
+     * \return  Resource instance ID or LWM2M_VALUE_NO_INSTANCE.
+     */
+    uint16_t getInstId( void ) const {return m_instId;}
+
+
+    /**
+     * \brief   Check if the value belongs to a resource instance.
+     *
+     * \return  true if the value is the value of a resource instance.
+     */
+    bool isInstance( void ) const {return m_instId != LWM2M_VALUE_NO_INSTANCE;}
+
+
+    /**
+     * \brief   Get the value as integer.
+     *
+     *          Floating point values are truncated and booleans
+     *          are returned as 0 or 1.
+     *
+     * \return  Integer value or 0 for non numeric types.
+     */
+    int64_t getInt( void ) const;
+
+
+    /**
+     * \brief   Get the value as floating point number.
+     *
+     * \return  Floating point value or 0 for non numeric types.
+     */
+    double getFloat( void ) const;
+
+
+    /**
+     * \brief   Get the value as boolean.
+     *
+     * \return  Boolean value or false for non numeric types.
+     */
+    bool getBool( void ) const {return getInt() != 0;}
+
+
+    /**
+     * \brief   Get the object ID of an object link.
+     *
+     * \return  Object ID or 0 if the value is no object link.
+     */
+    uint16_t getLinkObjId( void ) const {
+        return (m_type == e_lwm2m_value_type_objlink) ? m_val.asLink.objId : 0;
+    }
+
+
+    /**
+     * \brief   Get the instance ID of an object link.
+     *
+     * \return  Instance ID or 0 if the value is no object link.
+     */
+    uint16_t getLinkInstId( void ) const {
+        return (m_type == e_lwm2m_value_type_objlink) ? m_val.asLink.instId : 0;
+    }
+
+
+    /**
+     * \brief   Get the raw data of the value.
+     *
+     *          For strings and opaque values this is the value itself. The
+     *          data refers to the received packet.
+     *
+     * \return  Pointer to the data.
+     */
+    const uint8_t* getData( void ) const {return mp_data;}
+
+
+    /**
+     * \brief   Get the length of the raw data.
+     *
+     * \return  Length of the data in bytes.
+     */
+    size_t getLength( void ) const {return m_len;}
+
+
+    /**
+     * \brief   Get a copy of the raw data as string.
+     *
+     * \return  The data as string.
+     */
+    std::string getString( void ) const {
+        return (mp_data != NULL) ? std::string( (const char*)mp_data, m_len ) :
+            std::string();
+    }
+
+
+    /**
+     * \brief   Compare the content of two values.
+     *
+     *          The resource and instance IDs are not compared.
+     *
+     * \param   val     Value to compare with.
+     *
+     * \return  true if type and content of the values are equal.
+     */
+    bool equals( const LWM2MValue& val ) const;
+
+
+private:
+
+    /** Type of the value */
+    e_lwm2m_value_type_t m_type;
+
+    /** ID of the resource */
+    uint16_t m_resId;
+
+    /** ID of the resource instance */
+    uint16_t m_instId;
+
+    /** Raw data of the value */
+    const uint8_t* mp_data;
+
+    /** Length of the raw data */
+    size_t m_len;
+
+    /** Converted value */
+    union
+    {
+        int64_t asInt;
+        double asFloat;
+        struct
+        {
+            uint16_t objId;
+            uint16_t instId;
+        } asLink;
+    } m_val;
+};
+
+#endif /* #ifndef __LWM2MVALUE_H__ */
@@ -0,0 +1,453 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MValueDecoder.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of a decoder for LWM2M payloads.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LWM2MValueDecoder.h"
+#include "LWM2MObject.h"
+#include "LWM2MResource.h"
+
+/*
+ * --- Macro Definitions----------------------------------------------------- *
+ */
+
+/** Maximum length of a numeric text value */
+#define LWM2M_TEXT_NUM_MAX_LEN                  32
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_readTLVHeader()
+*/
+static size_t prv_readTLVHeader( const uint8_t* p_buf, size_t len,
+        uint8_t* p_type, uint16_t* p_id, size_t* p_dataLen )
+{
+    size_t hdrLen = 1;
+    size_t lenLen;
+
+    if( len < 2 )
+        return 0;
+
+    *p_type = p_buf[0] & LWM2M_TLV_TYPE_MASK;
+
+    /* identifier has 8 or 16 bits */
+    if( p_buf[0] & 0x20 )
+    {
+        if( len < 3 )
+            return 0;
+        *p_id = (p_buf[1] << 8) | p_buf[2];
+        hdrLen += 2;
+    }
+    else
+    {
+        *p_id = p_buf[1];
+        hdrLen += 1;
+    }
+
+    /* length is either part of the type or follows the identifier */
+    lenLen = (p_buf[0] >> 3) & 0x03;
+    if( hdrLen + lenLen > len )
+        return 0;
+
+    if( lenLen == 0 )
+    {
+        *p_dataLen = p_buf[0] & 0x07;
+    }
+    else
+    {
+        *p_dataLen = 0;
+        for( size_t i = 0; i < lenLen; i++ )
+            *p_dataLen = (*p_dataLen << 8) | p_buf[hdrLen + i];
+        hdrLen += lenLen;
+    }
+
+    if( hdrLen + *p_dataLen > len )
+        return 0;
+
+    return hdrLen;
+
+} /* prv_readTLVHeader() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* prv_readBigEndian()
+*/
+static uint64_t prv_readBigEndian( const uint8_t* p_buf, size_t len )
+{
+    uint64_t val = 0;
+    for( size_t i = 0; i < len; i++ )
+        val = (val << 8) | p_buf[i];
+    return val;
+
+} /* prv_readBigEndian() */
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValueDecoder::decode()
+*/
+int16_t LWM2MValueDecoder::decode( const lwm2m_uri_t* p_uri,
+        lwm2m_media_type_t format, const uint8_t* p_buf, size_t len,
+        LWM2MObject* p_obj, uint16_t instId )
+{
+    int16_t ret = 0;
+
+    clear();
+    m_instFilter = instId;
+
+    if( (p_uri == NULL) || ((p_buf == NULL) && (len > 0)) )
+        return -1;
+
+    if( format == LWM2M_CONTENT_TLV )
+    {
+        /* single resource instances belong to the resource of the URI */
+        ret = decodeTLV( p_buf, len, p_obj, LWM2M_URI_IS_SET_RESOURCE( p_uri ) ?
+                p_uri->resourceId : LWM2M_MAX_ID, false );
+    }
+    else if( LWM2M_URI_IS_SET_RESOURCE( p_uri ) )
+    {
+        /* any other format carries the value of a single resource */
+        LWM2MValue& val = addValue();
+        val.m_resId = p_uri->resourceId;
+        val.mp_data = p_buf;
+        val.m_len = len;
+
+        if( format == LWM2M_CONTENT_TEXT )
+            convertText( val, getResType( p_obj, val.m_resId ) );
+        else if( format == LWM2M_CONTENT_OPAQUE )
+            val.m_type = e_lwm2m_value_type_opaque;
+    }
+    else
+    {
+        /* object level payloads are only supported as TLV */
+        ret = -1;
+    }
+
+    if( ret < 0 )
+    {
+        clear();
+        return ret;
+    }
+
+    return (int16_t)m_count;
+
+} /* LWM2MValueDecoder::decode() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValueDecoder::findValue()
+*/
+const LWM2MValue* LWM2MValueDecoder::findValue( uint16_t resId ) const
+{
+    for( size_t i = 0; i < m_count; i++ )
+    {
+        if( m_values[i].m_resId == resId )
+            return &m_values[i];
+    }
+
+    return NULL;
+
+} /* LWM2MValueDecoder::findValue() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValueDecoder::decodeTLV()
+*/
+int16_t LWM2MValueDecoder::decodeTLV( const uint8_t* p_buf, size_t len,
+        LWM2MObject* p_obj, uint16_t resId, bool inMultiple )
+{
+    size_t offset = 0;
+
+    while( offset < len )
+    {
+        uint8_t type;
+        uint16_t id;
+        size_t dataLen;
+        size_t hdrLen = prv_readTLVHeader( p_buf + offset, len - offset,
+            &type, &id, &dataLen );
+
+        if( hdrLen == 0 )
+            /* malformed TLV */
+            return -1;
+
+        const uint8_t* p_data = p_buf + offset + hdrLen;
+
+        switch( type )
+        {
+        case LWM2M_TLV_TYPE_OBJ_INSTANCE:
+            /* the resources of the instance follow */
+            if( decodeTLV( p_data, dataLen, p_obj, LWM2M_MAX_ID,
+                    false ) != 0 )
+                return -1;
+            break;
+
+        case LWM2M_TLV_TYPE_MULTIPLE_RES:
+            /* the resource instances follow */
+            if( decodeTLV( p_data, dataLen, p_obj, id, true ) != 0 )
+                return -1;
+            break;
+
+        case LWM2M_TLV_TYPE_RES_INSTANCE:
+        case LWM2M_TLV_TYPE_RES_VALUE:
+        {
+            bool isInst = inMultiple || (type == LWM2M_TLV_TYPE_RES_INSTANCE);
+
+            if( isInst && (resId == LWM2M_MAX_ID) )
+                /* instance of an unknown resource */
+                break;
+
+            if( isInst && (m_instFilter != LWM2M_VALUE_NO_INSTANCE) &&
+                (id != m_instFilter) )
+                /* instance was not requested */
+                break;
+
+            LWM2MValue& val = addValue();
+            if( isInst )
+            {
+                val.m_resId = resId;
+                val.m_instId = id;
+            }
+            else
+            {
+                val.m_resId = id;
+            }
+            val.mp_data = p_data;
+            val.m_len = dataLen;
+            convertTLV( val, getResType( p_obj, val.m_resId ) );
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        offset += hdrLen + dataLen;
+    }
+
+    return 0;
+
+} /* LWM2MValueDecoder::decodeTLV() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValueDecoder::addValue()
+*/
+LWM2MValue& LWM2MValueDecoder::addValue( void )
+{
+    if( m_count == m_values.size() )
+        m_values.push_back( LWM2MValue() );
+    else
+        m_values[m_count] = LWM2MValue();
+
+    return m_values[m_count++];
+
+} /* LWM2MValueDecoder::addValue() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValueDecoder::getResType()
+*/
+e_lwm2m_value_type_t LWM2MValueDecoder::getResType( LWM2MObject* p_obj,
+        uint16_t resId )
+{
+    LWM2MResource* p_res = NULL;
+
+    if( p_obj != NULL )
+        p_res = p_obj->getResource( resId );
+
+    if( p_res == NULL )
+        return e_lwm2m_value_type_none;
+
+    return p_res->getType();
+
+} /* LWM2MValueDecoder::getResType() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValueDecoder::convertTLV()
+*/
+void LWM2MValueDecoder::convertTLV( LWM2MValue& val, e_lwm2m_value_type_t type )
+{
+    switch( type )
+    {
+    case e_lwm2m_value_type_int:
+    case e_lwm2m_value_type_time:
+        if( (val.m_len == 1) || (val.m_len == 2) || (val.m_len == 4) ||
+            (val.m_len == 8) )
+        {
+            /* sign extend the big endian value */
+            uint64_t raw = prv_readBigEndian( val.mp_data, val.m_len );
+            uint8_t shift = 64 - (val.m_len * 8);
+            val.m_val.asInt = ((int64_t)(raw << shift)) >> shift;
+            val.m_type = type;
+        }
+        break;
+
+    case e_lwm2m_value_type_float:
+        if( val.m_len == 4 )
+        {
+            uint32_t raw = (uint32_t)prv_readBigEndian( val.mp_data, 4 );
+            float f;
+            memcpy( &f, &raw, sizeof(f) );
+            val.m_val.asFloat = f;
+            val.m_type = type;
+        }
+        else if( val.m_len == 8 )
+        {
+            uint64_t raw = prv_readBigEndian( val.mp_data, 8 );
+            memcpy( &val.m_val.asFloat, &raw, sizeof(double) );
+            val.m_type = type;
+        }
+        break;
+
+    case e_lwm2m_value_type_bool:
+        if( val.m_len == 1 )
+        {
+            val.m_val.asInt = (val.mp_data[0] != 0) ? 1 : 0;
+            val.m_type = type;
+        }
+        break;
+
+    case e_lwm2m_value_type_objlink:
+        if( val.m_len == 4 )
+        {
+            val.m_val.asLink.objId = (val.mp_data[0] << 8) | val.mp_data[1];
+            val.m_val.asLink.instId = (val.mp_data[2] << 8) | val.mp_data[3];
+            val.m_type = type;
+        }
+        break;
+
+    case e_lwm2m_value_type_string:
+        val.m_type = type;
+        break;
+
+    default:
+        /* unknown resources keep their raw data */
+        val.m_type = e_lwm2m_value_type_opaque;
+        break;
+    }
+
+} /* LWM2MValueDecoder::convertTLV() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MValueDecoder::convertText()
+*/
+void LWM2MValueDecoder::convertText( LWM2MValue& val, e_lwm2m_value_type_t type )
+{
+    char num[LWM2M_TEXT_NUM_MAX_LEN + 1];
+    char* p_end = NULL;
+
+    /* values of unknown resources are kept as strings */
+    val.m_type = e_lwm2m_value_type_string;
+
+    if( (type == e_lwm2m_value_type_none) || (type == e_lwm2m_value_type_string) ||
+        (type == e_lwm2m_value_type_opaque) )
+        return;
+
+    if( (val.m_len == 0) || (val.m_len > LWM2M_TEXT_NUM_MAX_LEN) )
+        return;
+
+    /* numbers are parsed from a terminated copy of the payload */
+    memcpy( num, val.mp_data, val.m_len );
+    num[val.m_len] = 0;
+
+    switch( type )
+    {
+    case e_lwm2m_value_type_int:
+    case e_lwm2m_value_type_time:
+        val.m_val.asInt = strtoll( num, &p_end, 10 );
+        break;
+
+    case e_lwm2m_value_type_float:
+        val.m_val.asFloat = strtod( num, &p_end );
+        break;
+
+    case e_lwm2m_value_type_bool:
+        if( (val.m_len == 1) && ((num[0] == '0') || (num[0] == '1')) )
+        {
+            val.m_val.asInt = num[0] - '0';
+            p_end = num + 1;
+        }
+        break;
+
+    case e_lwm2m_value_type_objlink:
+    {
+        unsigned long objId = strtoul( num, &p_end, 10 );
+        if( (p_end != NULL) && (*p_end == ':') )
+        {
+            val.m_val.asLink.objId = (uint16_t)objId;
+            val.m_val.asLink.instId = (uint16_t)strtoul( p_end + 1, &p_end, 10 );
+        }
+        else
+            p_end = NULL;
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    /* only take the conversion if the whole text was consumed */
+    if( (p_end != NULL) && (*p_end == 0) )
+        val.m_type = type;
+
+} /* LWM2MValueDecoder::convertText() */
@@ -0,0 +1,218 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MValueDecoder.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Description of a decoder for LWM2M payloads.
+ *
+ */
+
+
+#ifndef __LWM2MVALUEDECODER_H__
+#define __LWM2MVALUEDECODER_H__
+#ifndef __DECL_LWM2MVALUEDECODER_H__
+#define __DECL_LWM2MVALUEDECODER_H__ extern
+#endif /* #ifndef __DECL_LWM2MVALUEDECODER_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "liblwm2m.h"
+#include "LWM2MValue.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** TLV identifier types */
+#define LWM2M_TLV_TYPE_MASK                     0xC0
+#define LWM2M_TLV_TYPE_OBJ_INSTANCE             0x00
+#define LWM2M_TLV_TYPE_RES_INSTANCE             0x40
+#define LWM2M_TLV_TYPE_MULTIPLE_RES             0x80
+#define LWM2M_TLV_TYPE_RES_VALUE                0xC0
+
+/*
+ * --- Forward Declaration ----------------------------------------------------- *
+ */
+
+/* Forward declaration of the LWM2MObject class used for type lookups. */
+class LWM2MObject;
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MValueDecoder Class.
+ *
+ *          The decoder converts a received payload (text, opaque or TLV)
+ *          into a list of LWM2M Values. The types of the values are taken
+ *          from the resources of the object the payload belongs to. The
+ *          list is kept between payloads so that decoding does not
+ *          allocate memory once the decoder has seen the largest payload.
+ */
+class LWM2MValueDecoder
+{
+
+public:
+
+    /**
+     * \brief   Default constructor to create a decoder.
+     */
+    LWM2MValueDecoder( void )
+        : m_count( 0 )
+        , m_instFilter( LWM2M_VALUE_NO_INSTANCE ) {};
+
+
+    /**
+     * \brief   Default destructor of the decoder.
+     */
+    virtual ~LWM2MValueDecoder( void ) {};
+
+
+    /**
+     * \brief   Decode a payload.
+     *
+     *          Values of a previous payload are discarded.
+     *
+     * \param   p_uri   URI the payload belongs to.
+     * \param   format  Format of the payload.
+     * \param   p_buf   Payload data.
+     * \param   len     Length of the payload.
+     * \param   p_obj   Object used to look up the resource types or NULL.
+     * \param   instId  Resource instance to decode. Other instances of
+     *                  multiple instance resources are skipped without
+     *                  being converted. All values are decoded by default.
+     *
+     * \return  Number of decoded values or negative value on error.
+     */
+    int16_t decode( const lwm2m_uri_t* p_uri, lwm2m_media_type_t format,
+            const uint8_t* p_buf, size_t len, LWM2MObject* p_obj,
+            uint16_t instId = LWM2M_VALUE_NO_INSTANCE );
+
+
+    /**
+     * \brief   Discard all decoded values.
+     */
+    void clear( void ) {m_count = 0;}
+
+
+    /**
+     * \brief   Get the number of decoded values.
+     *
+     * \return  Number of values.
+     */
+    size_t getCount( void ) const {return m_count;}
+
+
+    /**
+     * \brief   Get a decoded value.
+     *
+     * \param   idx     Index of the value.
+     *
+     * \return  Reference to the value.
+     */
+    const LWM2MValue& getValue( size_t idx ) const {return m_values[idx];}
+
+
+    /**
+     * \brief   Find the first value of a resource.
+     *
+     * \param   resId   ID of the resource.
+     *
+     * \return  Pointer to the value or NULL if the payload had none.
+     */
+    const LWM2MValue* findValue( uint16_t resId ) const;
+
+
+private:
+
+    /**
+     * \brief   Decode TLV encoded data.
+     *
+     * \param   resId       Resource the instances in the data belong to
+     *                      or LWM2M_MAX_ID if it is not known.
+     * \param   inMultiple  True if the data is the content of a multiple
+     *                      resource.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int16_t decodeTLV( const uint8_t* p_buf, size_t len, LWM2MObject* p_obj,
+            uint16_t resId, bool inMultiple );
+
+
+    /**
+     * \brief   Get a new value at the end of the list.
+     */
+    LWM2MValue& addValue( void );
+
+
+    /**
+     * \brief   Get the type of a resource.
+     */
+    static e_lwm2m_value_type_t getResType( LWM2MObject* p_obj, uint16_t resId );
+
+
+    /**
+     * \brief   Convert the raw data of a TLV value.
+     */
+    static void convertTLV( LWM2MValue& val, e_lwm2m_value_type_t type );
+
+
+    /**
+     * \brief   Convert the raw data of a text value.
+     */
+    static void convertText( LWM2MValue& val, e_lwm2m_value_type_t type );
+
+
+private:
+
+    /** Decoded values, entries beyond m_count are kept for reuse */
+    std::vector< LWM2MValue > m_values;
+
+    /** Number of values of the current payload */
+    size_t m_count;
+
+    /** Resource instance to decode */
+    uint16_t m_instFilter;
+};
+
+#endif /* #ifndef __LWM2MVALUEDECODER_H__ */
@@ -0,0 +1,111 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MValueObserver.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Definition of a LWM2M Value Observer.
+ *
+ */
+
+
+#ifndef __LWM2MVALUEOBSERVER_H__
+#define __LWM2MVALUEOBSERVER_H__
+#ifndef __DECL_LWM2MVALUEOBSERVER_H__
+#define __DECL_LWM2MVALUEOBSERVER_H__ extern
+#endif /* #ifndef __DECL_LWM2MVALUEOBSERVER_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include "LWM2MResourceObserver.h"
+#include "LWM2MValue.h"
+
+/*
+ * --- Forward Declaration ----------------------------------------------------- *
+ */
+
+/* Forward declaration of the LWM2MResource class. */
+class LWM2MResource;
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2MValueObserver Class.
+ *
+ *          A LWM2M Value Observer receives the decoded value of a resource
+ *          instead of the raw LWM2M data. The value is decoded only once
+ *          per notification and shared by all value observers of the
+ *          resource. Resources that only have value observers are not
+ *          parsed into LWM2M data at all.
+ */
+class LWM2MValueObserver
+{
+
+public:
+
+    /**
+     * \brief   Default constructor.
+     */
+    LWM2MValueObserver( void ) {};
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MValueObserver( void ) {};
+
+
+    /**
+     * \brief   Notification about a new value.
+     *
+     * \param   p_res     The resource the notification is for.
+     * \param   p_params  Parameters of the notification. The data
+     *                    field is not set.
+     * \param   val       The decoded value.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    virtual int8_t notify( const LWM2MResource* p_res,
+            const s_lwm2m_obsparams_t* p_params, const LWM2MValue& val ) = 0;
+
+};
+
+#endif /* #ifndef __LWM2MVALUEOBSERVER_H__ */
@@ -0,0 +1,464 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MBenchmark.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   End-to-end benchmark of the LWM2M server.
+ *
+ *          The server is driven over loopback UDP by a fleet of simulated
+ *          clients. The benchmark measures the registration throughput,
+ *          the latency of reads, writes and observations, the
+ *          notification throughput and the CPU time of the server per
+ *          message.
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "LWM2MServer.h"
+#include "LWM2MDevice.h"
+#include "LWM2MObject.h"
+#include "LWM2MResource.h"
+#include "LWM2MResourceObserver.h"
+#include "LWM2MClientSim.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Default number of simulated clients */
+#define LWM2M_BENCH_CLIENTS                     1000
+
+/** Default number of reads and writes */
+#define LWM2M_BENCH_REQUESTS                    2000
+
+/** Default number of notifications per observation */
+#define LWM2M_BENCH_NOTIFICATIONS               10
+
+/** Maximum time in ms of a phase */
+#define LWM2M_BENCH_PHASE_TIMEOUT               60000
+
+/** Time in ms without progress that ends the notification phase */
+#define LWM2M_BENCH_IDLE_TIMEOUT                2000
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * Measurement of a phase.
+ */
+typedef struct
+{
+    /* time in us at the start */
+    uint64_t time;
+    /* CPU time in us of the process at the start */
+    uint64_t cpu;
+    /* statistics of the simulation at the start */
+    s_lwm2m_sim_stats_t sim;
+
+} s_bench_phase_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Observer counting the notifications of resources.
+ */
+class NotifyCounter
+    : public LWM2MResourceObserver
+{
+public:
+
+    NotifyCounter( void ) : m_count( 0 ) {};
+    virtual ~NotifyCounter( void ) {};
+
+    virtual int8_t notify( const LWM2MServer* p_srv,
+            const LWM2MResource* p_res, const s_lwm2m_obsparams_t* p_params ) {
+        if( (p_params->buffer != NULL) && (p_params->bufferLen > 0) )
+            m_count++;
+        return 0;
+    }
+
+    /** Number of notifications received */
+    std::atomic< uint64_t > m_count;
+};
+
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* timeUs()
+*/
+static uint64_t timeUs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+} /* timeUs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* cpuUs()
+*/
+static uint64_t cpuUs( void )
+{
+    struct rusage usage;
+
+    if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        return 0;
+
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+            1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+
+} /* cpuUs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* serve()
+*/
+static void serve( LWM2MServer* p_srv )
+{
+#ifndef OPCUA_LWM2M_SERVER_USE_THREAD
+    /* the benchmark runs the server itself */
+    p_srv->runServer();
+#else
+    (void)p_srv;
+    usleep( 1000 );
+#endif /* #ifndef OPCUA_LWM2M_SERVER_USE_THREAD */
+
+} /* serve() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* phaseStart()
+*/
+static void phaseStart( LWM2MClientSim& sim, s_bench_phase_t* p_phase )
+{
+    sim.getStats( &p_phase->sim );
+    p_phase->cpu = cpuUs();
+    p_phase->time = timeUs();
+
+} /* phaseStart() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* phaseEnd()
+*/
+static void phaseEnd( LWM2MClientSim& sim, const s_bench_phase_t* p_phase,
+        const char* p_name, uint64_t ops )
+{
+    s_lwm2m_sim_stats_t stats;
+    uint64_t time = timeUs() - p_phase->time;
+    uint64_t cpu = cpuUs() - p_phase->cpu;
+    uint64_t msgs;
+
+    sim.getStats( &stats );
+    msgs = (stats.rx - p_phase->sim.rx) + (stats.tx - p_phase->sim.tx);
+
+    /* the time of the simulated clients is not part of the server */
+    cpu -= std::min( cpu, stats.cpuTime - p_phase->sim.cpuTime );
+
+    printf( "%-14s %8llu ops %10.1f ms %10.1f ops/s %8.2f us CPU/msg\n",
+            p_name, (unsigned long long)ops, time / 1000.0,
+            (time > 0) ? ops * 1000000.0 / time : 0.0,
+            (msgs > 0) ? (double)cpu / msgs : 0.0 );
+
+} /* phaseEnd() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* printLatency()
+*/
+static void printLatency( const char* p_name, std::vector< uint64_t >& lat,
+        uint32_t errors )
+{
+    if( lat.empty() )
+    {
+        printf( "%-14s no samples, %u errors\n", p_name, errors );
+        return;
+    }
+
+    std::sort( lat.begin(), lat.end() );
+    printf( "%-14s p50 %8llu us p90 %8llu us p99 %8llu us max %8llu us, "
+            "%u errors\n", p_name,
+            (unsigned long long)lat[lat.size() * 50 / 100],
+            (unsigned long long)lat[lat.size() * 90 / 100],
+            (unsigned long long)lat[lat.size() * 99 / 100],
+            (unsigned long long)lat.back(), errors );
+
+} /* printLatency() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* usage()
+*/
+static void usage( const char* p_name )
+{
+    printf( "usage: %s [-c clients] [-r requests] [-o observations] "
+            "[-n notifications] [-p port]\n", p_name );
+    printf( "  -c  number of simulated clients (%d)\n",
+            LWM2M_BENCH_CLIENTS );
+    printf( "  -r  number of reads and of writes (%d)\n",
+            LWM2M_BENCH_REQUESTS );
+    printf( "  -o  number of observed resources (all clients)\n" );
+    printf( "  -n  notifications per observation (%d)\n",
+            LWM2M_BENCH_NOTIFICATIONS );
+    printf( "  -p  port of the server (%s)\n", LWM2M_STANDARD_PORT_STR );
+
+} /* usage() */
+
+
+/*
+ * --- Main ----------------------------------------------------------------- *
+ */
+int main( int argc, char **argv )
+{
+    uint32_t clients = LWM2M_BENCH_CLIENTS;
+    uint32_t requests = LWM2M_BENCH_REQUESTS;
+    uint32_t observes = 0;
+    uint32_t notifs = LWM2M_BENCH_NOTIFICATIONS;
+    std::string port = LWM2M_STANDARD_PORT_STR;
+    std::vector< LWM2MResource* > res;
+    std::vector< uint64_t > lat;
+    NotifyCounter counter;
+    s_bench_phase_t phase;
+    s_lwm2m_sim_stats_t stats;
+    s_lwm2m_request_config_t reqCfg;
+    struct rlimit lim;
+    uint32_t errors;
+    uint64_t start;
+    uint64_t last;
+    uint64_t count;
+    uint64_t sent;
+    uint32_t i;
+    int opt;
+
+    while( (opt = getopt( argc, argv, "c:r:o:n:p:h" )) != -1 )
+    {
+        switch( opt )
+        {
+            case 'c': clients = strtoul( optarg, NULL, 0 ); break;
+            case 'r': requests = strtoul( optarg, NULL, 0 ); break;
+            case 'o': observes = strtoul( optarg, NULL, 0 ); break;
+            case 'n': notifs = strtoul( optarg, NULL, 0 ); break;
+            case 'p': port = optarg; break;
+            default: usage( argv[0] ); return 1;
+        }
+    }
+    if( (observes == 0) || (observes > clients) )
+        observes = clients;
+
+    /* every client needs a socket */
+    if( getrlimit( RLIMIT_NOFILE, &lim ) == 0 )
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit( RLIMIT_NOFILE, &lim );
+    }
+
+    LWM2MServer* p_srv = LWM2MServer::instance();
+    if( p_srv->startServer() != 0 )
+    {
+        fprintf( stderr, "server could not be started\n" );
+        return 1;
+    }
+
+    /* every read shall reach a client */
+    p_srv->getRequestConfig( &reqCfg );
+    reqCfg.cacheReads = false;
+    p_srv->setRequestConfig( &reqCfg );
+
+    LWM2MClientSim sim( "::1", port, clients, "bench-" );
+    if( sim.start() != 0 )
+    {
+        fprintf( stderr, "clients could not be started\n" );
+        p_srv->stopServer();
+        return 1;
+    }
+
+    printf( "%u clients, %u requests, %u observations, "
+            "%u notifications each\n\n", clients, requests, observes, notifs );
+
+    /* registration */
+    phaseStart( sim, &phase );
+    sim.registerAll();
+    do
+    {
+        serve( p_srv );
+        sim.getStats( &stats );
+    } while( (stats.registered < clients) &&
+             (timeUs() - phase.time < LWM2M_BENCH_PHASE_TIMEOUT * 1000ULL) );
+    phaseEnd( sim, &phase, "register", stats.registered );
+
+    /* the resources are discovered once per device type */
+    phaseStart( sim, &phase );
+    for( i = 0; i < clients; i++ )
+    {
+        LWM2MDevice* p_dev = p_srv->getLWM2MDevice( sim.getName( i ) );
+        LWM2MObject* p_obj = (p_dev != NULL) ?
+                p_dev->getObject( LWM2M_SIM_SENSOR_OBJ, 0 ) : NULL;
+
+        if( (p_obj == NULL) || (p_srv->discover( p_obj ) != 0) )
+            continue;
+
+        if( p_obj->getResource( LWM2M_SIM_SENSOR_VALUE ) != NULL )
+            res.push_back( p_obj->getResource( LWM2M_SIM_SENSOR_VALUE ) );
+    }
+    phaseEnd( sim, &phase, "discover", res.size() );
+
+    if( res.empty() )
+    {
+        fprintf( stderr, "no client could be discovered\n" );
+        sim.stop();
+        p_srv->stopServer();
+        return 1;
+    }
+
+    /* reads */
+    lat.clear();
+    errors = 0;
+    phaseStart( sim, &phase );
+    for( i = 0; i < requests; i++ )
+    {
+        lwm2m_data_t* p_data = NULL;
+        int8_t ret;
+
+        start = timeUs();
+        ret = p_srv->read( res[i % res.size()], &p_data, NULL );
+        if( ret > 0 )
+        {
+            lat.push_back( timeUs() - start );
+            lwm2m_data_free( ret, p_data );
+        }
+        else
+            errors++;
+    }
+    phaseEnd( sim, &phase, "read", lat.size() );
+    printLatency( "read", lat, errors );
+
+    /* writes */
+    lat.clear();
+    errors = 0;
+    phaseStart( sim, &phase );
+    for( i = 0; i < requests; i++ )
+    {
+        start = timeUs();
+        if( p_srv->write( res[i % res.size()], "21.5", NULL ) == 0 )
+            lat.push_back( timeUs() - start );
+        else
+            errors++;
+    }
+    phaseEnd( sim, &phase, "write", lat.size() );
+    printLatency( "write", lat, errors );
+
+    /* observations */
+    lat.clear();
+    errors = 0;
+    phaseStart( sim, &phase );
+    for( i = 0; (i < observes) && (i < res.size()); i++ )
+    {
+        res[i]->registerObserver( &counter );
+
+        start = timeUs();
+        if( p_srv->observe( res[i], true ) == 0 )
+            lat.push_back( timeUs() - start );
+        else
+            errors++;
+    }
+    phaseEnd( sim, &phase, "observe", lat.size() );
+    printLatency( "observe", lat, errors );
+
+    /* notifications, the phase ends when no more notifications arrive */
+    counter.m_count = 0;
+    phaseStart( sim, &phase );
+    sent = sim.notifyAll( notifs );
+    last = timeUs();
+    count = 0;
+    while( (counter.m_count < sent) &&
+           (timeUs() - last < LWM2M_BENCH_IDLE_TIMEOUT * 1000ULL) )
+    {
+        serve( p_srv );
+        if( counter.m_count != count )
+        {
+            count = counter.m_count;
+            last = timeUs();
+        }
+    }
+    phaseEnd( sim, &phase, "notify", counter.m_count );
+    printf( "%-14s %llu sent, %llu received\n", "notify",
+            (unsigned long long)sent, (unsigned long long)counter.m_count );
+
+    /* leave the server */
+    sim.deregisterAll();
+    start = timeUs();
+    while( timeUs() - start < 100000 )
+        serve( p_srv );
+
+    for( i = 0; (i < observes) && (i < res.size()); i++ )
+        res[i]->deregisterObserver( &counter );
+
+    sim.stop();
+    p_srv->stopServer();
+
+    return 0;
+}
+
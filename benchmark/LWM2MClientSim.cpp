@@ -0,0 +1,606 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MClientSim.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Implementation of the LWM2M client fleet simulator.
+ *
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include "LWM2MClientSim.h"
+
+extern "C"
+{
+#include "liblwm2m.h"
+#include "er-coap-13/er-coap-13.h"
+}
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Maximum size of a message */
+#define LWM2M_SIM_BUF_SIZE                      1024
+
+/** Objects registered by the clients */
+#define LWM2M_SIM_OBJECTS                       "</1/0>,</3/0>,</3303/0>"
+
+/** Resources of the sensor object */
+#define LWM2M_SIM_SENSOR_LINKS                  \
+    "</3303/0>,</3303/0/5700>,</3303/0/5701>"
+
+/** Interval in ms of the registration check */
+#define LWM2M_SIM_REG_CHECK                     100
+
+/*
+ * --- Methods Definition ----------------------------------------------------- *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::LWM2MClientSim()
+*/
+LWM2MClientSim::LWM2MClientSim( const std::string& host,
+        const std::string& port, uint32_t clients, const std::string& prefix )
+    : m_host( host )
+    , m_port( port )
+    , m_clients( clients )
+    , m_thread( 0 )
+    , m_threadRun( false )
+{
+    uint32_t i;
+
+    memset( &m_stats, 0, sizeof(m_stats) );
+    pthread_mutex_init( &m_mutex, NULL );
+
+    for( i = 0; i < clients; i++ )
+    {
+        m_clients[i].sock = -1;
+        m_clients[i].name = prefix + std::to_string( i );
+        m_clients[i].mID = (uint16_t)rand();
+        m_clients[i].regID = 0;
+        m_clients[i].regTime = 0;
+        m_clients[i].regTries = 0;
+        m_clients[i].registered = false;
+        m_clients[i].value = (int32_t)(i % 100);
+    }
+
+} /* LWM2MClientSim::LWM2MClientSim() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::~LWM2MClientSim()
+*/
+LWM2MClientSim::~LWM2MClientSim( void )
+{
+    stop();
+    pthread_mutex_destroy( &m_mutex );
+
+} /* LWM2MClientSim::~LWM2MClientSim() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::start()
+*/
+int8_t LWM2MClientSim::start( void )
+{
+    struct addrinfo hints;
+    struct addrinfo* p_res = NULL;
+    std::vector< s_client_t >::iterator it;
+    int8_t ret = 0;
+
+    memset( &hints, 0, sizeof(hints) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if( getaddrinfo( m_host.c_str(), m_port.c_str(), &hints, &p_res ) != 0 )
+        return -1;
+
+    m_addr.assign( (uint8_t*)p_res->ai_addr,
+            (uint8_t*)p_res->ai_addr + p_res->ai_addrlen );
+
+    /* every client uses a socket of its own to get a separate port */
+    for( it = m_clients.begin(); (it != m_clients.end()) && (ret == 0); ++it )
+    {
+        it->sock = socket( p_res->ai_family, SOCK_DGRAM, 0 );
+        if( it->sock < 0 )
+            ret = -1;
+    }
+    freeaddrinfo( p_res );
+
+    if( ret == 0 )
+    {
+        m_threadRun = true;
+        if( pthread_create( &m_thread, NULL, threadEntryFunc, this ) != 0 )
+        {
+            m_threadRun = false;
+            ret = -1;
+        }
+    }
+
+    if( ret != 0 )
+        stop();
+
+    return ret;
+
+} /* LWM2MClientSim::start() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::stop()
+*/
+void LWM2MClientSim::stop( void )
+{
+    std::vector< s_client_t >::iterator it;
+
+    if( m_threadRun )
+    {
+        m_threadRun = false;
+        pthread_join( m_thread, NULL );
+        m_thread = 0;
+    }
+
+    for( it = m_clients.begin(); it != m_clients.end(); ++it )
+    {
+        if( it->sock >= 0 )
+        {
+            close( it->sock );
+            it->sock = -1;
+        }
+        it->registered = false;
+        it->obs.clear();
+    }
+
+} /* LWM2MClientSim::stop() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::registerAll()
+*/
+int8_t LWM2MClientSim::registerAll( void )
+{
+    std::vector< s_client_t >::iterator it;
+    uint64_t now = timeMs();
+
+    if( !m_threadRun )
+        return -1;
+
+    pthread_mutex_lock( &m_mutex );
+    for( it = m_clients.begin(); it != m_clients.end(); ++it )
+    {
+        if( it->registered )
+            continue;
+
+        it->regTries = 0;
+        sendRegistration( &(*it), now );
+    }
+    pthread_mutex_unlock( &m_mutex );
+
+    return 0;
+
+} /* LWM2MClientSim::registerAll() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::deregisterAll()
+*/
+void LWM2MClientSim::deregisterAll( void )
+{
+    std::vector< s_client_t >::iterator it;
+    coap_packet_t msg;
+
+    pthread_mutex_lock( &m_mutex );
+    for( it = m_clients.begin(); it != m_clients.end(); ++it )
+    {
+        if( !it->registered )
+            continue;
+
+        coap_init_message( &msg, COAP_TYPE_CON, COAP_DELETE, it->mID++ );
+        coap_set_header_uri_path( &msg, it->location.c_str() );
+        send( &(*it), &msg );
+        coap_free_header( &msg );
+
+        it->registered = false;
+        it->obs.clear();
+        m_stats.registered--;
+    }
+    pthread_mutex_unlock( &m_mutex );
+
+} /* LWM2MClientSim::deregisterAll() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::notifyAll()
+*/
+uint64_t LWM2MClientSim::notifyAll( uint32_t count )
+{
+    std::vector< s_client_t >::iterator it;
+    std::map< std::string, s_observe_t >::iterator obs;
+    coap_packet_t msg;
+    char val[16];
+    uint64_t sent = 0;
+    uint32_t i;
+
+    for( i = 0; i < count; i++ )
+    {
+        for( it = m_clients.begin(); it != m_clients.end(); ++it )
+        {
+            /* the lock is taken per client so that the requests of the
+             * server are still answered */
+            pthread_mutex_lock( &m_mutex );
+            for( obs = it->obs.begin(); obs != it->obs.end(); ++obs )
+            {
+                it->value++;
+                snprintf( val, sizeof(val), "%d.5", (int)it->value );
+
+                coap_init_message( &msg, COAP_TYPE_NON, COAP_205_CONTENT,
+                        it->mID++ );
+                coap_set_header_token( &msg, obs->second.token,
+                        obs->second.tokenLen );
+                coap_set_header_observe( &msg, obs->second.seq++ );
+                coap_set_header_content_type( &msg, LWM2M_CONTENT_TEXT );
+                coap_set_payload( &msg, val, strlen( val ) );
+
+                if( send( &(*it), &msg ) == 0 )
+                {
+                    m_stats.notifications++;
+                    sent++;
+                }
+                coap_free_header( &msg );
+            }
+            pthread_mutex_unlock( &m_mutex );
+        }
+    }
+    return sent;
+
+} /* LWM2MClientSim::notifyAll() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::getName()
+*/
+std::string LWM2MClientSim::getName( uint32_t idx ) const
+{
+    if( idx >= m_clients.size() )
+        return std::string();
+
+    return m_clients[idx].name;
+
+} /* LWM2MClientSim::getName() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::getStats()
+*/
+void LWM2MClientSim::getStats( s_lwm2m_sim_stats_t* p_stats )
+{
+    pthread_mutex_lock( &m_mutex );
+    *p_stats = m_stats;
+    pthread_mutex_unlock( &m_mutex );
+
+} /* LWM2MClientSim::getStats() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::run()
+*/
+void LWM2MClientSim::run( int timeout )
+{
+    std::vector< struct pollfd > fds( m_clients.size() );
+    uint8_t buf[LWM2M_SIM_BUF_SIZE];
+    uint64_t lastCheck = 0;
+    uint64_t now;
+    struct rusage usage;
+    size_t i;
+    int ready;
+    int len;
+
+    for( i = 0; i < m_clients.size(); i++ )
+    {
+        fds[i].fd = m_clients[i].sock;
+        fds[i].events = POLLIN;
+    }
+
+    while( m_threadRun )
+    {
+        ready = poll( fds.data(), fds.size(), timeout );
+
+        pthread_mutex_lock( &m_mutex );
+        for( i = 0; (i < fds.size()) && (ready > 0); i++ )
+        {
+            if( (fds[i].revents & POLLIN) == 0 )
+                continue;
+
+            ready--;
+            len = recv( fds[i].fd, buf, sizeof(buf), MSG_DONTWAIT );
+            if( len > 0 )
+                handle( &m_clients[i], buf, len );
+        }
+
+        /* repeat registrations that were not answered */
+        now = timeMs();
+        if( now - lastCheck >= LWM2M_SIM_REG_CHECK )
+        {
+            for( i = 0; i < m_clients.size(); i++ )
+            {
+                s_client_t* p_cli = &m_clients[i];
+                if( (!p_cli->registered) && (p_cli->regTries > 0) &&
+                    (p_cli->regTries < LWM2M_SIM_REG_RETRIES) &&
+                    (now - p_cli->regTime >= LWM2M_SIM_REG_TIMEOUT) )
+                    sendRegistration( p_cli, now );
+            }
+            lastCheck = now;
+        }
+
+        /* the CPU time of the simulation is excluded from the server */
+        if( getrusage( RUSAGE_THREAD, &usage ) == 0 )
+            m_stats.cpuTime =
+                (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+                1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+        pthread_mutex_unlock( &m_mutex );
+    }
+
+} /* LWM2MClientSim::run() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::handle()
+*/
+void LWM2MClientSim::handle( s_client_t* p_cli, uint8_t* p_buf, int len )
+{
+    coap_packet_t msg;
+    coap_packet_t rsp;
+    multi_option_t* p_opt;
+    std::string path;
+    std::string payload;
+    uint16_t format = LWM2M_CONTENT_TEXT;
+    uint8_t code = COAP_404_NOT_FOUND;
+    bool observe = false;
+
+    if( coap_parse_message( &msg, p_buf, (uint16_t)len ) != NO_ERROR )
+        return;
+
+    m_stats.rx++;
+
+    if( msg.code >= COAP_201_CREATED )
+    {
+        /* answer of the registration */
+        if( (msg.code == COAP_201_CREATED) && (msg.mid == p_cli->regID) &&
+            (!p_cli->registered) )
+        {
+            for( p_opt = msg.location_path; p_opt != NULL;
+                    p_opt = p_opt->next )
+                p_cli->location += "/" + std::string( (char*)p_opt->data,
+                        p_opt->len );
+            p_cli->registered = true;
+            m_stats.registered++;
+        }
+        coap_free_header( &msg );
+        return;
+    }
+
+    if( (msg.type != COAP_TYPE_CON) && (msg.type != COAP_TYPE_NON) )
+    {
+        /* acknowledgements and resets of notifications */
+        coap_free_header( &msg );
+        return;
+    }
+
+    m_stats.requests++;
+    for( p_opt = msg.uri_path; p_opt != NULL; p_opt = p_opt->next )
+        path += "/" + std::string( (char*)p_opt->data, p_opt->len );
+
+    switch( msg.code )
+    {
+        case COAP_GET:
+            if( IS_OPTION( &msg, COAP_OPTION_ACCEPT ) && (msg.accept_num > 0) &&
+                (msg.accept[0] == LWM2M_CONTENT_LINK) )
+            {
+                /* discover */
+                if( path == "/3303/0" )
+                {
+                    payload = LWM2M_SIM_SENSOR_LINKS;
+                    format = LWM2M_CONTENT_LINK;
+                    code = COAP_205_CONTENT;
+                }
+            }
+            else if( path == "/3303/0/5700" )
+            {
+                payload = std::to_string( p_cli->value ) + ".5";
+                code = COAP_205_CONTENT;
+            }
+            else if( path == "/3303/0/5701" )
+            {
+                payload = "Cel";
+                code = COAP_205_CONTENT;
+            }
+
+            if( (code == COAP_205_CONTENT) &&
+                IS_OPTION( &msg, COAP_OPTION_OBSERVE ) )
+            {
+                if( msg.observe == 0 )
+                {
+                    s_observe_t& obs = p_cli->obs[path];
+                    memcpy( obs.token, msg.token, msg.token_len );
+                    obs.tokenLen = msg.token_len;
+                    obs.seq = 1;
+                    observe = true;
+                }
+                else
+                    p_cli->obs.erase( path );
+            }
+            break;
+
+        case COAP_PUT:
+        case COAP_POST:
+            if( path.compare( 0, 8, "/3303/0/" ) == 0 )
+            {
+                if( (msg.payload_len > 0) && (path == "/3303/0/5700") )
+                    p_cli->value = atoi( std::string( (char*)msg.payload,
+                            msg.payload_len ).c_str() );
+                code = COAP_204_CHANGED;
+            }
+            break;
+
+        case COAP_DELETE:
+            code = COAP_202_DELETED;
+            break;
+
+        default:
+            code = COAP_405_METHOD_NOT_ALLOWED;
+            break;
+    }
+
+    coap_init_message( &rsp, (msg.type == COAP_TYPE_CON) ? COAP_TYPE_ACK :
+            COAP_TYPE_NON, code, msg.mid );
+    coap_set_header_token( &rsp, msg.token, msg.token_len );
+    if( observe )
+        coap_set_header_observe( &rsp, 0 );
+    if( !payload.empty() )
+    {
+        coap_set_header_content_type( &rsp, format );
+        coap_set_payload( &rsp, payload.c_str(), payload.size() );
+    }
+    send( p_cli, &rsp );
+
+    coap_free_header( &rsp );
+    coap_free_header( &msg );
+
+} /* LWM2MClientSim::handle() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::sendRegistration()
+*/
+void LWM2MClientSim::sendRegistration( s_client_t* p_cli, uint64_t now )
+{
+    coap_packet_t msg;
+    std::string query = "?ep=" + p_cli->name + "&lt=" +
+            std::to_string( LWM2M_SIM_LIFETIME ) + "&b=U";
+
+    p_cli->regID = p_cli->mID++;
+    p_cli->regTime = now;
+    p_cli->regTries++;
+    p_cli->location.clear();
+
+    coap_init_message( &msg, COAP_TYPE_CON, COAP_POST, p_cli->regID );
+    coap_set_header_uri_path( &msg, "/rd" );
+    coap_set_header_uri_query( &msg, query.c_str() );
+    coap_set_header_content_type( &msg, LWM2M_CONTENT_LINK );
+    coap_set_payload( &msg, LWM2M_SIM_OBJECTS, strlen( LWM2M_SIM_OBJECTS ) );
+    send( p_cli, &msg );
+    coap_free_header( &msg );
+
+} /* LWM2MClientSim::sendRegistration() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::send()
+*/
+int8_t LWM2MClientSim::send( s_client_t* p_cli, void* p_msg )
+{
+    uint8_t buf[LWM2M_SIM_BUF_SIZE];
+    size_t len;
+
+    if( coap_serialize_get_size( p_msg ) > sizeof(buf) )
+        return -1;
+
+    len = coap_serialize_message( p_msg, buf );
+    if( len == 0 )
+        return -1;
+
+    if( sendto( p_cli->sock, buf, len, 0, (struct sockaddr*)m_addr.data(),
+            m_addr.size() ) != (ssize_t)len )
+        return -1;
+
+    m_stats.tx++;
+    return 0;
+
+} /* LWM2MClientSim::send() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::timeMs()
+*/
+uint64_t LWM2MClientSim::timeMs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+} /* LWM2MClientSim::timeMs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* LWM2MClientSim::threadEntryFunc()
+*/
+void* LWM2MClientSim::threadEntryFunc( void* p_arg )
+{
+    ((LWM2MClientSim*)p_arg)->run( 10 );
+    return NULL;
+
+} /* LWM2MClientSim::threadEntryFunc() */
+
@@ -0,0 +1,328 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MClientSim.h
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Simulation of a fleet of LWM2M clients.
+ *
+ *          Every simulated client uses its own UDP socket so that the
+ *          server sees it as a separate peer. The clients register
+ *          a temperature sensor and answer reads, writes, discovers
+ *          and observations of the server. Notifications are sent on
+ *          demand.
+ */
+
+#ifndef __LWM2MCLIENTSIM_H__
+#define __LWM2MCLIENTSIM_H__
+#ifndef __DECL_LWM2MCLIENTSIM_H__
+#define __DECL_LWM2MCLIENTSIM_H__ extern
+#endif /* #ifndef __DECL_LWM2MCLIENTSIM_H__ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <pthread.h>
+
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Object of the simulated sensor */
+#define LWM2M_SIM_SENSOR_OBJ                    3303
+/** Value resource of the simulated sensor */
+#define LWM2M_SIM_SENSOR_VALUE                  5700
+/** Unit resource of the simulated sensor */
+#define LWM2M_SIM_SENSOR_UNIT                   5701
+
+/** Lifetime the clients register with in s */
+#define LWM2M_SIM_LIFETIME                      86400
+
+/** Time in ms after which a registration is sent again */
+#define LWM2M_SIM_REG_TIMEOUT                   2000
+
+/** Maximum number of registration attempts */
+#define LWM2M_SIM_REG_RETRIES                   4
+
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * Statistics of the simulation.
+ */
+typedef struct
+{
+    /** Number of registered clients */
+    uint32_t registered;
+    /** Number of messages received from the server */
+    uint64_t rx;
+    /** Number of messages sent to the server */
+    uint64_t tx;
+    /** Number of requests of the server */
+    uint64_t requests;
+    /** Number of notifications sent */
+    uint64_t notifications;
+    /** CPU time in us used by the simulation thread */
+    uint64_t cpuTime;
+
+} s_lwm2m_sim_stats_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   LWM2M client fleet simulator.
+ *
+ *          The simulator handles the messages of its clients in a thread
+ *          of its own. Registrations and notifications can be started
+ *          from any other thread.
+ */
+class LWM2MClientSim
+{
+
+private:
+
+    /**
+     * Observation of the server at a client.
+     */
+    struct s_observe_t
+    {
+        /* token of the observe request */
+        uint8_t token[8];
+        /* length of the token */
+        uint8_t tokenLen;
+        /* sequence number of the next notification */
+        uint32_t seq;
+    };
+
+    /**
+     * Simulated client.
+     */
+    struct s_client_t
+    {
+        /* socket of the client */
+        int sock;
+        /* endpoint name */
+        std::string name;
+        /* location of the registration at the server */
+        std::string location;
+        /* next message ID */
+        uint16_t mID;
+        /* message ID of the registration */
+        uint16_t regID;
+        /* time in ms of the last registration attempt */
+        uint64_t regTime;
+        /* number of registration attempts */
+        uint8_t regTries;
+        /* client is registered */
+        bool registered;
+        /* current sensor value */
+        int32_t value;
+        /* observations by URI path */
+        std::map< std::string, s_observe_t > obs;
+    };
+
+public:
+
+    /**
+     * \brief   Create a simulator.
+     *
+     * \param   host    Address of the server.
+     * \param   port    Port of the server.
+     * \param   clients Number of simulated clients.
+     * \param   prefix  Prefix of the endpoint names.
+     */
+    LWM2MClientSim( const std::string& host, const std::string& port,
+        uint32_t clients, const std::string& prefix );
+
+
+    /**
+     * \brief   Default destructor.
+     */
+    virtual ~LWM2MClientSim( void );
+
+
+    /**
+     * \brief   Open the sockets and start the simulation thread.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t start( void );
+
+
+    /**
+     * \brief   Stop the simulation thread and close the sockets.
+     */
+    void stop( void );
+
+
+    /**
+     * \brief   Register all clients at the server.
+     *
+     *          Registrations without an answer are repeated.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t registerAll( void );
+
+
+    /**
+     * \brief   Deregister all registered clients.
+     */
+    void deregisterAll( void );
+
+
+    /**
+     * \brief   Send notifications for the observations of all clients.
+     *
+     * \param   count   Number of notifications per observation.
+     *
+     * \return  Number of notifications sent.
+     */
+    uint64_t notifyAll( uint32_t count );
+
+
+    /**
+     * \brief   Get the name of a client.
+     *
+     * \param   idx     Index of the client.
+     *
+     * \return  Endpoint name of the client.
+     */
+    std::string getName( uint32_t idx ) const;
+
+
+    /**
+     * \brief   Get the statistics of the simulation.
+     *
+     * \param   p_stats Statistics to fill.
+     */
+    void getStats( s_lwm2m_sim_stats_t* p_stats );
+
+
+private:
+
+    /**
+     * \brief   Handle the messages received by the clients.
+     *
+     * \param   timeout Time in ms to wait for messages.
+     */
+    void run( int timeout );
+
+
+    /**
+     * \brief   Handle a message received by a client.
+     *
+     * \param   p_cli   Client that received the message.
+     * \param   p_buf   Received message.
+     * \param   len     Length of the message.
+     */
+    void handle( s_client_t* p_cli, uint8_t* p_buf, int len );
+
+
+    /**
+     * \brief   Send the registration of a client.
+     *
+     * \param   p_cli   Client to register.
+     * \param   now     Current time in ms.
+     */
+    void sendRegistration( s_client_t* p_cli, uint64_t now );
+
+
+    /**
+     * \brief   Serialize and send a message of a client.
+     *
+     * \param   p_cli   Client to send the message from.
+     * \param   p_msg   CoAP message to send.
+     *
+     * \return  0 on success or negative value on error.
+     */
+    int8_t send( s_client_t* p_cli, void* p_msg );
+
+
+    /**
+     * \brief   Get the current time.
+     *
+     * \return  Monotonic time in ms.
+     */
+    static uint64_t timeMs( void );
+
+
+    /**
+     * \brief   Entry of the simulation thread.
+     */
+    static void* threadEntryFunc( void* p_arg );
+
+
+private:
+
+    /** Address of the server */
+    std::string m_host;
+
+    /** Port of the server */
+    std::string m_port;
+
+    /** Simulated clients */
+    std::vector< s_client_t > m_clients;
+
+    /** Resolved address of the server */
+    std::vector< uint8_t > m_addr;
+
+    /** Statistics of the simulation */
+    s_lwm2m_sim_stats_t m_stats;
+
+    /** Mutex protecting the clients and statistics */
+    pthread_mutex_t m_mutex;
+
+    /** Simulation thread */
+    pthread_t m_thread;
+
+    /** indicate if to run the thread */
+    volatile bool m_threadRun;
+};
+
+#endif /* #ifndef __LWM2MCLIENTSIM_H__ */
+
@@ -0,0 +1,568 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MMicroBenchmark.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Microbenchmarks of the code running per message.
+ *
+ *          The lookups of objects and resources, the handling of
+ *          notifications by the server callbacks, the parsing of
+ *          payloads and the notification of resource observers are
+ *          measured without any network traffic. Every benchmark is
+ *          run for a list of sizes.
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <string>
+#include <vector>
+#include "LWM2MServer.h"
+#include "LWM2MDevice.h"
+#include "LWM2MObject.h"
+#include "LWM2MResource.h"
+#include "LWM2MResourceObserver.h"
+#include "LWM2MValueObserver.h"
+
+#ifndef OPCUA_LWM2M_BENCHMARK
+#error "The micro benchmark requires the test hooks of OPCUA_LWM2M_BENCHMARK"
+#endif /* #ifndef OPCUA_LWM2M_BENCHMARK */
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Default number of operations per measurement */
+#define LWM2M_MICRO_ITERATIONS                  200000
+
+/** Object ID of the first object of a device */
+#define LWM2M_MICRO_OBJ_BASE                    3300
+
+/** Number of precomputed random indices */
+#define LWM2M_MICRO_INDICES                     4096
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   Device the benchmarks can add objects to.
+ */
+class MicroDevice
+    : public LWM2MDevice
+{
+public:
+
+    MicroDevice( const std::string& name, uint16_t id, LWM2MServer* p_srv )
+        : LWM2MDevice( name, id, p_srv ) {};
+    virtual ~MicroDevice( void ) {};
+
+    void add( LWM2MObject* p_obj ) {addObject( p_obj );}
+};
+
+
+/**
+ * \brief   Resource the benchmarks can notify the observers of.
+ */
+class MicroResource
+    : public LWM2MResource
+{
+public:
+
+    MicroResource( uint16_t resId, bool rd, bool wr )
+        : LWM2MResource( resId, rd, wr ) {};
+    virtual ~MicroResource( void ) {};
+
+    void notify( const s_lwm2m_obsparams_t* p_params ) {
+        notifyObservers( p_params );
+    }
+};
+
+
+/**
+ * \brief   Observer counting its notifications.
+ */
+class CountObserver
+    : public LWM2MResourceObserver
+{
+public:
+
+    CountObserver( void ) : m_count( 0 ) {};
+    virtual ~CountObserver( void ) {};
+
+    virtual int8_t notify( const LWM2MServer* p_srv,
+            const LWM2MResource* p_res, const s_lwm2m_obsparams_t* p_params ) {
+        m_count++;
+        return 0;
+    }
+
+    /** Number of notifications */
+    uint64_t m_count;
+};
+
+
+/**
+ * \brief   Value observer counting the decoded values.
+ */
+class CountValueObserver
+    : public LWM2MValueObserver
+{
+public:
+
+    CountValueObserver( void ) : m_count( 0 ) {};
+    virtual ~CountValueObserver( void ) {};
+
+    virtual int8_t notify( const LWM2MResource* p_res,
+            const s_lwm2m_obsparams_t* p_params, const LWM2MValue& val ) {
+        m_count++;
+        return 0;
+    }
+
+    /** Number of values */
+    uint64_t m_count;
+};
+
+
+/*
+ * --- Local Variables ------------------------------------------------------ *
+ */
+
+/** Number of operations per measurement */
+static uint32_t gIterations = LWM2M_MICRO_ITERATIONS;
+
+/** Random indices used to spread the lookups */
+static std::vector< uint32_t > gIndices;
+
+/** Sink of the results to keep the compiler from removing work */
+static volatile uintptr_t gSink;
+
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* timeNs()
+*/
+static uint64_t timeNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+} /* timeNs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* measure()
+*/
+template< typename F >
+static void measure( const char* p_name, const char* p_param, uint32_t size,
+        F op )
+{
+    uint64_t start;
+    uint64_t time;
+    uint32_t i;
+
+    /* warm up caches and allocators */
+    for( i = 0; i < gIterations / 10; i++ )
+        op( gIndices[i % LWM2M_MICRO_INDICES] );
+
+    start = timeNs();
+    for( i = 0; i < gIterations; i++ )
+        op( gIndices[i % LWM2M_MICRO_INDICES] );
+    time = timeNs() - start;
+
+    printf( "%-18s %-12s %8u %12.1f ns/op\n", p_name, p_param, size,
+            (double)time / gIterations );
+
+} /* measure() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* createDevice()
+*/
+static LWM2MDevice* createDevice( LWM2MServer* p_srv, uint16_t id,
+        uint32_t objects, uint32_t resources )
+{
+    MicroDevice* p_dev = new MicroDevice( "micro-" + std::to_string( id ),
+            id, p_srv );
+    uint32_t i;
+    uint32_t j;
+
+    for( i = 0; i < objects; i++ )
+    {
+        LWM2MObject* p_obj = new LWM2MObject( LWM2M_MICRO_OBJ_BASE + i, 0 );
+        for( j = 0; j < resources; j++ )
+            p_obj->addResource( new LWM2MResource( j, true, true, false,
+                    e_lwm2m_value_type_float ) );
+        p_dev->add( p_obj );
+    }
+    return p_dev;
+
+} /* createDevice() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* encodeTlv()
+*/
+static size_t encodeTlv( uint32_t resources, uint8_t** pp_buf )
+{
+    lwm2m_data_t* p_data = lwm2m_data_new( resources );
+    lwm2m_media_type_t format = LWM2M_CONTENT_TLV;
+    lwm2m_uri_t uri;
+    size_t len;
+    uint32_t i;
+
+    for( i = 0; i < resources; i++ )
+    {
+        p_data[i].id = i;
+        lwm2m_data_encode_float( 20.0 + i, &p_data[i] );
+    }
+
+    uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID;
+    uri.objectId = LWM2M_MICRO_OBJ_BASE;
+    uri.instanceId = 0;
+    len = lwm2m_data_serialize( &uri, resources, p_data, &format, pp_buf );
+    lwm2m_data_free( resources, p_data );
+
+    return len;
+
+} /* encodeTlv() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* parseSizes()
+*/
+static std::vector< uint32_t > parseSizes( const char* p_list )
+{
+    std::vector< uint32_t > sizes;
+    char* p_end;
+
+    while( *p_list != '\0' )
+    {
+        uint32_t size = strtoul( p_list, &p_end, 0 );
+        if( p_end == p_list )
+            break;
+        if( size > 0 )
+            sizes.push_back( size );
+        p_list = (*p_end == ',') ? p_end + 1 : p_end;
+    }
+    return sizes;
+
+} /* parseSizes() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* benchLookups()
+*/
+static void benchLookups( LWM2MServer* p_srv,
+        const std::vector< uint32_t >& objects,
+        const std::vector< uint32_t >& resources )
+{
+    std::vector< uint32_t >::const_iterator it;
+
+    for( it = objects.begin(); it != objects.end(); ++it )
+    {
+        uint32_t cnt = *it;
+        LWM2MDevice* p_dev = createDevice( p_srv, 1, cnt, 1 );
+
+        measure( "getObject", "objects", cnt, [&]( uint32_t idx ) {
+            gSink = (uintptr_t)p_dev->getObject(
+                    LWM2M_MICRO_OBJ_BASE + idx % cnt, 0 );
+        } );
+        delete p_dev;
+    }
+
+    for( it = resources.begin(); it != resources.end(); ++it )
+    {
+        uint32_t cnt = *it;
+        LWM2MObject obj( LWM2M_MICRO_OBJ_BASE, 0 );
+        uint32_t i;
+
+        for( i = 0; i < cnt; i++ )
+            obj.addResource( new LWM2MResource( i ) );
+
+        measure( "getResource", "resources", cnt, [&]( uint32_t idx ) {
+            gSink = (uintptr_t)obj.getResource( idx % cnt );
+        } );
+    }
+
+} /* benchLookups() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* benchParse()
+*/
+static void benchParse( const std::vector< uint32_t >& resources )
+{
+    std::vector< uint32_t >::const_iterator it;
+    lwm2m_uri_t uri;
+    uint8_t text[] = "23.5";
+
+    uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID |
+            LWM2M_URI_FLAG_RESOURCE_ID;
+    uri.objectId = LWM2M_MICRO_OBJ_BASE;
+    uri.instanceId = 0;
+    uri.resourceId = 0;
+
+    measure( "data_parse", "text", 1, [&]( uint32_t idx ) {
+        lwm2m_data_t* p_data = NULL;
+        int cnt = lwm2m_data_parse( &uri, text, sizeof(text) - 1,
+                LWM2M_CONTENT_TEXT, &p_data );
+        if( cnt > 0 )
+            lwm2m_data_free( cnt, p_data );
+        gSink = cnt;
+    } );
+
+    uri.flag = LWM2M_URI_FLAG_OBJECT_ID | LWM2M_URI_FLAG_INSTANCE_ID;
+    for( it = resources.begin(); it != resources.end(); ++it )
+    {
+        uint8_t* p_buf = NULL;
+        size_t len = encodeTlv( *it, &p_buf );
+
+        measure( "data_parse", "tlv", *it, [&]( uint32_t idx ) {
+            lwm2m_data_t* p_data = NULL;
+            int cnt = lwm2m_data_parse( &uri, p_buf, len,
+                    LWM2M_CONTENT_TLV, &p_data );
+            if( cnt > 0 )
+                lwm2m_data_free( cnt, p_data );
+            gSink = cnt;
+        } );
+        lwm2m_free( p_buf );
+    }
+
+} /* benchParse() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* benchCallbacks()
+*/
+static int8_t benchCallbacks( LWM2MServer* p_srv,
+        const std::vector< uint32_t >& devices, uint32_t objects,
+        uint32_t resources )
+{
+    std::vector< uint32_t >::const_iterator it;
+    CountObserver obs;
+    CountValueObserver valObs;
+    uint8_t text[] = "23.5";
+    int8_t ret = 0;
+    uint8_t* p_tlv = NULL;
+    size_t tlvLen = encodeTlv( resources, &p_tlv );
+
+    for( it = devices.begin(); it != devices.end(); ++it )
+    {
+        std::vector< LWM2MDevice* > devs;
+        std::vector< LWM2MResource* > res;
+        std::vector< LWM2MObject* > objs;
+        uint32_t cnt = *it;
+        uint32_t i;
+
+        /* every device observes the last resource and object */
+        for( i = 0; i < cnt; i++ )
+        {
+            LWM2MDevice* p_dev = createDevice( p_srv, i + 1, objects,
+                    resources );
+            LWM2MObject* p_obj = p_dev->getObject(
+                    LWM2M_MICRO_OBJ_BASE + objects - 1, 0 );
+            std::vector< LWM2MResource* >::const_iterator r;
+
+            for( r = p_obj->resourceStart(); r != p_obj->resourceEnd(); ++r )
+                (*r)->registerObserver( &obs );
+
+            p_srv->addTestDevice( p_dev );
+            res.push_back( p_obj->getResource( resources - 1 ) );
+            objs.push_back( p_obj );
+            devs.push_back( p_dev );
+        }
+
+        /* the status of a notification is its counter */
+        measure( "notifyResCb", "devices", cnt, [&]( uint32_t idx ) {
+            p_srv->injectNotification( res[idx % cnt], 5, LWM2M_CONTENT_TEXT,
+                    text, sizeof(text) - 1 );
+        } );
+
+        measure( "notifyObjCb", "devices", cnt, [&]( uint32_t idx ) {
+            p_srv->injectNotification( objs[idx % cnt], 5, LWM2M_CONTENT_TLV,
+                    p_tlv, tlvLen );
+        } );
+
+        /* the values of notifications are decoded for value observers */
+        for( i = 0; i < cnt; i++ )
+            res[i]->registerObserver( &valObs );
+
+        valObs.m_count = 0;
+        measure( "notifyValue", "devices", cnt, [&]( uint32_t idx ) {
+            p_srv->injectNotification( res[idx % cnt], 5, LWM2M_CONTENT_TEXT,
+                    text, sizeof(text) - 1 );
+        } );
+
+        if( valObs.m_count < gIterations )
+        {
+            fprintf( stderr, "value observers missed %llu notifications\n",
+                    (unsigned long long)(gIterations - valObs.m_count) );
+            ret = -1;
+        }
+
+        for( i = 0; i < devs.size(); i++ )
+        {
+            p_srv->removeTestDevice( devs[i] );
+            delete devs[i];
+        }
+    }
+    lwm2m_free( p_tlv );
+
+    return ret;
+
+} /* benchCallbacks() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* benchFanout()
+*/
+static void benchFanout( const std::vector< uint32_t >& observers )
+{
+    std::vector< uint32_t >::const_iterator it;
+    s_lwm2m_obsparams_t params;
+    lwm2m_data_t* p_data = lwm2m_data_new( 1 );
+
+    lwm2m_data_encode_float( 23.5, p_data );
+    memset( &params, 0, sizeof(params) );
+    params.status = COAP_205_CONTENT;
+    params.data = p_data;
+    params.dataLen = 1;
+
+    for( it = observers.begin(); it != observers.end(); ++it )
+    {
+        std::vector< CountObserver > obs( *it );
+        MicroResource res( 0, true, true );
+        uint32_t i;
+
+        for( i = 0; i < obs.size(); i++ )
+            res.registerObserver( &obs[i] );
+
+        measure( "notifyObservers", "observers", *it, [&]( uint32_t idx ) {
+            res.notify( &params );
+        } );
+    }
+    lwm2m_data_free( 1, p_data );
+
+} /* benchFanout() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* usage()
+*/
+static void usage( const char* p_name )
+{
+    printf( "usage: %s [-i iterations] [-d devices] [-o objects] "
+            "[-r resources] [-b observers]\n", p_name );
+    printf( "  sizes are given as comma separated lists, the first size of\n"
+            "  objects and resources is used for the callbacks\n" );
+
+} /* usage() */
+
+
+/*
+ * --- Main ----------------------------------------------------------------- *
+ */
+int main( int argc, char **argv )
+{
+    std::vector< uint32_t > devices = parseSizes( "1,100,1000,10000" );
+    std::vector< uint32_t > objects = parseSizes( "1,8,64,256" );
+    std::vector< uint32_t > resources = parseSizes( "1,8,64,256" );
+    std::vector< uint32_t > observers = parseSizes( "1,8,64" );
+    LWM2MServer* p_srv = LWM2MServer::instance();
+    uint32_t i;
+    int ret = 0;
+    int opt;
+
+    while( (opt = getopt( argc, argv, "i:d:o:r:b:h" )) != -1 )
+    {
+        switch( opt )
+        {
+            case 'i': gIterations = strtoul( optarg, NULL, 0 ); break;
+            case 'd': devices = parseSizes( optarg ); break;
+            case 'o': objects = parseSizes( optarg ); break;
+            case 'r': resources = parseSizes( optarg ); break;
+            case 'b': observers = parseSizes( optarg ); break;
+            default: usage( argv[0] ); return 1;
+        }
+    }
+
+    if( (gIterations == 0) || devices.empty() || objects.empty() ||
+        resources.empty() || observers.empty() )
+    {
+        usage( argv[0] );
+        return 1;
+    }
+
+    /* the same random sequence for every run */
+    srand( 1 );
+    for( i = 0; i < LWM2M_MICRO_INDICES; i++ )
+        gIndices.push_back( (uint32_t)rand() );
+
+    printf( "%-18s %-12s %8s %12s\n", "benchmark", "parameter", "size",
+            "time" );
+    benchLookups( p_srv, objects, resources );
+    benchParse( resources );
+    if( benchCallbacks( p_srv, devices, objects.front(),
+            resources.front() ) != 0 )
+        ret = 1;
+    benchFanout( observers );
+
+    return ret;
+}
+
@@ -0,0 +1,844 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MReplay.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Replay of a captured traffic of the LWM2M server.
+ *
+ *          The datagrams received by a server in a capture are sent
+ *          to a new server at their original or an accelerated speed.
+ *          Every peer of the capture gets a socket of its own. Message
+ *          IDs and tokens of the answers are mapped to the requests of
+ *          the new server and the registration locations to the ones
+ *          the new server assigned.
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LWM2MServer.h"
+#include "LWM2MCapture.h"
+
+extern "C"
+{
+#include "er-coap-13/er-coap-13.h"
+}
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Time in ms without progress that ends the replay of deferred answers */
+#define LWM2M_REPLAY_IDLE_TIMEOUT               2000
+
+/** Maximum size of a datagram */
+#define LWM2M_REPLAY_MAX_PACKET                 1500
+
+/** CoAP option of the location path */
+#define LWM2M_REPLAY_OPT_LOCATION_PATH          8
+
+/** CoAP option of the URI path */
+#define LWM2M_REPLAY_OPT_URI_PATH               11
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * CoAP message split into its fields.
+ */
+typedef struct
+{
+    /* message type */
+    uint8_t type;
+    /* request method or response code */
+    uint8_t code;
+    /* message ID */
+    uint16_t mID;
+    /* token */
+    std::vector< uint8_t > token;
+    /* options by number in the order of the message */
+    std::vector< std::pair< uint16_t, std::vector< uint8_t > > > opts;
+    /* payload */
+    std::vector< uint8_t > payload;
+
+} s_replay_msg_t;
+
+
+/**
+ * Request of the captured server that the new server is expected to send.
+ */
+typedef struct
+{
+    /* request method */
+    uint8_t code;
+    /* URI path */
+    std::string path;
+    /* message ID in the capture */
+    uint16_t mID;
+    /* token in the capture */
+    std::vector< uint8_t > token;
+
+} s_replay_expect_t;
+
+
+/**
+ * Peer of the capture.
+ */
+typedef struct
+{
+    /* socket of the peer */
+    int sock;
+    /* requests of the captured server not sent by the new server yet */
+    std::deque< s_replay_expect_t > expect;
+    /* message IDs of the capture mapped to the ones of the new server */
+    std::map< uint16_t, uint16_t > mIDs;
+    /* tokens of the capture mapped to the ones of the new server */
+    std::map< std::vector< uint8_t >, std::vector< uint8_t > > tokens;
+    /* registration location assigned by the new server */
+    std::vector< std::vector< uint8_t > > location;
+    /* answers waiting for the request of the new server */
+    std::deque< size_t > deferred;
+
+} s_replay_peer_t;
+
+
+/**
+ * Statistics of a replay.
+ */
+typedef struct
+{
+    /* datagrams sent to the server */
+    uint64_t sent;
+    /* answers that had to wait for the request of the new server */
+    uint64_t deferred;
+    /* answers dropped because the new server did not send the request */
+    uint64_t dropped;
+    /* requests of the new server found in the capture */
+    uint64_t matched;
+    /* requests of the new server not found in the capture */
+    uint64_t unmatched;
+    /* datagrams received from the server */
+    uint64_t received;
+
+} s_replay_stats_t;
+
+
+/*
+ * --- Local Variables ------------------------------------------------------ *
+ */
+
+/** Replay is running */
+static std::atomic< bool > gRunning( false );
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* timeUs()
+*/
+static uint64_t timeUs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+} /* timeUs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* cpuUs()
+*/
+static uint64_t cpuUs( void )
+{
+    struct rusage usage;
+
+    if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        return 0;
+
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+            1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+
+} /* cpuUs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* parseMsg()
+*/
+static bool parseMsg( const uint8_t* p_buf, size_t len, s_replay_msg_t* p_msg )
+{
+    size_t pos;
+    uint16_t num = 0;
+    uint8_t tkl;
+
+    if( (len < 4) || ((p_buf[0] >> 6) != 1) )
+        return false;
+
+    p_msg->type = (p_buf[0] >> 4) & 0x03;
+    p_msg->code = p_buf[1];
+    p_msg->mID = ((uint16_t)p_buf[2] << 8) | p_buf[3];
+    tkl = p_buf[0] & 0x0F;
+    if( (tkl > 8) || (len < 4u + tkl) )
+        return false;
+
+    p_msg->token.assign( p_buf + 4, p_buf + 4 + tkl );
+    p_msg->opts.clear();
+    p_msg->payload.clear();
+
+    /* options are encoded as delta to the previous number and length */
+    for( pos = 4 + tkl; pos < len; )
+    {
+        uint32_t delta = p_buf[pos] >> 4;
+        uint32_t optLen = p_buf[pos] & 0x0F;
+
+        if( p_buf[pos] == 0xFF )
+        {
+            p_msg->payload.assign( p_buf + pos + 1, p_buf + len );
+            break;
+        }
+        pos++;
+
+        if( delta == 13 )
+        {
+            if( pos + 1 > len )
+                return false;
+            delta = 13 + p_buf[pos];
+            pos += 1;
+        }
+        else if( delta == 14 )
+        {
+            if( pos + 2 > len )
+                return false;
+            delta = 269 + (((uint32_t)p_buf[pos] << 8) | p_buf[pos + 1]);
+            pos += 2;
+        }
+        else if( delta == 15 )
+            return false;
+
+        if( optLen == 13 )
+        {
+            if( pos + 1 > len )
+                return false;
+            optLen = 13 + p_buf[pos];
+            pos += 1;
+        }
+        else if( optLen == 14 )
+        {
+            if( pos + 2 > len )
+                return false;
+            optLen = 269 + (((uint32_t)p_buf[pos] << 8) | p_buf[pos + 1]);
+            pos += 2;
+        }
+        else if( optLen == 15 )
+            return false;
+
+        if( pos + optLen > len )
+            return false;
+
+        num += delta;
+        p_msg->opts.push_back( std::make_pair( num,
+                std::vector< uint8_t >( p_buf + pos, p_buf + pos + optLen ) ) );
+        pos += optLen;
+    }
+    return true;
+
+} /* parseMsg() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* writeOptField()
+*/
+static void writeOptField( uint32_t val, uint8_t* p_nibble,
+        std::vector< uint8_t >& ext )
+{
+    if( val < 13 )
+        *p_nibble = val;
+    else if( val < 269 )
+    {
+        *p_nibble = 13;
+        ext.push_back( val - 13 );
+    }
+    else
+    {
+        *p_nibble = 14;
+        ext.push_back( (val - 269) >> 8 );
+        ext.push_back( (val - 269) & 0xFF );
+    }
+
+} /* writeOptField() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* buildMsg()
+*/
+static void buildMsg( const s_replay_msg_t* p_msg, std::vector< uint8_t >& buf )
+{
+    uint16_t num = 0;
+    size_t i;
+
+    buf.clear();
+    buf.push_back( 0x40 | (p_msg->type << 4) | p_msg->token.size() );
+    buf.push_back( p_msg->code );
+    buf.push_back( p_msg->mID >> 8 );
+    buf.push_back( p_msg->mID & 0xFF );
+    buf.insert( buf.end(), p_msg->token.begin(), p_msg->token.end() );
+
+    for( i = 0; i < p_msg->opts.size(); i++ )
+    {
+        std::vector< uint8_t > ext;
+        uint8_t delta;
+        uint8_t len;
+
+        writeOptField( p_msg->opts[i].first - num, &delta, ext );
+        writeOptField( p_msg->opts[i].second.size(), &len, ext );
+        buf.push_back( (delta << 4) | len );
+        buf.insert( buf.end(), ext.begin(), ext.end() );
+        buf.insert( buf.end(), p_msg->opts[i].second.begin(),
+                p_msg->opts[i].second.end() );
+        num = p_msg->opts[i].first;
+    }
+
+    if( !p_msg->payload.empty() )
+    {
+        buf.push_back( 0xFF );
+        buf.insert( buf.end(), p_msg->payload.begin(), p_msg->payload.end() );
+    }
+
+} /* buildMsg() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* getPath()
+*/
+static std::string getPath( const s_replay_msg_t* p_msg, uint16_t opt )
+{
+    std::string path;
+    size_t i;
+
+    for( i = 0; i < p_msg->opts.size(); i++ )
+    {
+        if( p_msg->opts[i].first != opt )
+            continue;
+
+        path += "/";
+        path.append( p_msg->opts[i].second.begin(),
+                p_msg->opts[i].second.end() );
+    }
+    return path;
+
+} /* getPath() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* isRequest()
+*/
+static bool isRequest( const s_replay_msg_t* p_msg )
+{
+    return (p_msg->code >= 1) && (p_msg->code < 32);
+
+} /* isRequest() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* mapAnswer()
+*/
+static bool mapAnswer( s_replay_peer_t* p_peer, s_replay_msg_t* p_msg )
+{
+    std::map< uint16_t, uint16_t >::const_iterator mID;
+    std::map< std::vector< uint8_t >,
+        std::vector< uint8_t > >::const_iterator token;
+
+    /* acknowledgements and resets refer to the message ID */
+    if( (p_msg->type == COAP_TYPE_ACK) || (p_msg->type == COAP_TYPE_RST) )
+    {
+        mID = p_peer->mIDs.find( p_msg->mID );
+        if( mID == p_peer->mIDs.end() )
+            return false;
+        p_msg->mID = mID->second;
+    }
+
+    /* responses and notifications refer to the token */
+    if( (p_msg->code >= 64) && !p_msg->token.empty() )
+    {
+        token = p_peer->tokens.find( p_msg->token );
+        if( token == p_peer->tokens.end() )
+            return false;
+        p_msg->token = token->second;
+    }
+    return true;
+
+} /* mapAnswer() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* mapLocation()
+*/
+static void mapLocation( const s_replay_peer_t* p_peer, s_replay_msg_t* p_msg )
+{
+    std::vector< std::pair< uint16_t, std::vector< uint8_t > > > opts;
+    size_t i;
+    size_t seg = 0;
+
+    if( p_peer->location.empty() ||
+        (getPath( p_msg, LWM2M_REPLAY_OPT_URI_PATH ).compare( 0, 4, "/rd/" )
+         != 0) )
+        return;
+
+    /* the segments following the registration path are replaced */
+    for( i = 0; i < p_msg->opts.size(); i++ )
+    {
+        if( p_msg->opts[i].first != LWM2M_REPLAY_OPT_URI_PATH )
+        {
+            opts.push_back( p_msg->opts[i] );
+            continue;
+        }
+
+        if( seg++ > 0 )
+            continue;
+
+        for( size_t l = 0; l < p_peer->location.size(); l++ )
+            opts.push_back( std::make_pair( (uint16_t)LWM2M_REPLAY_OPT_URI_PATH,
+                    p_peer->location[l] ) );
+    }
+    p_msg->opts = opts;
+
+} /* mapLocation() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* sendPacket()
+*/
+static bool sendPacket( const s_lwm2m_capture_packet_t& pkt,
+        s_replay_peer_t* p_peer, const std::vector< uint8_t >& srv,
+        s_replay_stats_t* p_stats )
+{
+    s_replay_msg_t msg;
+    std::vector< uint8_t > buf;
+
+    if( !parseMsg( &pkt.data[0], pkt.data.size(), &msg ) )
+        buf = pkt.data;
+    else
+    {
+        if( isRequest( &msg ) )
+            mapLocation( p_peer, &msg );
+        else if( !mapAnswer( p_peer, &msg ) )
+            return false;
+        buildMsg( &msg, buf );
+    }
+
+    sendto( p_peer->sock, &buf[0], buf.size(), 0,
+            (const struct sockaddr*)&srv[0], srv.size() );
+    p_stats->sent++;
+    return true;
+
+} /* sendPacket() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* receivePacket()
+*/
+static void receivePacket( const std::vector< s_lwm2m_capture_packet_t >& pkts,
+        s_replay_peer_t* p_peer, const std::vector< uint8_t >& srv,
+        s_replay_stats_t* p_stats )
+{
+    uint8_t buf[LWM2M_REPLAY_MAX_PACKET];
+    s_replay_msg_t msg;
+    std::deque< s_replay_expect_t >::iterator it;
+    std::deque< size_t > deferred;
+    std::string path;
+    ssize_t len;
+
+    while( (len = recv( p_peer->sock, buf, sizeof(buf), MSG_DONTWAIT )) > 0 )
+    {
+        p_stats->received++;
+        if( !parseMsg( buf, len, &msg ) )
+            continue;
+
+        /* the location of a registration is used by its updates */
+        if( msg.code == COAP_201_CREATED )
+        {
+            p_peer->location.clear();
+            for( size_t i = 0; i < msg.opts.size(); i++ )
+            {
+                if( msg.opts[i].first == LWM2M_REPLAY_OPT_LOCATION_PATH )
+                    p_peer->location.push_back( msg.opts[i].second );
+            }
+            continue;
+        }
+
+        if( !isRequest( &msg ) )
+            continue;
+
+        /* the request is mapped to the first one of the capture with the
+         * same method and path */
+        path = getPath( &msg, LWM2M_REPLAY_OPT_URI_PATH );
+        for( it = p_peer->expect.begin(); it != p_peer->expect.end(); ++it )
+        {
+            if( (it->code == msg.code) && (it->path == path) )
+                break;
+        }
+
+        if( it == p_peer->expect.end() )
+        {
+            p_stats->unmatched++;
+            continue;
+        }
+
+        p_peer->mIDs[it->mID] = msg.mID;
+        if( !it->token.empty() )
+            p_peer->tokens[it->token] = msg.token;
+        p_peer->expect.erase( it );
+        p_stats->matched++;
+
+        /* answers waiting for the request can be sent now */
+        deferred.swap( p_peer->deferred );
+        while( !deferred.empty() )
+        {
+            if( !sendPacket( pkts[deferred.front()], p_peer, srv, p_stats ) )
+                p_peer->deferred.push_back( deferred.front() );
+            deferred.pop_front();
+        }
+    }
+
+} /* receivePacket() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* replay()
+*/
+static void replay( const std::vector< s_lwm2m_capture_packet_t >* p_pkts,
+        std::vector< s_replay_peer_t >* p_peers,
+        const std::vector< size_t >* p_peerIdx,
+        const std::vector< uint8_t >* p_srv, double speed,
+        s_replay_stats_t* p_stats )
+{
+    std::vector< struct pollfd > fds( p_peers->size() );
+    uint64_t start = timeUs();
+    uint64_t last = start;
+    size_t idx = 0;
+    size_t pending;
+    size_t i;
+
+    for( i = 0; i < p_peers->size(); i++ )
+    {
+        fds[i].fd = (*p_peers)[i].sock;
+        fds[i].events = POLLIN;
+    }
+
+    while( true )
+    {
+        /* send the received datagrams that are due */
+        while( (idx < p_pkts->size()) && ((speed <= 0) ||
+               ((timeUs() - start) * speed >= (*p_pkts)[idx].time)) )
+        {
+            const s_lwm2m_capture_packet_t& pkt = (*p_pkts)[idx];
+            s_replay_peer_t* p_peer = &(*p_peers)[(*p_peerIdx)[idx]];
+
+            if( (pkt.dir == e_lwm2m_capture_in) &&
+                !sendPacket( pkt, p_peer, *p_srv, p_stats ) )
+            {
+                p_peer->deferred.push_back( idx );
+                p_stats->deferred++;
+            }
+            idx++;
+            last = timeUs();
+
+            /* keep up with the answers while sending as fast as possible */
+            if( (speed <= 0) && ((idx % 64) == 0) )
+                break;
+        }
+
+        if( poll( &fds[0], fds.size(), 1 ) > 0 )
+        {
+            for( i = 0; i < fds.size(); i++ )
+            {
+                if( fds[i].revents & POLLIN )
+                {
+                    receivePacket( *p_pkts, &(*p_peers)[i], *p_srv, p_stats );
+                    last = timeUs();
+                }
+            }
+        }
+
+        if( idx < p_pkts->size() )
+            continue;
+
+        /* wait for the requests of the deferred answers */
+        pending = 0;
+        for( i = 0; i < p_peers->size(); i++ )
+            pending += (*p_peers)[i].deferred.size();
+
+        if( (pending == 0) ||
+            (timeUs() - last > LWM2M_REPLAY_IDLE_TIMEOUT * 1000ULL) )
+        {
+            p_stats->dropped = pending;
+            break;
+        }
+    }
+
+    gRunning = false;
+
+} /* replay() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* usage()
+*/
+static void usage( const char* p_name )
+{
+    printf( "usage: %s [-s speed] [-S obj/res] [-p port] capture\n",
+            p_name );
+    printf( "  -s  speed relative to the capture, 0 as fast as possible (1)\n" );
+    printf( "  -S  resource observed on every device, may be repeated\n" );
+    printf( "  -p  port of the server (%s)\n", LWM2M_STANDARD_PORT_STR );
+
+} /* usage() */
+
+
+/*
+ * --- Main ----------------------------------------------------------------- *
+ */
+int main( int argc, char **argv )
+{
+    std::vector< s_lwm2m_capture_packet_t > pkts;
+    std::vector< s_replay_peer_t > peers;
+    std::vector< size_t > peerIdx;
+    std::map< std::string, size_t > peerMap;
+    std::vector< s_lwm2m_subscription_t > subs;
+    std::string port = LWM2M_STANDARD_PORT_STR;
+    std::vector< uint8_t > srv;
+    s_lwm2m_subscription_t sub;
+    s_lwm2m_metrics_t metrics;
+    s_replay_stats_t stats;
+    s_replay_msg_t msg;
+    struct addrinfo hints;
+    struct addrinfo* p_res = NULL;
+    struct rlimit lim;
+    double speed = 1.0;
+    uint64_t start;
+    uint64_t time;
+    uint64_t cpu;
+    size_t i;
+    int opt;
+
+    while( (opt = getopt( argc, argv, "s:S:p:h" )) != -1 )
+    {
+        switch( opt )
+        {
+            case 's': speed = strtod( optarg, NULL ); break;
+            case 'S':
+                sub.instId = LWM2M_SUBSCRIPTION_ALL_INSTANCES;
+                if( sscanf( optarg, "%hu/%hu", &sub.objId, &sub.resId ) != 2 )
+                {
+                    usage( argv[0] );
+                    return 1;
+                }
+                subs.push_back( sub );
+                break;
+            case 'p': port = optarg; break;
+            default: usage( argv[0] ); return 1;
+        }
+    }
+    if( optind >= argc )
+    {
+        usage( argv[0] );
+        return 1;
+    }
+
+    if( LWM2MCapture::load( argv[optind], pkts ) < 0 )
+    {
+        fprintf( stderr, "capture %s could not be read\n", argv[optind] );
+        return 1;
+    }
+    if( pkts.empty() )
+    {
+        fprintf( stderr, "capture %s is empty\n", argv[optind] );
+        return 1;
+    }
+
+    /* every peer needs a socket */
+    if( getrlimit( RLIMIT_NOFILE, &lim ) == 0 )
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit( RLIMIT_NOFILE, &lim );
+    }
+
+    memset( &hints, 0, sizeof(hints) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if( getaddrinfo( "::1", port.c_str(), &hints, &p_res ) != 0 )
+        return 1;
+    srv.assign( (uint8_t*)p_res->ai_addr,
+            (uint8_t*)p_res->ai_addr + p_res->ai_addrlen );
+
+    /* the peers are told apart by their address, the requests of the
+     * captured server are expected from the new server */
+    for( i = 0; i < pkts.size(); i++ )
+    {
+        std::string key( (const char*)&pkts[i].addr, pkts[i].addrLen );
+        std::map< std::string, size_t >::iterator it = peerMap.find( key );
+
+        if( it == peerMap.end() )
+        {
+            s_replay_peer_t peer;
+
+            peer.sock = socket( p_res->ai_family, SOCK_DGRAM, 0 );
+            if( peer.sock < 0 )
+            {
+                fprintf( stderr, "socket of peer %u could not be created\n",
+                        (unsigned)peers.size() );
+                return 1;
+            }
+            it = peerMap.insert( std::make_pair( key, peers.size() ) ).first;
+            peers.push_back( peer );
+        }
+        peerIdx.push_back( it->second );
+
+        if( (pkts[i].dir == e_lwm2m_capture_out) &&
+            !(pkts[i].flags & LWM2M_CAPTURE_FLAG_RETRANS) &&
+            parseMsg( &pkts[i].data[0], pkts[i].data.size(), &msg ) &&
+            isRequest( &msg ) )
+        {
+            s_replay_expect_t exp;
+
+            exp.code = msg.code;
+            exp.path = getPath( &msg, LWM2M_REPLAY_OPT_URI_PATH );
+            exp.mID = msg.mID;
+            exp.token = msg.token;
+            peers[it->second].expect.push_back( exp );
+        }
+    }
+    freeaddrinfo( p_res );
+
+    LWM2MServer* p_srv = LWM2MServer::instance();
+    if( p_srv->startServer() != 0 )
+    {
+        fprintf( stderr, "server could not be started\n" );
+        return 1;
+    }
+    for( i = 0; i < subs.size(); i++ )
+        p_srv->addSubscription( &subs[i] );
+
+    printf( "%u datagrams of %u peers over %.1f s, speed %.1f\n\n",
+            (unsigned)pkts.size(), (unsigned)peers.size(),
+            pkts.back().time / 1000000.0, speed );
+
+    /* the server runs in this thread, the peers in their own */
+    memset( &stats, 0, sizeof(stats) );
+    p_srv->resetMetrics();
+    start = timeUs();
+    cpu = cpuUs();
+    gRunning = true;
+    std::thread peerThread( replay, &pkts, &peers, &peerIdx, &srv, speed,
+            &stats );
+
+    while( gRunning )
+    {
+#ifndef OPCUA_LWM2M_SERVER_USE_THREAD
+        p_srv->runServer();
+#else
+        usleep( 1000 );
+#endif /* #ifndef OPCUA_LWM2M_SERVER_USE_THREAD */
+    }
+    peerThread.join();
+
+    time = timeUs() - start;
+    cpu = cpuUs() - cpu;
+    p_srv->getMetrics( &metrics );
+
+    printf( "%-14s %10.1f ms (%.1f ms captured)\n", "duration",
+            time / 1000.0, pkts.back().time / 1000.0 );
+    printf( "%-14s %10llu sent, %llu deferred, %llu dropped\n", "datagrams",
+            (unsigned long long)stats.sent,
+            (unsigned long long)stats.deferred,
+            (unsigned long long)stats.dropped );
+    printf( "%-14s %10llu matched, %llu not captured\n", "requests",
+            (unsigned long long)stats.matched,
+            (unsigned long long)stats.unmatched );
+    printf( "%-14s %10llu registrations, %llu updates, %llu notifications\n",
+            "server",
+            (unsigned long long)metrics.counters[e_lwm2m_metric_registrations],
+            (unsigned long long)metrics.counters[e_lwm2m_metric_updates],
+            (unsigned long long)metrics.counters[e_lwm2m_metric_notifications] );
+    printf( "%-14s p50 %8llu us p99 %8llu us max %8llu us\n", "loop",
+            (unsigned long long)metrics.histograms[e_lwm2m_histogram_loop].p50,
+            (unsigned long long)metrics.histograms[e_lwm2m_histogram_loop].p99,
+            (unsigned long long)metrics.histograms[e_lwm2m_histogram_loop].max );
+    printf( "%-14s %10.2f us CPU/msg (including the peers)\n", "cpu",
+            (stats.sent + stats.received > 0) ?
+            (double)cpu / (stats.sent + stats.received) : 0.0 );
+
+    for( i = 0; i < peers.size(); i++ )
+        close( peers[i].sock );
+    p_srv->stopServer();
+
+    return 0;
+}
+
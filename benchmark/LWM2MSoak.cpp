@@ -0,0 +1,579 @@
+/*
+ * --- License -------------------------------------------------------------- *
+ */
+
+/*
+ * Copyright 2017 NIKI 4.0 project team
+ *
+ * NIKI 4.0 was financed by the Baden-Württemberg Stiftung gGmbH (www.bwstiftung.de).
+ * Project partners are FZI Forschungszentrum Informatik am Karlsruher
+ * Institut für Technologie (www.fzi.de), Hahn-Schickard-Gesellschaft
+ * für angewandte Forschung e.V. (www.hahn-schickard.de) and
+ * Hochschule Offenburg (www.hs-offenburg.de).
+ * This file was developed by the Institute of reliable Embedded Systems
+ * and Communication Electronics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+ * --- Module Description --------------------------------------------------- *
+ */
+
+/**
+ * \file    LWM2MSoak.cpp
+ * \author  Institute of reliable Embedded Systems
+ *          and Communication Electronics
+ * \date    $Date$
+ * \version $Version$
+ *
+ * \brief   Soak test of the registration churn of the LWM2M server.
+ *
+ *          A fleet of simulated clients registers, is discovered and
+ *          observed and deregisters again in cycles. After every cycle
+ *          the resident memory, the heap, the allocations and the
+ *          objects left in the server are sampled. The test fails when
+ *          the memory of the idle server grows from cycle to cycle, when
+ *          the memory per registered device grows or when objects of
+ *          deregistered devices are left behind.
+ */
+
+
+/*
+ * --- Includes ------------------------------------------------------------- *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <new>
+#include <vector>
+#include "LWM2MServer.h"
+#include "LWM2MDevice.h"
+#include "LWM2MObject.h"
+#include "LWM2MResource.h"
+#include "LWM2MClock.h"
+#include "LWM2MClientSim.h"
+
+/*
+ * --- Macro Definitions ---------------------------------------------------- *
+ */
+
+/** Default number of simulated clients */
+#define LWM2M_SOAK_CLIENTS                      200
+
+/** Default number of cycles */
+#define LWM2M_SOAK_CYCLES                       50
+
+/** Default number of cycles before the baseline is taken */
+#define LWM2M_SOAK_WARMUP                       3
+
+/** Default growth in bytes per device that fails the test */
+#define LWM2M_SOAK_LIMIT                        16
+
+/** Default interval of devices with a failing observation */
+#define LWM2M_SOAK_FAIL_EVERY                   10
+
+/** Maximum time in ms to wait for registrations or deregistrations */
+#define LWM2M_SOAK_PHASE_TIMEOUT                30000
+
+/*
+ * --- Type Definitions ----------------------------------------------------- *
+ */
+
+/**
+ * Sample of the memory and of the objects of the server.
+ */
+typedef struct
+{
+    /* resident memory in bytes */
+    uint64_t rss;
+    /* allocated heap in bytes */
+    uint64_t heap;
+    /* live allocations of new */
+    uint64_t allocs;
+    /* gauges of the server */
+    s_lwm2m_metrics_t metrics;
+
+} s_soak_sample_t;
+
+
+/*
+ * --- Class Definition ----------------------------------------------------- *
+ */
+
+/**
+ * \brief   System clock that can skip ahead.
+ *
+ *          Deregistered devices are kept by the server for twice their
+ *          lifetime. Skipping the clock removes them within a cycle while
+ *          timeouts of requests still pass in real time.
+ */
+class SkipClock
+    : public LWM2MSystemClock
+{
+public:
+
+    SkipClock( void ) : m_skip( 0 ) {};
+    virtual ~SkipClock( void ) {};
+
+    virtual time_t seconds( void ) {
+        return LWM2MSystemClock::seconds() + (time_t)(m_skip / 1000);
+    }
+
+    virtual uint64_t milliseconds( void ) {
+        return LWM2MSystemClock::milliseconds() + m_skip;
+    }
+
+    /** Skip the clock ahead by ms */
+    void skip( uint64_t ms ) {m_skip += ms;}
+
+private:
+
+    /** Time in ms skipped so far */
+    std::atomic< uint64_t > m_skip;
+};
+
+
+/*
+ * --- Local Variables ------------------------------------------------------ *
+ */
+
+/** Number of allocations by new */
+static std::atomic< uint64_t > gAllocs( 0 );
+
+/** Number of releases by delete */
+static std::atomic< uint64_t > gFrees( 0 );
+
+
+/*
+ * --- Local Functions ------------------------------------------------------ *
+ */
+
+/*---------------------------------------------------------------------------*/
+/*
+* operator new()
+*/
+void* operator new( size_t size )
+{
+    void* p = malloc( (size > 0) ? size : 1 );
+
+    if( p == NULL )
+        throw std::bad_alloc();
+
+    gAllocs++;
+    return p;
+
+} /* operator new() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* operator delete()
+*/
+void operator delete( void* p ) noexcept
+{
+    if( p == NULL )
+        return;
+
+    gFrees++;
+    free( p );
+
+} /* operator delete() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* operator delete()
+*/
+void operator delete( void* p, size_t size ) noexcept
+{
+    (void)size;
+    operator delete( p );
+
+} /* operator delete() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* timeMs()
+*/
+static uint64_t timeMs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+} /* timeMs() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* rssBytes()
+*/
+static uint64_t rssBytes( void )
+{
+    unsigned long size = 0;
+    unsigned long rss = 0;
+    FILE* p_file = fopen( "/proc/self/statm", "r" );
+
+    if( p_file == NULL )
+        return 0;
+
+    if( fscanf( p_file, "%lu %lu", &size, &rss ) != 2 )
+        rss = 0;
+    fclose( p_file );
+
+    return (uint64_t)rss * sysconf( _SC_PAGESIZE );
+
+} /* rssBytes() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* heapBytes()
+*/
+static uint64_t heapBytes( void )
+{
+#if defined(__GLIBC__) && \
+    ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo info = mallinfo();
+    return (uint32_t)info.uordblks + (uint32_t)info.hblkhd;
+#else
+    return 0;
+#endif
+
+} /* heapBytes() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* serve()
+*/
+static void serve( LWM2MServer* p_srv )
+{
+#ifndef OPCUA_LWM2M_SERVER_USE_THREAD
+    /* the soak test runs the server itself */
+    p_srv->runServer();
+#else
+    (void)p_srv;
+    usleep( 1000 );
+#endif /* #ifndef OPCUA_LWM2M_SERVER_USE_THREAD */
+
+} /* serve() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* sample()
+*/
+static void sample( LWM2MServer* p_srv, s_soak_sample_t* p_sample )
+{
+    p_srv->getMetrics( &p_sample->metrics );
+    p_sample->rss = rssBytes();
+    p_sample->heap = heapBytes();
+    p_sample->allocs = gAllocs - gFrees;
+
+} /* sample() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* isIdle()
+*/
+static bool isIdle( const s_soak_sample_t* p_sample )
+{
+    const s_lwm2m_metrics_t* p_m = &p_sample->metrics;
+
+    return (p_m->devices == 0) && (p_m->deletions == 0) &&
+            (p_m->observations == 0) && (p_m->transactions == 0) &&
+            (p_m->queued == 0);
+
+} /* isIdle() */
+
+
+/*---------------------------------------------------------------------------*/
+/*
+* usage()
+*/
+static void usage( const char* p_name )
+{
+    printf( "usage: %s [-c clients] [-n cycles] [-t seconds] [-w warmup] "
+            "[-l bytes] [-f interval] [-N] [-p port]\n", p_name );
+    printf( "  -c  number of simulated clients (%d)\n", LWM2M_SOAK_CLIENTS );
+    printf( "  -n  number of cycles (%d)\n", LWM2M_SOAK_CYCLES );
+    printf( "  -t  maximum duration in s, 0 for no limit (0)\n" );
+    printf( "  -w  cycles before the baseline is taken (%d)\n",
+            LWM2M_SOAK_WARMUP );
+    printf( "  -l  growth in bytes per device that fails the test (%d)\n",
+            LWM2M_SOAK_LIMIT );
+    printf( "  -f  every n-th device also gets a failing observation (%d)\n",
+            LWM2M_SOAK_FAIL_EVERY );
+    printf( "  -N  clients use new ports in every cycle\n" );
+    printf( "  -p  port of the server (%s)\n", LWM2M_STANDARD_PORT_STR );
+
+} /* usage() */
+
+
+/*
+ * --- Main ----------------------------------------------------------------- *
+ */
+int main( int argc, char **argv )
+{
+    uint32_t clients = LWM2M_SOAK_CLIENTS;
+    uint32_t cycles = LWM2M_SOAK_CYCLES;
+    uint32_t duration = 0;
+    uint32_t warmup = LWM2M_SOAK_WARMUP;
+    uint32_t limit = LWM2M_SOAK_LIMIT;
+    uint32_t failEvery = LWM2M_SOAK_FAIL_EVERY;
+    bool newPorts = false;
+    std::string port = LWM2M_STANDARD_PORT_STR;
+    SkipClock clock;
+    s_soak_sample_t base;
+    s_soak_sample_t idle;
+    s_soak_sample_t peak;
+    s_lwm2m_sim_stats_t stats;
+    s_lwm2m_request_config_t reqCfg;
+    struct rlimit lim;
+    double basePerDev = 0;
+    double perDev;
+    double growth;
+    uint32_t residual = 0;
+    uint32_t done = 0;
+    uint32_t observed;
+    uint32_t failed;
+    uint64_t start;
+    uint64_t phase;
+    uint32_t cycle;
+    uint32_t i;
+    int ret = 0;
+    int opt;
+
+    while( (opt = getopt( argc, argv, "c:n:t:w:l:f:Np:h" )) != -1 )
+    {
+        switch( opt )
+        {
+            case 'c': clients = strtoul( optarg, NULL, 0 ); break;
+            case 'n': cycles = strtoul( optarg, NULL, 0 ); break;
+            case 't': duration = strtoul( optarg, NULL, 0 ); break;
+            case 'w': warmup = strtoul( optarg, NULL, 0 ); break;
+            case 'l': limit = strtoul( optarg, NULL, 0 ); break;
+            case 'f': failEvery = strtoul( optarg, NULL, 0 ); break;
+            case 'N': newPorts = true; break;
+            case 'p': port = optarg; break;
+            default: usage( argv[0] ); return 1;
+        }
+    }
+    if( (clients == 0) || (cycles <= warmup) )
+    {
+        usage( argv[0] );
+        return 1;
+    }
+
+    /* every client needs a socket */
+    if( getrlimit( RLIMIT_NOFILE, &lim ) == 0 )
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit( RLIMIT_NOFILE, &lim );
+    }
+
+    LWM2MClock::setClock( &clock );
+
+    LWM2MServer* p_srv = LWM2MServer::instance();
+    if( p_srv->startServer() != 0 )
+    {
+        fprintf( stderr, "server could not be started\n" );
+        LWM2MClock::setClock( NULL );
+        return 1;
+    }
+
+    /* every observation shall reach a client */
+    p_srv->getRequestConfig( &reqCfg );
+    reqCfg.cacheReads = false;
+    p_srv->setRequestConfig( &reqCfg );
+
+    LWM2MClientSim sim( "::1", port, clients, "soak-" );
+    if( sim.start() != 0 )
+    {
+        fprintf( stderr, "clients could not be started\n" );
+        p_srv->stopServer();
+        LWM2MClock::setClock( NULL );
+        return 1;
+    }
+
+    printf( "%u clients, %u cycles, baseline after %u cycles%s\n\n",
+            clients, cycles, warmup, newPorts ? ", new ports" : "" );
+    printf( "%5s %7s %7s %6s %6s %10s %10s %9s %9s %9s\n", "cycle",
+            "devices", "observe", "failed", "conns", "rss KiB", "heap KiB",
+            "allocs", "B/device", "residual" );
+
+    memset( &base, 0, sizeof(base) );
+    start = timeMs();
+    for( cycle = 1; cycle <= cycles; cycle++ )
+    {
+        if( (duration > 0) && (timeMs() - start >= duration * 1000ULL) )
+            break;
+
+        if( newPorts && (cycle > 1) )
+        {
+            /* the server sees the clients as new peers */
+            sim.stop();
+            if( sim.start() != 0 )
+            {
+                fprintf( stderr, "clients could not be restarted\n" );
+                ret = 1;
+                break;
+            }
+        }
+
+        /* registration */
+        sim.registerAll();
+        phase = timeMs();
+        do
+        {
+            serve( p_srv );
+            sim.getStats( &stats );
+        } while( (stats.registered < clients) &&
+                 (timeMs() - phase < LWM2M_SOAK_PHASE_TIMEOUT) );
+
+        /* discover and observe, some observations of objects fail since
+         * the clients do not know them */
+        observed = 0;
+        failed = 0;
+        for( i = 0; i < clients; i++ )
+        {
+            LWM2MDevice* p_dev = p_srv->getLWM2MDevice( sim.getName( i ) );
+            LWM2MObject* p_obj = (p_dev != NULL) ?
+                    p_dev->getObject( LWM2M_SIM_SENSOR_OBJ, 0 ) : NULL;
+            LWM2MResource* p_res;
+
+            if( (p_obj == NULL) || (p_srv->discover( p_obj ) != 0) )
+                continue;
+
+            p_res = p_obj->getResource( LWM2M_SIM_SENSOR_VALUE );
+            if( (p_res != NULL) && (p_srv->observe( p_res, true ) == 0) )
+            {
+                observed++;
+
+                /* every other observation is canceled again */
+                if( (i % 2) != 0 )
+                    p_srv->observe( p_res, false );
+            }
+
+            if( (failEvery > 0) && ((i % failEvery) == 0) &&
+                (p_srv->observe( p_obj, true ) != 0) )
+                failed++;
+        }
+        sim.notifyAll( 1 );
+        for( i = 0; i < 10; i++ )
+            serve( p_srv );
+        sample( p_srv, &peak );
+
+        /* deregistration, the deleted devices are kept for twice their
+         * lifetime */
+        sim.deregisterAll();
+        phase = timeMs();
+        do
+        {
+            serve( p_srv );
+            clock.skip( 2000ULL * LWM2M_SIM_LIFETIME + 1000 );
+            serve( p_srv );
+            sample( p_srv, &idle );
+        } while( (!isIdle( &idle )) &&
+                 (timeMs() - phase < LWM2M_SOAK_PHASE_TIMEOUT) );
+        done++;
+
+        if( !isIdle( &idle ) )
+            residual++;
+
+        /* memory of the registered devices on top of the idle server */
+        perDev = (peak.metrics.devices > 0) ?
+                ((double)peak.heap - (double)idle.heap) /
+                peak.metrics.devices : 0;
+
+        if( cycle == warmup )
+        {
+            base = idle;
+            basePerDev = perDev;
+        }
+
+        printf( "%5u %7u %7u %6u %6u %10llu %10llu %9llu %9.0f %9u\n",
+                cycle, peak.metrics.devices, observed, failed,
+                idle.metrics.connections,
+                (unsigned long long)idle.rss / 1024,
+                (unsigned long long)idle.heap / 1024,
+                (unsigned long long)idle.allocs, perDev,
+                idle.metrics.devices + idle.metrics.deletions +
+                idle.metrics.observations + idle.metrics.transactions +
+                idle.metrics.queued );
+        fflush( stdout );
+    }
+
+    if( done <= warmup )
+    {
+        fprintf( stderr, "not enough cycles for a baseline\n" );
+        ret = 1;
+    }
+    else
+    {
+        /* growth of the idle server per cycle and device */
+        growth = ((double)idle.heap - (double)base.heap) /
+                (done - warmup) / clients;
+
+        printf( "\nidle heap %+.1f B/device/cycle, live allocations %+lld, "
+                "rss %+lld KiB, connections %+d\n", growth,
+                (long long)idle.allocs - (long long)base.allocs,
+                ((long long)idle.rss - (long long)base.rss) / 1024,
+                (int)idle.metrics.connections -
+                (int)base.metrics.connections );
+        printf( "memory per device %.0f B, %.0f B after the warmup\n",
+                perDev, basePerDev );
+
+        if( growth > limit )
+        {
+            printf( "FAIL: the idle server grows by %.1f B per device and "
+                    "cycle\n", growth );
+            ret = 1;
+        }
+        if( perDev > basePerDev + limit )
+        {
+            printf( "FAIL: the memory per device grew by %.0f B\n",
+                    perDev - basePerDev );
+            ret = 1;
+        }
+        if( residual > 0 )
+        {
+            printf( "FAIL: objects were left behind in %u cycles\n",
+                    residual );
+            ret = 1;
+        }
+        if( ret == 0 )
+            printf( "PASS\n" );
+    }
+
+    sim.stop();
+    p_srv->stopServer();
+    LWM2MClock::setClock( NULL );
+
+    return ret;
+}